@@ -4,8 +4,9 @@
 #include <stdint.h>
 
 #include "tree.h"
+#include "node_arena.h"
 
-const size_t MAX_IDR_NUM = 64;
+const size_t IDR_STACK_START_CAP = 64;
 
 // these constants MUST be negative, so they will not collide with real name_index
 enum scope_start {
@@ -18,9 +19,8 @@ typedef struct {
     size_t  address;
 } idr_stack_elem_t;
 
-// TODO: make it reallocating
 typedef struct {
-    idr_stack_elem_t elems[MAX_IDR_NUM];
+    idr_stack_elem_t * elems;
     size_t size;
     size_t capacity;
 } idr_stack_t;
@@ -28,14 +28,13 @@ typedef struct {
 typedef struct {
     FILE * asm_file;
 
-    node_t * nodes;
-    size_t tree_size;
+    node_arena_t arena;
 
     node_t * root;
-    node_t * cur_node;
 
     idr_t * ids;
     unsigned int id_size;
+    interner_t names;
 
     size_t if_counter;
     size_t while_counter;
@@ -49,7 +48,7 @@ typedef struct {
 } be_context_t;
 
 /// @brief initialise context structure and read the tree for further actions
-be_context_t backendInit(size_t nodes_num, const char * asm_file_name, const char * tree_file_name);
+be_context_t backendInit(const char * asm_file_name, const char * tree_file_name);
 
 /// @brief destruct context structure
 void backendDtor(be_context_t * context);
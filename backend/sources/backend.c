@@ -32,7 +32,7 @@ static void quitScope(be_context_t * be, enum scope_start scope);
 
 static void makeSTDfuncs(be_context_t * be);
 
-be_context_t backendInit(size_t nodes_num, const char * asm_file_name, const char * tree_file_name)
+be_context_t backendInit(const char * asm_file_name, const char * tree_file_name)
 {
     assert(asm_file_name);
     assert(tree_file_name);
@@ -46,20 +46,16 @@ be_context_t backendInit(size_t nodes_num, const char * asm_file_name, const cha
         return context; // TODO: need to return error code
     }
 
-    context.nodes = (node_t *)calloc(nodes_num, sizeof(node_t));
-    context.tree_size = nodes_num;
-
-    context.cur_node = context.nodes;
+    context.arena = nodeArenaCtor();
     context.id_size = 0;
 
     readTreeForBackend(&context, tree_file_name);
 
-    context.root = context.nodes;
-
     context.idr_stack = (idr_stack_t *)calloc(1, sizeof(* context.idr_stack));
 
+    context.idr_stack->elems = (idr_stack_elem_t *)calloc(IDR_STACK_START_CAP, sizeof(idr_stack_elem_t));
     context.idr_stack->size = 0;
-    context.idr_stack->capacity = MAX_IDR_NUM; // TODO: make capacity variable
+    context.idr_stack->capacity = IDR_STACK_START_CAP;
 
     return context;
 }
@@ -68,6 +64,11 @@ static void idrStackPush(idr_stack_t * stack, int64_t name_index, size_t address
 {
     assert(stack);
 
+    if (stack->size == stack->capacity){
+        stack->capacity *= 2;
+        stack->elems = (idr_stack_elem_t *)realloc(stack->elems, stack->capacity * sizeof(idr_stack_elem_t));
+    }
+
     stack->elems[stack->size].name_index = name_index;
     stack->elems[stack->size].address = address;
 
@@ -81,29 +82,30 @@ static void readTreeForBackend(be_context_t * be, const char * tree_file_name)
 
     tree_context_t sub_context = {};
 
-    sub_context.cur_node = be->cur_node;
-    sub_context.id_size  = be->id_size;
+    sub_context.arena   = &be->arena;
+    sub_context.id_size = be->id_size;
 
-    readTreeFromIR(&sub_context, tree_file_name);
+    be->root = readTreeFromIR(&sub_context, tree_file_name);
 
-    be->cur_node = sub_context.cur_node;
     be->id_size  = sub_context.id_size;
     be->ids      = sub_context.ids;
+    be->names    = sub_context.names;
 }
 
 void backendDtor(be_context_t * context)
 {
     assert(context);
 
-    free(context->nodes);
+    nodeArenaDtor(&context->arena);
     free(context->ids);
+    internerDtor(&context->names);
 
-    context->nodes    = NULL;
-    context->cur_node = NULL;
-    context->ids      = NULL;
+    context->root = NULL;
+    context->ids  = NULL;
 
     fclose(context->asm_file);
 
+    free(context->idr_stack->elems);
     free(context->idr_stack);
 }
 
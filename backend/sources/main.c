@@ -1,20 +1,27 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <sys/types.h>
 #include <sys/stat.h>
 
 #include "backend.h"
 #include "logger.h"
+#include "tree.h"
 
-const size_t MAX_NODES_NUM = 1024;
+const char * const GRAPHS_FLAG = "--graphs";    //< dumps the read tree to backend_logs
 
 int main(int argc, char ** argv)
 {
     mkdir("backend_logs", 0777);
 
     logStart("backend_logs/log.html", LOG_DEBUG_PLUS, LOG_HTML);
-    logCancelBuffer();
+
+    if (argc > 1 && strcmp(argv[1], GRAPHS_FLAG) == 0){
+        treeGraphDumpsEnable(true);
+        argc--;
+        argv++;
+    }
 
     const char * ir_file_name  = "out.ast";
     const char * asm_file_name = "compiled.asm";
@@ -24,12 +31,11 @@ int main(int argc, char ** argv)
         asm_file_name = argv[2];
     }
 
-    be_context_t backend = backendInit(MAX_NODES_NUM, asm_file_name, ir_file_name);
+    be_context_t backend = backendInit(asm_file_name, ir_file_name);
 
 
     tree_context_t tree_context = {};
 
-    tree_context.cur_node = backend.root;
     tree_context.id_size = backend.id_size;
     tree_context.ids = backend.ids;
 
@@ -39,6 +45,7 @@ int main(int argc, char ** argv)
 
     backendDtor(&backend);
 
+    treeGraphDumpsWait();
     logExit();
 
     return 0;
@@ -4,6 +4,7 @@
 #include <stdint.h>
 
 #include "tree.h"
+#include "node_arena.h"
 #include "x64_emitters.h"
 
 // these constants MUST be negative, so they will not collide with real name_index
@@ -63,9 +64,48 @@ enum IR_type {
     IR_START      = 24,
     IR_EXIT       = 25,
 
-    IR_QUIT_SCOPE = 26
+    IR_QUIT_SCOPE = 26,
+
+    IR_UNIT_CODE  = 27
+};
+
+
+enum unit_symbol_type {
+    UNIT_FUNC      = 0,     //< label of a function declared in the unit
+    UNIT_CALL      = 1,     //< rel32 of a call of the function with the name
+    UNIT_STD_IN    = 2,     //< rel32 of a call of std_in
+    UNIT_STD_OUT   = 3      //< rel32 of a call of std_out
 };
 
+typedef struct {
+    size_t offset;                      //< from the start of the unit code
+    enum unit_symbol_type type;
+
+    char name[NAME_MAX_LENGTH];         //< for functions and calls
+    size_t arg_num;                     //< for functions
+} unit_symbol_t;
+
+/// @brief machine code of a top-level function, only its calls depend on the place of the code in the program
+typedef struct {
+    char * code;
+    size_t size;
+
+    unit_symbol_t * symbols;            //< sorted by offset
+    size_t symbols_num;
+} unit_code_t;
+
+/// @brief frees the code and the struct itself
+void unitCodeDtor(unit_code_t * unit_code);
+
+// a part of the code of the unit from the previous compilation
+typedef struct {
+    const unit_code_t * unit_code;
+    const size_t * symbol_ids;          //< names of the symbols in the id table of this compilation
+
+    size_t begin;
+    size_t end;
+} unit_code_part_t;
+
 
 const size_t MAX_LABEL_NAME_LEN = 64;
 
@@ -78,15 +118,24 @@ typedef struct {
         int64_t imm_val;            //< for push_imm
 
         char label_name[MAX_LABEL_NAME_LEN];    //< for labels
+
+        unit_code_part_t code_part; //< for the code of unchanged functions
     };
 
     size_t name_id;
-    size_t arg_num;                 //< for funcs
+    size_t arg_num;                 //< for funcs and calls (number of the pushed args)
 
     int32_t addr;
 } IR_block_t;
 
-const size_t IR_START_CAP = 1024;
+// name_id of the labels that are not the starts of functions
+const size_t NOT_FUNC_LABEL = SIZE_MAX;
+
+// label_block_idx of the calls of the functions that are not declared in the program
+const size_t NOT_RESOLVED_CALL = SIZE_MAX;
+
+const size_t IR_START_CAP      = 1024;
+const size_t UNIT_IR_START_CAP = 64;
 
 typedef struct {
     IR_block_t * blocks;
@@ -95,9 +144,50 @@ typedef struct {
 
     int32_t std_in_addr;
     int32_t std_out_addr;
+    int32_t std_io_init_addr;
+    int32_t std_io_exit_addr;
 } IR_context_t;
 
+// top-level function, it is lowered to IR by its own worker
 typedef struct {
+    node_t * node;                  //< FUNC_DECL node
+
+    size_t IR_pos;                  //< index of the main IR block the function is placed before
+    name_stack_t name_stack;        //< names visible at the declaration
+
+    size_t global_var_counter;
+    size_t if_counter;
+    size_t while_counter;
+
+    IR_context_t IR;                //< labels and jumps are local to this IR
+
+    const unit_code_t * cached;     //< code from the previous compilation, the function is not lowered then
+    size_t * symbol_ids;
+
+    unit_code_t * code;             //< code of the lowered function if keep_unit_codes, the caller may take it
+} func_unit_t;
+
+const size_t NOT_UNIT_SEGMENT = SIZE_MAX;
+
+// continuous range of IR blocks, it is encoded by one worker into its own buffers
+typedef struct {
+    size_t begin;
+    size_t end;
+
+    size_t unit_index;              //< NOT_UNIT_SEGMENT for the code of the global statements
+
+    size_t base_addr;
+    size_t code_size;
+
+    char * bin_buf;
+    size_t bin_size;
+
+    char * asm_buf;
+    size_t asm_size;
+} IR_segment_t;
+
+typedef struct {
+    node_arena_t arena;
     node_t * root;
 
     FILE * asm_file;
@@ -105,6 +195,7 @@ typedef struct {
 
     idr_t * id_table;
     size_t id_table_size;
+    interner_t names;               //< names of the ids read by backendInit, backendCtor keeps the caller's ones
 
     bool in_function;
     name_stack_t name_stack;
@@ -115,10 +206,34 @@ typedef struct {
     size_t while_counter;
 
     IR_context_t IR;
+
+    size_t workers_num;
+
+    func_unit_t * units;
+    size_t units_num;
+    size_t units_capacity;
+
+    IR_segment_t * segments;
+    size_t segments_num;
+
+    const unit_code_t * const * cached_units;   //< by the order of top-level functions, NULL - lower the function
+    size_t cached_units_num;
+    bool keep_unit_codes;                       //< save the code of every lowered top-level function to its unit
+
+    interner_t symbol_names;                    //< names of the ids, to find the symbols of the cached units
+    size_t * symbol_name_ids;                   //< id in the id table of every name of symbol_names
+
+    bool relocatable;               //< the program is compiled to an object, the linker resolves undeclared functions
+    bool jit;                       //< the program runs in the compiler process, its exit returns to the caller of _start
+
+    FILE * diag_file;               //< errors in the program go here, stderr by default
 } backend_ctx_t;
 
 
-backend_ctx_t backendInit(const char * ast_file_name);
+backend_ctx_t backendInit(const char * ast_file_name, size_t workers_num);
+
+/// @brief context for the tree that is already in memory
+backend_ctx_t backendCtor(node_t * root, const idr_t * ids, size_t ids_num, size_t workers_num);
 
 void backendDestroy(backend_ctx_t * ctx);
 
@@ -0,0 +1,33 @@
+#ifndef IR_INTERPRETER_INCLUDED
+#define IR_INTERPRETER_INCLUDED
+
+#include <stdio.h>
+
+#include "backend_x64.h"
+
+const size_t INTERP_STACK_SIZE    = 1 << 20;    //< in 8 byte slots, as 8 MB stack of the elf
+const size_t INTERP_STACK_RESERVE = 1024;       //< slots for the expressions, the overflow is checked by frames and vars
+
+/// @brief runs the native code of the function on the stack of the interpreter, stack_top is the last pushed arg
+typedef int64_t (* native_call_t)(const void * func, int64_t * stack_top, int64_t * globals);
+
+/// @brief top-level functions become hot after the calls and loop iterations in them, the caller compiles them
+///        and the interpreter calls their native code after that
+typedef struct interp_tiering {
+    size_t hot_threshold;
+    void (* on_hot)(struct interp_tiering * tiering, size_t unit_index);  //< once for every function
+    void * ctx;
+
+    const void ** native_funcs;     //< by unit index, NULL until the function is compiled, read atomically
+    native_call_t call_native;
+} interp_tiering_t;
+
+/// @brief runs the lowered program without generating the code, in and out go to the files
+/// @param tiering NULL - every function is interpreted
+/// @return 0 if the program exited, errors of the program (division by zero, stack overflow) go to ctx->diag_file
+int interpretProgram(backend_ctx_t * ctx, FILE * in_file, FILE * out_file, interp_tiering_t * tiering);
+
+/// @brief same as std_in: the first char is either '-' or a digit, the rest of the line are digits, 0 at the end of the file
+int64_t interpReadNumber(FILE * in_file);
+
+#endif
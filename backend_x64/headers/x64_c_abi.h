@@ -0,0 +1,36 @@
+#ifndef X64_C_ABI_INCLUDED
+#define X64_C_ABI_INCLUDED
+
+#include <stdio.h>
+
+#include "backend_x64.h"
+#include "x64_object.h"
+#include "x64_emitters.h"
+
+const char * const C_ABI_SECTION_PREFIX = ".text.c_abi.";     //< sections of the thunks of the exported functions
+
+const char * const C_ABI_HOOKS_TYPE_NAME = "lang_io_hooks_t";
+
+// hook table the host passes as the first argument of every exported function,
+// the thunk keeps its address in r15 that the compiled code never touches
+const int32_t C_ABI_HOOK_IN_OFFSET   = 0;      //< int64_t (*in)(void * user)
+const int32_t C_ABI_HOOK_OUT_OFFSET  = 8;      //< void (*out)(void * user, int64_t value)
+const int32_t C_ABI_HOOK_USER_OFFSET = 16;     //< void * user
+
+/// @brief puts the lowered program to the object, exported functions are called with SysV ABI through the thunks,
+///        in and out call the hooks; the program must not have global statements
+/// @param export_names functions to export, all top-level functions if export_names_num == 0
+/// @param header_file C header with the hook table and the prototypes of the exported functions, can be NULL
+/// @return 0 if succeeded, errors go to ctx->diag_file
+int compileCLibrary(backend_ctx_t * ctx, x64_object_t * object, const char * const * export_names, size_t export_names_num,
+                    FILE * header_file);
+
+/// @brief std_in that calls the in hook of the table in r15
+/// @return size of the code
+size_t emitHookInStub(emit_ctx_t * ctx);
+
+/// @brief std_out that calls the out hook of the table in r15 with the value pushed by the program
+/// @return size of the code
+size_t emitHookOutStub(emit_ctx_t * ctx);
+
+#endif
@@ -2,6 +2,44 @@
 #define X64_COMPILE_INCLUDED
 
 #include "backend_x64.h"
+#include "x64_object.h"
+
+/// @brief code of the std functions, it is copied to the start of every program
+typedef struct {
+    char * code;
+    size_t code_size;
+
+    int32_t in_addr;            //< addresses of std_in and std_out in the code
+    int32_t out_addr;
+    int32_t init_addr;          //< maps the buffers of in and out, the program starts with it
+    int32_t exit_addr;          //< writes the rest of out and unmaps the buffers
+} std_lib_t;
+
+/// @brief reads code segment of the std lib elf (code == NULL on errors)
+std_lib_t stdLibLoad(const char * std_lib_file_name);
+
+void stdLibFree(std_lib_t * std_lib);
+
+/// @brief writes elf of the lowered program to elf_file, listing goes to asm_file if it is not NULL
+void compileProgram(backend_ctx_t * ctx, const std_lib_t * std_lib, FILE * elf_file, FILE * asm_file);
+
+/// @brief writes std lib and the code of the lowered program without elf header, the program starts at std_lib->code_size
+/// @return size of the code
+size_t compileCode(backend_ctx_t * ctx, const std_lib_t * std_lib, FILE * code_file);
+
+/// @brief writes the code of the top-level function of the segment alone, addresses of its blocks are set from the start
+///        of this code, rel32 of its calls and of std in/out are left to the caller
+/// @return size of the code
+size_t compileFunc(backend_ctx_t * ctx, const IR_segment_t * segment, FILE * code_file);
+
+/// @brief first block of the top-level function of the segment, the segment starts with the jump over it in the program
+size_t segmentFuncLabel(const backend_ctx_t * ctx, const IR_segment_t * segment);
+
+/// @brief puts the code of the lowered program to the object, calls and std in/out are left to the linker
+void compileObject(backend_ctx_t * ctx, x64_object_t * object);
+
+/// @brief true if the program has something besides the function declarations at the top level
+bool hasGlobalStatements(const node_t * root);
 
 void compile(backend_ctx_t * ctx, const char * asm_file_name, const char * elf_file_name, const char * std_lib_file_name);
 
@@ -5,7 +5,7 @@
 
 typedef struct {
     FILE * bin_file;
-    FILE * asm_file;
+    FILE * asm_file;            // NULL if the listing is not needed
 
     bool emitting;
 } emit_ctx_t;
@@ -87,7 +87,7 @@ size_t emit_pop_mem(emit_ctx_t * ctx, int reg, int32_t imm32);
 /*********************************************/
 
 
-/******************** SUB, ADD ********************/
+/******************** SUB, ADD, AND ********************/
 // sub reg64, imm32
 size_t emit_sub_reg_imm32(emit_ctx_t * ctx, int reg, int32_t imm32);
 
@@ -99,6 +99,9 @@ size_t emit_add_reg_imm32(emit_ctx_t * ctx, int reg, int32_t imm32);
 
 // sub reg64, reg64
 size_t emit_add_reg_reg(emit_ctx_t * ctx, int dest, int src);
+
+// and reg64, imm32
+size_t emit_and_reg_imm32(emit_ctx_t * ctx, int reg, int32_t imm32);
 /**************************************************/
 
 
@@ -118,6 +121,9 @@ size_t emit_mov_reg_reg(emit_ctx_t * ctx, int dst, int src);
 // mov QWORD[reg64 + imm32], reg64
 size_t emit_mov_mem_reg(emit_ctx_t * ctx, int dst, int32_t imm32, int src);
 
+// mov reg64, QWORD[reg64 + imm32]
+size_t emit_mov_reg_mem(emit_ctx_t * ctx, int dst, int src, int32_t imm32);
+
 // mov reg64, imm64
 size_t emit_mov_reg_imm(emit_ctx_t * ctx, int reg, int64_t imm64);
 /*********************************************/
@@ -132,6 +138,9 @@ size_t emit_jz_rel32(emit_ctx_t * ctx, int32_t rel32);
 
 // call imm32 (near)
 size_t emit_call_rel32(emit_ctx_t * ctx, int32_t rel32);
+
+// call QWORD[reg64 + imm32]
+size_t emit_call_mem(emit_ctx_t * ctx, int reg, int32_t imm32);
 /***************************************************/
 
 
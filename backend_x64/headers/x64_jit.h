@@ -0,0 +1,30 @@
+#ifndef X64_JIT_INCLUDED
+#define X64_JIT_INCLUDED
+
+#include "backend_x64.h"
+#include "x64_compile.h"
+
+const char * const PERF_MAP_FILE_FORMAT = "/tmp/perf-%d.map";   //< perf takes the names of the jit code from here
+
+const char * const JIT_STD_LIB_SYMBOL = "std_funcs";
+const char * const JIT_MAIN_SYMBOL    = "_start";
+const char * const JIT_ENTRY_SYMBOL   = "jit_entry";
+
+// the program does not keep the registers C wants to be saved, so the entries from C save them
+const int JIT_SAVED_REGS[] = {R_RBX, R_RBP, R_R12, R_R13, R_R14, R_R15};
+const size_t JIT_SAVED_REGS_NUM = sizeof(JIT_SAVED_REGS) / sizeof(JIT_SAVED_REGS[0]);
+
+/// @brief compiles the lowered program to memory and runs it in this process, exit of the program returns here;
+///        names of the functions are written to /tmp/perf-<pid>.map
+/// @return 0 if the program was run
+int runProgram(backend_ctx_t * ctx, const std_lib_t * std_lib);
+
+/// @brief opens /tmp/perf-<pid>.map of this process
+/// @param mode as in fopen, the tiered code appends its functions to the map of the jit
+/// @return NULL if the map cannot be opened
+FILE * openPerfMap(const char * mode);
+
+/// @brief writes "start size name" of one piece of the code to the perf map
+void writePerfMapEntry(FILE * map_file, uintptr_t start, size_t size, const char * name);
+
+#endif
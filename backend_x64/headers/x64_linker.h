@@ -0,0 +1,16 @@
+#ifndef X64_LINKER_INCLUDED
+#define X64_LINKER_INCLUDED
+
+#include "x64_object.h"
+#include "x64_compile.h"
+
+const char * const STD_LIB_SECTION_NAME = ".text.std";
+
+/// @brief std lib as an object: its code in one section with std_in and std_out symbols
+x64_object_t stdLibObject(const std_lib_t * std_lib);
+
+/// @brief writes elf of the objects and the std lib, only the sections reachable from _start are kept
+/// @return 0 if succeeded, undefined and duplicate symbols are reported to diag_file
+int linkObjects(const x64_object_t * objects, size_t objects_num, const std_lib_t * std_lib, FILE * elf_file, FILE * diag_file);
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef X64_OBJECT_INCLUDED
+#define X64_OBJECT_INCLUDED
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "tree.h"
+
+const char * const OBJ_MAIN_SECTION_NAME   = ".text";
+const char * const OBJ_FUNC_SECTION_PREFIX = ".text.";     //< every top-level function gets its own section
+
+const char * const OBJ_ENTRY_SYMBOL   = "_start";
+const char * const OBJ_STD_IN_SYMBOL  = "std_in";
+const char * const OBJ_STD_OUT_SYMBOL = "std_out";
+const char * const OBJ_STD_IO_INIT_SYMBOL = "std_io_init";     //< _start calls it for the buffers of in and out
+const char * const OBJ_STD_IO_EXIT_SYMBOL = "std_io_exit";     //< exit calls it to write the rest of out
+
+const size_t OBJ_MAX_SECTION_NAME_LEN = NAME_MAX_LENGTH + 16;
+
+// section of the undefined symbols
+const size_t OBJ_UNDEF_SECTION = SIZE_MAX;
+
+const size_t OBJ_START_CAP = 16;
+
+enum obj_symbol_bind {
+    OBJ_LOCAL  = 0,
+    OBJ_GLOBAL = 1,
+    OBJ_WEAK   = 2      //< global definition wins over it, the first one is taken if there are only weak ones
+};
+
+typedef struct {
+    char name[NAME_MAX_LENGTH];
+    enum obj_symbol_bind bind;
+    bool is_func;
+
+    size_t section;     //< OBJ_UNDEF_SECTION if the symbol is defined in another object
+    size_t value;       //< offset in the section
+    size_t size;
+} obj_symbol_t;
+
+// rel32 = S + addend - P, it is the only relocation calls need
+typedef struct {
+    size_t offset;      //< of rel32 in the section
+    size_t symbol;
+    int64_t addend;
+} obj_reloc_t;
+
+typedef struct {
+    char name[OBJ_MAX_SECTION_NAME_LEN];
+
+    char * code;
+    size_t size;
+
+    obj_reloc_t * relocs;
+    size_t relocs_num;
+    size_t relocs_capacity;
+} obj_section_t;
+
+/// @brief relocatable code of one program, calls and std in/out are resolved by the linker
+typedef struct {
+    obj_section_t * sections;
+    size_t sections_num;
+    size_t sections_capacity;
+
+    obj_symbol_t * symbols;
+    size_t symbols_num;
+    size_t symbols_capacity;
+} x64_object_t;
+
+x64_object_t objectCtor();
+
+void objectDtor(x64_object_t * object);
+
+/// @brief the code is copied, returns index of the section
+size_t objectAddSection(x64_object_t * object, const char * name, const char * code, size_t size);
+
+/// @brief returns index of the symbol
+size_t objectAddSymbol(x64_object_t * object, const char * name, enum obj_symbol_bind bind, bool is_func,
+                       size_t section, size_t value, size_t size);
+
+void objectAddReloc(x64_object_t * object, size_t section, size_t offset, size_t symbol, int64_t addend);
+
+/// @brief writes ET_REL elf with .text* sections, their .rela.text* and .symtab
+void objectWrite(const x64_object_t * object, FILE * obj_file);
+
+/// @brief reads ET_REL elf, sections == NULL on errors
+x64_object_t objectLoad(const char * obj_file_name);
+
+#endif
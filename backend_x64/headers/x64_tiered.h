@@ -0,0 +1,20 @@
+#ifndef X64_TIERED_INCLUDED
+#define X64_TIERED_INCLUDED
+
+#include "backend_x64.h"
+#include "x64_compile.h"
+
+const size_t TIER_HOT_THRESHOLD    = 1000;         //< calls and loop iterations of a function before it is compiled
+const size_t TIER_CODE_REGION_SIZE = 64 << 20;     //< native code is placed in one region, so rel32 of every call reaches
+
+const char * const TIER_NATIVE_CALL_SYMBOL = "tier_native_call";
+
+/// @brief starts the program in the interpreter, hot top-level functions are compiled on a background thread
+///        together with their callees and the interpreter calls their native code after that;
+///        native in and out call the interpreter, so both read and write through the same buffers of stdin and stdout;
+///        names of the compiled functions are added to /tmp/perf-<pid>.map
+/// @param hot_threshold at least 1, a function with hot_threshold 1 is compiled at its first call
+/// @return 0 if the program exited
+int runTiered(backend_ctx_t * ctx, size_t hot_threshold);
+
+#endif
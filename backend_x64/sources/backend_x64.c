@@ -3,20 +3,41 @@
 #include <assert.h>
 #include <stdint.h>
 #include <stdarg.h>
+#include <string.h>
 
 #include "backend_x64.h"
 #include "logger.h"
 #include "IR_handler.h"
-
-
-const size_t MAX_NODES_NUM = 1024;
+#include "node_stack.h"
+#include "thread_pool.h"
 
 
 static void makeIRrecursive(backend_ctx_t * be, node_t * cur_node);
 
+static void makeIRtopLevel(backend_ctx_t * ctx, node_t * node);
+
 static void IRresolveLabels(backend_ctx_t * ctx);
 
 
+static void IRinit(IR_context_t * IR, size_t capacity);
+
+static void addFuncUnit(backend_ctx_t * ctx, node_t * node);
+
+static size_t countOpers(node_t * node, enum oper op);
+
+static void lowerFuncUnitTask(void * shared, size_t task_index, size_t worker_index);
+
+static void IRlinkUnits(backend_ctx_t * ctx);
+
+static void addSegment(backend_ctx_t * ctx, size_t begin, size_t end, size_t unit_index);
+
+static void lowerCachedUnit(backend_ctx_t * ctx, func_unit_t * unit);
+
+static void internSymbolNames(backend_ctx_t * ctx);
+
+static size_t findIdByName(const backend_ctx_t * ctx, const char * name);
+
+
 static name_addr_t getNameAddr(backend_ctx_t * ctx, size_t var_index);
 
 static void addNewName(backend_ctx_t * ctx, size_t var_index, int64_t addr, bool is_global);
@@ -33,6 +54,8 @@ static void leaveScopeAndFreeVars(backend_ctx_t * ctx, enum scope_start scope);
 
 static IR_block_t * IRnextBlock(backend_ctx_t * ctx, enum IR_type type);
 
+static size_t IRnextBlockIndex(backend_ctx_t * ctx, enum IR_type type);
+
 static size_t IRnewLabel(backend_ctx_t * ctx, const char * fmt, ...);
 
 
@@ -72,37 +95,74 @@ static void translateFuncDecl(backend_ctx_t * ctx, node_t * node);
 
 static void translateCompare(backend_ctx_t * ctx, node_t * node);
 
+static void backendStateInit(backend_ctx_t * ctx, size_t workers_num);
+
 
-backend_ctx_t backendInit(const char * ast_file_name)
+backend_ctx_t backendInit(const char * ast_file_name, size_t workers_num)
 {
     assert(ast_file_name);
 
     backend_ctx_t ctx = {};
-    ctx.root = (node_t *)calloc(MAX_NODES_NUM, sizeof(node_t));
+    ctx.arena = nodeArenaCtor();
 
     tree_context_t tree = {};
-    tree.cur_node = ctx.root;
+    tree.arena = &ctx.arena;
 
     ctx.root = readTreeFromIR(&tree, ast_file_name);
     ctx.id_table_size = tree.id_size;
     ctx.id_table      = tree.ids;
+    ctx.names         = tree.names;
 
-    ctx.name_stack.elems = (name_addr_t *)calloc(NAME_STACK_START_CAP, sizeof(name_addr_t));
-    ctx.name_stack.capacity = NAME_STACK_START_CAP;
-    ctx.name_stack.size     = 0;
+    backendStateInit(&ctx, workers_num);
 
-    ctx.in_function = false;
+    return ctx;
+}
+
+
+// the tree is not owned by the context (its arena stays empty), the ids are copied but not their names
+backend_ctx_t backendCtor(node_t * root, const idr_t * ids, size_t ids_num, size_t workers_num)
+{
+    assert(ids || ids_num == 0);
+
+    backend_ctx_t ctx = {};
+    ctx.arena = nodeArenaCtor();
+
+    ctx.root = root;
+
+    ctx.id_table_size = ids_num;
+    ctx.id_table = (idr_t *)calloc(ids_num + 1, sizeof(idr_t));
+    if (ids_num > 0)
+        memcpy(ctx.id_table, ids, ids_num * sizeof(idr_t));
+
+    backendStateInit(&ctx, workers_num);
 
     return ctx;
 }
 
 
+static void backendStateInit(backend_ctx_t * ctx, size_t workers_num)
+{
+    assert(ctx);
+
+    ctx->name_stack.elems = (name_addr_t *)calloc(NAME_STACK_START_CAP, sizeof(name_addr_t));
+    ctx->name_stack.capacity = NAME_STACK_START_CAP;
+    ctx->name_stack.size     = 0;
+
+    ctx->in_function = false;
+
+    ctx->workers_num = workers_num;
+
+    ctx->diag_file = stderr;
+}
+
+
 void backendDestroy(backend_ctx_t * ctx)
 {
     assert(ctx);
 
     free(ctx->id_table);
-    free(ctx->root);
+    internerDtor(&ctx->names);
+    nodeArenaDtor(&ctx->arena);
 
     ctx->id_table = NULL;
     ctx->root     = NULL;
@@ -112,6 +172,43 @@ void backendDestroy(backend_ctx_t * ctx)
 
     free(ctx->IR.blocks);
     ctx->IR.blocks = NULL;
+
+    for (size_t unit_index = 0; unit_index < ctx->units_num; unit_index++)
+        free(ctx->units[unit_index].name_stack.elems);
+
+    for (size_t unit_index = 0; unit_index < ctx->units_num; unit_index++){
+        free(ctx->units[unit_index].symbol_ids);
+
+        if (ctx->units[unit_index].code != NULL)
+            unitCodeDtor(ctx->units[unit_index].code);
+    }
+
+    free(ctx->units);
+    ctx->units = NULL;
+    ctx->units_num = 0;
+
+    internerDtor(&ctx->symbol_names);
+    free(ctx->symbol_name_ids);
+    ctx->symbol_name_ids = NULL;
+
+    for (size_t segment_index = 0; segment_index < ctx->segments_num; segment_index++){
+        free(ctx->segments[segment_index].bin_buf);
+        free(ctx->segments[segment_index].asm_buf);
+    }
+
+    free(ctx->segments);
+    ctx->segments = NULL;
+    ctx->segments_num = 0;
+}
+
+
+void unitCodeDtor(unit_code_t * unit_code)
+{
+    assert(unit_code);
+
+    free(unit_code->code);
+    free(unit_code->symbols);
+    free(unit_code);
 }
 
 
@@ -238,7 +335,7 @@ static name_addr_t getNameAddr(backend_ctx_t * ctx, size_t var_id)
         }
     }
 
-    fprintf(stderr, "X64 BACKEND: ERROR: variable %s is not declared in this scope!\n",
+    fprintf(ctx->diag_file, "X64 BACKEND: ERROR: variable %s is not declared in this scope!\n",
         ctx->id_table[var_id].name);
 
     name_addr_t zero = {};
@@ -262,6 +359,13 @@ static IR_block_t * IRnextBlock(backend_ctx_t * ctx, enum IR_type type)
 }
 
 
+// NOTE: blocks may be reallocated by the next IRnextBlock, so keep indices instead of pointers
+static size_t IRnextBlockIndex(backend_ctx_t * ctx, enum IR_type type)
+{
+    return (size_t)(IRnextBlock(ctx, type) - ctx->IR.blocks);
+}
+
+
 static size_t IRnewLabel(backend_ctx_t * ctx, const char * fmt, ...)
 {
     IR_block_t * label_block = IRnextBlock(ctx, IR_LABEL);
@@ -273,28 +377,333 @@ static size_t IRnewLabel(backend_ctx_t * ctx, const char * fmt, ...)
 
     va_end(args);
 
+    label_block->name_id = NOT_FUNC_LABEL;
+
     return label_block - ctx->IR.blocks;
 }
 
 
+static void IRinit(IR_context_t * IR, size_t capacity)
+{
+    assert(IR);
+
+    IR->blocks = (IR_block_t *)calloc(capacity, sizeof(*(IR->blocks)));
+    IR->capacity = capacity;
+    IR->size = 0;
+}
+
+
 void makeIR(backend_ctx_t * ctx)
 {
     assert(ctx);
 
-    ctx->IR.blocks = (IR_block_t *)calloc(IR_START_CAP, sizeof(*(ctx->IR.blocks)));
-    ctx->IR.capacity = IR_START_CAP;
-    ctx->IR.size = 0;
+    IRinit(&ctx->IR, IR_START_CAP);
 
     IRnextBlock(ctx, IR_START);
 
-    makeIRrecursive(ctx, ctx->root);
+    makeIRtopLevel(ctx, ctx->root);
 
     IRnextBlock(ctx, IR_EXIT);
 
+    if (ctx->cached_units != NULL)
+        internSymbolNames(ctx);
+
+    // top-level functions do not depend on each other, so they are lowered in parallel
+    parallelFor(ctx->units_num, ctx->workers_num, lowerFuncUnitTask, ctx);
+
+    IRlinkUnits(ctx);
+
     IRresolveLabels(ctx);
 }
 
 
+static void makeIRtopLevel(backend_ctx_t * ctx, node_t * node)
+{
+    assert(ctx);
+
+    // global statements are lowered right here, top-level functions are postponed
+    while (node != NULL && node->type == OPR && node->val.op == SEP){
+        node_t * statement = node->left;
+
+        if (statement != NULL && statement->type == OPR && statement->val.op == FUNC_DECL)
+            addFuncUnit(ctx, statement);
+        else
+            makeIRrecursive(ctx, statement);
+
+        node = node->right;
+    }
+
+    makeIRrecursive(ctx, node);
+}
+
+
+static void addFuncUnit(backend_ctx_t * ctx, node_t * node)
+{
+    assert(ctx);
+    assert(node);
+
+    if (ctx->units_num >= ctx->units_capacity){
+        ctx->units_capacity = (ctx->units_capacity == 0) ? 16 : ctx->units_capacity * 2;
+        ctx->units = (func_unit_t *)realloc(ctx->units, ctx->units_capacity * sizeof(func_unit_t));
+    }
+
+    func_unit_t * unit = ctx->units + ctx->units_num;
+    ctx->units_num++;
+
+    unit->node   = node;
+    unit->IR_pos = ctx->IR.size;
+
+    // function sees only names declared before it
+    unit->name_stack.size     = ctx->name_stack.size;
+    unit->name_stack.capacity = ctx->name_stack.size + NAME_STACK_START_CAP;
+    unit->name_stack.elems    = (name_addr_t *)calloc(unit->name_stack.capacity, sizeof(name_addr_t));
+    memcpy(unit->name_stack.elems, ctx->name_stack.elems, ctx->name_stack.size * sizeof(name_addr_t));
+
+    unit->global_var_counter = ctx->global_var_counter;
+    unit->if_counter         = ctx->if_counter;
+    unit->while_counter      = ctx->while_counter;
+
+    unit->IR = {};
+
+    size_t func_index = ctx->units_num - 1;
+
+    unit->cached     = (func_index < ctx->cached_units_num) ? ctx->cached_units[func_index] : NULL;
+    unit->symbol_ids = NULL;
+    unit->code       = NULL;
+
+    // labels are numbered as if the function was lowered in place
+    ctx->if_counter    += countOpers(node, IF);
+    ctx->while_counter += countOpers(node, WHILE);
+}
+
+
+static size_t countOpers(node_t * node, enum oper op)
+{
+    size_t count = 0;
+
+    node_stack_t stack = nodeStackCtor();
+    nodeStackPush(&stack, node, NULL, 0);
+
+    while (! nodeStackEmpty(&stack)){
+        node_t * cur_node = nodeStackPop(&stack).node;
+
+        if (cur_node == NULL)
+            continue;
+
+        if (cur_node->type == OPR && cur_node->val.op == op)
+            count++;
+
+        nodeStackPush(&stack, cur_node->left,  NULL, 0);
+        nodeStackPush(&stack, cur_node->right, NULL, 0);
+    }
+
+    nodeStackDtor(&stack);
+
+    return count;
+}
+
+
+static void lowerFuncUnitTask(void * shared, size_t task_index, size_t /*worker_index*/)
+{
+    backend_ctx_t * ctx = (backend_ctx_t *)shared;
+    func_unit_t * unit = ctx->units + task_index;
+
+    // private context of the worker, id table is only read here
+    backend_ctx_t unit_ctx = *ctx;
+
+    unit_ctx.name_stack         = unit->name_stack;
+    unit_ctx.in_function        = false;
+    unit_ctx.global_var_counter = unit->global_var_counter;
+    unit_ctx.local_var_counter  = 0;
+    unit_ctx.if_counter         = unit->if_counter;
+    unit_ctx.while_counter      = unit->while_counter;
+
+    IRinit(&unit_ctx.IR, UNIT_IR_START_CAP);
+
+    if (unit->cached != NULL)
+        lowerCachedUnit(&unit_ctx, unit);
+    else
+        translateFuncDecl(&unit_ctx, unit->node);
+
+    unit->IR         = unit_ctx.IR;
+    unit->name_stack = unit_ctx.name_stack;
+}
+
+
+static void IRrebaseJump(IR_block_t * block, const size_t * new_index, size_t base)
+{
+    if (block->type != IR_JMP && block->type != IR_COND_JMP)
+        return;
+
+    if (new_index)
+        block->label_block_idx = new_index[block->label_block_idx];
+    else
+        block->label_block_idx += base;
+}
+
+
+static void IRlinkUnits(backend_ctx_t * ctx)
+{
+    assert(ctx);
+
+    size_t main_size  = ctx->IR.size;
+    size_t total_size = main_size;
+
+    for (size_t unit_index = 0; unit_index < ctx->units_num; unit_index++)
+        total_size += ctx->units[unit_index].IR.size;
+
+    // new indices of the main IR blocks, units are inserted before the blocks at their IR_pos
+    size_t * new_index = (size_t *)calloc(main_size, sizeof(size_t));
+    size_t unit_index = 0;
+    size_t shift = 0;
+
+    for (size_t old_index = 0; old_index < main_size; old_index++){
+        for ( ; unit_index < ctx->units_num && ctx->units[unit_index].IR_pos == old_index; unit_index++)
+            shift += ctx->units[unit_index].IR.size;
+
+        new_index[old_index] = old_index + shift;
+    }
+
+    IR_block_t * blocks = (IR_block_t *)calloc(total_size, sizeof(IR_block_t));
+
+    ctx->segments = (IR_segment_t *)calloc(2 * ctx->units_num + 1, sizeof(IR_segment_t));
+    ctx->segments_num = 0;
+
+    size_t cur_index = 0;
+    size_t segment_begin = 0;
+    unit_index = 0;
+
+    for (size_t old_index = 0; old_index <= main_size; old_index++){
+        for ( ; unit_index < ctx->units_num && ctx->units[unit_index].IR_pos == old_index; unit_index++){
+            func_unit_t * unit = ctx->units + unit_index;
+
+            addSegment(ctx, segment_begin, cur_index, NOT_UNIT_SEGMENT);
+
+            memcpy(blocks + cur_index, unit->IR.blocks, unit->IR.size * sizeof(IR_block_t));
+            for (size_t block_index = 0; block_index < unit->IR.size; block_index++)
+                IRrebaseJump(blocks + cur_index + block_index, NULL, cur_index);
+
+            addSegment(ctx, cur_index, cur_index + unit->IR.size, unit_index);
+
+            cur_index += unit->IR.size;
+            segment_begin = cur_index;
+
+            free(unit->IR.blocks);
+            unit->IR.blocks = NULL;
+        }
+
+        if (old_index == main_size)
+            break;
+
+        blocks[cur_index] = ctx->IR.blocks[old_index];
+        IRrebaseJump(blocks + cur_index, new_index, 0);
+        cur_index++;
+    }
+
+    addSegment(ctx, segment_begin, cur_index, NOT_UNIT_SEGMENT);
+
+    free(new_index);
+    free(ctx->IR.blocks);
+
+    ctx->IR.blocks   = blocks;
+    ctx->IR.size     = total_size;
+    ctx->IR.capacity = total_size;
+}
+
+
+static void addSegment(backend_ctx_t * ctx, size_t begin, size_t end, size_t unit_index)
+{
+    if (begin == end)
+        return;
+
+    IR_segment_t * segment = ctx->segments + ctx->segments_num;
+    ctx->segments_num++;
+
+    segment->begin = begin;
+    segment->end   = end;
+
+    segment->unit_index = unit_index;
+}
+
+
+// code of the previous compilation is cut at the labels of its functions, so calls to them are resolved as usual
+static void lowerCachedUnit(backend_ctx_t * ctx, func_unit_t * unit)
+{
+    assert(ctx);
+    assert(unit);
+
+    const unit_code_t * unit_code = unit->cached;
+
+    unit->symbol_ids = (size_t *)calloc(unit_code->symbols_num + 1, sizeof(size_t));
+
+    size_t part_begin = 0;
+
+    for (size_t symbol_index = 0; symbol_index <= unit_code->symbols_num; symbol_index++){
+        const unit_symbol_t * symbol = unit_code->symbols + symbol_index;
+
+        bool is_last = (symbol_index == unit_code->symbols_num);
+
+        if (! is_last && (symbol->type == UNIT_FUNC || symbol->type == UNIT_CALL))
+            unit->symbol_ids[symbol_index] = findIdByName(ctx, symbol->name);
+
+        if (! is_last && symbol->type != UNIT_FUNC)
+            continue;
+
+        size_t part_end = is_last ? unit_code->size : symbol->offset;
+
+        if (part_end > part_begin){
+            IR_block_t * part_block = IRnextBlock(ctx, IR_UNIT_CODE);
+
+            part_block->code_part.unit_code  = unit_code;
+            part_block->code_part.symbol_ids = unit->symbol_ids;
+            part_block->code_part.begin      = part_begin;
+            part_block->code_part.end        = part_end;
+        }
+
+        if (is_last)
+            break;
+
+        size_t func_label_idx = IRnewLabel(ctx, "%s", symbol->name);
+        ctx->IR.blocks[func_label_idx].name_id = unit->symbol_ids[symbol_index];
+        ctx->IR.blocks[func_label_idx].arg_num = symbol->arg_num;
+
+        part_begin = part_end;
+    }
+}
+
+
+// the first id of every name is kept, units are lowered in parallel and only look the names up
+static void internSymbolNames(backend_ctx_t * ctx)
+{
+    assert(ctx);
+
+    internerReset(&ctx->symbol_names);
+
+    free(ctx->symbol_name_ids);
+    ctx->symbol_name_ids = (size_t *)calloc(ctx->id_table_size + 1, sizeof(size_t));
+
+    for (size_t id_index = 0; id_index < ctx->id_table_size; id_index++){
+        const char * name = ctx->id_table[id_index].name;
+        uint32_t name_id = internerIntern(&ctx->symbol_names, name, strlen(name));
+
+        if (name_id + 1 == internerSize(&ctx->symbol_names))
+            ctx->symbol_name_ids[name_id] = id_index;
+    }
+}
+
+
+static size_t findIdByName(const backend_ctx_t * ctx, const char * name)
+{
+    assert(ctx);
+    assert(name);
+
+    uint32_t name_id = internerFind(&ctx->symbol_names, name, strlen(name));
+
+    // names of the unit are in its tree, so they are always in the table
+    return (name_id == INTERNER_NO_ID) ? 0 : ctx->symbol_name_ids[name_id];
+}
+
+
 static void makeIRrecursive(backend_ctx_t * ctx, node_t * node)
 {
     assert(ctx);
@@ -323,12 +732,17 @@ static void makeIRrecursive(backend_ctx_t * ctx, node_t * node)
         case       OUT: translateOut(ctx, node);        break;
 
         case SEP:
-            makeIRrecursive(ctx, node->left);
-            makeIRrecursive(ctx, node->right);
+            // statement chains are right-leaning and may be very long, so they are walked by a loop
+            while (node != NULL && node->type == OPR && node->val.op == SEP){
+                makeIRrecursive(ctx, node->left);
+                node = node->right;
+            }
+
+            makeIRrecursive(ctx, node);
             break;
 
         default:
-            fprintf(stderr, "X64 BACKEND: ERROR: invalid op_num: %d\n", op_num);
+            fprintf(ctx->diag_file, "X64 BACKEND: ERROR: invalid op_num: %d\n", op_num);
             break;
     }
 }
@@ -336,13 +750,28 @@ static void makeIRrecursive(backend_ctx_t * ctx, node_t * node)
 
 static void IRresolveLabels(backend_ctx_t * ctx)
 {
+    for (size_t id_index = 0; id_index < ctx->id_table_size; id_index++)
+        ctx->id_table[id_index].IR_index = NOT_RESOLVED_CALL;
+
+    // the last declaration of the function wins
     for (size_t IR_index = 0; IR_index < ctx->IR.size; IR_index++){
         IR_block_t * block = ctx->IR.blocks + IR_index;
 
-        if (block->type == IR_CALL){
-            size_t func_index = ctx->id_table[block->name_id].IR_index;
-            block->label_block_idx = func_index;
-        }
+        if (block->type == IR_LABEL && block->name_id != NOT_FUNC_LABEL)
+            ctx->id_table[block->name_id].IR_index = IR_index;
+    }
+
+    for (size_t IR_index = 0; IR_index < ctx->IR.size; IR_index++){
+        IR_block_t * block = ctx->IR.blocks + IR_index;
+
+        if (block->type != IR_CALL)
+            continue;
+
+        size_t func_index = ctx->id_table[block->name_id].IR_index;
+        block->label_block_idx = func_index;
+
+        if (func_index == NOT_RESOLVED_CALL && ! ctx->relocatable)
+            fprintf(ctx->diag_file, "X64 BACKEND: ERROR: function %s is not declared!\n", ctx->id_table[block->name_id].name);
     }
 }
 
@@ -388,7 +817,7 @@ static void translateExpression(backend_ctx_t * ctx, node_t * node)
             break;
 
         default:
-            fprintf(stderr, "X64 BACKEND: ERROR: invalid op_num: %d\n", op_num);
+            fprintf(ctx->diag_file, "X64 BACKEND: ERROR: invalid op_num: %d\n", op_num);
             break;
     }
 }
@@ -455,12 +884,16 @@ static void translateCall(backend_ctx_t * ctx, node_t * node)
     node_t * func_node = node->left;
     node_t * arg_tree  = node->right;
 
-    size_t num_of_args = ctx->id_table[func_node->val.id].num_of_args;
-    const char * func_name = ctx->id_table[func_node->val.id].name;
+    // the callee may be in another object, so the call knows how many args it pushes
+    size_t num_of_args = 0;
+    for (node_t * arg_node = arg_tree; arg_node != NULL; arg_node = arg_node->right)
+        num_of_args++;
 
     translateCallHandleArgs(ctx, arg_tree);
 
-    IRnextBlock(ctx, IR_CALL)->name_id = func_node->val.id;
+    IR_block_t * call_block = IRnextBlock(ctx, IR_CALL);
+    call_block->name_id = func_node->val.id;
+    call_block->arg_num = num_of_args;
     //!!! label_block_idx field must be set later!!!
 }
 
@@ -480,13 +913,13 @@ static void translateVarDecl(backend_ctx_t * ctx, node_t * node)
 {
     logPrint(LOG_DEBUG_PLUS, "%s\n", __PRETTY_FUNCTION__);
 
-    printf("locals = %ld\n", ctx->local_var_counter);
+    logPrint(LOG_DEBUG, "locals = %zu\n", ctx->local_var_counter);
 
     int64_t addr = (ctx->in_function) ?
         (- ctx->local_var_counter  * 8 - 8):
         (- ctx->global_var_counter * 8);
 
-    printf("name = %s, addr = %ld, global = %d\n", ctx->id_table[node->left->val.id].name, addr, !(ctx->in_function));
+    logPrint(LOG_DEBUG, "name = %s, addr = %ld, global = %d\n", ctx->id_table[node->left->val.id].name, addr, !(ctx->in_function));
 
     size_t var_index = node->left->val.id;
     addNewName(ctx, var_index, addr, !(ctx->in_function));
@@ -529,7 +962,7 @@ static void translateIfElse(backend_ctx_t * ctx, node_t * node)
         node_t * if_else_node = node->right;
 
         // condition
-        IR_block_t * else_cond_jmp = IRnextBlock(ctx, IR_COND_JMP);
+        size_t else_cond_jmp = IRnextBlockIndex(ctx, IR_COND_JMP);
 
         // if body
         enterScope(ctx, START_OF_SCOPE);
@@ -537,10 +970,11 @@ static void translateIfElse(backend_ctx_t * ctx, node_t * node)
         leaveScopeAndFreeVars(ctx, START_OF_SCOPE);
 
         // jump over else
-        IR_block_t * jmp_over_else = IRnextBlock(ctx, IR_JMP);
+        size_t jmp_over_else = IRnextBlockIndex(ctx, IR_JMP);
 
         // else label
-        else_cond_jmp->label_block_idx = IRnewLabel(ctx, "__IF_%zu_ELSE", if_counter);
+        size_t else_label_idx = IRnewLabel(ctx, "__IF_%zu_ELSE", if_counter);
+        ctx->IR.blocks[else_cond_jmp].label_block_idx = else_label_idx;
 
         // else body
         enterScope(ctx, START_OF_SCOPE);
@@ -548,20 +982,22 @@ static void translateIfElse(backend_ctx_t * ctx, node_t * node)
         leaveScopeAndFreeVars(ctx, START_OF_SCOPE);
 
         // end label
-        jmp_over_else->label_block_idx = IRnewLabel(ctx, "__IF_%zu_END", if_counter);
+        size_t end_label_idx = IRnewLabel(ctx, "__IF_%zu_END", if_counter);
+        ctx->IR.blocks[jmp_over_else].label_block_idx = end_label_idx;
     }
     else {
         // we do not have else
 
         // condition
-        IR_block_t * end_cond_jmp = IRnextBlock(ctx, IR_COND_JMP);
+        size_t end_cond_jmp = IRnextBlockIndex(ctx, IR_COND_JMP);
 
         enterScope(ctx, START_OF_SCOPE);
         makeIRrecursive(ctx, node->right);
         leaveScopeAndFreeVars(ctx, START_OF_SCOPE);
 
         // end label
-        end_cond_jmp->label_block_idx = IRnewLabel(ctx, "__IF_%zu_END", if_counter);
+        size_t end_label_idx = IRnewLabel(ctx, "__IF_%zu_END", if_counter);
+        ctx->IR.blocks[end_cond_jmp].label_block_idx = end_label_idx;
     }
 }
 
@@ -580,7 +1016,7 @@ static void translateWhile(backend_ctx_t * ctx, node_t * node)
     ctx->while_counter++;
 
     // cond jump block
-    IR_block_t * cond_jmp_to_end = IRnextBlock(ctx, IR_COND_JMP);
+    size_t cond_jmp_to_end = IRnextBlockIndex(ctx, IR_COND_JMP);
 
     // body of while
     enterScope(ctx, START_OF_SCOPE);
@@ -593,7 +1029,7 @@ static void translateWhile(backend_ctx_t * ctx, node_t * node)
 
     // end label
     size_t end_label_idx = IRnewLabel(ctx, "__WHILE_%zu_END", while_counter);
-    cond_jmp_to_end->label_block_idx = end_label_idx;
+    ctx->IR.blocks[cond_jmp_to_end].label_block_idx = end_label_idx;
 }
 
 
@@ -624,11 +1060,11 @@ static void translateFuncDecl(backend_ctx_t * ctx, node_t * node)
 
 
     // jump over function
-    IR_block_t * jmp_over_func = IRnextBlock(ctx, IR_JMP);
+    size_t jmp_over_func = IRnextBlockIndex(ctx, IR_JMP);
 
     // label index of the function
     size_t func_label_idx = IRnewLabel(ctx, "%s", func_name);
-    ctx->id_table[func_node->val.id].IR_index = func_label_idx; //into the table
+    ctx->IR.blocks[func_label_idx].name_id = func_node->val.id; // goes into the table after linking
     ctx->IR.blocks[func_label_idx].arg_num = num_of_args;
 
 
@@ -639,7 +1075,8 @@ static void translateFuncDecl(backend_ctx_t * ctx, node_t * node)
     makeIRrecursive(ctx, func_body);
 
     // end label
-    jmp_over_func->label_block_idx = IRnewLabel(ctx, "__END_OF_%s__", func_name);
+    size_t end_label_idx = IRnewLabel(ctx, "__END_OF_%s__", func_name);
+    ctx->IR.blocks[jmp_over_func].label_block_idx = end_label_idx;
 
     leaveScope(ctx, START_OF_FUNC_SCOPE);
     ctx->in_function = false;
@@ -0,0 +1,777 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <math.h>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "backend_x64.h"
+#include "x64_compile.h"
+#include "ir_interpreter.h"
+#include "logger.h"
+
+// the IR is translated to the instructions that keep the address of their handler (direct threading),
+// the stack of the program is laid out as the stack of the elf: same slots, same frames, so the results are the same
+
+#define INTERP_ARITHMETIC(X) \
+    X(ADD) X(SUB) X(MUL) X(DIV)
+
+#define INTERP_COMPARISONS(X) \
+    X(GREATER) X(LESS) X(GREATER_EQ) X(LESS_EQ) X(EQUAL) X(N_EQUAL)
+
+#define INTERP_BINARY(X) INTERP_ARITHMETIC(X) INTERP_COMPARISONS(X)
+
+// operations wrap as the machine code does
+#define INTERP_ADD(a, b)        (int64_t)((uint64_t)(a) + (uint64_t)(b))
+#define INTERP_SUB(a, b)        (int64_t)((uint64_t)(a) - (uint64_t)(b))
+#define INTERP_MUL(a, b)        (int64_t)((uint64_t)(a) * (uint64_t)(b))
+#define INTERP_DIV(a, b)        ((a) / (b))
+#define INTERP_GREATER(a, b)    (int64_t)((a) >  (b))
+#define INTERP_LESS(a, b)       (int64_t)((a) <  (b))
+#define INTERP_GREATER_EQ(a, b) (int64_t)((a) >= (b))
+#define INTERP_LESS_EQ(a, b)    (int64_t)((a) <= (b))
+#define INTERP_EQUAL(a, b)      (int64_t)((a) == (b))
+#define INTERP_N_EQUAL(a, b)    (int64_t)((a) != (b))
+
+// idiv of the elf traps on these
+#define INTERP_CHECK_DIV(a, b)        if ((b) == 0 || ((a) == INT64_MIN && (b) == -1)) goto division_error;
+#define INTERP_CHECK_ADD(a, b)
+#define INTERP_CHECK_SUB(a, b)
+#define INTERP_CHECK_MUL(a, b)
+#define INTERP_CHECK_GREATER(a, b)
+#define INTERP_CHECK_LESS(a, b)
+#define INTERP_CHECK_GREATER_EQ(a, b)
+#define INTERP_CHECK_LESS_EQ(a, b)
+#define INTERP_CHECK_EQUAL(a, b)
+#define INTERP_CHECK_N_EQUAL(a, b)
+
+#define BINARY_OP(name)                 OP_##name,
+#define VAR_IMM_OP(name)                OP_VAR_IMM_##name,
+#define VAR_VAR_OP(name)                OP_VAR_VAR_##name,
+#define JUMP_UNLESS_OP(name)            OP_JUMP_UNLESS_##name,
+#define VAR_IMM_JUMP_UNLESS_OP(name)    OP_VAR_IMM_JUMP_UNLESS_##name,
+#define VAR_VAR_JUMP_UNLESS_OP(name)    OP_VAR_VAR_JUMP_UNLESS_##name,
+
+// superinstructions are the most common sequences of the lowered expressions and conditions:
+// var imm op, var var op, cmp + cond_jmp, push imm + pop var
+enum interp_op {
+    OP_START,
+    OP_EXIT,
+
+    OP_PUSH_IMM,
+    OP_PUSH_VAR,
+    OP_POP_VAR,
+    OP_SET_VAR_IMM,
+
+    OP_VAR_DECL,
+    OP_QUIT_SCOPE,
+
+    OP_SET_FR_PTR,
+    OP_CALL,
+    OP_CALL_END,
+    OP_RET,
+
+    OP_JMP,
+    OP_COND_JMP,
+
+    OP_COUNTED_CALL,        //< the calls and the jumps get these handlers if there is tiering
+    OP_COUNTED_JMP,
+
+    OP_IN,
+    OP_OUT,
+    OP_SQRT,
+
+    INTERP_BINARY(BINARY_OP)
+    INTERP_BINARY(VAR_IMM_OP)
+    INTERP_BINARY(VAR_VAR_OP)
+    INTERP_COMPARISONS(JUMP_UNLESS_OP)
+    INTERP_COMPARISONS(VAR_IMM_JUMP_UNLESS_OP)
+    INTERP_COMPARISONS(VAR_VAR_JUMP_UNLESS_OP)
+
+    OPS_NUM
+};
+
+#undef BINARY_OP
+#undef VAR_IMM_OP
+#undef VAR_VAR_OP
+#undef JUMP_UNLESS_OP
+#undef VAR_IMM_JUMP_UNLESS_OP
+#undef VAR_VAR_JUMP_UNLESS_OP
+
+enum interp_base {
+    FRAME_BASE  = 0,    //< rbp
+    GLOBAL_BASE = 1     //< rbx
+};
+
+typedef struct interp_instr {
+    const void * handler;
+    const struct interp_instr * target;     //< jumps and calls
+
+    int64_t imm;                            //< immediate, number of args or of the freed vars, unit of the call or of the jump
+
+    int32_t slot[2];                        //< vars as the offsets in 8 byte slots from their bases
+    uint8_t base[2];
+
+    enum interp_op op;
+} interp_instr_t;
+
+typedef struct {
+    interp_instr_t * instrs;
+    size_t size;
+
+    size_t * block_instrs;                  //< instruction of every IR block, labels get the next one
+    size_t * targets;                       //< IR blocks of the jumps, until they are resolved
+} interp_code_t;
+
+const size_t NO_TARGET = SIZE_MAX;
+
+const int64_t NO_UNIT = -1;
+
+static int translateIR(const backend_ctx_t * ctx, interp_code_t * code);
+
+static int translateSegment(const backend_ctx_t * ctx, interp_code_t * code, const IR_segment_t * segment, int64_t unit,
+                            const int64_t * label_units);
+
+static size_t translateSuper(const IR_block_t * blocks, size_t block_index, size_t end, interp_instr_t * instr);
+
+static int binaryIndex(enum IR_type type);
+
+static bool isComparison(enum IR_type type);
+
+static bool isPushVar(const IR_block_t * block);
+
+static void setVar(interp_instr_t * instr, size_t var_index, const IR_block_t * block);
+
+static int execute(backend_ctx_t * ctx, interp_code_t * code, FILE * in_file, FILE * out_file, interp_tiering_t * tiering);
+
+
+static int64_t interpSqrt(int64_t value);
+
+
+int interpretProgram(backend_ctx_t * ctx, FILE * in_file, FILE * out_file, interp_tiering_t * tiering)
+{
+    assert(ctx);
+    assert(in_file);
+    assert(out_file);
+
+    interp_code_t code = {
+        .instrs       = (interp_instr_t *)calloc(2 * ctx->IR.size + 1, sizeof(interp_instr_t)),     // calls take two
+        .size         = 0,
+        .block_instrs = (size_t *)calloc(ctx->IR.size + 1, sizeof(size_t)),
+        .targets      = (size_t *)calloc(2 * ctx->IR.size + 1, sizeof(size_t))
+    };
+
+    int status = translateIR(ctx, &code);
+
+    if (status == 0){
+        logPrint(LOG_DEBUG, "interpreter: %zu IR blocks -> %zu instructions\n", ctx->IR.size, code.size);
+        status = execute(ctx, &code, in_file, out_file, tiering);
+    }
+
+    free(code.instrs);
+    free(code.block_instrs);
+    free(code.targets);
+
+    return status;
+}
+
+
+static int translateIR(const backend_ctx_t * ctx, interp_code_t * code)
+{
+    assert(ctx);
+    assert(code);
+
+    size_t blocks_num = ctx->IR.size;
+
+    for (size_t instr_index = 0; instr_index <= 2 * blocks_num; instr_index++)
+        code->targets[instr_index] = NO_TARGET;
+
+    // calls of the top-level functions and jumps in them know the function, its counter is there
+    int64_t * label_units = (int64_t *)calloc(blocks_num + 1, sizeof(int64_t));
+
+    for (size_t block_index = 0; block_index < blocks_num; block_index++)
+        label_units[block_index] = NO_UNIT;
+
+    for (size_t segment_index = 0; segment_index < ctx->segments_num; segment_index++){
+        const IR_segment_t * segment = ctx->segments + segment_index;
+
+        if (segment->unit_index != NOT_UNIT_SEGMENT)
+            label_units[segmentFuncLabel(ctx, segment)] = (int64_t)segment->unit_index;
+    }
+
+    int status = 0;
+
+    for (size_t segment_index = 0; segment_index < ctx->segments_num && status == 0; segment_index++){
+        const IR_segment_t * segment = ctx->segments + segment_index;
+        int64_t unit = (segment->unit_index == NOT_UNIT_SEGMENT) ? NO_UNIT : (int64_t)segment->unit_index;
+
+        status = translateSegment(ctx, code, segment, unit, label_units);
+    }
+
+    free(label_units);
+
+    if (status != 0)
+        return status;
+
+    code->block_instrs[blocks_num] = code->size;
+
+    // every jump goes to a label, so the target is the instruction after it
+    for (size_t instr_index = 0; instr_index < code->size; instr_index++){
+        if (code->targets[instr_index] != NO_TARGET)
+            code->instrs[instr_index].target = code->instrs + code->block_instrs[code->targets[instr_index]];
+    }
+
+    return 0;
+}
+
+
+// superinstructions do not cross the segments, the code of a function is not mixed with the global statements
+static int translateSegment(const backend_ctx_t * ctx, interp_code_t * code, const IR_segment_t * segment, int64_t unit,
+                            const int64_t * label_units)
+{
+    assert(ctx);
+    assert(code);
+    assert(segment);
+    assert(label_units);
+
+    const IR_block_t * blocks = ctx->IR.blocks;
+    size_t end = segment->end;
+
+    size_t block_index = segment->begin;
+
+    while (block_index < end){
+        const IR_block_t * block = blocks + block_index;
+        interp_instr_t * instr = code->instrs + code->size;
+
+        code->block_instrs[block_index] = code->size;
+
+        size_t fused = translateSuper(blocks, block_index, end, instr);
+
+        if (fused != 0){
+            if (blocks[block_index + fused - 1].type == IR_COND_JMP)
+                code->targets[code->size] = blocks[block_index + fused - 1].label_block_idx;
+
+            for (size_t inner = 1; inner < fused; inner++)
+                code->block_instrs[block_index + inner] = code->size;
+
+            code->size++;
+            block_index += fused;
+            continue;
+        }
+
+        block_index++;
+
+        switch (block->type){
+            case IR_LABEL:
+                continue;
+
+            case IR_START:      instr->op = OP_START;     break;
+            case IR_EXIT:       instr->op = OP_EXIT;      break;
+
+            case IR_PUSH_IMM:
+                instr->op  = OP_PUSH_IMM;
+                instr->imm = (int32_t)block->imm_val;
+                break;
+
+            case IR_PUSH_MEM:   instr->op = OP_PUSH_VAR;  setVar(instr, 0, block); break;
+            case IR_POP_MEM:    instr->op = OP_POP_VAR;   setVar(instr, 0, block); break;
+            case IR_IN:         instr->op = OP_IN;        setVar(instr, 0, block); break;
+
+            case IR_VAR_DECL:   instr->op = OP_VAR_DECL;  break;
+
+            case IR_QUIT_SCOPE:
+                instr->op  = OP_QUIT_SCOPE;
+                instr->imm = block->imm_val;
+                break;
+
+            case IR_SET_FR_PTR: instr->op = OP_SET_FR_PTR; break;
+            case IR_RET:        instr->op = OP_RET;        break;
+
+            case IR_CALL:
+                if (block->label_block_idx == NOT_RESOLVED_CALL){
+                    fprintf(ctx->diag_file, "X64 BACKEND: ERROR: function '%s' is not declared, "
+                                            "the interpreter does not link objects\n", ctx->id_table[block->name_id].name);
+                    return 1;
+                }
+
+                instr->op  = OP_CALL;
+                instr->imm = label_units[block->label_block_idx];
+                code->targets[code->size] = block->label_block_idx;
+
+                // the call returns to the cleanup that frees the args and pushes the result
+                code->size++;
+                instr++;
+
+                instr->op  = OP_CALL_END;
+                instr->imm = (int64_t)blocks[block->label_block_idx].arg_num;
+                break;
+
+            case IR_JMP:
+                instr->op  = OP_JMP;
+                instr->imm = unit;
+                code->targets[code->size] = block->label_block_idx;
+                break;
+
+            case IR_COND_JMP:
+                instr->op = OP_COND_JMP;
+                code->targets[code->size] = block->label_block_idx;
+                break;
+
+            case IR_OUT:        instr->op = OP_OUT;        break;
+            case IR_SQRT:       instr->op = OP_SQRT;       break;
+
+            case IR_ADD: case IR_SUB: case IR_MUL: case IR_DIV:
+            case IR_GREATER: case IR_LESS: case IR_GREATER_EQ: case IR_LESS_EQ: case IR_EQUAL: case IR_N_EQUAL:
+                instr->op = (enum interp_op)(OP_ADD + binaryIndex(block->type));
+                break;
+
+            case IR_UNIT_CODE:
+                fprintf(ctx->diag_file, "X64 BACKEND: ERROR: machine code of the previous compilation cannot be interpreted\n");
+                return 1;
+
+            default:
+                fprintf(ctx->diag_file, "X64 BACKEND: ERROR: unknown IR block %d\n", block->type);
+                return 1;
+        }
+
+        code->size++;
+    }
+
+    return 0;
+}
+
+
+// returns the number of the fused IR blocks, 0 if the block starts no superinstruction
+static size_t translateSuper(const IR_block_t * blocks, size_t block_index, size_t end, interp_instr_t * instr)
+{
+    assert(blocks);
+    assert(instr);
+
+    const IR_block_t * block = blocks + block_index;
+    size_t left = end - block_index;
+
+    if (left >= 2 && block[0].type == IR_PUSH_IMM && block[1].type == IR_POP_MEM){
+        instr->op  = OP_SET_VAR_IMM;
+        instr->imm = (int32_t)block[0].imm_val;
+        setVar(instr, 0, block + 1);
+        return 2;
+    }
+
+    if (left >= 2 && isComparison(block[0].type) && block[1].type == IR_COND_JMP){
+        instr->op = (enum interp_op)(OP_JUMP_UNLESS_GREATER + (block[0].type - IR_GREATER));
+        return 2;
+    }
+
+    if (left < 3 || !isPushVar(block) || (block[1].type != IR_PUSH_IMM && !isPushVar(block + 1)))
+        return 0;
+
+    int binary_index = binaryIndex(block[2].type);
+    if (binary_index < 0)
+        return 0;
+
+    bool with_imm = (block[1].type == IR_PUSH_IMM);
+
+    setVar(instr, 0, block);
+
+    if (with_imm)
+        instr->imm = (int32_t)block[1].imm_val;
+    else
+        setVar(instr, 1, block + 1);
+
+    if (left >= 4 && isComparison(block[2].type) && block[3].type == IR_COND_JMP){
+        enum interp_op first = (with_imm ? OP_VAR_IMM_JUMP_UNLESS_GREATER : OP_VAR_VAR_JUMP_UNLESS_GREATER);
+        instr->op = (enum interp_op)(first + (block[2].type - IR_GREATER));
+        return 4;
+    }
+
+    instr->op = (enum interp_op)((with_imm ? OP_VAR_IMM_ADD : OP_VAR_VAR_ADD) + binary_index);
+
+    return 3;
+}
+
+
+// order of the binary ops is the same in the IR and in INTERP_BINARY, -1 for other blocks
+static int binaryIndex(enum IR_type type)
+{
+    if (type >= IR_ADD && type <= IR_DIV)
+        return type - IR_ADD;
+
+    if (isComparison(type))
+        return IR_DIV - IR_ADD + 1 + type - IR_GREATER;
+
+    return -1;
+}
+
+
+static bool isComparison(enum IR_type type)
+{
+    return type >= IR_GREATER && type <= IR_N_EQUAL;
+}
+
+
+static bool isPushVar(const IR_block_t * block)
+{
+    return block->type == IR_PUSH_MEM;
+}
+
+
+static void setVar(interp_instr_t * instr, size_t var_index, const IR_block_t * block)
+{
+    assert(instr);
+    assert(block);
+
+    instr->slot[var_index] = (int32_t)(block->var.rel_addr / 8);
+    instr->base[var_index] = (block->var.is_global ? GLOBAL_BASE : FRAME_BASE);
+}
+
+
+// the value of the top slot is kept in tos, the memory of the slot is written only when it is not the top anymore
+#define NEXT            goto *ip->handler
+#define PUSH(value)     { int64_t pushed = (value); *sp = tos; sp--; tos = pushed; }
+#define POP(dst)        { (dst) = tos; sp++; tos = *sp; }
+#define SET_SP(new_sp)  { *sp = tos; sp = (new_sp); tos = *sp; }
+
+#define VAR(index)          (bases[ip->base[index]] + ip->slot[index])
+#define LOAD(ptr)           ((ptr) == sp ? tos : *(ptr))
+#define STORE(ptr, value)   { if ((ptr) == sp) tos = (value); else *(ptr) = (value); }
+
+#define CHECK_STACK     if (sp < stack_limit) goto stack_overflow;
+
+#define BINARY_HANDLER(name)                                \
+    op_##name: {                                            \
+        int64_t b = tos;                                    \
+        int64_t a = sp[1];                                  \
+        INTERP_CHECK_##name(a, b)                           \
+        sp++;                                               \
+        tos = INTERP_##name(a, b);                          \
+        ip++;                                               \
+        NEXT;                                               \
+    }
+
+#define VAR_IMM_HANDLER(name)                               \
+    op_VAR_IMM_##name: {                                    \
+        int64_t a = LOAD(VAR(0));                           \
+        int64_t b = ip->imm;                                \
+        INTERP_CHECK_##name(a, b)                           \
+        PUSH(INTERP_##name(a, b));                          \
+        ip++;                                               \
+        NEXT;                                               \
+    }
+
+#define VAR_VAR_HANDLER(name)                               \
+    op_VAR_VAR_##name: {                                    \
+        int64_t a = LOAD(VAR(0));                           \
+        int64_t b = LOAD(VAR(1));                           \
+        INTERP_CHECK_##name(a, b)                           \
+        PUSH(INTERP_##name(a, b));                          \
+        ip++;                                               \
+        NEXT;                                               \
+    }
+
+#define JUMP_UNLESS_HANDLER(name)                           \
+    op_JUMP_UNLESS_##name: {                                \
+        int64_t b = tos;                                    \
+        int64_t a = sp[1];                                  \
+        sp += 2;                                            \
+        tos = *sp;                                          \
+        ip = (INTERP_##name(a, b) ? ip + 1 : ip->target);   \
+        NEXT;                                               \
+    }
+
+#define VAR_IMM_JUMP_UNLESS_HANDLER(name)                   \
+    op_VAR_IMM_JUMP_UNLESS_##name: {                        \
+        int64_t a = LOAD(VAR(0));                           \
+        ip = (INTERP_##name(a, ip->imm) ? ip + 1 : ip->target); \
+        NEXT;                                               \
+    }
+
+#define VAR_VAR_JUMP_UNLESS_HANDLER(name)                   \
+    op_VAR_VAR_JUMP_UNLESS_##name: {                        \
+        int64_t a = LOAD(VAR(0));                           \
+        int64_t b = LOAD(VAR(1));                           \
+        ip = (INTERP_##name(a, b) ? ip + 1 : ip->target);   \
+        NEXT;                                               \
+    }
+
+#define BINARY_LABEL(name)                  &&op_##name,
+#define VAR_IMM_LABEL(name)                 &&op_VAR_IMM_##name,
+#define VAR_VAR_LABEL(name)                 &&op_VAR_VAR_##name,
+#define JUMP_UNLESS_LABEL(name)             &&op_JUMP_UNLESS_##name,
+#define VAR_IMM_JUMP_UNLESS_LABEL(name)     &&op_VAR_IMM_JUMP_UNLESS_##name,
+#define VAR_VAR_JUMP_UNLESS_LABEL(name)     &&op_VAR_VAR_JUMP_UNLESS_##name,
+
+static int execute(backend_ctx_t * ctx, interp_code_t * code, FILE * in_file, FILE * out_file, interp_tiering_t * tiering)
+{
+    assert(ctx);
+    assert(code);
+
+    // same order as enum interp_op
+    static const void * const HANDLERS[OPS_NUM] = {
+        &&op_START, &&op_EXIT,
+        &&op_PUSH_IMM, &&op_PUSH_VAR, &&op_POP_VAR, &&op_SET_VAR_IMM,
+        &&op_VAR_DECL, &&op_QUIT_SCOPE,
+        &&op_SET_FR_PTR, &&op_CALL, &&op_CALL_END, &&op_RET,
+        &&op_JMP, &&op_COND_JMP,
+        &&op_COUNTED_CALL, &&op_COUNTED_JMP,
+        &&op_IN, &&op_OUT, &&op_SQRT,
+
+        INTERP_BINARY(BINARY_LABEL)
+        INTERP_BINARY(VAR_IMM_LABEL)
+        INTERP_BINARY(VAR_VAR_LABEL)
+        INTERP_COMPARISONS(JUMP_UNLESS_LABEL)
+        INTERP_COMPARISONS(VAR_IMM_JUMP_UNLESS_LABEL)
+        INTERP_COMPARISONS(VAR_VAR_JUMP_UNLESS_LABEL)
+    };
+
+    for (size_t instr_index = 0; instr_index < code->size; instr_index++){
+        interp_instr_t * instr = code->instrs + instr_index;
+        enum interp_op op = instr->op;
+
+        if (tiering != NULL && op == OP_CALL)
+            op = OP_COUNTED_CALL;
+        if (tiering != NULL && op == OP_JMP)
+            op = OP_COUNTED_JMP;
+
+        instr->handler = HANDLERS[op];
+    }
+
+    // native code of the hot functions runs on this stack too, its overflow hits the guard page as in the elf
+    size_t page_size   = (size_t)sysconf(_SC_PAGESIZE);
+    size_t stack_bytes = INTERP_STACK_SIZE * sizeof(int64_t) + page_size;
+
+    char * stack_map = (char *)mmap(NULL, stack_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (stack_map == MAP_FAILED){
+        fprintf(ctx->diag_file, "X64 BACKEND: ERROR: cannot map the stack of the interpreter\n");
+        return 1;
+    }
+
+    mprotect(stack_map, page_size, PROT_NONE);
+
+    int64_t * stack = (int64_t *)(stack_map + page_size);
+    int64_t * stack_limit = stack + INTERP_STACK_RESERVE;
+
+    size_t * counters = (size_t *)calloc(ctx->units_num + 1, sizeof(size_t));
+
+    // the top slot is argc of the elf, the first global is placed there
+    int64_t * sp = stack + INTERP_STACK_SIZE - 1;
+    int64_t tos = 0;
+
+    int64_t * bases[2] = {sp, sp};
+    int64_t rax = 0;
+
+    int status = 0;
+
+    const interp_instr_t * ip = code->instrs;
+    NEXT;
+
+    op_START:
+        bases[GLOBAL_BASE] = sp;
+        ip++;
+        NEXT;
+
+    op_EXIT:
+        goto finish;
+
+    op_PUSH_IMM:
+        PUSH(ip->imm);
+        ip++;
+        NEXT;
+
+    op_PUSH_VAR:
+        PUSH(LOAD(VAR(0)));
+        ip++;
+        NEXT;
+
+    op_POP_VAR: {
+        int64_t value = 0;
+        POP(value);
+        int64_t * var = VAR(0);
+        STORE(var, value);
+        ip++;
+        NEXT;
+    }
+
+    op_SET_VAR_IMM: {
+        int64_t * var = VAR(0);
+        STORE(var, ip->imm);
+        ip++;
+        NEXT;
+    }
+
+    op_VAR_DECL:
+        SET_SP(sp - 1);
+        CHECK_STACK;
+        ip++;
+        NEXT;
+
+    op_QUIT_SCOPE:
+        SET_SP(sp + ip->imm);
+        ip++;
+        NEXT;
+
+    op_SET_FR_PTR:
+        PUSH((int64_t)bases[FRAME_BASE]);
+        bases[FRAME_BASE] = sp;
+        CHECK_STACK;
+        ip++;
+        NEXT;
+
+    op_CALL:
+        PUSH((int64_t)(ip + 1));
+        ip = ip->target;
+        NEXT;
+
+    op_CALL_END:
+        SET_SP(sp + ip->imm);
+        PUSH(rax);
+        ip++;
+        NEXT;
+
+    op_RET: {
+        int64_t saved_frame = 0;
+        int64_t return_addr = 0;
+
+        POP(rax);
+        SET_SP(bases[FRAME_BASE]);
+        POP(saved_frame);
+        POP(return_addr);
+
+        bases[FRAME_BASE] = (int64_t *)saved_frame;
+        ip = (const interp_instr_t *)return_addr;
+        NEXT;
+    }
+
+    op_JMP:
+        ip = ip->target;
+        NEXT;
+
+    op_COUNTED_CALL:
+        if (ip->imm != NO_UNIT){
+            const void * native = __atomic_load_n(tiering->native_funcs + ip->imm, __ATOMIC_ACQUIRE);
+
+            // native code takes everything from the memory of the stack
+            if (native != NULL){
+                *sp = tos;
+                rax = tiering->call_native(native, sp, bases[GLOBAL_BASE]);
+                tos = *sp;
+
+                ip++;
+                NEXT;
+            }
+
+            if (++counters[ip->imm] == tiering->hot_threshold)
+                tiering->on_hot(tiering, (size_t)ip->imm);
+        }
+        goto op_CALL;
+
+    // the loop that made the function hot is finished by the interpreter, the next call goes to the native code
+    op_COUNTED_JMP:
+        if (ip->target <= ip && ip->imm != NO_UNIT && ++counters[ip->imm] == tiering->hot_threshold)
+            tiering->on_hot(tiering, (size_t)ip->imm);
+
+        ip = ip->target;
+        NEXT;
+
+    op_COND_JMP: {
+        int64_t cond = 0;
+        POP(cond);
+        ip = (cond != 0 ? ip + 1 : ip->target);
+        NEXT;
+    }
+
+    op_IN: {
+        int64_t value = interpReadNumber(in_file);
+        int64_t * var = VAR(0);
+        STORE(var, value);
+        ip++;
+        NEXT;
+    }
+
+    op_OUT: {
+        int64_t value = 0;
+        POP(value);
+        fprintf(out_file, "%" PRId64 "\n", value);
+        ip++;
+        NEXT;
+    }
+
+    op_SQRT:
+        tos = interpSqrt(tos);
+        ip++;
+        NEXT;
+
+    INTERP_BINARY(BINARY_HANDLER)
+    INTERP_BINARY(VAR_IMM_HANDLER)
+    INTERP_BINARY(VAR_VAR_HANDLER)
+    INTERP_COMPARISONS(JUMP_UNLESS_HANDLER)
+    INTERP_COMPARISONS(VAR_IMM_JUMP_UNLESS_HANDLER)
+    INTERP_COMPARISONS(VAR_VAR_JUMP_UNLESS_HANDLER)
+
+    division_error:
+        fflush(out_file);
+        fprintf(ctx->diag_file, "X64 BACKEND: ERROR: division by zero or overflow in the interpreted program\n");
+        status = 1;
+        goto finish;
+
+    stack_overflow:
+        fflush(out_file);
+        fprintf(ctx->diag_file, "X64 BACKEND: ERROR: stack overflow in the interpreted program\n");
+        status = 1;
+        goto finish;
+
+    finish:
+        fflush(out_file);
+        munmap(stack_map, stack_bytes);
+        free(counters);
+
+        return status;
+}
+
+#undef NEXT
+#undef PUSH
+#undef POP
+#undef SET_SP
+#undef VAR
+#undef LOAD
+#undef STORE
+#undef CHECK_STACK
+
+
+int64_t interpReadNumber(FILE * in_file)
+{
+    assert(in_file);
+
+    uint64_t value = 0;
+    bool negative = false;
+
+    int symbol = getc(in_file);
+
+    if (symbol == EOF)
+        return 0;
+
+    if (symbol == '-')
+        negative = true;
+    else
+        value = (uint8_t)(symbol - '0');
+
+    while ((symbol = getc(in_file)) != '\n' && symbol != EOF)
+        value = value * 10 + (uint8_t)(symbol - '0');
+
+    return (int64_t)(negative ? 0 - value : value);
+}
+
+
+// cvtsd2si rounds to nearest and gives INT64_MIN for the values it cannot convert
+static int64_t interpSqrt(int64_t value)
+{
+    double root = sqrt((double)value);
+
+    if (isnan(root) || root >= 9223372036854775808.0)
+        return INT64_MIN;
+
+    return llrint(root);
+}
@@ -1,39 +1,288 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
 
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <unistd.h>
 
 #include "x64_compile.h"
+#include "x64_object.h"
+#include "x64_linker.h"
+#include "x64_c_abi.h"
+#include "x64_jit.h"
+#include "ir_interpreter.h"
+#include "x64_tiered.h"
 #include "backend_x64.h"
 #include "logger.h"
+#include "thread_pool.h"
 
 const char * const LOG_FOLDER_NAME = "logs";
 const char * const LOG_FILE_NAME   = "logs/log.html";
 
+static int compileToObject(const char * ast_file_name, const char * obj_file_name, size_t threads_num);
+
+static int linkObjectFiles(const char * elf_file_name, const char * std_lib_file_name,
+                           char * const * obj_file_names, size_t objects_num);
+
+static int compileToCLibrary(const char * ast_file_name, const char * obj_file_name, const char * header_file_name,
+                             const char * const * export_names, size_t export_names_num, size_t threads_num);
+
+static int runAst(const char * ast_file_name, const char * std_lib_file_name, size_t threads_num);
+
+static int interpretAst(const char * ast_file_name, size_t threads_num);
+
+static int runAstTiered(const char * ast_file_name, size_t hot_threshold, size_t threads_num);
+
 
 // ARGS
+// [-j threads_num] - number of worker threads (number of cores by default)
 // 1 - ast file name
 // 2 - asm file name (for debug)
 // 3 - elf file name
 // 4 - std lib file name (binary)
+// or
+// -c ast_file obj_file                 - relocatable object, the linker resolves calls of undeclared functions
+// --link elf_file std_lib obj_files    - links the objects with the std lib, functions nobody calls are dropped
+// --c-abi ast_file obj_file header_file [funcs] - object for C code, the functions (all by default) are called with SysV ABI
+// --run ast_file std_lib               - runs the program in this process without writing elf, perf map goes to /tmp
+// --interpret ast_file                 - runs the IR without generating the code, reference for the results of the elf
+// --tiered ast_file [calls]            - interprets the program, functions called or looped that many times run natively
 int main(int argc, char ** argv)
 {
-    if (argc != 5){
+    size_t threads_num = getCoresNum();
+
+    int arg_index = 1;
+
+    if (argc > arg_index + 1 && strcmp(argv[arg_index], "-j") == 0){
+        threads_num = strtoul(argv[arg_index + 1], NULL, 10);
+        if (threads_num == 0)
+            threads_num = 1;
+
+        arg_index += 2;
+    }
+
+    bool object_mode = (argc - arg_index == 3 && strcmp(argv[arg_index], "-c") == 0);
+    bool link_mode   = (argc - arg_index >= 4 && strcmp(argv[arg_index], "--link") == 0);
+    bool c_abi_mode  = (argc - arg_index >= 4 && strcmp(argv[arg_index], "--c-abi") == 0);
+    bool run_mode    = (argc - arg_index == 3 && strcmp(argv[arg_index], "--run") == 0);
+    bool tiered_mode = (argc - arg_index >= 2 && argc - arg_index <= 3 && strcmp(argv[arg_index], "--tiered") == 0);
+
+    if (argc - arg_index == 2 && strcmp(argv[arg_index], "--interpret") == 0)
+        return interpretAst(argv[arg_index + 1], threads_num);
+
+    if (tiered_mode){
+        size_t hot_threshold = TIER_HOT_THRESHOLD;
+
+        if (argc - arg_index == 3){
+            char * threshold_end = NULL;
+            hot_threshold = strtoul(argv[arg_index + 2], &threshold_end, 10);
+
+            if (!isdigit(argv[arg_index + 2][0]) || *threshold_end != '\0'){
+                fprintf(stderr, "X64 BACKEND: ERROR: '%s' is not a number of calls\n", argv[arg_index + 2]);
+                return 1;
+            }
+        }
+        if (hot_threshold == 0)
+            hot_threshold = 1;
+
+        return runAstTiered(argv[arg_index + 1], hot_threshold, threads_num);
+    }
+
+    if (object_mode || link_mode || c_abi_mode || run_mode){
+        mkdir(LOG_FOLDER_NAME, 0777);
+        logStart(LOG_FILE_NAME, LOG_DEBUG_PLUS, LOG_HTML);
+
+        if (object_mode)
+            return compileToObject(argv[arg_index + 1], argv[arg_index + 2], threads_num);
+
+        if (run_mode)
+            return runAst(argv[arg_index + 1], argv[arg_index + 2], threads_num);
+
+        if (c_abi_mode)
+            return compileToCLibrary(argv[arg_index + 1], argv[arg_index + 2], argv[arg_index + 3],
+                                     argv + arg_index + 4, (size_t)(argc - arg_index - 4), threads_num);
+
+        return linkObjectFiles(argv[arg_index + 1], argv[arg_index + 2], argv + arg_index + 3, (size_t)(argc - arg_index - 3));
+    }
+
+    if (argc - arg_index != 4){
         fprintf(stderr, "X64 BACKEND: incorrect number of args given!\n");
         return 0;
     }
 
+    char ** file_names = argv + arg_index;
+
     mkdir(LOG_FOLDER_NAME, 0777);
     logStart(LOG_FILE_NAME, LOG_DEBUG_PLUS, LOG_HTML);
-    logCancelBuffer();
 
-    backend_ctx_t backend = backendInit(argv[1]);
+    backend_ctx_t backend = backendInit(file_names[0], threads_num);
+
+    makeIR(&backend);
+    compile(&backend, file_names[1], file_names[2], file_names[3]);
+
+    backendDestroy(&backend);
+
+    return 0;
+}
+
+
+static int compileToObject(const char * ast_file_name, const char * obj_file_name, size_t threads_num)
+{
+    FILE * obj_file = fopen(obj_file_name, "wb");
+    if (obj_file == NULL){
+        fprintf(stderr, "X64 BACKEND: ERROR: cannot open '%s'\n", obj_file_name);
+        return 1;
+    }
+
+    backend_ctx_t backend = backendInit(ast_file_name, threads_num);
+    backend.relocatable = true;
 
     makeIR(&backend);
-    compile(&backend, argv[2], argv[3], argv[4]);
 
+    x64_object_t object = objectCtor();
+
+    compileObject(&backend, &object);
+    objectWrite(&object, obj_file);
+
+    objectDtor(&object);
     backendDestroy(&backend);
 
+    fclose(obj_file);
+
     return 0;
 }
+
+
+static int linkObjectFiles(const char * elf_file_name, const char * std_lib_file_name,
+                           char * const * obj_file_names, size_t objects_num)
+{
+    std_lib_t std_lib = stdLibLoad(std_lib_file_name);
+    if (std_lib.code == NULL)
+        return 1;
+
+    x64_object_t * objects = (x64_object_t *)calloc(objects_num, sizeof(x64_object_t));
+    int status = 0;
+
+    for (size_t object_index = 0; object_index < objects_num; object_index++){
+        objects[object_index] = objectLoad(obj_file_names[object_index]);
+
+        if (objects[object_index].sections == NULL)
+            status = 1;
+    }
+
+    FILE * elf_file = (status == 0) ? fopen(elf_file_name, "wb") : NULL;
+
+    if (elf_file != NULL){
+        status = linkObjects(objects, objects_num, &std_lib, elf_file, stderr);
+
+        fclose(elf_file);
+
+        if (status == 0)
+            chmod(elf_file_name, 0755);
+        else
+            unlink(elf_file_name);
+    }
+    else
+        status = 1;
+
+    for (size_t object_index = 0; object_index < objects_num; object_index++)
+        objectDtor(objects + object_index);
+
+    free(objects);
+    stdLibFree(&std_lib);
+
+    return status;
+}
+
+
+static int compileToCLibrary(const char * ast_file_name, const char * obj_file_name, const char * header_file_name,
+                             const char * const * export_names, size_t export_names_num, size_t threads_num)
+{
+    FILE * obj_file    = fopen(obj_file_name, "wb");
+    FILE * header_file = fopen(header_file_name, "w");
+
+    if (obj_file == NULL || header_file == NULL){
+        fprintf(stderr, "X64 BACKEND: ERROR: cannot open '%s'\n", (obj_file == NULL) ? obj_file_name : header_file_name);
+
+        if (obj_file != NULL)
+            fclose(obj_file);
+        if (header_file != NULL)
+            fclose(header_file);
+
+        return 1;
+    }
+
+    backend_ctx_t backend = backendInit(ast_file_name, threads_num);
+    backend.relocatable = true;
+
+    makeIR(&backend);
+
+    x64_object_t object = objectCtor();
+
+    int status = compileCLibrary(&backend, &object, export_names, export_names_num, header_file);
+
+    if (status == 0)
+        objectWrite(&object, obj_file);
+
+    objectDtor(&object);
+    backendDestroy(&backend);
+
+    fclose(header_file);
+    fclose(obj_file);
+
+    if (status != 0){
+        unlink(obj_file_name);
+        unlink(header_file_name);
+    }
+
+    return status;
+}
+
+
+static int runAst(const char * ast_file_name, const char * std_lib_file_name, size_t threads_num)
+{
+    std_lib_t std_lib = stdLibLoad(std_lib_file_name);
+    if (std_lib.code == NULL)
+        return 1;
+
+    backend_ctx_t backend = backendInit(ast_file_name, threads_num);
+
+    makeIR(&backend);
+
+    int status = runProgram(&backend, &std_lib);
+
+    backendDestroy(&backend);
+    stdLibFree(&std_lib);
+
+    return status;
+}
+
+
+static int interpretAst(const char * ast_file_name, size_t threads_num)
+{
+    backend_ctx_t backend = backendInit(ast_file_name, threads_num);
+
+    makeIR(&backend);
+
+    int status = interpretProgram(&backend, stdin, stdout, NULL);
+
+    backendDestroy(&backend);
+
+    return status;
+}
+
+
+static int runAstTiered(const char * ast_file_name, size_t hot_threshold, size_t threads_num)
+{
+    backend_ctx_t backend = backendInit(ast_file_name, threads_num);
+
+    makeIR(&backend);
+
+    int status = runTiered(&backend, hot_threshold);
+
+    backendDestroy(&backend);
+
+    return status;
+}
@@ -0,0 +1,379 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "backend_x64.h"
+#include "x64_c_abi.h"
+#include "x64_compile.h"
+#include "x64_emitters.h"
+#include "x64_object.h"
+#include "logger.h"
+
+// registers of the integer args in SysV ABI, the first one takes the hook table
+const int C_ABI_ARG_REGS[] = {R_RDI, R_RSI, R_RDX, R_RCX, R_R8, R_R9};
+const size_t C_ABI_ARG_REGS_NUM = sizeof(C_ABI_ARG_REGS) / sizeof(C_ABI_ARG_REGS[0]);
+
+const int C_ABI_HOOKS_REG = R_R15;
+
+enum c_code_kind {
+    C_CODE_THUNK,
+    C_CODE_IN_STUB,
+    C_CODE_OUT_STUB,
+    C_CODE_EMPTY_STUB
+};
+
+// function of the program that is exported
+typedef struct {
+    char name[NAME_MAX_LENGTH];     //< symbols of the object are reallocated by the thunks, so the name is copied
+    size_t symbol;                  //< symbol of the function in the object
+    size_t arg_num;
+    const node_t * func_head;       //< for the names of the args, NULL if the function is not top-level
+} c_export_t;
+
+static bool findExport(backend_ctx_t * ctx, const x64_object_t * object, const char * name, c_export_t * export_func);
+
+static size_t addThunk(backend_ctx_t * ctx, x64_object_t * object, const c_export_t * export_func);
+
+static void defineStub(x64_object_t * object, size_t symbol, enum c_code_kind kind);
+
+static size_t emitCode(x64_object_t * object, const char * section_name, enum c_code_kind kind, size_t arg_num, size_t * call_offset);
+
+static size_t emitThunk(emit_ctx_t * ctx, size_t arg_num, size_t * call_offset);
+
+static void writeHeader(backend_ctx_t * ctx, FILE * header_file, const c_export_t * exports, size_t exports_num);
+
+
+// the program is compiled as an object first, then its symbols are hidden and the thunks become the only globals
+int compileCLibrary(backend_ctx_t * ctx, x64_object_t * object, const char * const * export_names, size_t export_names_num,
+                    FILE * header_file)
+{
+    assert(ctx);
+    assert(object);
+    assert(export_names || export_names_num == 0);
+
+    if (hasGlobalStatements(ctx->root)){
+        fprintf(ctx->diag_file, "X64 BACKEND: ERROR: library cannot have global statements, there is nobody to run them\n");
+        return 1;
+    }
+
+    compileObject(ctx, object);
+
+    int status = 0;
+
+    // undefined symbols are either std in/out that go to the hooks, io init/exit of _start nobody runs
+    // or the functions nobody declared
+    size_t symbols_num = object->symbols_num;
+
+    for (size_t symbol_index = 0; symbol_index < symbols_num; symbol_index++){
+        obj_symbol_t * symbol = object->symbols + symbol_index;
+
+        if (symbol->section != OBJ_UNDEF_SECTION)
+            continue;
+
+        if (strcmp(symbol->name, OBJ_STD_IN_SYMBOL) == 0)
+            defineStub(object, symbol_index, C_CODE_IN_STUB);
+        else if (strcmp(symbol->name, OBJ_STD_OUT_SYMBOL) == 0)
+            defineStub(object, symbol_index, C_CODE_OUT_STUB);
+        else if (strcmp(symbol->name, OBJ_STD_IO_INIT_SYMBOL) == 0 || strcmp(symbol->name, OBJ_STD_IO_EXIT_SYMBOL) == 0)
+            defineStub(object, symbol_index, C_CODE_EMPTY_STUB);
+        else {
+            fprintf(ctx->diag_file, "X64 BACKEND: ERROR: function %s is not declared in the library!\n", symbol->name);
+            status = 1;
+        }
+    }
+
+    size_t exports_capacity = (export_names_num > 0) ? export_names_num : symbols_num;
+    c_export_t * exports = (c_export_t *)calloc(exports_capacity + 1, sizeof(c_export_t));
+    size_t exports_num = 0;
+
+    if (export_names_num == 0){
+        for (size_t symbol_index = 0; symbol_index < symbols_num; symbol_index++){
+            const obj_symbol_t * symbol = object->symbols + symbol_index;
+
+            if (findExport(ctx, object, symbol->name, exports + exports_num))
+                exports_num++;
+        }
+    }
+
+    for (size_t name_index = 0; name_index < export_names_num; name_index++){
+        if (findExport(ctx, object, export_names[name_index], exports + exports_num)){
+            exports_num++;
+            continue;
+        }
+
+        fprintf(ctx->diag_file, "X64 BACKEND: ERROR: cannot export '%s', there is no such function\n", export_names[name_index]);
+        status = 1;
+    }
+
+    // only the thunks are seen from the outside, the code of the functions can be called with our convention only
+    for (size_t symbol_index = 0; symbol_index < object->symbols_num; symbol_index++)
+        object->symbols[symbol_index].bind = OBJ_LOCAL;
+
+    for (size_t export_index = 0; export_index < exports_num; export_index++)
+        addThunk(ctx, object, exports + export_index);
+
+    logPrint(LOG_DEBUG, "c abi: %zu functions are exported\n", exports_num);
+
+    if (header_file != NULL && status == 0)
+        writeHeader(ctx, header_file, exports, exports_num);
+
+    free(exports);
+
+    return status;
+}
+
+
+static bool findExport(backend_ctx_t * ctx, const x64_object_t * object, const char * name, c_export_t * export_func)
+{
+    assert(ctx);
+    assert(object);
+    assert(name);
+    assert(export_func);
+
+    size_t symbol_index = 0;
+
+    for (; symbol_index < object->symbols_num; symbol_index++){
+        const obj_symbol_t * symbol = object->symbols + symbol_index;
+
+        // functions of the program are global before the thunks hide them, the stubs are local
+        if (symbol->bind == OBJ_GLOBAL && symbol->is_func && symbol->section != OBJ_UNDEF_SECTION &&
+            strcmp(symbol->name, OBJ_ENTRY_SYMBOL) != 0 && strcmp(symbol->name, name) == 0)
+            break;
+    }
+
+    if (symbol_index == object->symbols_num)
+        return false;
+
+    strncpy(export_func->name, name, NAME_MAX_LENGTH - 1);
+    export_func->symbol = symbol_index;
+
+    for (size_t id_index = 0; id_index < ctx->id_table_size; id_index++){
+        const idr_t * id = ctx->id_table + id_index;
+
+        if (id->IR_index != NOT_RESOLVED_CALL && strcmp(id->name, name) == 0)
+            export_func->arg_num = ctx->IR.blocks[id->IR_index].arg_num;
+    }
+
+    // the last declaration is the called one
+    export_func->func_head = NULL;
+
+    for (size_t unit_index = ctx->units_num; unit_index > 0; unit_index--){
+        const node_t * func_head = ctx->units[unit_index - 1].node->left;
+
+        if (strcmp(ctx->id_table[func_head->left->val.id].name, name) == 0){
+            export_func->func_head = func_head;
+            break;
+        }
+    }
+
+    return true;
+}
+
+
+static size_t addThunk(backend_ctx_t * ctx, x64_object_t * object, const c_export_t * export_func)
+{
+    assert(ctx);
+    assert(object);
+    assert(export_func);
+
+    char section_name[OBJ_MAX_SECTION_NAME_LEN] = {};
+    snprintf(section_name, OBJ_MAX_SECTION_NAME_LEN, "%s%s", C_ABI_SECTION_PREFIX, export_func->name);
+
+    size_t call_offset = 0;
+    size_t section = emitCode(object, section_name, C_CODE_THUNK, export_func->arg_num, &call_offset);
+
+    objectAddReloc(object, section, call_offset, export_func->symbol, - (int64_t)sizeof(int32_t));
+
+    return objectAddSymbol(object, export_func->name, OBJ_GLOBAL, true, section, 0, object->sections[section].size);
+}
+
+
+static void defineStub(x64_object_t * object, size_t symbol, enum c_code_kind kind)
+{
+    assert(object);
+
+    char section_name[OBJ_MAX_SECTION_NAME_LEN] = {};
+    snprintf(section_name, OBJ_MAX_SECTION_NAME_LEN, "%s%s", C_ABI_SECTION_PREFIX, object->symbols[symbol].name);
+
+    size_t section = emitCode(object, section_name, kind, 0, NULL);
+
+    obj_symbol_t * stub_symbol = object->symbols + symbol;
+
+    stub_symbol->bind    = OBJ_LOCAL;
+    stub_symbol->is_func = true;
+    stub_symbol->section = section;
+    stub_symbol->value   = 0;
+    stub_symbol->size    = object->sections[section].size;
+}
+
+
+static size_t emitCode(x64_object_t * object, const char * section_name, enum c_code_kind kind, size_t arg_num, size_t * call_offset)
+{
+    assert(object);
+    assert(section_name);
+
+    char * code = NULL;
+    size_t code_size = 0;
+
+    emit_ctx_t emit_ctx = {
+        .bin_file = open_memstream(&code, &code_size),
+        .asm_file = NULL,
+        .emitting = true
+    };
+
+    switch (kind){
+        case C_CODE_THUNK:      emitThunk(&emit_ctx, arg_num, call_offset); break;
+        case C_CODE_IN_STUB:    emitHookInStub(&emit_ctx);  break;
+        case C_CODE_OUT_STUB:   emitHookOutStub(&emit_ctx); break;
+        case C_CODE_EMPTY_STUB: emit_ret(&emit_ctx);        break;
+        default:                assert(0 && "unknown hook kind"); break;
+    }
+
+    fclose(emit_ctx.bin_file);
+
+    size_t section = objectAddSection(object, section_name, code, code_size);
+
+    free(code);
+
+    return section;
+}
+
+
+// the args are pushed from the last one as the program does it, rel32 of the call is set by the relocation
+static size_t emitThunk(emit_ctx_t * ctx, size_t arg_num, size_t * call_offset)
+{
+    assert(ctx);
+    assert(call_offset);
+
+    size_t code_size = 0;
+
+    code_size += emit_push_reg(ctx, R_RBP);
+    code_size += emit_mov_reg_reg(ctx, R_RBP, R_RSP);
+    code_size += emit_push_reg(ctx, C_ABI_HOOKS_REG);
+    code_size += emit_mov_reg_reg(ctx, C_ABI_HOOKS_REG, C_ABI_ARG_REGS[0]);
+
+    for (size_t arg_index = arg_num; arg_index > 0; arg_index--){
+        // the first arg is the hook table
+        size_t c_arg_index = arg_index;
+
+        if (c_arg_index < C_ABI_ARG_REGS_NUM)
+            code_size += emit_push_reg(ctx, C_ABI_ARG_REGS[c_arg_index]);
+        else
+            code_size += emit_push_mem(ctx, R_RBP, (int32_t)(16 + 8 * (c_arg_index - C_ABI_ARG_REGS_NUM)));
+    }
+
+    *call_offset = code_size + 1;
+    code_size += emit_call_rel32(ctx, 0);
+
+    if (arg_num > 0)
+        code_size += emit_add_reg_imm32(ctx, R_RSP, (int32_t)(arg_num * 8));
+
+    code_size += emit_pop_reg(ctx, C_ABI_HOOKS_REG);
+    code_size += emit_pop_reg(ctx, R_RBP);
+    code_size += emit_ret(ctx);
+
+    return code_size;
+}
+
+
+// the hooks are C functions, so the stack is aligned by 16 before calling them
+size_t emitHookInStub(emit_ctx_t * ctx)
+{
+    assert(ctx);
+
+    size_t code_size = 0;
+
+    code_size += emit_push_reg(ctx, R_RBP);
+    code_size += emit_mov_reg_reg(ctx, R_RBP, R_RSP);
+    code_size += emit_and_reg_imm32(ctx, R_RSP, -16);
+
+    code_size += emit_mov_reg_mem(ctx, R_RDI, C_ABI_HOOKS_REG, C_ABI_HOOK_USER_OFFSET);
+    code_size += emit_call_mem(ctx, C_ABI_HOOKS_REG, C_ABI_HOOK_IN_OFFSET);
+
+    code_size += emit_mov_reg_reg(ctx, R_RSP, R_RBP);
+    code_size += emit_pop_reg(ctx, R_RBP);
+    code_size += emit_ret(ctx);
+
+    return code_size;
+}
+
+
+// the value is pushed by the program before the call
+size_t emitHookOutStub(emit_ctx_t * ctx)
+{
+    assert(ctx);
+
+    size_t code_size = 0;
+
+    code_size += emit_push_reg(ctx, R_RBP);
+    code_size += emit_mov_reg_reg(ctx, R_RBP, R_RSP);
+    code_size += emit_and_reg_imm32(ctx, R_RSP, -16);
+
+    code_size += emit_mov_reg_mem(ctx, R_RDI, C_ABI_HOOKS_REG, C_ABI_HOOK_USER_OFFSET);
+    code_size += emit_mov_reg_mem(ctx, R_RSI, R_RBP, 16);
+    code_size += emit_call_mem(ctx, C_ABI_HOOKS_REG, C_ABI_HOOK_OUT_OFFSET);
+
+    code_size += emit_mov_reg_reg(ctx, R_RSP, R_RBP);
+    code_size += emit_pop_reg(ctx, R_RBP);
+    code_size += emit_ret(ctx);
+
+    return code_size;
+}
+
+
+static void writeHeader(backend_ctx_t * ctx, FILE * header_file, const c_export_t * exports, size_t exports_num)
+{
+    assert(ctx);
+    assert(header_file);
+    assert(exports || exports_num == 0);
+
+    fprintf(header_file,
+        "// generated by the compiler, link with the object of the program\n"
+        "#pragma once\n"
+        "\n"
+        "#include <stdint.h>\n"
+        "\n"
+        "#ifdef __cplusplus\n"
+        "extern \"C\" {\n"
+        "#endif\n"
+        "\n"
+        "#ifndef LANG_IO_HOOKS_DEFINED\n"
+        "#define LANG_IO_HOOKS_DEFINED\n"
+        "\n"
+        "// in and out of the program call these hooks, the table must live while the function runs\n"
+        "typedef struct {\n"
+        "    int64_t (* in)(void * user);\n"
+        "    void (* out)(void * user, int64_t value);\n"
+        "    void * user;\n"
+        "} %s;\n"
+        "\n"
+        "#endif\n"
+        "\n", C_ABI_HOOKS_TYPE_NAME);
+
+    for (size_t export_index = 0; export_index < exports_num; export_index++){
+        const c_export_t * export_func = exports + export_index;
+
+        fprintf(header_file, "int64_t %s(const %s * hooks", export_func->name, C_ABI_HOOKS_TYPE_NAME);
+
+        const node_t * arg_node = (export_func->func_head != NULL) ? export_func->func_head->right : NULL;
+
+        for (size_t arg_index = 0; arg_index < export_func->arg_num; arg_index++){
+            if (arg_node != NULL){
+                fprintf(header_file, ", int64_t %s", ctx->id_table[arg_node->left->val.id].name);
+                arg_node = arg_node->right;
+            }
+            else
+                fprintf(header_file, ", int64_t arg%zu", arg_index);
+        }
+
+        fprintf(header_file, ");\n");
+    }
+
+    fprintf(header_file,
+        "\n"
+        "#ifdef __cplusplus\n"
+        "}\n"
+        "#endif\n");
+}
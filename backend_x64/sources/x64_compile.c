@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <assert.h>
 #include <stdint.h>
+#include <string.h>
 
 #include <sys/stat.h>
 
@@ -9,11 +10,13 @@
 #include "x64_compile.h"
 #include "x64_emitters.h"
 #include "elf_handler.h"
+#include "x64_object.h"
 #include "logger.h"
+#include "thread_pool.h"
 
-#define asm_emit_label(...)   if (ctx->emit->emitting) fprintf(ctx->emit->asm_file, __VA_ARGS__)
-#define asm_emit_comment(...) if (ctx->emit->emitting) fprintf(ctx->emit->asm_file, "; " __VA_ARGS__)
-#define asm_end_of_block()    if (ctx->emit->emitting) fprintf(ctx->emit->asm_file, "\n")
+#define asm_emit_label(...)   if (ctx->emit->emitting && ctx->emit->asm_file != NULL) fprintf(ctx->emit->asm_file, __VA_ARGS__)
+#define asm_emit_comment(...) if (ctx->emit->emitting && ctx->emit->asm_file != NULL) fprintf(ctx->emit->asm_file, "; " __VA_ARGS__)
+#define asm_end_of_block()    if (ctx->emit->emitting && ctx->emit->asm_file != NULL) fprintf(ctx->emit->asm_file, "\n")
 
 #define BLOCK_START     size_t block_size = 0
 #define EMIT(emit_func, ...) block_size += emit_func (ctx->emit ,##__VA_ARGS__)
@@ -21,12 +24,30 @@
 
 static size_t calculateAddresses(backend_ctx_t * ctx, size_t start_addr);
 
-static size_t readStdFuncsAddresses(backend_ctx_t * ctx, FILE * std_lib_file, size_t std_lib_code_size);
 
-static size_t compileFromIR(backend_ctx_t * ctx, size_t start_addr);
+static size_t compileFromIR(backend_ctx_t * ctx, size_t begin, size_t end, size_t start_addr);
 
+static void sizeSegmentTask(void * shared, size_t task_index, size_t worker_index);
+
+static void rebaseSegmentTask(void * shared, size_t task_index, size_t worker_index);
+
+static void encodeSegmentTask(void * shared, size_t task_index, size_t worker_index);
+
+static void writeCode(backend_ctx_t * ctx, const std_lib_t * std_lib, FILE * bin_file, FILE * asm_file);
+
+static void writeSegments(backend_ctx_t * ctx, FILE * bin_file, FILE * asm_file);
+
+static void saveUnitCode(backend_ctx_t * ctx, const IR_segment_t * segment);
+
+static void addUnitSymbol(unit_code_t * unit_code, size_t * capacity, size_t offset, enum unit_symbol_type type,
+                          const char * name, size_t arg_num);
+
+static void addSegmentSymbols(backend_ctx_t * ctx, x64_object_t * object, const IR_segment_t * segment,
+                              size_t section, size_t * id_symbols);
+
+static void addSegmentRelocs(backend_ctx_t * ctx, x64_object_t * object, const IR_segment_t * segment,
+                             size_t section, size_t * id_symbols, size_t * std_symbols);
 
-static void emitBinStdFuncs(FILE * std_funcs_bin_file, FILE * bin_file, size_t std_funcs_code_size);
 
 static size_t emitStart(backend_ctx_t * ctx, IR_block_t * block);
 
@@ -67,6 +88,141 @@ static size_t compileCmp(backend_ctx_t * ctx, IR_block_t * block);
 
 static size_t compileQuitScope(backend_ctx_t * ctx, IR_block_t * block);
 
+static size_t compileUnitCode(backend_ctx_t * ctx, IR_block_t * block);
+
+
+
+std_lib_t stdLibLoad(const char * std_lib_file_name)
+{
+    assert(std_lib_file_name);
+
+    std_lib_t std_lib = {};
+
+    FILE * std_lib_file = fopen(std_lib_file_name, "rb");
+    if (std_lib_file == NULL){
+        fprintf(stderr, "X64 BACKEND: ERROR: cannot open std lib '%s'\n", std_lib_file_name);
+        return std_lib;
+    }
+
+    size_t code_size = moveToCodeStart(std_lib_file);
+
+    // the code segment starts with the addresses of std_in, std_out, io_init and io_exit
+    size_t std_addrs[4] = {};
+
+    fread(std_addrs, sizeof(std_addrs[0]), 4, std_lib_file);
+
+    code_size -= sizeof(std_addrs);
+
+    std_lib.in_addr   = (int32_t)(std_addrs[0] - sizeof(std_addrs));
+    std_lib.out_addr  = (int32_t)(std_addrs[1] - sizeof(std_addrs));
+    std_lib.init_addr = (int32_t)(std_addrs[2] - sizeof(std_addrs));
+    std_lib.exit_addr = (int32_t)(std_addrs[3] - sizeof(std_addrs));
+
+    std_lib.code = (char *)calloc(code_size, sizeof(char));
+    std_lib.code_size = fread(std_lib.code, sizeof(char), code_size, std_lib_file);
+
+    fclose(std_lib_file);
+
+    logPrint(LOG_DEBUG, "std_in  addr = %d\n", std_lib.in_addr);
+    logPrint(LOG_DEBUG, "std_out addr = %d\n", std_lib.out_addr);
+    logPrint(LOG_DEBUG, "io_init addr = %d\n", std_lib.init_addr);
+    logPrint(LOG_DEBUG, "io_exit addr = %d\n", std_lib.exit_addr);
+
+    return std_lib;
+}
+
+
+void stdLibFree(std_lib_t * std_lib)
+{
+    assert(std_lib);
+
+    free(std_lib->code);
+
+    std_lib->code = NULL;
+    std_lib->code_size = 0;
+}
+
+
+void compileProgram(backend_ctx_t * ctx, const std_lib_t * std_lib, FILE * elf_file, FILE * asm_file)
+{
+    assert(ctx);
+    assert(std_lib);
+    assert(elf_file);
+
+    emit_ctx_t emit_ctx = {
+        .bin_file = elf_file,
+        .asm_file = asm_file,
+        .emitting = true
+    };
+
+    ctx->emit = &emit_ctx;
+
+    ctx->IR.std_in_addr      = std_lib->in_addr;
+    ctx->IR.std_out_addr     = std_lib->out_addr;
+    ctx->IR.std_io_init_addr = std_lib->init_addr;
+    ctx->IR.std_io_exit_addr = std_lib->exit_addr;
+
+    /**** compiling here ****/
+    size_t code_size = calculateAddresses(ctx, std_lib->code_size);
+
+    writeSimpleElfHeader(elf_file, std_lib->code_size, code_size);
+
+    writeCode(ctx, std_lib, elf_file, asm_file);
+    /************************/
+
+    ctx->emit = NULL;
+}
+
+
+size_t compileCode(backend_ctx_t * ctx, const std_lib_t * std_lib, FILE * code_file)
+{
+    assert(ctx);
+    assert(std_lib);
+    assert(code_file);
+
+    emit_ctx_t emit_ctx = {
+        .bin_file = code_file,
+        .asm_file = NULL,
+        .emitting = true
+    };
+
+    ctx->emit = &emit_ctx;
+
+    ctx->IR.std_in_addr      = std_lib->in_addr;
+    ctx->IR.std_out_addr     = std_lib->out_addr;
+    ctx->IR.std_io_init_addr = std_lib->init_addr;
+    ctx->IR.std_io_exit_addr = std_lib->exit_addr;
+
+    size_t code_size = calculateAddresses(ctx, std_lib->code_size);
+
+    writeCode(ctx, std_lib, code_file, NULL);
+
+    ctx->emit = NULL;
+
+    return code_size;
+}
+
+
+// std lib goes first, segments follow it at the addresses calculated before
+static void writeCode(backend_ctx_t * ctx, const std_lib_t * std_lib, FILE * bin_file, FILE * asm_file)
+{
+    assert(ctx);
+    assert(std_lib);
+    assert(bin_file);
+
+    fwrite(std_lib->code, sizeof(char), std_lib->code_size, bin_file);
+
+    logPrint(LOG_DEBUG, "\nstarted translating to asm...\n");
+
+    parallelFor(ctx->segments_num, ctx->workers_num, encodeSegmentTask, ctx);
+
+    for (size_t segment_index = 0; segment_index < ctx->segments_num && ctx->keep_unit_codes; segment_index++)
+        saveUnitCode(ctx, ctx->segments + segment_index);
+
+    writeSegments(ctx, bin_file, asm_file);
+
+    logPrint(LOG_DEBUG, "\nsuccessfully translated to asm!\n");
+}
 
 
 void compile(backend_ctx_t * ctx, const char * asm_file_name, const char * elf_file_name, const char * std_lib_file_name)
@@ -75,66 +231,256 @@ void compile(backend_ctx_t * ctx, const char * asm_file_name, const char * elf_f
     assert(asm_file_name);
     assert(std_lib_file_name);
 
-    FILE * emit_asm_file = fopen(asm_file_name, "w");
-    FILE * emit_bin_file = fopen(elf_file_name, "wb");
+    std_lib_t std_lib = stdLibLoad(std_lib_file_name);
+
+    FILE * asm_file = fopen(asm_file_name, "w");
+    FILE * elf_file = fopen(elf_file_name, "wb");
+
+    assert(elf_file);
+
+    compileProgram(ctx, &std_lib, elf_file, asm_file);
 
-    FILE * std_lib_bin_file = fopen(std_lib_file_name, "rb");
+    stdLibFree(&std_lib);
 
-    assert(emit_bin_file);
-    setbuf(emit_bin_file, NULL);
+    if (asm_file != NULL)
+        fclose(asm_file);
+    fclose(elf_file);
+
+    chmod(elf_file_name, 0755);
+}
+
+
+size_t compileFunc(backend_ctx_t * ctx, const IR_segment_t * segment, FILE * code_file)
+{
+    assert(ctx);
+    assert(segment);
+    assert(code_file);
+    assert(segment->unit_index != NOT_UNIT_SEGMENT);
+
+    size_t begin = segmentFuncLabel(ctx, segment);
 
     emit_ctx_t emit_ctx = {
-        .bin_file = emit_bin_file,
-        .asm_file = emit_asm_file,
+        .bin_file = NULL,
+        .asm_file = NULL,
+        .emitting = false
+    };
+
+    backend_ctx_t func_ctx = *ctx;
+    func_ctx.emit = &emit_ctx;
+
+    // jumps of the function are local, so its addresses are taken from the start of its code
+    compileFromIR(&func_ctx, begin, segment->end, 0);
+
+    emit_ctx.bin_file = code_file;
+    emit_ctx.emitting = true;
+
+    return compileFromIR(&func_ctx, begin, segment->end, 0);
+}
+
+
+size_t segmentFuncLabel(const backend_ctx_t * ctx, const IR_segment_t * segment)
+{
+    assert(ctx);
+    assert(segment);
+
+    if (ctx->IR.blocks[segment->begin].type == IR_JMP)
+        return segment->begin + 1;
+
+    return segment->begin;
+}
+
+
+// global statements go to .text one after another, every top-level function goes to its own section
+void compileObject(backend_ctx_t * ctx, x64_object_t * object)
+{
+    assert(ctx);
+    assert(object);
+
+    emit_ctx_t emit_ctx = {
+        .bin_file = NULL,
+        .asm_file = NULL,
         .emitting = true
     };
 
     ctx->emit = &emit_ctx;
 
-    /**** compiling here ****/
-    size_t std_lib_code_size = moveToCodeStart(std_lib_bin_file);
+    // section of a function starts at its label, .text never runs into it, so the jump over it is not needed
+    for (size_t segment_index = 0; segment_index < ctx->segments_num; segment_index++){
+        IR_segment_t * segment = ctx->segments + segment_index;
 
-    std_lib_code_size = readStdFuncsAddresses(ctx, std_lib_bin_file, std_lib_code_size);
+        if (segment->unit_index != NOT_UNIT_SEGMENT)
+            segment->begin = segmentFuncLabel(ctx, segment);
+    }
 
-    size_t code_size = calculateAddresses(ctx, std_lib_code_size);
+    parallelFor(ctx->segments_num, ctx->workers_num, sizeSegmentTask, ctx);
 
-    writeSimpleElfHeader(emit_bin_file, std_lib_code_size, code_size);
+    size_t main_size = 0;
 
-    emitBinStdFuncs(std_lib_bin_file, emit_bin_file, std_lib_code_size);
-    compileFromIR(ctx, 0);
-    /************************/
+    for (size_t segment_index = 0; segment_index < ctx->segments_num; segment_index++){
+        IR_segment_t * segment = ctx->segments + segment_index;
 
-    fclose(std_lib_bin_file);
-    fclose(emit_asm_file);
-    fclose(emit_bin_file);
+        if (segment->unit_index != NOT_UNIT_SEGMENT){
+            segment->base_addr = 0;
+            continue;
+        }
 
-    chmod(elf_file_name, 0755);
+        segment->base_addr = main_size;
+        main_size += segment->code_size;
+    }
+
+    parallelFor(ctx->segments_num, ctx->workers_num, rebaseSegmentTask, ctx);
+
+    parallelFor(ctx->segments_num, ctx->workers_num, encodeSegmentTask, ctx);
+
+    size_t * segment_sections = (size_t *)calloc(ctx->segments_num + 1, sizeof(size_t));
+
+    char * main_code = (char *)calloc(main_size + 1, sizeof(char));
+
+    for (size_t segment_index = 0; segment_index < ctx->segments_num; segment_index++){
+        IR_segment_t * segment = ctx->segments + segment_index;
+
+        if (segment->unit_index == NOT_UNIT_SEGMENT)
+            memcpy(main_code + segment->base_addr, segment->bin_buf, segment->bin_size);
+    }
+
+    size_t main_section = objectAddSection(object, OBJ_MAIN_SECTION_NAME, main_code, main_size);
+    free(main_code);
+
+    for (size_t segment_index = 0; segment_index < ctx->segments_num; segment_index++){
+        IR_segment_t * segment = ctx->segments + segment_index;
+
+        if (segment->unit_index == NOT_UNIT_SEGMENT){
+            segment_sections[segment_index] = main_section;
+            continue;
+        }
+
+        node_t * func_node = ctx->units[segment->unit_index].node->left->left;
+
+        char section_name[OBJ_MAX_SECTION_NAME_LEN] = {};
+        snprintf(section_name, OBJ_MAX_SECTION_NAME_LEN, "%s%s", OBJ_FUNC_SECTION_PREFIX, ctx->id_table[func_node->val.id].name);
+
+        segment_sections[segment_index] = objectAddSection(object, section_name, segment->bin_buf, segment->bin_size);
+    }
+
+    // the program without global statements is a library, its _start is taken only if there is no other one
+    objectAddSymbol(object, OBJ_ENTRY_SYMBOL, hasGlobalStatements(ctx->root) ? OBJ_GLOBAL : OBJ_WEAK, true, main_section, 0, 0);
+
+    size_t * id_symbols = (size_t *)calloc(ctx->id_table_size + 1, sizeof(size_t));
+    for (size_t id_index = 0; id_index < ctx->id_table_size; id_index++)
+        id_symbols[id_index] = OBJ_UNDEF_SECTION;
+
+    size_t std_symbols[4] = {OBJ_UNDEF_SECTION, OBJ_UNDEF_SECTION, OBJ_UNDEF_SECTION, OBJ_UNDEF_SECTION};
+
+    for (size_t segment_index = 0; segment_index < ctx->segments_num; segment_index++)
+        addSegmentSymbols(ctx, object, ctx->segments + segment_index, segment_sections[segment_index], id_symbols);
+
+    for (size_t segment_index = 0; segment_index < ctx->segments_num; segment_index++)
+        addSegmentRelocs(ctx, object, ctx->segments + segment_index, segment_sections[segment_index], id_symbols, std_symbols);
+
+    for (size_t segment_index = 0; segment_index < ctx->segments_num; segment_index++){
+        free(ctx->segments[segment_index].bin_buf);
+        ctx->segments[segment_index].bin_buf = NULL;
+    }
+
+    free(id_symbols);
+    free(segment_sections);
+
+    ctx->emit = NULL;
 }
 
 
-static size_t readStdFuncsAddresses(backend_ctx_t * ctx, FILE * std_lib_file, size_t std_lib_code_size)
+static void addSegmentSymbols(backend_ctx_t * ctx, x64_object_t * object, const IR_segment_t * segment,
+                              size_t section, size_t * id_symbols)
 {
     assert(ctx);
-    assert(std_lib_file);
+    assert(object);
+    assert(segment);
+    assert(id_symbols);
 
-    size_t std_in_addr = 0;
-    size_t std_out_addr = 0;
+    for (size_t block_index = segment->begin; block_index < segment->end; block_index++){
+        const IR_block_t * block = ctx->IR.blocks + block_index;
 
-    fread(&std_in_addr , sizeof(std_in_addr) , 1, std_lib_file);
-    fread(&std_out_addr, sizeof(std_out_addr), 1, std_lib_file);
+        // only the last declaration of the function is called
+        if (block->type != IR_LABEL || block->name_id == NOT_FUNC_LABEL || ctx->id_table[block->name_id].IR_index != block_index)
+            continue;
+
+        // addresses are taken from the start of the section
+        size_t value = (size_t)block->addr;
+
+        // top-level function takes all its section
+        size_t size = (segment->unit_index != NOT_UNIT_SEGMENT && block_index == segment->begin) ? segment->code_size : 0;
+
+        id_symbols[block->name_id] = objectAddSymbol(object, ctx->id_table[block->name_id].name, OBJ_GLOBAL, true, section, value, size);
+    }
+}
+
+
+// rel32 follows the one byte opcode of the call, it is zeroed as the linker puts S + A - P there
+static void addSegmentRelocs(backend_ctx_t * ctx, x64_object_t * object, const IR_segment_t * segment,
+                             size_t section, size_t * id_symbols, size_t * std_symbols)
+{
+    assert(ctx);
+    assert(object);
+    assert(segment);
+    assert(id_symbols);
+    assert(std_symbols);
+
+    const int64_t rel32_addend = - (int64_t)sizeof(int32_t);
+
+    for (size_t block_index = segment->begin; block_index < segment->end; block_index++){
+        const IR_block_t * block = ctx->IR.blocks + block_index;
+
+        size_t * symbol = NULL;
+        const char * name = NULL;
+
+        if (block->type == IR_CALL){
+            symbol = id_symbols + block->name_id;
+            name   = ctx->id_table[block->name_id].name;
+        }
+        else if (block->type == IR_IN){
+            symbol = std_symbols + 0;
+            name   = OBJ_STD_IN_SYMBOL;
+        }
+        else if (block->type == IR_OUT){
+            symbol = std_symbols + 1;
+            name   = OBJ_STD_OUT_SYMBOL;
+        }
+        else if (block->type == IR_START){
+            symbol = std_symbols + 2;
+            name   = OBJ_STD_IO_INIT_SYMBOL;
+        }
+        else if (block->type == IR_EXIT){
+            symbol = std_symbols + 3;
+            name   = OBJ_STD_IO_EXIT_SYMBOL;
+        }
+
+        if (symbol == NULL)
+            continue;
+
+        if (*symbol == OBJ_UNDEF_SECTION)
+            *symbol = objectAddSymbol(object, name, OBJ_GLOBAL, false, OBJ_UNDEF_SECTION, 0, 0);
+
+        size_t offset = (size_t)block->addr + 1;
+
+        memset(object->sections[section].code + offset, 0, sizeof(int32_t));
+        objectAddReloc(object, section, offset, *symbol, rel32_addend);
+    }
+}
 
-    std_lib_code_size -= sizeof(std_in_addr) + sizeof(std_out_addr);
 
-    std_in_addr  -= 16;
-    std_out_addr -= 16;
+bool hasGlobalStatements(const node_t * root)
+{
+    for (const node_t * sep = root; sep != NULL; sep = sep->right){
+        if (sep->type != OPR || sep->val.op != SEP)
+            return true;
 
-    ctx->IR.std_in_addr  = std_in_addr;
-    ctx->IR.std_out_addr = std_out_addr;
+        const node_t * statement = sep->left;
 
-    printf("std_in  addr = %zu\n", std_in_addr);
-    printf("std_out addr = %zu\n", std_out_addr);
+        if (statement != NULL && ! (statement->type == OPR && statement->val.op == FUNC_DECL))
+            return true;
+    }
 
-    return std_lib_code_size;
+    return false;
 }
 
 
@@ -142,25 +488,160 @@ static size_t calculateAddresses(backend_ctx_t * ctx, size_t start_addr)
 {
     assert(ctx);
 
-    ctx->emit->emitting = false;
+    // all encodings have fixed size, so segments are measured independently and then placed one after another
+    parallelFor(ctx->segments_num, ctx->workers_num, sizeSegmentTask, ctx);
 
-    size_t code_size = compileFromIR(ctx, start_addr);
+    size_t cur_addr = start_addr;
 
-    ctx->emit->emitting = true;
+    for (size_t segment_index = 0; segment_index < ctx->segments_num; segment_index++){
+        ctx->segments[segment_index].base_addr = cur_addr;
+        cur_addr += ctx->segments[segment_index].code_size;
+    }
 
-    return code_size;
+    parallelFor(ctx->segments_num, ctx->workers_num, rebaseSegmentTask, ctx);
+
+    return cur_addr;
 }
 
 
-static size_t compileFromIR(backend_ctx_t * ctx, size_t start_addr)
+static void sizeSegmentTask(void * shared, size_t task_index, size_t /*worker_index*/)
+{
+    backend_ctx_t * ctx = (backend_ctx_t *)shared;
+    IR_segment_t * segment = ctx->segments + task_index;
+
+    emit_ctx_t emit_ctx = {
+        .bin_file = NULL,
+        .asm_file = NULL,
+        .emitting = false
+    };
+
+    backend_ctx_t segment_ctx = *ctx;
+    segment_ctx.emit = &emit_ctx;
+
+    segment->code_size = compileFromIR(&segment_ctx, segment->begin, segment->end, 0);
+}
+
+
+static void rebaseSegmentTask(void * shared, size_t task_index, size_t /*worker_index*/)
+{
+    backend_ctx_t * ctx = (backend_ctx_t *)shared;
+    IR_segment_t * segment = ctx->segments + task_index;
+
+    for (size_t block_index = segment->begin; block_index < segment->end; block_index++)
+        ctx->IR.blocks[block_index].addr += (int32_t)segment->base_addr;
+}
+
+
+static void encodeSegmentTask(void * shared, size_t task_index, size_t /*worker_index*/)
+{
+    backend_ctx_t * ctx = (backend_ctx_t *)shared;
+    IR_segment_t * segment = ctx->segments + task_index;
+
+    emit_ctx_t emit_ctx = {
+        .bin_file = open_memstream(&segment->bin_buf, &segment->bin_size),
+        .asm_file = (ctx->emit->asm_file == NULL) ? NULL : open_memstream(&segment->asm_buf, &segment->asm_size),
+        .emitting = true
+    };
+
+    backend_ctx_t segment_ctx = *ctx;
+    segment_ctx.emit = &emit_ctx;
+
+    compileFromIR(&segment_ctx, segment->begin, segment->end, segment->base_addr);
+
+    fclose(emit_ctx.bin_file);
+    if (emit_ctx.asm_file != NULL)
+        fclose(emit_ctx.asm_file);
+}
+
+
+static void writeSegments(backend_ctx_t * ctx, FILE * bin_file, FILE * asm_file)
 {
     assert(ctx);
 
-    logPrint(LOG_DEBUG, "\nstarted translating to asm...\n");
+    for (size_t segment_index = 0; segment_index < ctx->segments_num; segment_index++){
+        IR_segment_t * segment = ctx->segments + segment_index;
+
+        fwrite(segment->bin_buf, sizeof(char), segment->bin_size, bin_file);
+        if (asm_file != NULL)
+            fwrite(segment->asm_buf, sizeof(char), segment->asm_size, asm_file);
+
+        free(segment->bin_buf);
+        free(segment->asm_buf);
+
+        segment->bin_buf = NULL;
+        segment->asm_buf = NULL;
+    }
+}
+
+
+// calls are the only position dependent instructions: jumps are local and variables are addressed by rbx and rbp
+static void saveUnitCode(backend_ctx_t * ctx, const IR_segment_t * segment)
+{
+    assert(ctx);
+    assert(segment);
+
+    if (segment->unit_index == NOT_UNIT_SEGMENT || ctx->units[segment->unit_index].cached != NULL)
+        return;
+
+    unit_code_t * unit_code = (unit_code_t *)calloc(1, sizeof(unit_code_t));
+
+    unit_code->size = segment->bin_size;
+    unit_code->code = (char *)calloc(segment->bin_size + 1, sizeof(char));
+    memcpy(unit_code->code, segment->bin_buf, segment->bin_size);
+
+    size_t capacity = 0;
+
+    for (size_t block_index = segment->begin; block_index < segment->end; block_index++){
+        const IR_block_t * block = ctx->IR.blocks + block_index;
+        size_t offset = (size_t)block->addr - segment->base_addr;
+
+        // rel32 follows the one byte opcode of the call
+        if (block->type == IR_LABEL && block->name_id != NOT_FUNC_LABEL)
+            addUnitSymbol(unit_code, &capacity, offset, UNIT_FUNC, block->label_name, block->arg_num);
+        else if (block->type == IR_CALL)
+            addUnitSymbol(unit_code, &capacity, offset + 1, UNIT_CALL, ctx->id_table[block->name_id].name, 0);
+        else if (block->type == IR_IN)
+            addUnitSymbol(unit_code, &capacity, offset + 1, UNIT_STD_IN, "", 0);
+        else if (block->type == IR_OUT)
+            addUnitSymbol(unit_code, &capacity, offset + 1, UNIT_STD_OUT, "", 0);
+    }
+
+    ctx->units[segment->unit_index].code = unit_code;
+}
+
+
+static void addUnitSymbol(unit_code_t * unit_code, size_t * capacity, size_t offset, enum unit_symbol_type type,
+                          const char * name, size_t arg_num)
+{
+    assert(unit_code);
+    assert(capacity);
+    assert(name);
+
+    if (unit_code->symbols_num >= *capacity){
+        *capacity = (*capacity == 0) ? 16 : *capacity * 2;
+        unit_code->symbols = (unit_symbol_t *)realloc(unit_code->symbols, *capacity * sizeof(unit_symbol_t));
+    }
+
+    unit_symbol_t * symbol = unit_code->symbols + unit_code->symbols_num;
+    unit_code->symbols_num++;
+
+    *symbol = {};
+
+    symbol->offset  = offset;
+    symbol->type    = type;
+    symbol->arg_num = arg_num;
+
+    strncpy(symbol->name, name, NAME_MAX_LENGTH - 1);
+}
+
+
+static size_t compileFromIR(backend_ctx_t * ctx, size_t begin, size_t end, size_t start_addr)
+{
+    assert(ctx);
 
     size_t cur_addr = start_addr;
 
-    for (size_t block_index = 0; block_index < ctx->IR.size; block_index++){
+    for (size_t block_index = begin; block_index < end; block_index++){
         IR_block_t * block = ctx->IR.blocks + block_index;
         size_t block_size = 0;
 
@@ -202,6 +683,8 @@ static size_t compileFromIR(backend_ctx_t * ctx, size_t start_addr)
             case IR_SQRT: block_size = compileSqrt(ctx, block); break;
 
             case IR_QUIT_SCOPE: block_size = compileQuitScope(ctx, block); break;
+
+            case IR_UNIT_CODE: block_size = compileUnitCode(ctx, block); break;
         }
 
         // if we are calculating addresses
@@ -211,20 +694,7 @@ static size_t compileFromIR(backend_ctx_t * ctx, size_t start_addr)
         cur_addr += block_size;
     }
 
-
-    logPrint(LOG_DEBUG, "\nsuccessfully translated to asm!\n");
-
-    return cur_addr;
-}
-
-
-static void emitBinStdFuncs(FILE * std_funcs_bin_file, FILE * bin_file, size_t std_funcs_code_size)
-{
-    char * buffer = (char *)calloc(std_funcs_code_size, sizeof(char));
-    fread(buffer, sizeof(char), std_funcs_code_size, std_funcs_bin_file);
-    fwrite(buffer, sizeof(char), std_funcs_code_size, bin_file);
-
-    free(buffer);
+    return cur_addr - start_addr;
 }
 
 
@@ -235,6 +705,14 @@ static size_t emitStart(backend_ctx_t * ctx, IR_block_t * block)
     asm_emit_comment("===================== STARTING TRANSLATION =====================\n");
     asm_emit_label("_start:\n");
 
+    // the buffers of in and out are kept in r14 until the exit
+    EMIT(emit_call_rel32, ctx->IR.std_io_init_addr - (int32_t)block->addr - 5);
+
+    // the first global is placed at rbx, in elf it is argc there, in jit it would be the return address
+    if (ctx->jit)
+        EMIT(emit_sub_reg_imm32, R_RSP, 8);
+
+    EMIT(emit_mov_reg_reg, R_R14, R_RAX);
     EMIT(emit_mov_reg_reg, R_RBX, R_RSP);
 
     asm_end_of_block();
@@ -248,7 +726,18 @@ static size_t emitExit(backend_ctx_t * ctx, IR_block_t * block)
     BLOCK_START;
     asm_emit_comment("\t--- EXITING ---\n");
 
+    // the rest of out is written here, output of the program that crashed is lost
+    EMIT(emit_call_rel32, ctx->IR.std_io_exit_addr - (int32_t)block->addr - 5);
+
     EMIT(emit_mov_reg_reg, R_RSP, R_RBX);
+
+    // _start of the jit code is called, the return address is above the slot of the first global
+    if (ctx->jit){
+        EMIT(emit_add_reg_imm32, R_RSP, 8);
+        EMIT(emit_ret);
+        BLOCK_RET;
+    }
+
     EMIT(emit_mov_reg_imm, R_RAX, 0x3c);
     EMIT(emit_mov_reg_imm, R_RDI, 0x00);
     EMIT(emit_syscall);
@@ -397,12 +886,10 @@ static size_t compileAddSubMulDiv(backend_ctx_t * ctx, IR_block_t * block)
     if (block->type == IR_DIV)
         EMIT(emit_cqo);
 
-    switch(block->type){
-        case IR_ADD: EMIT(emit_add_reg_reg, R_RAX, R_RCX); break;
-        case IR_SUB: EMIT(emit_sub_reg_reg, R_RAX, R_RCX); break;
-        case IR_MUL: EMIT(emit_imul_reg, R_RCX); break;
-        case IR_DIV: EMIT(emit_idiv_reg, R_RCX); break;
-    }
+    if      (block->type == IR_ADD) EMIT(emit_add_reg_reg, R_RAX, R_RCX);
+    else if (block->type == IR_SUB) EMIT(emit_sub_reg_reg, R_RAX, R_RCX);
+    else if (block->type == IR_MUL) EMIT(emit_imul_reg, R_RCX);
+    else if (block->type == IR_DIV) EMIT(emit_idiv_reg, R_RCX);
 
     EMIT(emit_push_reg, R_RAX);
 
@@ -431,18 +918,29 @@ static size_t compileCall(backend_ctx_t * ctx, IR_block_t * block)
 {
     BLOCK_START;
 
-    IR_block_t * label_block = ctx->IR.blocks + block->label_block_idx;
+    const char * func_name = ctx->id_table[block->name_id].name;
+
+    asm_emit_comment("\t--- CALLING %s ---\n", func_name);
+
+    // rel32 of the call of an undeclared function is set by the linker
+    int32_t target_addr = 0;
+    size_t arg_num = block->arg_num;
+
+    if (block->label_block_idx != NOT_RESOLVED_CALL){
+        IR_block_t * label_block = ctx->IR.blocks + block->label_block_idx;
 
-    asm_emit_comment("\t--- CALLING %s ---\n", label_block->label_name);
+        target_addr = label_block->addr;
+        arg_num     = label_block->arg_num;
+    }
 
-    int32_t rel_addr = label_block->addr - block->addr;
+    int32_t rel_addr = target_addr - block->addr;
     rel_addr -= 5;
     EMIT(emit_call_rel32, rel_addr);
 
-    EMIT(emit_add_reg_imm32, R_RSP, label_block->arg_num * 8);
+    EMIT(emit_add_reg_imm32, R_RSP, arg_num * 8);
     EMIT(emit_push_reg, R_RAX);
 
-    asm_emit_comment("\t--- END OF CALLING %s ---\n", label_block->label_name);
+    asm_emit_comment("\t--- END OF CALLING %s ---\n", func_name);
     asm_end_of_block();
 
     BLOCK_RET;
@@ -540,3 +1038,56 @@ static size_t compileCmp(backend_ctx_t * ctx, IR_block_t * block)
 
     BLOCK_RET;
 }
+
+
+// the code is copied as is, only rel32 of its calls are changed for the new places of the callees
+static size_t compileUnitCode(backend_ctx_t * ctx, IR_block_t * block)
+{
+    const unit_code_part_t * part = &block->code_part;
+    const unit_code_t * unit_code = part->unit_code;
+
+    size_t part_size = part->end - part->begin;
+
+    if (! ctx->emit->emitting)
+        return part_size;
+
+    char * code = (char *)calloc(part_size + 1, sizeof(char));
+    memcpy(code, unit_code->code + part->begin, part_size);
+
+    for (size_t symbol_index = 0; symbol_index < unit_code->symbols_num; symbol_index++){
+        const unit_symbol_t * symbol = unit_code->symbols + symbol_index;
+
+        if (symbol->type == UNIT_FUNC || symbol->offset < part->begin || symbol->offset >= part->end)
+            continue;
+
+        int32_t target_addr = 0;
+
+        switch (symbol->type){
+            case UNIT_CALL: {
+                size_t func_index = ctx->id_table[part->symbol_ids[symbol_index]].IR_index;
+                target_addr = (func_index == NOT_RESOLVED_CALL) ? 0 : ctx->IR.blocks[func_index].addr;
+                break;
+            }
+            case UNIT_STD_IN:
+                target_addr = ctx->IR.std_in_addr;
+                break;
+            case UNIT_STD_OUT:
+                target_addr = ctx->IR.std_out_addr;
+                break;
+            case UNIT_FUNC:
+            default:
+                break;
+        }
+
+        size_t code_offset = symbol->offset - part->begin;
+
+        int32_t rel_addr = target_addr - (block->addr + (int32_t)code_offset + (int32_t)sizeof(int32_t));
+        memcpy(code + code_offset, &rel_addr, sizeof(rel_addr));
+    }
+
+    fwrite(code, sizeof(char), part_size, ctx->emit->bin_file);
+
+    free(code);
+
+    return part_size;
+}
@@ -66,7 +66,7 @@ static uint8_t modRM(uint8_t mod, uint8_t reg, uint8_t rm)
 #define check_src_reg(reg, rex) do{if (reg >= R_R8) {reg-=8; rex|=REX_R;}} while(0)
 #define check_dst_reg(reg, rex) do{if (reg >= R_R8) {reg-=8; rex|=REX_B;}} while(0)
 
-#define asm_emit(...) if (ctx->emitting) fprintf(ctx->asm_file, "\t\t" __VA_ARGS__)
+#define asm_emit(...) if (ctx->emitting && ctx->asm_file != NULL) fprintf(ctx->asm_file, "\t\t" __VA_ARGS__)
 
 
 /******************** PUSH ********************/
@@ -148,7 +148,7 @@ size_t emit_pop_mem(emit_ctx_t * ctx, int reg, int32_t imm32)
 
 
 
-/******************** SUB, ADD ********************/
+/******************** SUB, ADD, AND ********************/
 // sub reg64, imm32
 size_t emit_sub_reg_imm32(emit_ctx_t * ctx, int reg, int32_t imm32)
 {
@@ -210,6 +210,24 @@ size_t emit_add_reg_reg(emit_ctx_t * ctx, int dest, int src)
 
     return emit_bytes(rex, 0x01, modRM(0b11, src, dest));
 }
+
+
+// and reg64, imm32
+size_t emit_and_reg_imm32(emit_ctx_t * ctx, int reg, int32_t imm32)
+{
+    asm_emit("and %s, %d\n", reg_names[reg], imm32);
+
+    uint8_t rex = REX_W;
+
+    check_dst_reg(reg, rex);
+
+    size_t bytes_emitted = 0;
+
+    bytes_emitted += emit_bytes(rex, 0x81, modRM(0b11, 4, reg));
+    bytes_emitted += emit_imm32(imm32);
+
+    return bytes_emitted;
+}
 /**************************************************/
 
 
@@ -271,6 +289,24 @@ size_t emit_mov_mem_reg(emit_ctx_t * ctx, int dst, int32_t imm32, int src)
 }
 
 
+// mov reg64, QWORD[reg64 + imm32]
+size_t emit_mov_reg_mem(emit_ctx_t * ctx, int dst, int src, int32_t imm32)
+{
+    asm_emit("mov %s, QWORD[%s+(%d)]\n", reg_names[dst], reg_names[src], imm32);
+
+    uint8_t rex = REX_W;
+    check_src_reg(dst, rex);
+    check_dst_reg(src, rex);
+
+    size_t emitted_bytes = 0;
+
+    emitted_bytes += emit_bytes(rex, 0x8B, modRM(0b10, dst, src));
+    emitted_bytes += emit_imm32(imm32);
+
+    return emitted_bytes;
+}
+
+
 // mov reg64, imm64
 size_t emit_mov_reg_imm(emit_ctx_t * ctx, int reg, int64_t imm64)
 {
@@ -326,6 +362,23 @@ size_t emit_call_rel32(emit_ctx_t * ctx, int32_t rel32)
 
     return emitted_bytes;
 }
+
+// call QWORD[reg64 + imm32]
+size_t emit_call_mem(emit_ctx_t * ctx, int reg, int32_t imm32)
+{
+    asm_emit("call QWORD[%s+(%d)]\n", reg_names[reg], imm32);
+
+    size_t emitted_bytes = 0;
+
+    if (reg < 8)
+        emitted_bytes += emit_bytes(0xFF, modRM(0b10, 2, reg));
+    else
+        emitted_bytes += emit_bytes(REX_B, 0xFF, modRM(0b10, 2, reg - 8));
+
+    emitted_bytes += emit_imm32(imm32);
+
+    return emitted_bytes;
+}
 /***************************************************/
 
 
@@ -0,0 +1,161 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "backend_x64.h"
+#include "x64_jit.h"
+#include "x64_compile.h"
+#include "x64_emitters.h"
+#include "logger.h"
+
+typedef void (* jit_entry_t)();
+
+static size_t emitEntry(emit_ctx_t * ctx, size_t entry_addr, size_t start_addr);
+
+static void writePerfMap(const backend_ctx_t * ctx, const std_lib_t * std_lib, size_t code_size, size_t entry_size, uintptr_t base);
+
+
+int runProgram(backend_ctx_t * ctx, const std_lib_t * std_lib)
+{
+    assert(ctx);
+    assert(std_lib);
+
+    ctx->jit = true;
+
+    char * code = NULL;
+    size_t code_size = 0;
+
+    FILE * code_file = open_memstream(&code, &code_size);
+
+    size_t entry_addr = compileCode(ctx, std_lib, code_file);
+
+    emit_ctx_t emit_ctx = {
+        .bin_file = code_file,
+        .asm_file = NULL,
+        .emitting = true
+    };
+
+    size_t entry_size = emitEntry(&emit_ctx, entry_addr, std_lib->code_size);
+
+    fclose(code_file);
+
+    // the code is written while the memory is not executable and it is never writable after that
+    void * jit_code = mmap(NULL, code_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (jit_code == MAP_FAILED){
+        fprintf(ctx->diag_file, "X64 BACKEND: ERROR: cannot map %zu bytes for the code\n", code_size);
+        free(code);
+        return 1;
+    }
+
+    memcpy(jit_code, code, code_size);
+    free(code);
+
+    if (mprotect(jit_code, code_size, PROT_READ | PROT_EXEC) != 0){
+        fprintf(ctx->diag_file, "X64 BACKEND: ERROR: cannot make the code executable\n");
+        munmap(jit_code, code_size);
+        return 1;
+    }
+
+    writePerfMap(ctx, std_lib, entry_addr, entry_size, (uintptr_t)jit_code);
+
+    logPrint(LOG_DEBUG, "jit: %zu bytes of code at %p\n", code_size, jit_code);
+
+    // casting an object pointer to a function pointer is only conditionally supported, so the address is copied instead
+    jit_entry_t entry = NULL;
+    const char * entry_code = (char *)jit_code + entry_addr;
+    memcpy(&entry, &entry_code, sizeof(entry));
+
+    // the program writes with syscalls, so our buffered output goes first
+    fflush(stdout);
+
+    entry();
+
+    munmap(jit_code, code_size);
+
+    return 0;
+}
+
+
+FILE * openPerfMap(const char * mode)
+{
+    assert(mode);
+
+    char map_file_name[FILENAME_MAX] = {};
+    snprintf(map_file_name, FILENAME_MAX, PERF_MAP_FILE_FORMAT, getpid());
+
+    FILE * map_file = fopen(map_file_name, mode);
+    if (map_file == NULL)
+        logPrint(LOG_RELEASE, "jit: cannot write perf map '%s'\n", map_file_name);
+
+    return map_file;
+}
+
+
+void writePerfMapEntry(FILE * map_file, uintptr_t start, size_t size, const char * name)
+{
+    assert(map_file);
+    assert(name);
+
+    fprintf(map_file, "%lx %zx %s\n", start, size, name);
+}
+
+
+// exit of the program makes ret by the address _start saved in rbx, so it gets back here
+static size_t emitEntry(emit_ctx_t * ctx, size_t entry_addr, size_t start_addr)
+{
+    assert(ctx);
+
+    size_t code_size = 0;
+
+    for (size_t reg_index = 0; reg_index < JIT_SAVED_REGS_NUM; reg_index++)
+        code_size += emit_push_reg(ctx, JIT_SAVED_REGS[reg_index]);
+
+    int32_t rel_addr = (int32_t)start_addr - (int32_t)(entry_addr + code_size) - 5;
+    code_size += emit_call_rel32(ctx, rel_addr);
+
+    for (size_t reg_index = JIT_SAVED_REGS_NUM; reg_index > 0; reg_index--)
+        code_size += emit_pop_reg(ctx, JIT_SAVED_REGS[reg_index - 1]);
+
+    code_size += emit_ret(ctx);
+
+    return code_size;
+}
+
+
+// "start size name" in hex, every segment is either a top-level function or global statements
+static void writePerfMap(const backend_ctx_t * ctx, const std_lib_t * std_lib, size_t code_size, size_t entry_size, uintptr_t base)
+{
+    assert(ctx);
+    assert(std_lib);
+
+    FILE * map_file = openPerfMap("w");
+    if (map_file == NULL)
+        return;
+
+    writePerfMapEntry(map_file, base, std_lib->code_size, JIT_STD_LIB_SYMBOL);
+
+    for (size_t segment_index = 0; segment_index < ctx->segments_num; segment_index++){
+        const IR_segment_t * segment = ctx->segments + segment_index;
+
+        if (segment->code_size == 0)
+            continue;
+
+        const char * name = JIT_MAIN_SYMBOL;
+
+        if (segment->unit_index != NOT_UNIT_SEGMENT)
+            name = ctx->id_table[ctx->units[segment->unit_index].node->left->left->val.id].name;
+
+        writePerfMapEntry(map_file, base + segment->base_addr, segment->code_size, name);
+    }
+
+    writePerfMapEntry(map_file, base + code_size, entry_size, JIT_ENTRY_SYMBOL);
+
+    fclose(map_file);
+}
+
@@ -0,0 +1,384 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "x64_linker.h"
+#include "x64_object.h"
+#include "x64_compile.h"
+#include "elf_handler.h"
+#include "logger.h"
+
+// definition of a global symbol
+typedef struct {
+    const char * name;
+    size_t object;
+    size_t symbol;
+    bool weak;
+} link_symbol_t;
+
+typedef struct {
+    bool live;
+    size_t addr;            //< from the start of the code
+} link_section_t;
+
+// place of a symbol after the resolution
+typedef struct {
+    bool found;
+    size_t object;
+    size_t section;
+    size_t value;
+} link_target_t;
+
+typedef struct {
+    const x64_object_t ** objects;      //< std lib goes first, it is placed at the start of the code as before
+    size_t objects_num;
+
+    link_symbol_t * globals;            //< sorted by name, one definition for every name
+    size_t globals_num;
+
+    link_section_t ** sections;
+
+    FILE * diag_file;
+    bool failed;
+} linker_t;
+
+// sections to visit by the marking
+typedef struct {
+    size_t object;
+    size_t section;
+} section_ref_t;
+
+static void collectGlobals(linker_t * linker);
+
+static link_target_t resolveSymbol(linker_t * linker, size_t object_index, size_t symbol_index);
+
+static link_target_t findGlobal(linker_t * linker, const char * name);
+
+static void markLiveSections(linker_t * linker, link_target_t entry);
+
+static size_t placeSections(linker_t * linker);
+
+static void relocateSection(linker_t * linker, size_t object_index, size_t section_index, char * code);
+
+static int compareSymbolsByName(const void * first, const void * second);
+
+static int compareNameWithSymbol(const void * name, const void * symbol);
+
+
+x64_object_t stdLibObject(const std_lib_t * std_lib)
+{
+    assert(std_lib);
+
+    x64_object_t object = objectCtor();
+
+    size_t section = objectAddSection(&object, STD_LIB_SECTION_NAME, std_lib->code, std_lib->code_size);
+
+    objectAddSymbol(&object, OBJ_STD_IN_SYMBOL,      OBJ_GLOBAL, true, section, (size_t)std_lib->in_addr,   0);
+    objectAddSymbol(&object, OBJ_STD_OUT_SYMBOL,     OBJ_GLOBAL, true, section, (size_t)std_lib->out_addr,  0);
+    objectAddSymbol(&object, OBJ_STD_IO_INIT_SYMBOL, OBJ_GLOBAL, true, section, (size_t)std_lib->init_addr, 0);
+    objectAddSymbol(&object, OBJ_STD_IO_EXIT_SYMBOL, OBJ_GLOBAL, true, section, (size_t)std_lib->exit_addr, 0);
+
+    return object;
+}
+
+
+int linkObjects(const x64_object_t * objects, size_t objects_num, const std_lib_t * std_lib, FILE * elf_file, FILE * diag_file)
+{
+    assert(objects || objects_num == 0);
+    assert(std_lib);
+    assert(elf_file);
+    assert(diag_file);
+
+    x64_object_t std_object = stdLibObject(std_lib);
+
+    linker_t linker = {};
+
+    linker.objects_num = objects_num + 1;
+    linker.objects = (const x64_object_t **)calloc(linker.objects_num, sizeof(x64_object_t *));
+    linker.sections = (link_section_t **)calloc(linker.objects_num, sizeof(link_section_t *));
+    linker.diag_file = diag_file;
+
+    linker.objects[0] = &std_object;
+    for (size_t object_index = 0; object_index < objects_num; object_index++)
+        linker.objects[object_index + 1] = objects + object_index;
+
+    for (size_t object_index = 0; object_index < linker.objects_num; object_index++)
+        linker.sections[object_index] = (link_section_t *)calloc(linker.objects[object_index]->sections_num + 1, sizeof(link_section_t));
+
+    collectGlobals(&linker);
+
+    link_target_t entry = findGlobal(&linker, OBJ_ENTRY_SYMBOL);
+
+    if (! entry.found){
+        fprintf(diag_file, "X64 LINKER: ERROR: undefined entry point '%s'\n", OBJ_ENTRY_SYMBOL);
+        linker.failed = true;
+    }
+    else
+        markLiveSections(&linker, entry);
+
+    if (! linker.failed){
+        size_t code_size = placeSections(&linker);
+        char * code = (char *)calloc(code_size + 1, sizeof(char));
+
+        for (size_t object_index = 0; object_index < linker.objects_num; object_index++)
+            for (size_t section_index = 0; section_index < linker.objects[object_index]->sections_num; section_index++)
+                relocateSection(&linker, object_index, section_index, code);
+
+        size_t entry_addr = linker.sections[entry.object][entry.section].addr + entry.value;
+
+        if (! linker.failed){
+            writeSimpleElfHeader(elf_file, entry_addr, code_size);
+            fwrite(code, sizeof(char), code_size, elf_file);
+        }
+
+        free(code);
+    }
+
+    for (size_t object_index = 0; object_index < linker.objects_num; object_index++)
+        free(linker.sections[object_index]);
+
+    free(linker.sections);
+    free(linker.objects);
+    free(linker.globals);
+
+    objectDtor(&std_object);
+
+    return linker.failed ? 1 : 0;
+}
+
+
+// there must be one global definition of every name, weak ones are taken only if there are no global ones
+static void collectGlobals(linker_t * linker)
+{
+    assert(linker);
+
+    size_t capacity = 0;
+    for (size_t object_index = 0; object_index < linker->objects_num; object_index++)
+        capacity += linker->objects[object_index]->symbols_num;
+
+    link_symbol_t * definitions = (link_symbol_t *)calloc(capacity + 1, sizeof(link_symbol_t));
+    size_t definitions_num = 0;
+
+    for (size_t object_index = 0; object_index < linker->objects_num; object_index++){
+        const x64_object_t * object = linker->objects[object_index];
+
+        for (size_t symbol_index = 0; symbol_index < object->symbols_num; symbol_index++){
+            const obj_symbol_t * symbol = object->symbols + symbol_index;
+
+            if (symbol->bind == OBJ_LOCAL || symbol->section == OBJ_UNDEF_SECTION)
+                continue;
+
+            definitions[definitions_num++] = {
+                .name   = symbol->name,
+                .object = object_index,
+                .symbol = symbol_index,
+                .weak   = (symbol->bind == OBJ_WEAK)
+            };
+        }
+    }
+
+    // global definitions go before the weak ones, the earlier objects go first
+    qsort(definitions, definitions_num, sizeof(link_symbol_t), compareSymbolsByName);
+
+    size_t unique_num = 0;
+
+    for (size_t definition_index = 0; definition_index < definitions_num; definition_index++){
+        link_symbol_t * definition = definitions + definition_index;
+
+        if (unique_num > 0 && strcmp(definitions[unique_num - 1].name, definition->name) == 0){
+            if (! definition->weak){
+                fprintf(linker->diag_file, "X64 LINKER: ERROR: multiple definition of '%s'\n", definition->name);
+                linker->failed = true;
+            }
+
+            continue;
+        }
+
+        definitions[unique_num++] = *definition;
+    }
+
+    linker->globals     = definitions;
+    linker->globals_num = unique_num;
+}
+
+
+static link_target_t resolveSymbol(linker_t * linker, size_t object_index, size_t symbol_index)
+{
+    assert(linker);
+
+    const obj_symbol_t * symbol = linker->objects[object_index]->symbols + symbol_index;
+
+    if (symbol->bind == OBJ_LOCAL && symbol->section != OBJ_UNDEF_SECTION){
+        link_target_t target = {
+            .found   = true,
+            .object  = object_index,
+            .section = symbol->section,
+            .value   = symbol->value
+        };
+
+        return target;
+    }
+
+    return findGlobal(linker, symbol->name);
+}
+
+
+static link_target_t findGlobal(linker_t * linker, const char * name)
+{
+    assert(linker);
+    assert(name);
+
+    link_target_t target = {};
+
+    const link_symbol_t * found = (const link_symbol_t *)bsearch(name, linker->globals, linker->globals_num,
+                                                                 sizeof(link_symbol_t), compareNameWithSymbol);
+    if (found == NULL)
+        return target;
+
+    const obj_symbol_t * symbol = linker->objects[found->object]->symbols + found->symbol;
+
+    target.found   = true;
+    target.object  = found->object;
+    target.section = symbol->section;
+    target.value   = symbol->value;
+
+    return target;
+}
+
+
+// functions are in their own sections, so the sections nobody calls are dropped
+static void markLiveSections(linker_t * linker, link_target_t entry)
+{
+    assert(linker);
+
+    size_t capacity = OBJ_START_CAP;
+    section_ref_t * stack = (section_ref_t *)calloc(capacity, sizeof(section_ref_t));
+    size_t stack_size = 0;
+
+    linker->sections[entry.object][entry.section].live = true;
+    stack[stack_size++] = {.object = entry.object, .section = entry.section};
+
+    while (stack_size > 0){
+        section_ref_t cur = stack[--stack_size];
+        const obj_section_t * section = linker->objects[cur.object]->sections + cur.section;
+
+        for (size_t reloc_index = 0; reloc_index < section->relocs_num; reloc_index++){
+            size_t symbol_index = section->relocs[reloc_index].symbol;
+            link_target_t target = resolveSymbol(linker, cur.object, symbol_index);
+
+            if (! target.found){
+                fprintf(linker->diag_file, "X64 LINKER: ERROR: undefined reference to '%s' in %s\n",
+                        linker->objects[cur.object]->symbols[symbol_index].name, section->name);
+                linker->failed = true;
+                continue;
+            }
+
+            if (linker->sections[target.object][target.section].live)
+                continue;
+
+            linker->sections[target.object][target.section].live = true;
+
+            if (stack_size >= capacity){
+                capacity *= 2;
+                stack = (section_ref_t *)realloc(stack, capacity * sizeof(section_ref_t));
+            }
+
+            stack[stack_size++] = {.object = target.object, .section = target.section};
+        }
+    }
+
+    free(stack);
+}
+
+
+static size_t placeSections(linker_t * linker)
+{
+    assert(linker);
+
+    size_t cur_addr = 0;
+    size_t live_num = 0;
+    size_t sections_num = 0;
+
+    for (size_t object_index = 0; object_index < linker->objects_num; object_index++){
+        const x64_object_t * object = linker->objects[object_index];
+
+        for (size_t section_index = 0; section_index < object->sections_num; section_index++){
+            link_section_t * section = linker->sections[object_index] + section_index;
+
+            sections_num++;
+
+            if (! section->live)
+                continue;
+
+            section->addr = cur_addr;
+            cur_addr += object->sections[section_index].size;
+
+            live_num++;
+        }
+    }
+
+    logPrint(LOG_DEBUG, "linker: %zu of %zu sections are kept, code size = %zu\n", live_num, sections_num, cur_addr);
+
+    return cur_addr;
+}
+
+
+// rel32 = S + A - P, where all addresses are taken from the start of the code; symbols are resolved by the marking
+static void relocateSection(linker_t * linker, size_t object_index, size_t section_index, char * code)
+{
+    assert(linker);
+    assert(code);
+
+    const link_section_t * place = linker->sections[object_index] + section_index;
+
+    if (! place->live)
+        return;
+
+    const obj_section_t * section = linker->objects[object_index]->sections + section_index;
+
+    memcpy(code + place->addr, section->code, section->size);
+
+    for (size_t reloc_index = 0; reloc_index < section->relocs_num; reloc_index++){
+        const obj_reloc_t * reloc = section->relocs + reloc_index;
+
+        link_target_t target = resolveSymbol(linker, object_index, reloc->symbol);
+
+        int64_t symbol_addr = (int64_t)(linker->sections[target.object][target.section].addr + target.value);
+        int64_t reloc_addr  = (int64_t)(place->addr + reloc->offset);
+
+        int64_t rel_addr = symbol_addr + reloc->addend - reloc_addr;
+
+        if (rel_addr < INT32_MIN || rel_addr > INT32_MAX){
+            fprintf(linker->diag_file, "X64 LINKER: ERROR: '%s' is too far\n", linker->objects[object_index]->symbols[reloc->symbol].name);
+            linker->failed = true;
+            continue;
+        }
+
+        int32_t rel32 = (int32_t)rel_addr;
+        memcpy(code + reloc_addr, &rel32, sizeof(rel32));
+    }
+}
+
+
+static int compareSymbolsByName(const void * first, const void * second)
+{
+    const link_symbol_t * first_symbol  = (const link_symbol_t *)first;
+    const link_symbol_t * second_symbol = (const link_symbol_t *)second;
+
+    int name_cmp = strcmp(first_symbol->name, second_symbol->name);
+    if (name_cmp != 0)
+        return name_cmp;
+
+    if (first_symbol->weak != second_symbol->weak)
+        return first_symbol->weak ? 1 : -1;
+
+    return (first_symbol->object > second_symbol->object) - (first_symbol->object < second_symbol->object);
+}
+
+
+static int compareNameWithSymbol(const void * name, const void * symbol)
+{
+    return strcmp((const char *)name, ((const link_symbol_t *)symbol)->name);
+}
@@ -0,0 +1,615 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <elf.h>
+
+#include "x64_object.h"
+#include "logger.h"
+
+// all sections of the elf except the null one: code, relocations of the code, .symtab, .strtab, .shstrtab, .note.GNU-stack
+typedef struct {
+    size_t * rela_index;            //< index of .rela section of every code section, 0 if there are no relocations
+    size_t symtab_index;
+    size_t strtab_index;
+    size_t shstrtab_index;
+    size_t note_stack_index;        //< empty, tells the host linker that the code does not need executable stack
+    size_t sections_num;
+
+    size_t * symbol_index;          //< index of every symbol in .symtab, locals go first
+    size_t first_global;
+} obj_layout_t;
+
+static obj_layout_t makeLayout(const x64_object_t * object);
+
+static size_t writeStringTable(FILE * table, const char * str);
+
+static size_t writePadding(FILE * file, size_t offset, size_t align);
+
+static bool loadSections(x64_object_t * object, const char * elf, size_t elf_size, const char * obj_file_name);
+
+static bool checkRange(size_t offset, size_t size, size_t elf_size);
+
+static const char * getString(const char * elf, size_t elf_size, const Elf64_Shdr * table, size_t str_offset);
+
+
+x64_object_t objectCtor()
+{
+    x64_object_t object = {};
+
+    object.sections_capacity = OBJ_START_CAP;
+    object.sections = (obj_section_t *)calloc(object.sections_capacity, sizeof(obj_section_t));
+
+    object.symbols_capacity = OBJ_START_CAP;
+    object.symbols = (obj_symbol_t *)calloc(object.symbols_capacity, sizeof(obj_symbol_t));
+
+    return object;
+}
+
+
+void objectDtor(x64_object_t * object)
+{
+    assert(object);
+
+    for (size_t section_index = 0; section_index < object->sections_num; section_index++){
+        free(object->sections[section_index].code);
+        free(object->sections[section_index].relocs);
+    }
+
+    free(object->sections);
+    free(object->symbols);
+
+    *object = {};
+}
+
+
+size_t objectAddSection(x64_object_t * object, const char * name, const char * code, size_t size)
+{
+    assert(object);
+    assert(name);
+    assert(code || size == 0);
+
+    if (object->sections_num >= object->sections_capacity){
+        object->sections_capacity *= 2;
+        object->sections = (obj_section_t *)realloc(object->sections, object->sections_capacity * sizeof(obj_section_t));
+    }
+
+    obj_section_t * section = object->sections + object->sections_num;
+    *section = {};
+
+    strncpy(section->name, name, OBJ_MAX_SECTION_NAME_LEN - 1);
+
+    section->code = (char *)calloc(size + 1, sizeof(char));
+    section->size = size;
+    if (size > 0)
+        memcpy(section->code, code, size);
+
+    return object->sections_num++;
+}
+
+
+size_t objectAddSymbol(x64_object_t * object, const char * name, enum obj_symbol_bind bind, bool is_func,
+                       size_t section, size_t value, size_t size)
+{
+    assert(object);
+    assert(name);
+
+    if (object->symbols_num >= object->symbols_capacity){
+        object->symbols_capacity *= 2;
+        object->symbols = (obj_symbol_t *)realloc(object->symbols, object->symbols_capacity * sizeof(obj_symbol_t));
+    }
+
+    obj_symbol_t * symbol = object->symbols + object->symbols_num;
+    *symbol = {};
+
+    strncpy(symbol->name, name, NAME_MAX_LENGTH - 1);
+
+    symbol->bind    = bind;
+    symbol->is_func = is_func;
+    symbol->section = section;
+    symbol->value   = value;
+    symbol->size    = size;
+
+    return object->symbols_num++;
+}
+
+
+void objectAddReloc(x64_object_t * object, size_t section, size_t offset, size_t symbol, int64_t addend)
+{
+    assert(object);
+    assert(section < object->sections_num);
+    assert(symbol  < object->symbols_num);
+
+    obj_section_t * cur_section = object->sections + section;
+
+    if (cur_section->relocs_num >= cur_section->relocs_capacity){
+        cur_section->relocs_capacity = (cur_section->relocs_capacity == 0) ? OBJ_START_CAP : cur_section->relocs_capacity * 2;
+        cur_section->relocs = (obj_reloc_t *)realloc(cur_section->relocs, cur_section->relocs_capacity * sizeof(obj_reloc_t));
+    }
+
+    obj_reloc_t * reloc = cur_section->relocs + cur_section->relocs_num;
+    cur_section->relocs_num++;
+
+    reloc->offset = offset;
+    reloc->symbol = symbol;
+    reloc->addend = addend;
+}
+
+
+void objectWrite(const x64_object_t * object, FILE * obj_file)
+{
+    assert(object);
+    assert(obj_file);
+
+    /*
+    structure will be like this:
+
+    Elf64_Ehdr
+    <code of the sections>
+    <relocations of the sections>
+    .symtab
+    .strtab
+    .shstrtab
+    Elf64_Shdr[]            (.note.GNU-stack is empty, it has only the header)
+    */
+
+    obj_layout_t layout = makeLayout(object);
+
+    Elf64_Shdr * headers = (Elf64_Shdr *)calloc(layout.sections_num, sizeof(Elf64_Shdr));
+
+    char * shstrtab = NULL;
+    size_t shstrtab_size = 0;
+    FILE * shstrtab_file = open_memstream(&shstrtab, &shstrtab_size);
+    writeStringTable(shstrtab_file, "");
+
+    char * strtab = NULL;
+    size_t strtab_size = 0;
+    FILE * strtab_file = open_memstream(&strtab, &strtab_size);
+    writeStringTable(strtab_file, "");
+
+    // the header is written when the offset of the section headers is known
+    Elf64_Ehdr elf_hdr = {};
+    fwrite(&elf_hdr, sizeof(elf_hdr), 1, obj_file);
+
+    size_t offset = sizeof(Elf64_Ehdr);
+
+    for (size_t section_index = 0; section_index < object->sections_num; section_index++){
+        const obj_section_t * section = object->sections + section_index;
+        Elf64_Shdr * header = headers + section_index + 1;
+
+        header->sh_name      = (Elf64_Word)writeStringTable(shstrtab_file, section->name);
+        header->sh_type      = SHT_PROGBITS;
+        header->sh_flags     = SHF_ALLOC | SHF_EXECINSTR;
+        header->sh_offset    = offset;
+        header->sh_size      = section->size;
+        header->sh_addralign = 1;
+
+        fwrite(section->code, sizeof(char), section->size, obj_file);
+        offset += section->size;
+    }
+
+    for (size_t section_index = 0; section_index < object->sections_num; section_index++){
+        const obj_section_t * section = object->sections + section_index;
+
+        if (layout.rela_index[section_index] == 0)
+            continue;
+
+        offset = writePadding(obj_file, offset, sizeof(Elf64_Xword));
+
+        char rela_name[OBJ_MAX_SECTION_NAME_LEN + 8] = {};
+        snprintf(rela_name, sizeof(rela_name), ".rela%s", section->name);
+
+        Elf64_Shdr * header = headers + layout.rela_index[section_index];
+
+        header->sh_name      = (Elf64_Word)writeStringTable(shstrtab_file, rela_name);
+        header->sh_type      = SHT_RELA;
+        header->sh_flags     = SHF_INFO_LINK;
+        header->sh_offset    = offset;
+        header->sh_size      = section->relocs_num * sizeof(Elf64_Rela);
+        header->sh_link      = (Elf64_Word)layout.symtab_index;
+        header->sh_info      = (Elf64_Word)(section_index + 1);
+        header->sh_addralign = sizeof(Elf64_Xword);
+        header->sh_entsize   = sizeof(Elf64_Rela);
+
+        for (size_t reloc_index = 0; reloc_index < section->relocs_num; reloc_index++){
+            const obj_reloc_t * reloc = section->relocs + reloc_index;
+
+            Elf64_Rela rela = {
+                .r_offset = reloc->offset,
+                .r_info   = ELF64_R_INFO(layout.symbol_index[reloc->symbol], R_X86_64_PLT32),
+                .r_addend = reloc->addend
+            };
+
+            fwrite(&rela, sizeof(rela), 1, obj_file);
+        }
+
+        offset += header->sh_size;
+    }
+
+    offset = writePadding(obj_file, offset, sizeof(Elf64_Xword));
+
+    Elf64_Sym * symtab = (Elf64_Sym *)calloc(object->symbols_num + 1, sizeof(Elf64_Sym));
+
+    for (size_t symbol_index = 0; symbol_index < object->symbols_num; symbol_index++){
+        const obj_symbol_t * symbol = object->symbols + symbol_index;
+        Elf64_Sym * elf_symbol = symtab + layout.symbol_index[symbol_index];
+
+        unsigned char bind = (symbol->bind == OBJ_LOCAL) ? STB_LOCAL : (symbol->bind == OBJ_WEAK) ? STB_WEAK : STB_GLOBAL;
+        unsigned char type = symbol->is_func ? STT_FUNC : STT_NOTYPE;
+
+        elf_symbol->st_name  = (Elf64_Word)writeStringTable(strtab_file, symbol->name);
+        elf_symbol->st_info  = (unsigned char)ELF64_ST_INFO(bind, type);
+        elf_symbol->st_other = STV_DEFAULT;
+        elf_symbol->st_shndx = (symbol->section == OBJ_UNDEF_SECTION) ? SHN_UNDEF : (Elf64_Section)(symbol->section + 1);
+        elf_symbol->st_value = symbol->value;
+        elf_symbol->st_size  = symbol->size;
+    }
+
+    Elf64_Shdr * symtab_header = headers + layout.symtab_index;
+
+    symtab_header->sh_name      = (Elf64_Word)writeStringTable(shstrtab_file, ".symtab");
+    symtab_header->sh_type      = SHT_SYMTAB;
+    symtab_header->sh_offset    = offset;
+    symtab_header->sh_size      = (object->symbols_num + 1) * sizeof(Elf64_Sym);
+    symtab_header->sh_link      = (Elf64_Word)layout.strtab_index;
+    symtab_header->sh_info      = (Elf64_Word)layout.first_global;
+    symtab_header->sh_addralign = sizeof(Elf64_Xword);
+    symtab_header->sh_entsize   = sizeof(Elf64_Sym);
+
+    fwrite(symtab, sizeof(Elf64_Sym), object->symbols_num + 1, obj_file);
+    offset += symtab_header->sh_size;
+
+    free(symtab);
+
+    Elf64_Shdr * strtab_header = headers + layout.strtab_index;
+
+    strtab_header->sh_name = (Elf64_Word)writeStringTable(shstrtab_file, ".strtab");
+    Elf64_Shdr * shstrtab_header = headers + layout.shstrtab_index;
+    shstrtab_header->sh_name = (Elf64_Word)writeStringTable(shstrtab_file, ".shstrtab");
+
+    Elf64_Shdr * note_stack_header = headers + layout.note_stack_index;
+    note_stack_header->sh_name = (Elf64_Word)writeStringTable(shstrtab_file, ".note.GNU-stack");
+
+    fclose(strtab_file);
+    fclose(shstrtab_file);
+
+    strtab_header->sh_type      = SHT_STRTAB;
+    strtab_header->sh_offset    = offset;
+    strtab_header->sh_size      = strtab_size;
+    strtab_header->sh_addralign = 1;
+
+    fwrite(strtab, sizeof(char), strtab_size, obj_file);
+    offset += strtab_size;
+
+    shstrtab_header->sh_type      = SHT_STRTAB;
+    shstrtab_header->sh_offset    = offset;
+    shstrtab_header->sh_size      = shstrtab_size;
+    shstrtab_header->sh_addralign = 1;
+
+    fwrite(shstrtab, sizeof(char), shstrtab_size, obj_file);
+    offset += shstrtab_size;
+
+    note_stack_header->sh_type      = SHT_PROGBITS;
+    note_stack_header->sh_offset    = offset;
+    note_stack_header->sh_addralign = 1;
+
+    free(strtab);
+    free(shstrtab);
+
+    offset = writePadding(obj_file, offset, sizeof(Elf64_Xword));
+
+    fwrite(headers, sizeof(Elf64_Shdr), layout.sections_num, obj_file);
+
+    elf_hdr = {
+        .e_ident = {
+            [EI_MAG0] = ELFMAG0,
+            [EI_MAG1] = ELFMAG1,
+            [EI_MAG2] = ELFMAG2,
+            [EI_MAG3] = ELFMAG3,
+
+            [EI_CLASS]   = ELFCLASS64,
+            [EI_DATA]    = ELFDATA2LSB,
+            [EI_VERSION] = EV_CURRENT,
+        },
+        .e_type    = ET_REL,
+        .e_machine = EM_X86_64,
+        .e_version = EV_CURRENT,
+
+        .e_shoff     = offset,
+        .e_ehsize    = sizeof(Elf64_Ehdr),
+        .e_shentsize = sizeof(Elf64_Shdr),
+        .e_shnum     = (Elf64_Half)layout.sections_num,
+        .e_shstrndx  = (Elf64_Half)layout.shstrtab_index
+    };
+
+    fseek(obj_file, 0, SEEK_SET);
+    fwrite(&elf_hdr, sizeof(elf_hdr), 1, obj_file);
+    fseek(obj_file, 0, SEEK_END);
+
+    free(headers);
+    free(layout.rela_index);
+    free(layout.symbol_index);
+}
+
+
+x64_object_t objectLoad(const char * obj_file_name)
+{
+    assert(obj_file_name);
+
+    x64_object_t object = {};
+
+    FILE * obj_file = fopen(obj_file_name, "rb");
+    if (obj_file == NULL){
+        fprintf(stderr, "X64 BACKEND: ERROR: cannot open object '%s'\n", obj_file_name);
+        return object;
+    }
+
+    fseek(obj_file, 0, SEEK_END);
+    size_t elf_size = (size_t)ftell(obj_file);
+    fseek(obj_file, 0, SEEK_SET);
+
+    char * elf = (char *)calloc(elf_size + 1, sizeof(char));
+    elf_size = fread(elf, sizeof(char), elf_size, obj_file);
+
+    fclose(obj_file);
+
+    object = objectCtor();
+
+    if (! loadSections(&object, elf, elf_size, obj_file_name))
+        objectDtor(&object);
+
+    free(elf);
+
+    return object;
+}
+
+
+static obj_layout_t makeLayout(const x64_object_t * object)
+{
+    assert(object);
+
+    obj_layout_t layout = {};
+
+    // null section goes first, code sections keep their indices + 1
+    size_t section_index = object->sections_num + 1;
+
+    layout.rela_index = (size_t *)calloc(object->sections_num + 1, sizeof(size_t));
+
+    for (size_t code_index = 0; code_index < object->sections_num; code_index++)
+        if (object->sections[code_index].relocs_num > 0)
+            layout.rela_index[code_index] = section_index++;
+
+    layout.symtab_index     = section_index++;
+    layout.strtab_index     = section_index++;
+    layout.shstrtab_index   = section_index++;
+    layout.note_stack_index = section_index++;
+    layout.sections_num     = section_index;
+
+    // null symbol goes first, elf wants local symbols before the global ones
+    layout.symbol_index = (size_t *)calloc(object->symbols_num + 1, sizeof(size_t));
+
+    size_t symbol_index = 1;
+
+    for (size_t cur_index = 0; cur_index < object->symbols_num; cur_index++)
+        if (object->symbols[cur_index].bind == OBJ_LOCAL)
+            layout.symbol_index[cur_index] = symbol_index++;
+
+    layout.first_global = symbol_index;
+
+    for (size_t cur_index = 0; cur_index < object->symbols_num; cur_index++)
+        if (object->symbols[cur_index].bind != OBJ_LOCAL)
+            layout.symbol_index[cur_index] = symbol_index++;
+
+    return layout;
+}
+
+
+static size_t writeStringTable(FILE * table, const char * str)
+{
+    assert(table);
+    assert(str);
+
+    size_t offset = (size_t)ftell(table);
+    fwrite(str, sizeof(char), strlen(str) + 1, table);
+
+    return offset;
+}
+
+
+static size_t writePadding(FILE * file, size_t offset, size_t align)
+{
+    assert(file);
+
+    for ( ; offset % align != 0; offset++)
+        fputc(0, file);
+
+    return offset;
+}
+
+
+// code sections are taken as they are, the others must not be loaded: objects contain code only
+static bool loadSections(x64_object_t * object, const char * elf, size_t elf_size, const char * obj_file_name)
+{
+    assert(object);
+    assert(elf);
+    assert(obj_file_name);
+
+    Elf64_Ehdr elf_hdr = {};
+
+    if (elf_size < sizeof(elf_hdr)){
+        fprintf(stderr, "X64 BACKEND: ERROR: '%s' is not an elf\n", obj_file_name);
+        return false;
+    }
+
+    memcpy(&elf_hdr, elf, sizeof(elf_hdr));
+
+    if (memcmp(elf_hdr.e_ident, ELFMAG, SELFMAG) != 0 || elf_hdr.e_ident[EI_CLASS] != ELFCLASS64 ||
+        elf_hdr.e_ident[EI_DATA] != ELFDATA2LSB || elf_hdr.e_type != ET_REL || elf_hdr.e_machine != EM_X86_64 ||
+        elf_hdr.e_shentsize != sizeof(Elf64_Shdr) || ! checkRange(elf_hdr.e_shoff, elf_hdr.e_shnum * sizeof(Elf64_Shdr), elf_size) ||
+        elf_hdr.e_shstrndx >= elf_hdr.e_shnum){
+        fprintf(stderr, "X64 BACKEND: ERROR: '%s' is not an x86-64 relocatable elf\n", obj_file_name);
+        return false;
+    }
+
+    size_t sections_num = elf_hdr.e_shnum;
+
+    Elf64_Shdr * headers = (Elf64_Shdr *)calloc(sections_num + 1, sizeof(Elf64_Shdr));
+    memcpy(headers, elf + elf_hdr.e_shoff, sections_num * sizeof(Elf64_Shdr));
+
+    const Elf64_Shdr * shstrtab = headers + elf_hdr.e_shstrndx;
+
+    // index in the object of every code section of the elf
+    size_t * section_map = (size_t *)calloc(sections_num + 1, sizeof(size_t));
+    const Elf64_Shdr * symtab = NULL;
+
+    bool loaded = true;
+
+    for (size_t section_index = 0; section_index < sections_num && loaded; section_index++){
+        const Elf64_Shdr * header = headers + section_index;
+
+        section_map[section_index] = OBJ_UNDEF_SECTION;
+
+        if (header->sh_type == SHT_SYMTAB)
+            symtab = header;
+
+        if (header->sh_type == SHT_REL){
+            fprintf(stderr, "X64 BACKEND: ERROR: '%s': relocations without addends are not supported\n", obj_file_name);
+            loaded = false;
+        }
+
+        if ((header->sh_flags & SHF_ALLOC) == 0)
+            continue;
+
+        const char * name = getString(elf, elf_size, shstrtab, header->sh_name);
+
+        if (header->sh_type != SHT_PROGBITS || (header->sh_flags & SHF_EXECINSTR) == 0 || name == NULL ||
+            ! checkRange(header->sh_offset, header->sh_size, elf_size)){
+            fprintf(stderr, "X64 BACKEND: ERROR: '%s': only code sections are supported\n", obj_file_name);
+            loaded = false;
+            break;
+        }
+
+        section_map[section_index] = objectAddSection(object, name, elf + header->sh_offset, header->sh_size);
+    }
+
+    if (loaded && (symtab == NULL || symtab->sh_entsize != sizeof(Elf64_Sym) || symtab->sh_link >= sections_num ||
+                   ! checkRange(symtab->sh_offset, symtab->sh_size, elf_size))){
+        fprintf(stderr, "X64 BACKEND: ERROR: '%s' has no symbol table\n", obj_file_name);
+        loaded = false;
+    }
+
+    size_t elf_symbols_num = loaded ? symtab->sh_size / sizeof(Elf64_Sym) : 0;
+    size_t * symbol_map = (size_t *)calloc(elf_symbols_num + 1, sizeof(size_t));
+
+    for (size_t symbol_index = 1; symbol_index < elf_symbols_num && loaded; symbol_index++){
+        Elf64_Sym elf_symbol = {};
+        memcpy(&elf_symbol, elf + symtab->sh_offset + symbol_index * sizeof(Elf64_Sym), sizeof(elf_symbol));
+
+        symbol_map[symbol_index] = OBJ_UNDEF_SECTION;
+
+        unsigned char type = ELF64_ST_TYPE(elf_symbol.st_info);
+        unsigned char bind = ELF64_ST_BIND(elf_symbol.st_info);
+
+        if (type == STT_FILE)
+            continue;
+
+        const char * name = getString(elf, elf_size, headers + symtab->sh_link, elf_symbol.st_name);
+
+        size_t section = OBJ_UNDEF_SECTION;
+
+        if (elf_symbol.st_shndx != SHN_UNDEF){
+            section = (elf_symbol.st_shndx < sections_num) ? section_map[elf_symbol.st_shndx] : OBJ_UNDEF_SECTION;
+
+            if (section == OBJ_UNDEF_SECTION){
+                fprintf(stderr, "X64 BACKEND: ERROR: '%s': symbol '%s' is not in the code\n", obj_file_name, (name == NULL) ? "" : name);
+                loaded = false;
+                break;
+            }
+        }
+
+        // symbols of sections have no names
+        if (type == STT_SECTION)
+            name = object->sections[section].name;
+
+        if (name == NULL || strlen(name) >= NAME_MAX_LENGTH){
+            fprintf(stderr, "X64 BACKEND: ERROR: '%s': bad name of symbol %zu\n", obj_file_name, symbol_index);
+            loaded = false;
+            break;
+        }
+
+        enum obj_symbol_bind obj_bind = (bind == STB_LOCAL) ? OBJ_LOCAL : (bind == STB_WEAK) ? OBJ_WEAK : OBJ_GLOBAL;
+
+        symbol_map[symbol_index] = objectAddSymbol(object, name, obj_bind, type == STT_FUNC, section,
+                                                   elf_symbol.st_value, elf_symbol.st_size);
+    }
+
+    for (size_t section_index = 0; section_index < sections_num && loaded; section_index++){
+        const Elf64_Shdr * header = headers + section_index;
+
+        if (header->sh_type != SHT_RELA)
+            continue;
+
+        size_t target = (header->sh_info < sections_num) ? section_map[header->sh_info] : OBJ_UNDEF_SECTION;
+
+        // relocations of the sections that are not loaded (debug info) are not needed
+        if (target == OBJ_UNDEF_SECTION)
+            continue;
+
+        if (header->sh_entsize != sizeof(Elf64_Rela) || ! checkRange(header->sh_offset, header->sh_size, elf_size)){
+            fprintf(stderr, "X64 BACKEND: ERROR: '%s': bad relocation section\n", obj_file_name);
+            loaded = false;
+            break;
+        }
+
+        for (size_t reloc_index = 0; reloc_index < header->sh_size / sizeof(Elf64_Rela); reloc_index++){
+            Elf64_Rela rela = {};
+            memcpy(&rela, elf + header->sh_offset + reloc_index * sizeof(Elf64_Rela), sizeof(rela));
+
+            size_t elf_symbol = ELF64_R_SYM(rela.r_info);
+            size_t type       = ELF64_R_TYPE(rela.r_info);
+
+            bool known_symbol = (elf_symbol > 0 && elf_symbol < elf_symbols_num && symbol_map[elf_symbol] != OBJ_UNDEF_SECTION);
+
+            if ((type != R_X86_64_PC32 && type != R_X86_64_PLT32) || ! known_symbol ||
+                rela.r_offset + sizeof(int32_t) > object->sections[target].size){
+                fprintf(stderr, "X64 BACKEND: ERROR: '%s': unsupported relocation %zu at 0x%lx\n", obj_file_name, type, rela.r_offset);
+                loaded = false;
+                break;
+            }
+
+            objectAddReloc(object, target, rela.r_offset, symbol_map[elf_symbol], rela.r_addend);
+        }
+    }
+
+    free(symbol_map);
+    free(section_map);
+    free(headers);
+
+    return loaded;
+}
+
+
+static bool checkRange(size_t offset, size_t size, size_t elf_size)
+{
+    return offset <= elf_size && size <= elf_size - offset;
+}
+
+
+static const char * getString(const char * elf, size_t elf_size, const Elf64_Shdr * table, size_t str_offset)
+{
+    assert(elf);
+    assert(table);
+
+    if (table->sh_type != SHT_STRTAB || ! checkRange(table->sh_offset, table->sh_size, elf_size) || str_offset >= table->sh_size)
+        return NULL;
+
+    const char * str = elf + table->sh_offset + str_offset;
+
+    // the string must end inside the table
+    if (memchr(str, '\0', table->sh_size - str_offset) == NULL)
+        return NULL;
+
+    return str;
+}
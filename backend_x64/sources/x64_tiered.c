@@ -0,0 +1,531 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "backend_x64.h"
+#include "x64_tiered.h"
+#include "x64_compile.h"
+#include "x64_emitters.h"
+#include "x64_c_abi.h"
+#include "x64_jit.h"
+#include "ir_interpreter.h"
+#include "logger.h"
+
+const size_t NOT_FUNC_UNIT = SIZE_MAX;
+
+// laid out as the hook table of x64_c_abi.h
+typedef struct {
+    int64_t (* in)(void * user);
+    void (* out)(void * user, int64_t value);
+    void * user;
+} tier_hooks_t;
+
+typedef struct {
+    backend_ctx_t * backend;
+
+    // native in and out go to the files of the interpreter through the hooks, so both take the same buffers
+    FILE * in_file;
+    FILE * out_file;
+    tier_hooks_t hooks;
+
+    char * region;                      //< reserved without access, chunks of it are made executable one by one
+    size_t region_used;
+    size_t page_size;
+
+    const char * std_in_stub;           //< native functions call them
+    const char * std_out_stub;
+    native_call_t native_call;
+
+    const void ** native_funcs;         //< by unit index, the interpreter reads them atomically
+    bool * failed;                      //< functions that call something besides the top-level functions
+    size_t * label_units;               //< unit of the label of every top-level function
+    const IR_segment_t ** unit_segments;
+
+    // hot functions in the order they became hot, the interpreter reports every function once
+    size_t * queue;
+    size_t queue_size;
+    size_t queue_pos;
+    bool stopping;
+
+    pthread_mutex_t lock;
+    pthread_cond_t  wake;
+
+    FILE * perf_map;
+} tier_ctx_t;
+
+static int tierInit(tier_ctx_t * tier, backend_ctx_t * ctx, FILE * in_file, FILE * out_file);
+
+static void tierDestroy(tier_ctx_t * tier);
+
+static size_t emitNativeCall(emit_ctx_t * ctx, const tier_hooks_t * hooks);
+
+static int64_t tierIn(void * user);
+
+static void tierOut(void * user, int64_t value);
+
+static void onHot(interp_tiering_t * tiering, size_t unit_index);
+
+static void * compilerMain(void * shared);
+
+static void compileHotFunc(tier_ctx_t * tier, size_t unit_index);
+
+static size_t collectCallees(tier_ctx_t * tier, size_t unit_index, size_t * group, size_t * group_index);
+
+static void patchCalls(tier_ctx_t * tier, size_t unit_index, char * code, size_t func_offset, const char * chunk,
+                       const size_t * group_index, const size_t * offsets);
+
+static char * reserveChunk(tier_ctx_t * tier, size_t size);
+
+static bool commitChunk(tier_ctx_t * tier, char * chunk, const char * code, size_t size);
+
+
+int runTiered(backend_ctx_t * ctx, size_t hot_threshold)
+{
+    assert(ctx);
+    assert(hot_threshold > 0);
+
+    tier_ctx_t tier = {};
+
+    if (tierInit(&tier, ctx, stdin, stdout) != 0){
+        tierDestroy(&tier);
+        return 1;
+    }
+
+    interp_tiering_t tiering = {
+        .hot_threshold = hot_threshold,
+        .on_hot        = onHot,
+        .ctx           = &tier,
+        .native_funcs  = tier.native_funcs,
+        .call_native   = tier.native_call
+    };
+
+    pthread_t compiler = {};
+    bool background = (pthread_create(&compiler, NULL, compilerMain, &tier) == 0);
+
+    if (!background)
+        logPrint(LOG_RELEASE, "tiered: cannot start the compiler thread, the program is interpreted\n");
+
+    int status = interpretProgram(ctx, tier.in_file, tier.out_file, &tiering);
+
+    if (background){
+        pthread_mutex_lock(&tier.lock);
+        tier.stopping = true;
+        pthread_cond_signal(&tier.wake);
+        pthread_mutex_unlock(&tier.lock);
+
+        pthread_join(compiler, NULL);
+    }
+
+    tierDestroy(&tier);
+
+    return status;
+}
+
+
+// the first chunk of the region is std in/out and the entry the interpreter calls native functions by
+static int tierInit(tier_ctx_t * tier, backend_ctx_t * ctx, FILE * in_file, FILE * out_file)
+{
+    assert(tier);
+    assert(ctx);
+    assert(in_file);
+    assert(out_file);
+
+    tier->backend   = ctx;
+    tier->in_file   = in_file;
+    tier->out_file  = out_file;
+    tier->page_size = (size_t)sysconf(_SC_PAGESIZE);
+
+    tier->hooks.in   = tierIn;
+    tier->hooks.out  = tierOut;
+    tier->hooks.user = tier;
+
+    pthread_mutex_init(&tier->lock, NULL);
+    pthread_cond_init(&tier->wake, NULL);
+
+    size_t units_num = ctx->units_num;
+
+    tier->native_funcs  = (const void **)calloc(units_num + 1, sizeof(const void *));
+    tier->failed        = (bool *)calloc(units_num + 1, sizeof(bool));
+    tier->queue         = (size_t *)calloc(units_num + 1, sizeof(size_t));
+    tier->unit_segments = (const IR_segment_t **)calloc(units_num + 1, sizeof(const IR_segment_t *));
+    tier->label_units   = (size_t *)calloc(ctx->IR.size + 1, sizeof(size_t));
+
+    for (size_t block_index = 0; block_index < ctx->IR.size; block_index++)
+        tier->label_units[block_index] = NOT_FUNC_UNIT;
+
+    for (size_t segment_index = 0; segment_index < ctx->segments_num; segment_index++){
+        const IR_segment_t * segment = ctx->segments + segment_index;
+
+        if (segment->unit_index == NOT_UNIT_SEGMENT)
+            continue;
+
+        tier->unit_segments[segment->unit_index] = segment;
+        tier->label_units[segmentFuncLabel(ctx, segment)] = segment->unit_index;
+    }
+
+    tier->perf_map = openPerfMap("a");
+
+    void * region = mmap(NULL, TIER_CODE_REGION_SIZE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+    if (region == MAP_FAILED){
+        fprintf(ctx->diag_file, "X64 BACKEND: ERROR: cannot reserve %zu bytes for the code\n", TIER_CODE_REGION_SIZE);
+        return 1;
+    }
+
+    tier->region = (char *)region;
+
+    char * code = NULL;
+    size_t code_size = 0;
+
+    FILE * code_file = open_memstream(&code, &code_size);
+
+    emit_ctx_t emit_ctx = {
+        .bin_file = code_file,
+        .asm_file = NULL,
+        .emitting = true
+    };
+
+    size_t in_stub_size     = emitHookInStub(&emit_ctx);
+    size_t out_stub_size    = emitHookOutStub(&emit_ctx);
+    size_t native_call_size = emitNativeCall(&emit_ctx, &tier->hooks);
+
+    fclose(code_file);
+
+    char * chunk = reserveChunk(tier, code_size);
+    bool committed = (chunk != NULL && commitChunk(tier, chunk, code, code_size));
+
+    free(code);
+
+    if (!committed){
+        fprintf(ctx->diag_file, "X64 BACKEND: ERROR: cannot make std in/out executable\n");
+        return 1;
+    }
+
+    tier->std_in_stub  = chunk;
+    tier->std_out_stub = chunk + in_stub_size;
+
+    // copied as the entry in x64_jit.c, the code is not a function to C++
+    const char * native_call_code = chunk + in_stub_size + out_stub_size;
+    memcpy(&tier->native_call, &native_call_code, sizeof(tier->native_call));
+
+    if (tier->perf_map != NULL){
+        writePerfMapEntry(tier->perf_map, (uintptr_t)tier->std_in_stub,  in_stub_size,     OBJ_STD_IN_SYMBOL);
+        writePerfMapEntry(tier->perf_map, (uintptr_t)tier->std_out_stub, out_stub_size,    OBJ_STD_OUT_SYMBOL);
+        writePerfMapEntry(tier->perf_map, (uintptr_t)native_call_code,   native_call_size, TIER_NATIVE_CALL_SYMBOL);
+        fflush(tier->perf_map);
+    }
+
+    return 0;
+}
+
+
+static void tierDestroy(tier_ctx_t * tier)
+{
+    assert(tier);
+
+    if (tier->region != NULL)
+        munmap(tier->region, TIER_CODE_REGION_SIZE);
+
+    if (tier->perf_map != NULL)
+        fclose(tier->perf_map);
+
+    free(tier->native_funcs);
+    free(tier->failed);
+    free(tier->queue);
+    free(tier->unit_segments);
+    free(tier->label_units);
+
+    pthread_mutex_destroy(&tier->lock);
+    pthread_cond_destroy(&tier->wake);
+}
+
+
+// int64_t (const void * func, int64_t * stack_top, int64_t * globals): the function runs on the stack of the interpreter
+// with rbx of the program, the stack of C is kept in r13 and the hook table in r15, the compiled code never touches them
+static size_t emitNativeCall(emit_ctx_t * ctx, const tier_hooks_t * hooks)
+{
+    assert(ctx);
+    assert(hooks);
+
+    size_t code_size = 0;
+
+    for (size_t reg_index = 0; reg_index < JIT_SAVED_REGS_NUM; reg_index++)
+        code_size += emit_push_reg(ctx, JIT_SAVED_REGS[reg_index]);
+
+    code_size += emit_push_reg(ctx, R_RDI);
+    code_size += emit_mov_reg_reg(ctx, R_R13, R_RSP);
+    code_size += emit_mov_reg_imm(ctx, R_R15, (int64_t)(uintptr_t)hooks);
+    code_size += emit_mov_reg_reg(ctx, R_RBX, R_RDX);
+    code_size += emit_mov_reg_reg(ctx, R_RSP, R_RSI);
+
+    code_size += emit_call_mem(ctx, R_R13, 0);
+
+    code_size += emit_mov_reg_reg(ctx, R_RSP, R_R13);
+    code_size += emit_pop_reg(ctx, R_RDI);
+
+    for (size_t reg_index = JIT_SAVED_REGS_NUM; reg_index > 0; reg_index--)
+        code_size += emit_pop_reg(ctx, JIT_SAVED_REGS[reg_index - 1]);
+
+    code_size += emit_ret(ctx);
+
+    return code_size;
+}
+
+
+static int64_t tierIn(void * user)
+{
+    tier_ctx_t * tier = (tier_ctx_t *)user;
+
+    return interpReadNumber(tier->in_file);
+}
+
+
+static void tierOut(void * user, int64_t value)
+{
+    tier_ctx_t * tier = (tier_ctx_t *)user;
+
+    fprintf(tier->out_file, "%" PRId64 "\n", value);
+}
+
+
+static void onHot(interp_tiering_t * tiering, size_t unit_index)
+{
+    assert(tiering);
+
+    tier_ctx_t * tier = (tier_ctx_t *)tiering->ctx;
+
+    pthread_mutex_lock(&tier->lock);
+
+    tier->queue[tier->queue_size] = unit_index;
+    tier->queue_size++;
+
+    pthread_cond_signal(&tier->wake);
+    pthread_mutex_unlock(&tier->lock);
+}
+
+
+// functions that are still in the queue when the program exits are not compiled
+static void * compilerMain(void * shared)
+{
+    tier_ctx_t * tier = (tier_ctx_t *)shared;
+
+    pthread_mutex_lock(&tier->lock);
+
+    while (true){
+        while (!tier->stopping && tier->queue_pos == tier->queue_size)
+            pthread_cond_wait(&tier->wake, &tier->lock);
+
+        if (tier->stopping)
+            break;
+
+        size_t unit_index = tier->queue[tier->queue_pos];
+        tier->queue_pos++;
+
+        pthread_mutex_unlock(&tier->lock);
+
+        compileHotFunc(tier, unit_index);
+
+        pthread_mutex_lock(&tier->lock);
+    }
+
+    pthread_mutex_unlock(&tier->lock);
+
+    return NULL;
+}
+
+
+// native code never returns to the interpreter, so the callees that are interpreted yet are compiled with the function
+static void compileHotFunc(tier_ctx_t * tier, size_t unit_index)
+{
+    assert(tier);
+
+    if (tier->native_funcs[unit_index] != NULL || tier->failed[unit_index])
+        return;
+
+    size_t units_num = tier->backend->units_num;
+
+    size_t * group       = (size_t *)calloc(units_num + 1, sizeof(size_t));
+    size_t * group_index = (size_t *)calloc(units_num + 1, sizeof(size_t));
+    size_t * offsets     = (size_t *)calloc(units_num + 1, sizeof(size_t));
+
+    size_t group_size = collectCallees(tier, unit_index, group, group_index);
+
+    char * code = NULL;
+    size_t code_size = 0;
+    char * chunk = NULL;
+
+    if (group_size != 0){
+        FILE * code_file = open_memstream(&code, &code_size);
+
+        size_t cur_offset = 0;
+
+        for (size_t member = 0; member < group_size; member++){
+            offsets[member] = cur_offset;
+            cur_offset += compileFunc(tier->backend, tier->unit_segments[group[member]], code_file);
+        }
+
+        fclose(code_file);
+
+        chunk = reserveChunk(tier, code_size);
+    }
+
+    if (chunk != NULL){
+        for (size_t member = 0; member < group_size; member++)
+            patchCalls(tier, group[member], code, offsets[member], chunk, group_index, offsets);
+    }
+
+    if (chunk == NULL || !commitChunk(tier, chunk, code, code_size)){
+        tier->failed[unit_index] = true;
+        group_size = 0;
+    }
+
+    for (size_t member = 0; member < group_size; member++){
+        size_t member_unit = group[member];
+        const IR_segment_t * segment = tier->unit_segments[member_unit];
+
+        size_t size = ((member + 1 < group_size) ? offsets[member + 1] : code_size) - offsets[member];
+
+        if (tier->perf_map != NULL){
+            const backend_ctx_t * ctx = tier->backend;
+            writePerfMapEntry(tier->perf_map, (uintptr_t)(chunk + offsets[member]), size,
+                              ctx->id_table[ctx->IR.blocks[segmentFuncLabel(ctx, segment)].name_id].name);
+        }
+
+        __atomic_store_n(tier->native_funcs + member_unit, (const void *)(chunk + offsets[member]), __ATOMIC_RELEASE);
+    }
+
+    if (tier->perf_map != NULL)
+        fflush(tier->perf_map);
+
+    free(code);
+    free(group);
+    free(group_index);
+    free(offsets);
+}
+
+
+// returns the number of the functions to compile, 0 if some of them calls a function that is not top-level
+static size_t collectCallees(tier_ctx_t * tier, size_t unit_index, size_t * group, size_t * group_index)
+{
+    assert(tier);
+    assert(group);
+    assert(group_index);
+
+    const backend_ctx_t * ctx = tier->backend;
+
+    for (size_t index = 0; index < ctx->units_num; index++)
+        group_index[index] = NOT_FUNC_UNIT;
+
+    size_t group_size = 0;
+
+    group[group_size] = unit_index;
+    group_index[unit_index] = group_size;
+    group_size++;
+
+    for (size_t member = 0; member < group_size; member++){
+        const IR_segment_t * segment = tier->unit_segments[group[member]];
+
+        for (size_t block_index = segment->begin; block_index < segment->end; block_index++){
+            const IR_block_t * block = ctx->IR.blocks + block_index;
+
+            if (block->type != IR_CALL)
+                continue;
+
+            size_t callee = tier->label_units[block->label_block_idx];
+
+            if (callee == NOT_FUNC_UNIT || tier->failed[callee]){
+                tier->failed[unit_index] = true;
+                return 0;
+            }
+
+            if (tier->native_funcs[callee] != NULL || group_index[callee] != NOT_FUNC_UNIT)
+                continue;
+
+            group[group_size] = callee;
+            group_index[callee] = group_size;
+            group_size++;
+        }
+    }
+
+    return group_size;
+}
+
+
+// rel32 follows the one byte opcode of the call
+static void patchCalls(tier_ctx_t * tier, size_t unit_index, char * code, size_t func_offset, const char * chunk,
+                       const size_t * group_index, const size_t * offsets)
+{
+    assert(tier);
+    assert(code);
+    assert(chunk);
+    assert(group_index);
+    assert(offsets);
+
+    const backend_ctx_t * ctx = tier->backend;
+    const IR_segment_t * segment = tier->unit_segments[unit_index];
+
+    for (size_t block_index = segmentFuncLabel(ctx, segment); block_index < segment->end; block_index++){
+        const IR_block_t * block = ctx->IR.blocks + block_index;
+        const char * target = NULL;
+
+        if (block->type == IR_CALL){
+            size_t callee = tier->label_units[block->label_block_idx];
+
+            if (tier->native_funcs[callee] != NULL)
+                target = (const char *)tier->native_funcs[callee];
+            else
+                target = chunk + offsets[group_index[callee]];
+        }
+        else if (block->type == IR_IN)
+            target = tier->std_in_stub;
+        else if (block->type == IR_OUT)
+            target = tier->std_out_stub;
+
+        if (target == NULL)
+            continue;
+
+        size_t offset = func_offset + (size_t)block->addr + 1;
+        int32_t rel_addr = (int32_t)(target - (chunk + offset + sizeof(int32_t)));
+
+        memcpy(code + offset, &rel_addr, sizeof(int32_t));
+    }
+}
+
+
+// chunks take whole pages, so a page is never writable and executable at once
+static char * reserveChunk(tier_ctx_t * tier, size_t size)
+{
+    assert(tier);
+
+    size_t pages_size = (size + tier->page_size - 1) / tier->page_size * tier->page_size;
+
+    if (pages_size == 0 || tier->region_used + pages_size > TIER_CODE_REGION_SIZE)
+        return NULL;
+
+    char * chunk = tier->region + tier->region_used;
+    tier->region_used += pages_size;
+
+    return chunk;
+}
+
+
+static bool commitChunk(tier_ctx_t * tier, char * chunk, const char * code, size_t size)
+{
+    assert(tier);
+    assert(chunk);
+    assert(code);
+
+    if (mprotect(chunk, size, PROT_READ | PROT_WRITE) != 0)
+        return false;
+
+    memcpy(chunk, code, size);
+
+    return mprotect(chunk, size, PROT_READ | PROT_EXEC) == 0;
+}
@@ -5,8 +5,36 @@ section .text
 ;====================================================
 ; ---- RELATIVE ADDRESSES FOR COMPILER ----
 ; These addresses are relative to the start of std_funcs
-dq __in_standard_func_please_do_not_name_your_funcs_this_name__  - $
-dq __out_standard_func_please_do_not_name_your_funcs_this_name__ - $ + 8
+dq __in_standard_func_please_do_not_name_your_funcs_this_name__      - $
+dq __out_standard_func_please_do_not_name_your_funcs_this_name__     - $ + 8
+dq __io_init_standard_func_please_do_not_name_your_funcs_this_name__ - $ + 16
+dq __io_exit_standard_func_please_do_not_name_your_funcs_this_name__ - $ + 24
+;====================================================
+
+
+;====================================================
+; ---- BUFFERS OF IN AND OUT ----
+; _start calls io_init and keeps the address it returns in r14,
+; the compiled code never touches r14
+IO_BUF_SIZE       equ 65536
+IO_ALT_STACK_SIZE equ 32768
+
+IO_OUT_LEN        equ 0                         ; bytes in the out buffer
+IO_IN_POS         equ 8                         ; next byte of the in buffer
+IO_IN_LEN         equ 16                        ; bytes in the in buffer
+IO_OLD_FPE        equ 32                        ; sigactions and sigaltstack before io_init
+IO_OLD_SEGV       equ 64
+IO_OLD_ALT_STACK  equ 96
+IO_OUT_BUF        equ 128
+IO_IN_BUF         equ IO_OUT_BUF   + IO_BUF_SIZE
+IO_ALT_STACK      equ IO_IN_BUF    + IO_BUF_SIZE
+IO_STATE_SIZE     equ IO_ALT_STACK + IO_ALT_STACK_SIZE
+
+IO_MAX_NUM_LEN    equ 32                        ; std_out copies 32 bytes, '-', 19 digits and '\n' fit
+
+SIGFPE            equ 8
+SIGSEGV           equ 11
+IO_SIGNAL_FLAGS   equ 0x8C000000                ; SA_RESETHAND | SA_ONSTACK | SA_RESTORER
 ;====================================================
 
 
@@ -22,70 +50,147 @@ __in_standard_func_please_do_not_name_your_funcs_this_name__:
         push rbp
         mov rbp, rsp
 
-        sub rsp, 32        ; [rbp - 32] is start of the buffer
+        xor r8, r8              ; is negative
+        xor r9, r9              ; num = 0
 
-        xor r12, r12            ; index = 0
-		xor r13, r13
+    ; --- the line is in the buffer: 8 digits at once ---
+        mov rsi, [r14 + IO_IN_POS]
+        mov r10, [r14 + IO_IN_LEN]
+        lea rdi, [r14 + IO_IN_BUF]
+        xor r11, r11            ; chunks of 8 digits read
 
-    ; --- checking first symbol for '-' ---
-        ; --- reading ---
-        mov rax, 0
-        mov rdi, 0
-        lea rsi, [-32 + rbp]
-        mov rdx, 1
+        cmp rsi, r10
+        jae .slow_symbols
 
-        syscall
-        ; ---------------
-        inc r12
+        cmp BYTE [rdi + rsi], '-'
+        jne .chunk
+
+        mov r8, 1
+        inc rsi
+
+    .chunk:
+        lea rax, [rsi + 8]
+        cmp rax, r10            ; the chunk goes past the buffer
+        ja .slow_restart
+
+        mov rax, [rdi + rsi]
+
+    ; high bit of every byte that is not a digit
+        mov rcx, 0x3030303030303030
+        mov rdx, rax
+        sub rdx, rcx            ; below '0'
+        or rdx, rax             ; above 0x7F
+        mov rcx, 0x4646464646464646
+        add rcx, rax            ; above '9'
+        or rdx, rcx
+        mov rcx, 0x8080808080808080
+        and rdx, rcx
+
+        mov rcx, 8              ; rcx = digits in the chunk
+        test rdx, rdx
+        jz .convert
+
+        bsf rcx, rdx
+        shr rcx, 3
+
+        lea rdx, [rdi + rsi]
+        cmp BYTE [rdx + rcx], 0x0A
+        jne .slow_restart       ; other symbols are read as digits by the slow way
+
+        test rcx, rcx
+        jnz .convert
+
+        test r11, r11           ; empty line is read by the slow way too
+        jz .slow_restart
 
-        cmp BYTE [rsi], '-'
-        jne .reading_symbol
+        jmp .fast_end
 
-        dec r12
-        mov r13, 1
+    .convert:
+    ; digits go to the high bytes, the first one is the highest
+        mov rdx, 0x0F0F0F0F0F0F0F0F
+        and rax, rdx
+
+        mov rdx, rcx
+        shl rcx, 3
+        neg rcx
+        add rcx, 64
+        shl rax, cl
+
+    ; pairs, fours and eights of digits are summed by multiplications
+        imul rax, rax, 2561     ; 10 * 256 + 1
+        shr rax, 8
+        mov rcx, 0x00FF00FF00FF00FF
+        and rax, rcx
+
+        imul rax, rax, 6553601  ; 100 * 65536 + 1
+        shr rax, 16
+        mov rcx, 0x0000FFFF0000FFFF
+        and rax, rcx
+
+        mov rcx, 42949672960001 ; 10000 * 2^32 + 1
+        imul rax, rcx
+        shr rax, 32
+
+        lea rcx, [rel __pow10_standard_func_please_do_not_name_your_funcs_this_name__]
+        imul r9, [rcx + rdx * 8]
+        add r9, rax             ; num = num * 10^digits + chunk
+
+        add rsi, rdx
+        cmp rdx, 8
+        jb .fast_end
+
+        inc r11
+        jmp .chunk
+
+    .fast_end:
+        inc rsi                 ; '\n'
+        mov [r14 + IO_IN_POS], rsi
+        jmp .the_end
     ; -------------------------------------
 
-    .reading_symbol:
-        ; --- reading ---
-        mov rax, 0
-        mov rdi, 0
-        lea rsi, [-32 + rbp + r12*1]
-        mov rdx, 1
+    .slow_restart:
+        xor r8, r8
+        xor r9, r9
 
-        syscall
-        ; ---------------
+    ; --- checking first symbol for '-' ---
+    .slow_symbols:
+        call __io_getc_standard_func_please_do_not_name_your_funcs_this_name__
 
-        inc r12                 ; index++
+        cmp rax, -1             ; nothing to read
+        je .the_end
 
-        cmp BYTE [rsi], 0x0A    ; do while byte != '\n'
-        jne .reading_symbol
+        cmp al, '-'
+        jne .add_digit
 
-        dec r12
+        mov r8, 1
+        jmp .next_symbol
+    ; -------------------------------------
+
+    .add_digit:
+        sub al, '0'
+        movzx rax, al
+        imul r9, r9, 10         ; num = num * 10 + (char - '0')
+        add r9, rax
 
-        xor rax, rax            ; num = 0
-        mov r8, 1               ; decimal multiplicator
-    .calc_loop:
-        dec r12
+    .next_symbol:
+        call __io_getc_standard_func_please_do_not_name_your_funcs_this_name__
 
-        xor rcx, rcx
-        mov cl, [-32 + rbp + r12*1]
-        sub cl, '0'
-        imul rcx, r8        ; r9 = (char - '0') * 10^n
-        imul r8, r8, 10
+        cmp rax, -1
+        je .the_end
 
-        add rax, rcx
+        cmp al, 0x0A            ; do while byte != '\n'
+        jne .add_digit
 
-        test r12, r12
-        jnz .calc_loop
+    .the_end:
+        mov rax, r9
 
     ; if it was negative:
-        test r13, r13
-        jz .the_end
+        test r8, r8
+        jz .positive
 
         neg rax
 
-    .the_end:
-
+    .positive:
         mov rsp, rbp
         pop rbp
 
@@ -104,65 +209,307 @@ __out_standard_func_please_do_not_name_your_funcs_this_name__:
         push rbp
         mov rbp, rsp
 
-        sub rsp, 32            ; [rbp - BUF_LEN] is start of the buffer
+        sub rsp, 32             ; [rbp - 32] is start of the buffer
 
-        xor r12, r12                ; index = 0
+        cmp QWORD [r14 + IO_OUT_LEN], IO_BUF_SIZE - IO_MAX_NUM_LEN
+        jbe .has_space
 
-        mov rax, [rbp + 16]         ; rax = first arg
+        call __io_flush_standard_func_please_do_not_name_your_funcs_this_name__
 
-        mov r8, QWORD (1 << 63)
-        xor rcx, rcx
+    .has_space:
+        mov rax, [rbp + 16]     ; rax = first arg
 
-        test rax, r8
-        jz .print_unsigned
+    ; --- digits go from the end of the buffer ---
+        lea rdi, [rbp - 1]
+        mov BYTE [rdi], 0x0A    ; \n
 
-        mov BYTE [-32 + rbp], '-'
-        inc rcx
+        mov r8, rax             ; sign
 
-        neg rax
+        test rax, rax
+        jns .abs_taken
+
+        neg rax                 ; INT64_MIN stays the same, it is divided as unsigned
+
+    .abs_taken:
+        lea rsi, [rel __digit_pairs_standard_func_please_do_not_name_your_funcs_this_name__]
+        mov r9, 0x28F5C28F5C28F5C3  ; 2^66 / 100 rounded up
 
-    .print_unsigned:
+    ; --- two digits for every division ---
+    .pair_loop:
+        cmp rax, 100
+        jb .last_digits
+
+        mov rcx, rax
+        shr rax, 2
+        mul r9
+        shr rdx, 2              ; rdx = num / 100
+        mov rax, rdx
+
+        imul rdx, rdx, 100
+        sub rcx, rdx            ; rcx = num % 100
+
+        movzx edx, WORD [rsi + rcx * 2]
+        sub rdi, 2
+        mov [rdi], dx
+
+        jmp .pair_loop
+
+    .last_digits:
+        cmp rax, 10
+        jb .one_digit
+
+        movzx edx, WORD [rsi + rax * 2]
+        sub rdi, 2
+        mov [rdi], dx
+        jmp .sign
+
+    .one_digit:
+        add al, '0'
+        dec rdi
+        mov BYTE [rdi], al
+
+    .sign:
+        test r8, r8
+        jns .copy
+
+        dec rdi
+        mov BYTE [rdi], '-'
+
+    ; --- appending to the out buffer, 32 bytes are copied whatever the length is ---
+    .copy:
+        mov rcx, [r14 + IO_OUT_LEN]
+
+        movdqu xmm0, [rdi]
+        movdqu xmm1, [rdi + 16]
+        movdqu [r14 + rcx + IO_OUT_BUF], xmm0
+        movdqu [r14 + rcx + IO_OUT_BUF + 16], xmm1
+
+        mov rdx, rbp
+        sub rdx, rdi
+        add rcx, rdx
+        mov [r14 + IO_OUT_LEN], rcx
+
+        mov rsp, rbp
+        pop rbp
+    ret
+; ================================================================
+
+
+
+; ================================================================
+; -----------------------------------------
+; Maps the buffers of in and out, division by zero and stack overflow
+; write the out buffer before the program is killed
+; Return:
+;   rax = address of the buffers, exits with 1 if there is no memory
+; -----------------------------------------
+__io_init_standard_func_please_do_not_name_your_funcs_this_name__:
+        push rbp
+        mov rbp, rsp
+
+        mov rax, 9              ; mmap
+        xor rdi, rdi
+        mov rsi, IO_STATE_SIZE
+        mov rdx, 3              ; PROT_READ | PROT_WRITE
+        mov r10, 0x22           ; MAP_PRIVATE | MAP_ANONYMOUS
+        mov r8, -1
+        xor r9, r9
+        syscall
+
+        cmp rax, -4096          ; errors are -4095..-1
+        ja .no_memory
+
+        mov r8, rax
+
+    ; --- stack overflow needs its own stack for the handler ---
         sub rsp, 32
-        mov rsi, rsp                ; rsi = &num_buf
+        lea rax, [r8 + IO_ALT_STACK]
+        mov [rsp], rax          ; ss_sp
+        mov QWORD [rsp + 8], 0  ; ss_flags
+        mov QWORD [rsp + 16], IO_ALT_STACK_SIZE
+
+        mov rax, 131            ; sigaltstack
+        mov rdi, rsp
+        lea rsi, [r8 + IO_OLD_ALT_STACK]
+        syscall
+
+    ; --- the handler works once, the fault repeats and kills the program as before ---
+        lea rax, [rel __io_signal_standard_func_please_do_not_name_your_funcs_this_name__]
+        mov [rsp], rax          ; sa_handler
+        mov eax, IO_SIGNAL_FLAGS
+        mov [rsp + 8], rax      ; sa_flags
+        lea rax, [rel __io_sigreturn_standard_func_please_do_not_name_your_funcs_this_name__]
+        mov [rsp + 16], rax     ; sa_restorer
+        mov QWORD [rsp + 24], 0 ; sa_mask
+
+        mov rax, 13             ; rt_sigaction
+        mov rdi, SIGFPE
+        mov rsi, rsp
+        lea rdx, [r8 + IO_OLD_FPE]
+        mov r10, 8
+        syscall
 
-        xor r11, r11
-        mov rdi, 10                 ; divisor
-    .num_loop:
-        xor rdx, rdx                ; edx = 0 (for div)
+        mov rax, 13
+        mov rdi, SIGSEGV
+        mov rsi, rsp
+        lea rdx, [r8 + IO_OLD_SEGV]
+        mov r10, 8
+        syscall
 
-        div rdi                     ; dl = num % 10
-        add dl, '0'                 ; dl = ascii digit
-        mov BYTE [rsi + r11], dl          ; into reversed buffer
-        inc r11
+        mov rax, r8
+
+        mov rsp, rbp
+        pop rbp
+    ret
+
+    .no_memory:
+        mov rax, 60
+        mov rdi, 1
+        syscall
+; ================================================================
+
+
+
+; ================================================================
+; -----------------------------------------
+; Writes the out buffer, gives the signals back and unmaps the buffers
+; (the jit is run by the process that lives after the program)
+; Entry:
+;   r14 = address of the buffers
+; -----------------------------------------
+__io_exit_standard_func_please_do_not_name_your_funcs_this_name__:
+        call __io_flush_standard_func_please_do_not_name_your_funcs_this_name__
+
+        mov rax, 13             ; rt_sigaction
+        mov rdi, SIGFPE
+        lea rsi, [r14 + IO_OLD_FPE]
+        xor rdx, rdx
+        mov r10, 8
+        syscall
 
-        cmp rax, 0                  ; until number is 0
-        jne .num_loop
+        mov rax, 13
+        mov rdi, SIGSEGV
+        lea rsi, [r14 + IO_OLD_SEGV]
+        xor rdx, rdx
+        mov r10, 8
+        syscall
 
-        dec rcx
-    .reverse_loop:
-        inc rcx
-        dec r11
-        mov dl, BYTE [rsi + r11]        ; from reversed buffer
-        mov BYTE [-32 + rbp + rcx], dl        ; to normal buffer
+        mov rax, 131            ; sigaltstack
+        lea rdi, [r14 + IO_OLD_ALT_STACK]
+        xor rsi, rsi
+        syscall
 
-        cmp r11, 0
-        jne .reverse_loop
+        mov rax, 11             ; munmap
+        mov rdi, r14
+        mov rsi, IO_STATE_SIZE
+        syscall
+    ret
+; ================================================================
 
-        inc rcx
-        mov BYTE [-32 + rbp + rcx], 0x0a        ; \n
 
-        inc rcx
+
+; ================================================================
+; -----------------------------------------
+; Writes the out buffer, keeps r8 and r9
+; -----------------------------------------
+__io_flush_standard_func_please_do_not_name_your_funcs_this_name__:
+        mov rdx, [r14 + IO_OUT_LEN]
+        lea rsi, [r14 + IO_OUT_BUF]
+
+    .write_loop:
+        test rdx, rdx
+        jz .written
 
     ; --- writing buffer ---
         mov rax, 1
         mov rdi, 1
-        lea rsi, [-32 + rbp]
-        mov rdx, rcx
         syscall
     ; ----------------------
 
-        mov rsp, rbp
-        pop rbp
+        test rax, rax           ; the rest is dropped on errors
+        jle .written
+
+        add rsi, rax
+        sub rdx, rax
+        jmp .write_loop
+
+    .written:
+        mov QWORD [r14 + IO_OUT_LEN], 0
     ret
 ; ================================================================
 
+
+
+; ================================================================
+; -----------------------------------------
+; Takes the next byte of stdin, keeps r8 and r9
+; Return:
+;   rax = byte or -1 at the end of the input
+; -----------------------------------------
+__io_getc_standard_func_please_do_not_name_your_funcs_this_name__:
+        mov rax, [r14 + IO_IN_POS]
+        cmp rax, [r14 + IO_IN_LEN]
+        jb .has_byte
+
+    ; the out buffer goes first, so the program does not wait for input silently
+        call __io_flush_standard_func_please_do_not_name_your_funcs_this_name__
+
+    ; --- reading ---
+        mov rax, 0
+        mov rdi, 0
+        lea rsi, [r14 + IO_IN_BUF]
+        mov rdx, IO_BUF_SIZE
+        syscall
+    ; ---------------
+
+        test rax, rax
+        jg .filled
+
+        mov rax, -1
+    ret
+
+    .filled:
+        mov [r14 + IO_IN_LEN], rax
+        xor rax, rax
+
+    .has_byte:
+        lea rdx, [rax + 1]
+        mov [r14 + IO_IN_POS], rdx
+        movzx rax, BYTE [r14 + rax + IO_IN_BUF]
+    ret
+; ================================================================
+
+
+
+; ================================================================
+; -----------------------------------------
+; Handler of SIGFPE and SIGSEGV, r14 is the one of the program
+; -----------------------------------------
+__io_signal_standard_func_please_do_not_name_your_funcs_this_name__:
+        call __io_flush_standard_func_please_do_not_name_your_funcs_this_name__
+    ret
+
+__io_sigreturn_standard_func_please_do_not_name_your_funcs_this_name__:
+        mov rax, 15             ; rt_sigreturn
+        syscall
+; ================================================================
+
+
+
+; ================================================================
+; ---- TABLES ----
+__digit_pairs_standard_func_please_do_not_name_your_funcs_this_name__:
+        db "00010203040506070809"
+        db "10111213141516171819"
+        db "20212223242526272829"
+        db "30313233343536373839"
+        db "40414243444546474849"
+        db "50515253545556575859"
+        db "60616263646566676869"
+        db "70717273747576777879"
+        db "80818283848586878889"
+        db "90919293949596979899"
+
+__pow10_standard_func_please_do_not_name_your_funcs_this_name__:
+        dq 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000
+; ================================================================
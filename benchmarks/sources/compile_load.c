@@ -0,0 +1,300 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <signal.h>
+#include <limits.h>
+
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "compile_protocol.h"
+
+// Starts compiler.exe --server and measures latency (p50, p99) and throughput of compile requests
+// from 1, 2, 4, ... concurrent clients, every client sends its requests one after another over one connection.
+// For comparison the same program is compiled by a new compiler.exe process per request.
+
+const char * const WORK_DIR_NAME    = "compile_load_work";
+const char * const SOCKET_FILE_NAME = "compiler.sock";
+
+const size_t DEFAULT_REQUESTS_NUM = 2000;
+const size_t PROCESS_RUNS_NUM     = 100;
+
+const int SERVER_START_TRIES = 500;         // 10 ms each
+
+typedef struct {
+    const char * code;
+    size_t code_size;
+
+    size_t requests_num;
+    double * latencies;
+
+    size_t errors_num;
+} client_t;
+
+static pid_t startServer(const char * compiler_path, const char * std_funcs_path);
+
+static void runClients(const char * code, size_t code_size, size_t clients_num, size_t requests_num);
+
+static void * clientMain(void * arg);
+
+static void runProcesses(const char * compiler_path, const char * std_funcs_path, const char * program_path);
+
+static void printLatencies(const char * mode, size_t clients_num, double * latencies, size_t latencies_num, double wall_time, size_t errors_num);
+
+static int compareDoubles(const void * first, const void * second);
+
+static char * readFile(const char * file_name, size_t * size);
+
+static double getTime();
+
+// ARGS
+// [requests per client] - 2000 by default
+// [program file]        - code_examples/square_solver.txt by default
+int main(int argc, char ** argv)
+{
+    size_t requests_num = DEFAULT_REQUESTS_NUM;
+    if (argc > 1)
+        requests_num = strtoul(argv[1], NULL, 10);
+
+    char compiler_path [PATH_MAX] = "";
+    char std_funcs_path[PATH_MAX] = "";
+    char program_path  [PATH_MAX] = "";
+
+    if (realpath("../compiler.exe", compiler_path) == NULL ||
+        realpath("../backend_x64/std_funcs.bin", std_funcs_path) == NULL){
+        fprintf(stderr, "COMPILE LOAD: build the driver first (preferably with BUILD=RELEASE)\n");
+        return 1;
+    }
+
+    if (realpath((argc > 2) ? argv[2] : "../code_examples/square_solver.txt", program_path) == NULL){
+        fprintf(stderr, "COMPILE LOAD: cannot find the program\n");
+        return 1;
+    }
+
+    size_t code_size = 0;
+    char * code = readFile(program_path, &code_size);
+
+    mkdir(WORK_DIR_NAME, 0777);
+    if (chdir(WORK_DIR_NAME) != 0){
+        fprintf(stderr, "COMPILE LOAD: cannot enter %s\n", WORK_DIR_NAME);
+        return 1;
+    }
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    pid_t server_pid = startServer(compiler_path, std_funcs_path);
+    if (server_pid < 0){
+        free(code);
+        return 1;
+    }
+
+    long cores_num = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t max_clients_num = (cores_num > 0) ? 2 * (size_t)cores_num : 2;
+
+    printf("%-10s %8s %10s %12s %10s %10s %8s\n", "mode", "clients", "requests", "requests/s", "p50 us", "p99 us", "errors");
+
+    for (size_t clients_num = 1; clients_num <= max_clients_num; clients_num *= 2)
+        runClients(code, code_size, clients_num, requests_num);
+
+    kill(server_pid, SIGTERM);
+    waitpid(server_pid, NULL, 0);
+
+    runProcesses(compiler_path, std_funcs_path, program_path);
+
+    free(code);
+
+    return 0;
+}
+
+static pid_t startServer(const char * compiler_path, const char * std_funcs_path)
+{
+    assert(compiler_path);
+    assert(std_funcs_path);
+
+    unlink(SOCKET_FILE_NAME);
+
+    pid_t pid = fork();
+
+    if (pid == 0){
+        execl(compiler_path, compiler_path, "--std", std_funcs_path, "--server", SOCKET_FILE_NAME, (char *)NULL);
+        _exit(127);
+    }
+
+    for (int try_index = 0; try_index < SERVER_START_TRIES; try_index++){
+        int socket_fd = compileServerConnect(SOCKET_FILE_NAME);
+
+        if (socket_fd >= 0){
+            close(socket_fd);
+            return pid;
+        }
+
+        usleep(10000);
+    }
+
+    fprintf(stderr, "COMPILE LOAD: server did not start\n");
+
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+
+    return -1;
+}
+
+static void runClients(const char * code, size_t code_size, size_t clients_num, size_t requests_num)
+{
+    assert(code);
+
+    client_t * clients = (client_t *)calloc(clients_num, sizeof(client_t));
+    pthread_t * threads = (pthread_t *)calloc(clients_num, sizeof(pthread_t));
+
+    double * latencies = (double *)calloc(clients_num * requests_num, sizeof(double));
+
+    double start = getTime();
+
+    for (size_t client_index = 0; client_index < clients_num; client_index++){
+        clients[client_index].code = code;
+        clients[client_index].code_size = code_size;
+        clients[client_index].requests_num = requests_num;
+        clients[client_index].latencies = latencies + client_index * requests_num;
+
+        pthread_create(threads + client_index, NULL, clientMain, clients + client_index);
+    }
+
+    size_t errors_num = 0;
+
+    for (size_t client_index = 0; client_index < clients_num; client_index++){
+        pthread_join(threads[client_index], NULL);
+        errors_num += clients[client_index].errors_num;
+    }
+
+    double wall_time = getTime() - start;
+
+    printLatencies("server", clients_num, latencies, clients_num * requests_num, wall_time, errors_num);
+
+    free(latencies);
+    free(threads);
+    free(clients);
+}
+
+static void * clientMain(void * arg)
+{
+    client_t * client = (client_t *)arg;
+
+    int socket_fd = compileServerConnect(SOCKET_FILE_NAME);
+
+    for (size_t request_index = 0; request_index < client->requests_num; request_index++){
+        compile_response_t response = {};
+        char * elf  = NULL;
+        char * diag = NULL;
+
+        double start = getTime();
+
+        bool done = socket_fd >= 0 && sendCompileRequest(socket_fd, client->code, client->code_size, 0) &&
+                    recvCompileResponse(socket_fd, &response, &elf, &diag);
+
+        client->latencies[request_index] = getTime() - start;
+
+        if (! done || response.status != COMPILE_SUCCESS || response.elf_size == 0)
+            client->errors_num++;
+
+        free(elf);
+        free(diag);
+    }
+
+    if (socket_fd >= 0)
+        close(socket_fd);
+
+    return NULL;
+}
+
+static void runProcesses(const char * compiler_path, const char * std_funcs_path, const char * program_path)
+{
+    assert(compiler_path);
+    assert(std_funcs_path);
+    assert(program_path);
+
+    double * latencies = (double *)calloc(PROCESS_RUNS_NUM, sizeof(double));
+    size_t errors_num = 0;
+
+    double start = getTime();
+
+    for (size_t run_index = 0; run_index < PROCESS_RUNS_NUM; run_index++){
+        double run_start = getTime();
+
+        pid_t pid = fork();
+
+        if (pid == 0){
+            execl(compiler_path, compiler_path, "-j", "1", "--std", std_funcs_path, "-o", "process.elf", program_path, (char *)NULL);
+            _exit(127);
+        }
+
+        int status = 0;
+        waitpid(pid, &status, 0);
+
+        latencies[run_index] = getTime() - run_start;
+
+        if (! WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            errors_num++;
+    }
+
+    printLatencies("process", 1, latencies, PROCESS_RUNS_NUM, getTime() - start, errors_num);
+
+    unlink("process.elf");
+    free(latencies);
+}
+
+static void printLatencies(const char * mode, size_t clients_num, double * latencies, size_t latencies_num, double wall_time, size_t errors_num)
+{
+    assert(mode);
+    assert(latencies);
+    assert(latencies_num > 0);
+
+    qsort(latencies, latencies_num, sizeof(double), compareDoubles);
+
+    double p50 = latencies[latencies_num / 2];
+    double p99 = latencies[latencies_num * 99 / 100];
+
+    printf("%-10s %8zu %10zu %12.0f %10.1f %10.1f %8zu\n", mode, clients_num, latencies_num,
+           (double)latencies_num / wall_time, p50 * 1e6, p99 * 1e6, errors_num);
+}
+
+static int compareDoubles(const void * first, const void * second)
+{
+    double first_val  = *(const double *)first;
+    double second_val = *(const double *)second;
+
+    return (first_val > second_val) - (first_val < second_val);
+}
+
+static char * readFile(const char * file_name, size_t * size)
+{
+    assert(file_name);
+    assert(size);
+
+    struct stat st = {};
+    stat(file_name, &st);
+
+    *size = (size_t)st.st_size;
+
+    char * buffer = (char *)calloc(*size + 1, sizeof(char));
+
+    FILE * file = fopen(file_name, "rb");
+    if (file != NULL){
+        *size = fread(buffer, sizeof(char), *size, file);
+        fclose(file);
+    }
+
+    return buffer;
+}
+
+static double getTime()
+{
+    struct timespec time_spec = {};
+    clock_gettime(CLOCK_MONOTONIC, &time_spec);
+
+    return (double)time_spec.tv_sec + (double)time_spec.tv_nsec * 1e-9;
+}
@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "tree.h"
+#include "IR_handler.h"
+#include "node_arena.h"
+#include "logger.h"
+
+// Measures reading and writing throughput (MB/s) of the text IR and of the binary one on large files.
+// Without arguments it generates a program with DEFAULT_STATEMENTS_NUM statements.
+
+const size_t DEFAULT_STATEMENTS_NUM = 1000000;
+const size_t RUNS_NUM = 5;
+
+const char * const GENERATED_FILE_NAME = "ir_throughput.ast";
+const char * const TEXT_OUT_FILE_NAME  = "ir_throughput_out.ast";
+const char * const BIN_OUT_FILE_NAME   = "ir_throughput_out.astb";
+
+static void writeBenchProgram(const char * file_name, size_t statements_num);
+
+static void benchFile(const char * file_name);
+
+static double readTime(const char * file_name, size_t * nodes_num);
+
+static double writeTime(const char * in_file_name, const char * out_file_name);
+
+static double getTime();
+
+static size_t getFileSize(const char * file_name);
+
+// ARGS
+// [IR files] - generated program if there are no files
+int main(int argc, char ** argv)
+{
+    logStart("/dev/null", LOG_RELEASE, LOG_TEXT);
+
+    printf("%-24s %8s %10s %12s %10s %12s\n", "file", "size MB", "read MB/s", "read Mnode/s", "write MB/s", "astb read MB/s");
+
+    if (argc > 1){
+        for (int arg_index = 1; arg_index < argc; arg_index++)
+            benchFile(argv[arg_index]);
+    }
+    else {
+        writeBenchProgram(GENERATED_FILE_NAME, DEFAULT_STATEMENTS_NUM);
+        benchFile(GENERATED_FILE_NAME);
+
+        unlink(GENERATED_FILE_NAME);
+    }
+
+    unlink(TEXT_OUT_FILE_NAME);
+    unlink(BIN_OUT_FILE_NAME);
+
+    logExit();
+
+    return 0;
+}
+
+static void benchFile(const char * file_name)
+{
+    assert(file_name);
+
+    size_t nodes_num = 0;
+
+    double read_time = readTime(file_name, &nodes_num);
+    double write_time = writeTime(file_name, TEXT_OUT_FILE_NAME);
+
+    writeTime(file_name, BIN_OUT_FILE_NAME);
+    double bin_read_time = readTime(BIN_OUT_FILE_NAME, &nodes_num);
+
+    double file_mb = (double)getFileSize(file_name) / 1e6;
+
+    printf("%-24s %8.1f %10.1f %12.2f %10.1f %12.1f\n", file_name, file_mb,
+           file_mb / read_time, (double)nodes_num / read_time / 1e6,
+           (double)getFileSize(TEXT_OUT_FILE_NAME) / 1e6 / write_time,
+           (double)getFileSize(BIN_OUT_FILE_NAME)  / 1e6 / bin_read_time);
+}
+
+// best of RUNS_NUM
+static double readTime(const char * file_name, size_t * nodes_num)
+{
+    assert(file_name);
+    assert(nodes_num);
+
+    double best_time = 0.;
+
+    for (size_t run_index = 0; run_index < RUNS_NUM; run_index++){
+        node_arena_t arena = nodeArenaCtor();
+
+        tree_context_t tree = {};
+        tree.arena = &arena;
+
+        double start = getTime();
+        node_t * root = readTreeFromIR(&tree, file_name);
+        double run_time = getTime() - start;
+
+        if (root == NULL)
+            fprintf(stderr, "IR_THROUGHPUT: cannot read '%s'\n", file_name);
+
+        // mapped binary nodes are not in the chunks of the arena
+        *nodes_num = (arena.mapping == NULL) ? nodeArenaSize(&arena) : *nodes_num;
+
+        if (run_index == 0 || run_time < best_time)
+            best_time = run_time;
+
+        nodeArenaDtor(&arena);
+        free(tree.ids);
+        internerDtor(&tree.names);
+    }
+
+    return best_time;
+}
+
+// best of RUNS_NUM
+static double writeTime(const char * in_file_name, const char * out_file_name)
+{
+    assert(in_file_name);
+    assert(out_file_name);
+
+    node_arena_t arena = nodeArenaCtor();
+
+    tree_context_t tree = {};
+    tree.arena = &arena;
+
+    node_t * root = readTreeFromIR(&tree, in_file_name);
+
+    double best_time = 0.;
+
+    for (size_t run_index = 0; run_index < RUNS_NUM && root != NULL; run_index++){
+        double start = getTime();
+        writeTreeToFile(&tree, root, out_file_name);
+        double run_time = getTime() - start;
+
+        if (run_index == 0 || run_time < best_time)
+            best_time = run_time;
+    }
+
+    nodeArenaDtor(&arena);
+    free(tree.ids);
+    internerDtor(&tree.names);
+
+    return best_time;
+}
+
+// a function with loops, conditions and calls, then many top-level statements with fractional numbers
+static void writeBenchProgram(const char * file_name, size_t statements_num)
+{
+    assert(file_name);
+
+    FILE * file = fopen(file_name, "w");
+    assert(file);
+
+    fprintf(file, "IR312:1\n");
+    fprintf(file, "NAMETABLE size: 4 {\n");
+    fprintf(file, "\t0000: \"value\", VAR, 0;\n");
+    fprintf(file, "\t0001: \"sum\", VAR, 0;\n");
+    fprintf(file, "\t0002: \"step\", FUNC, 1;\n");
+    fprintf(file, "\t0003: \"arg\", VAR, 0;\n");
+    fprintf(file, "}\n");
+
+    fprintf(file, "{OPR:SEP\n{OPR:VAR\n{IDR:0}{}}\n");
+    fprintf(file, "{OPR:SEP\n{OPR:VAR\n{IDR:1}{}}\n");
+
+    fprintf(file, "{OPR:SEP\n{OPR:DEF\n{OPR:FUNC_HDR\n{IDR:2}{OPR:ARG_SEP\n{IDR:3}{}}\n}\n"
+                  "{OPR:SEP\n{OPR:WHILE\n{OPR:GREATER\n{IDR:3}{NUM:10}}\n{OPR:SEP\n"
+                  "{OPR:ASSIGN\n{IDR:3}{OPR:DIV\n{IDR:3}{NUM:2.5}}\n}\n{}}\n}\n"
+                  "{OPR:SEP\n{OPR:RET\n{IDR:3}{}}\n{}}\n}\n}\n");
+
+    for (size_t statement_index = 0; statement_index < statements_num; statement_index++){
+        if (statement_index % 4 == 3){
+            fprintf(file, "{OPR:SEP\n{OPR:IF\n{OPR:LESS_EQ\n{IDR:0}{NUM:%zu}}\n{OPR:SEP\n"
+                          "{OPR:ASSIGN\n{IDR:1}{OPR:CALL\n{IDR:2}{OPR:ARG_SEP\n{IDR:0}{}}\n}\n}\n{}}\n}\n",
+                          statement_index);
+            continue;
+        }
+
+        fprintf(file, "{OPR:SEP\n{OPR:ASSIGN\n{IDR:1}{OPR:ADD\n{OPR:MUL\n{IDR:1}{NUM:%lg}}\n{OPR:SUB\n{IDR:0}{NUM:-%zu}}\n}\n}\n",
+                      (double)statement_index / 7., statement_index);
+    }
+
+    fprintf(file, "{OPR:SEP\n{OPR:OUT\n{IDR:1}{}}\n{}");
+
+    for (size_t closing_index = 0; closing_index < statements_num + 4; closing_index++)
+        fprintf(file, "}\n");
+
+    fclose(file);
+}
+
+static double getTime()
+{
+    struct timespec time_spec = {};
+    clock_gettime(CLOCK_MONOTONIC, &time_spec);
+
+    return (double)time_spec.tv_sec + (double)time_spec.tv_nsec * 1e-9;
+}
+
+static size_t getFileSize(const char * file_name)
+{
+    assert(file_name);
+
+    struct stat st = {};
+    stat(file_name, &st);
+
+    return (size_t)st.st_size;
+}
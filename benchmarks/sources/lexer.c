@@ -0,0 +1,232 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+
+#include "frontend.h"
+#include "lexer_scan.h"
+#include "IR_handler.h"
+#include "logger.h"
+#include "thread_pool.h"
+
+// Measures throughput (MB/s) of the lexer alone and of the whole frontend (lexer + parser) on large sources.
+// Without arguments it generates a program of DEFAULT_FUNCS_NUM functions.
+// Every source is measured with each instruction set of the scanning functions the CPU supports,
+// then parsing by parts is measured on all cores (isa column shows the number of workers, lexing is not measured apart).
+
+const size_t DEFAULT_FUNCS_NUM = 20000;
+const size_t RUNS_NUM = 5;
+
+static char * generateProgram(size_t funcs_num);
+
+static void benchText(const char * name, const char * code, size_t workers_num);
+
+static void benchTextIsa(const char * name, const char * code, scan_isa_t isa);
+
+static void benchTextParallel(const char * name, const char * code, size_t workers_num);
+
+static double getTime();
+
+// ARGS
+// [-j threads_num] - workers of parsing by parts (number of cores by default)
+// [source files]   - generated program if there are no files
+int main(int argc, char ** argv)
+{
+    logStart("/dev/null", LOG_RELEASE, LOG_TEXT);
+
+    size_t workers_num = getCoresNum();
+
+    int first_file = 1;
+
+    if (argc > 2 && strcmp(argv[1], "-j") == 0){
+        workers_num = strtoul(argv[2], NULL, 10);
+        if (workers_num == 0)
+            workers_num = 1;
+
+        first_file = 3;
+    }
+
+    printf("%-24s %-8s %8s %10s %12s %12s\n", "source", "isa", "size MB", "lex MB/s", "lex Mtok/s", "parse MB/s");
+
+    if (argc > first_file){
+        for (int arg_index = first_file; arg_index < argc; arg_index++){
+            program_text_t program = {};
+            if (!programTextOpen(&program, argv[arg_index])){
+                fprintf(stderr, "LEXER: ERROR: cannot read '%s'\n", argv[arg_index]);
+                continue;
+            }
+
+            benchText(argv[arg_index], program.text, workers_num);
+
+            programTextClose(&program);
+        }
+    }
+    else {
+        char * code = generateProgram(DEFAULT_FUNCS_NUM);
+
+        benchText("generated", code, workers_num);
+
+        free(code);
+    }
+
+    logExit();
+
+    return 0;
+}
+
+static void benchText(const char * name, const char * code, size_t workers_num)
+{
+    assert(name);
+    assert(code);
+
+    scan_isa_t default_isa = scanGetIsa();
+
+    for (int isa = SCAN_SCALAR; isa <= SCAN_AVX2; isa++){
+        if (scanSetIsa((scan_isa_t)isa))
+            benchTextIsa(name, code, (scan_isa_t)isa);
+    }
+
+    scanSetIsa(default_isa);
+
+    benchTextParallel(name, code, workers_num);
+}
+
+// best of RUNS_NUM for both lexing and full parsing
+static void benchTextIsa(const char * name, const char * code, scan_isa_t isa)
+{
+    assert(name);
+    assert(code);
+
+    fe_context_t fe = frontendInit(MAX_TOKEN_NUM);
+    fe.diag_file = stdout;
+
+    double best_lex_time   = 0.;
+    double best_parse_time = 0.;
+
+    for (size_t run_index = 0; run_index < RUNS_NUM; run_index++){
+        frontendReset(&fe);
+
+        double start = getTime();
+        int lex_status = lexicalAnalysis(&fe, code);
+        double lex_time = getTime() - start;
+
+        if (lex_status != 0){
+            fprintf(stderr, "LEXER: ERROR: cannot lex '%s'\n", name);
+            frontendDtor(&fe);
+            return;
+        }
+
+        frontendReset(&fe);
+
+        start = getTime();
+        node_t * root = frontendParse(&fe, code);
+        double parse_time = getTime() - start;
+
+        if (root == NULL){
+            fprintf(stderr, "LEXER: ERROR: cannot parse '%s'\n", name);
+            frontendDtor(&fe);
+            return;
+        }
+
+        if (run_index == 0 || lex_time < best_lex_time)
+            best_lex_time = lex_time;
+        if (run_index == 0 || parse_time < best_parse_time)
+            best_parse_time = parse_time;
+    }
+
+    double code_mb = (double)strlen(code) / 1e6;
+
+    printf("%-24s %-8s %8.1f %10.1f %12.2f %12.1f\n", name, scanIsaName(isa), code_mb,
+           code_mb / best_lex_time, (double)fe.tokens_size / best_lex_time / 1e6,
+           code_mb / best_parse_time);
+
+    frontendDtor(&fe);
+}
+
+// sources shorter than PARALLEL_PARSE_MIN_SIZE or without top-level functions are parsed by one thread anyway
+static void benchTextParallel(const char * name, const char * code, size_t workers_num)
+{
+    assert(name);
+    assert(code);
+
+    fe_context_t fe = frontendInit(MAX_TOKEN_NUM);
+    fe.diag_file = stdout;
+    fe.workers_num = workers_num;
+
+    double best_parse_time = 0.;
+
+    for (size_t run_index = 0; run_index < RUNS_NUM; run_index++){
+        frontendReset(&fe);
+
+        double start = getTime();
+        node_t * root = frontendParse(&fe, code);
+        double parse_time = getTime() - start;
+
+        if (root == NULL){
+            fprintf(stderr, "LEXER: ERROR: cannot parse '%s'\n", name);
+            frontendDtor(&fe);
+            return;
+        }
+
+        if (run_index == 0 || parse_time < best_parse_time)
+            best_parse_time = parse_time;
+    }
+
+    double code_mb = (double)strlen(code) / 1e6;
+
+    char workers_str[32] = "";
+    snprintf(workers_str, sizeof(workers_str), "j%zu", workers_num);
+
+    printf("%-24s %-8s %8.1f %10s %12s %12.1f\n", name, workers_str, code_mb, "-", "-", code_mb / best_parse_time);
+
+    frontendDtor(&fe);
+}
+
+// mostly whitespace, comments and long names like the sources our generators produce, every function has its own name
+static char * generateProgram(size_t funcs_num)
+{
+    const char * const func_format =
+        "func compute_weighted_value_%zu(alpha_parameter, beta_parameter)\n"
+        "begin\n"
+        "    # accumulates the weighted sum of the parameters #\n"
+        "    var result_accumulator;\n"
+        "    result_accumulator = alpha_parameter * %zu + beta_parameter / 3 - (alpha_parameter ^ 2);\n"
+        "\n"
+        "    while (result_accumulator >= 100)\n"
+        "    begin\n"
+        "        result_accumulator = result_accumulator - 7.5;\n"
+        "    end;\n"
+        "\n"
+        "    if (result_accumulator != 0)\n"
+        "    begin\n"
+        "        out(sqrt(result_accumulator) + compute_weighted_value_%zu(result_accumulator, 1));\n"
+        "    end\n"
+        "    else\n"
+        "    begin\n"
+        "        out(beta_parameter);\n"
+        "    end;\n"
+        "\n"
+        "    return result_accumulator;\n"
+        "end;\n"
+        "\n";
+
+    const size_t MAX_FUNC_LEN = 1024;
+
+    char * code = (char *)calloc(funcs_num * MAX_FUNC_LEN + 1, sizeof(*code));
+    char * code_end = code;
+
+    for (size_t func_index = 0; func_index < funcs_num; func_index++)
+        code_end += snprintf(code_end, MAX_FUNC_LEN, func_format,
+                             func_index, func_index % 97, (func_index + 1) % funcs_num);
+
+    return code;
+}
+
+static double getTime()
+{
+    struct timespec time_spec = {};
+    clock_gettime(CLOCK_MONOTONIC, &time_spec);
+
+    return (double)time_spec.tv_sec + (double)time_spec.tv_nsec * 1e-9;
+}
@@ -0,0 +1,230 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+// Generates IR programs with N statements (half of them in one function body, half at the top level,
+// so both long statement chains are exercised) and measures the middleend and the x64 backend on them.
+// Time per statement and memory per statement must stay flat while N grows.
+
+const char * const WORK_DIR_NAME = "scaling_work";
+
+const size_t MIN_STATEMENTS_NUM     = 1000;
+const size_t DEFAULT_STATEMENTS_NUM = 1000000;
+
+typedef struct {
+    double seconds;
+    long max_rss_kb;
+    int status;
+} run_result_t;
+
+static void writeBenchProgram(const char * file_name, size_t statements_num);
+
+static run_result_t runStage(char * const argv[]);
+
+static void printResult(const char * stage, size_t statements_num, run_result_t result);
+
+// ARGS
+// [max statements num] - 10^6 by default
+int main(int argc, char ** argv)
+{
+    size_t max_statements_num = DEFAULT_STATEMENTS_NUM;
+    if (argc > 1)
+        max_statements_num = strtoul(argv[1], NULL, 10);
+
+    char middleend_path[PATH_MAX] = "";
+    char backend_path  [PATH_MAX] = "";
+    char std_funcs_path[PATH_MAX] = "";
+
+    if (realpath("../middleend.exe", middleend_path) == NULL ||
+        realpath("../backend_x64/backend_x64.exe", backend_path) == NULL ||
+        realpath("../backend_x64/std_funcs.bin", std_funcs_path) == NULL){
+        fprintf(stderr, "SCALING: build middleend and backend_x64 first (preferably with BUILD=RELEASE)\n");
+        return 1;
+    }
+
+    // backend logs everything, so its log goes nowhere here
+    mkdir(WORK_DIR_NAME, 0777);
+    if (chdir(WORK_DIR_NAME) != 0){
+        fprintf(stderr, "SCALING: cannot enter %s\n", WORK_DIR_NAME);
+        return 1;
+    }
+
+    mkdir("logs", 0777);
+    unlink("logs/log.html");
+    symlink("/dev/null", "logs/log.html");
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    printf("%-12s %10s %10s %14s %10s %14s\n", "stage", "statements", "seconds", "us/statement", "max RSS MB", "bytes/statement");
+
+    for (size_t statements_num = MIN_STATEMENTS_NUM; statements_num <= max_statements_num; statements_num *= 10){
+        char ast_file_name[64] = "";
+        sprintf(ast_file_name, "bench_%zu.ast", statements_num);
+
+        writeBenchProgram(ast_file_name, statements_num);
+
+        char * middleend_argv[] = {middleend_path, ast_file_name, NULL};
+        printResult("middleend", statements_num, runStage(middleend_argv));
+
+        char asm_file_name[] = "bench.asm";
+        char elf_file_name[] = "bench.elf";
+
+        char * backend_argv[] = {backend_path, ast_file_name, asm_file_name, elf_file_name, std_funcs_path, NULL};
+        printResult("backend_x64", statements_num, runStage(backend_argv));
+
+        unlink(ast_file_name);
+    }
+
+    return 0;
+}
+
+
+enum bench_ids {
+    ID_V = 0,
+    ID_S = 1,
+    ID_F = 2,
+    ID_A = 3,
+    ID_T = 4,
+
+    IDS_NUM
+};
+
+static void writeStatementStart(FILE * file)
+{
+    fprintf(file, "{OPR:SEP\n");
+}
+
+static void writeChainEnd(FILE * file, size_t statements_num)
+{
+    fprintf(file, "{}");
+
+    for (size_t statement_index = 0; statement_index < statements_num; statement_index++)
+        fprintf(file, "}\n");
+}
+
+static void writeBenchProgram(const char * file_name, size_t statements_num)
+{
+    assert(file_name);
+
+    FILE * file = fopen(file_name, "w");
+    assert(file);
+
+    fprintf(file, "IR312:1\n");
+    fprintf(file, "NAMETABLE size: %d {\n", IDS_NUM);
+    fprintf(file, "\t0000: \"v\", VAR, 0;\n");
+    fprintf(file, "\t0001: \"s\", VAR, 0;\n");
+    fprintf(file, "\t0002: \"f\", FUNC, 1;\n");
+    fprintf(file, "\t0003: \"a\", VAR, 0;\n");
+    fprintf(file, "\t0004: \"t\", VAR, 0;\n");
+    fprintf(file, "}\n");
+
+    size_t body_num = statements_num / 2;
+    size_t top_num  = statements_num - body_num;
+
+    size_t top_chain_len = 0;
+
+    // var v; var s; in(v);
+    writeStatementStart(file);
+    fprintf(file, "{OPR:VAR\n{IDR:%d}{}}\n", ID_V);
+    writeStatementStart(file);
+    fprintf(file, "{OPR:VAR\n{IDR:%d}{}}\n", ID_S);
+    writeStatementStart(file);
+    fprintf(file, "{OPR:IN\n{IDR:%d}{}}\n", ID_V);
+    top_chain_len += 3;
+
+    // func f(a) begin var t; t = a; t = t * 2 + (3 - 1) - a; ... return t; end;
+    writeStatementStart(file);
+    top_chain_len++;
+
+    fprintf(file, "{OPR:DEF\n{OPR:FUNC_HDR\n{IDR:%d}{OPR:ARG_SEP\n{IDR:%d}{}}\n}\n", ID_F, ID_A);
+
+    writeStatementStart(file);
+    fprintf(file, "{OPR:VAR\n{IDR:%d}{}}\n", ID_T);
+    writeStatementStart(file);
+    fprintf(file, "{OPR:ASSIGN\n{IDR:%d}{IDR:%d}}\n", ID_T, ID_A);
+
+    for (size_t statement_index = 0; statement_index < body_num; statement_index++){
+        writeStatementStart(file);
+        fprintf(file, "{OPR:ASSIGN\n{IDR:%d}{OPR:SUB\n{OPR:ADD\n{OPR:MUL\n{IDR:%d}{NUM:2}}\n"
+                      "{OPR:SUB\n{NUM:3}{NUM:1}}\n}\n{IDR:%d}}\n}\n", ID_T, ID_T, ID_A);
+    }
+
+    writeStatementStart(file);
+    fprintf(file, "{OPR:RET\n{IDR:%d}{}}\n", ID_T);
+
+    writeChainEnd(file, body_num + 3);
+    fprintf(file, "}\n");
+
+    // s = v + 1 * (2 + 3); ...
+    for (size_t statement_index = 0; statement_index < top_num; statement_index++){
+        writeStatementStart(file);
+        fprintf(file, "{OPR:ASSIGN\n{IDR:%d}{OPR:ADD\n{IDR:%d}{OPR:MUL\n{NUM:1}{OPR:ADD\n{NUM:2}{NUM:3}}\n}\n}\n}\n",
+                      ID_S, ID_V);
+    }
+    top_chain_len += top_num;
+
+    // s = f(v); out(s);
+    writeStatementStart(file);
+    fprintf(file, "{OPR:ASSIGN\n{IDR:%d}{OPR:CALL\n{IDR:%d}{OPR:ARG_SEP\n{IDR:%d}{}}\n}\n}\n", ID_S, ID_F, ID_V);
+    writeStatementStart(file);
+    fprintf(file, "{OPR:OUT\n{IDR:%d}{}}\n", ID_S);
+    top_chain_len += 2;
+
+    writeChainEnd(file, top_chain_len);
+
+    fclose(file);
+}
+
+static run_result_t runStage(char * const argv[])
+{
+    run_result_t result = {};
+
+    struct timespec start = {};
+    struct timespec end   = {};
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    pid_t pid = fork();
+    if (pid == 0){
+        int null_fd = open("/dev/null", O_WRONLY);
+        dup2(null_fd, STDOUT_FILENO);
+        dup2(null_fd, STDERR_FILENO);
+
+        execv(argv[0], argv);
+        _exit(127);
+    }
+
+    struct rusage usage = {};
+    wait4(pid, &result.status, 0, &usage);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    result.seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) * 1e-9;
+    result.max_rss_kb = usage.ru_maxrss;
+
+    return result;
+}
+
+static void printResult(const char * stage, size_t statements_num, run_result_t result)
+{
+    if (!WIFEXITED(result.status) || WEXITSTATUS(result.status) != 0){
+        printf("%-12s %10zu FAILED (status %d)\n", stage, statements_num, result.status);
+        return;
+    }
+
+    printf("%-12s %10zu %10.3f %14.3f %10.1f %14.1f\n",
+           stage, statements_num, result.seconds,
+           result.seconds * 1e6 / (double)statements_num,
+           (double)result.max_rss_kb / 1024.,
+           (double)result.max_rss_kb * 1024. / (double)statements_num);
+}
@@ -0,0 +1,609 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <elf.h>
+
+#include <sys/mman.h>
+
+// Calls std_in and std_out of the std lib images the way the compiled programs do and measures ns per number.
+// Every image is checked first: std_out must print the same as printf and std_in must read back the same numbers,
+// the fixed edge cases go before the random numbers.
+// Give the image of the previous std_funcs.asm next to the current one to compare them,
+// images older than buffered in and out have no io_init and io_exit and are rejected:
+//     git show $(git rev-list -n 1 --skip=1 HEAD -- backend_x64/std_funcs.asm):backend_x64/std_funcs.bin > old_std_funcs.bin
+
+const size_t NUMBERS_NUM = 1 << 20;
+const size_t RUNS_NUM    = 5;
+
+const char * const DEFAULT_STD_LIB_NAME = "../backend_x64/std_funcs.bin";
+
+const char * const NUMBERS_FILE_NAME = "std_io_numbers.txt";
+const char * const OUT_FILE_NAME     = "std_io_out.txt";
+
+const size_t STD_IN_BUF_SIZE = 65536;     //< IO_BUF_SIZE of std_funcs.asm, a file is read by chunks of that size
+
+// ends of int64 and lengths around the chunks of 8 digits of std_in
+const int64_t EDGE_NUMBERS[] = {
+    INT64_MIN, INT64_MAX, 0, -1, 1,
+    10000000, 12345678, -99999999,
+    100000000, 123456789, -999999999,
+    1000000000000000, 1234567890123456, -9999999999999999,
+    1000000000000000000, 1234567890123456789, -999999999999999999
+};
+const size_t EDGE_NUMBERS_NUM = sizeof(EDGE_NUMBERS) / sizeof(EDGE_NUMBERS[0]);
+
+// lines printf never makes: std_in takes them as the old byte by byte reader did, other symbols count as digits
+const char * const EDGE_LINES[] = {
+    "-9223372036854775808", "9223372036854775807", "0", "-0",
+    "12345678", "-123456789", "1234567890123456", "-1234567890123456789",
+    "+42", "-+7", "4x2", "12345678+", "1234567.", " 7", "7 "
+};
+const size_t EDGE_LINES_NUM = sizeof(EDGE_LINES) / sizeof(EDGE_LINES[0]);
+
+const char * const EDGE_SPLIT_LINE = "-1234567890123";     //< crosses the end of the first chunk of the in buffer
+const char * const EDGE_LAST_LINE  = "987";                //< the file ends without '\n'
+
+// the code segment starts with the addresses of std_in, std_out, io_init and io_exit from the start of the segment
+typedef struct {
+    char * code;
+    size_t code_size;
+
+    const void * in;
+    const void * out;
+    const void * init;
+    const void * exit;
+} std_image_t;
+
+typedef struct {
+    const char * name;
+    int64_t (* make)(uint64_t random);
+} numbers_kind_t;
+
+static bool loadImage(const char * file_name, std_image_t * image);
+
+static void freeImage(std_image_t * image);
+
+static void writeNumbers(const int64_t * numbers, size_t numbers_num, const char * file_name);
+
+static bool checkImage(const std_image_t * image, const int64_t * numbers, size_t numbers_num);
+
+static bool checkEdgeCases(const std_image_t * image);
+
+static size_t makeEdgeText(char * text);
+
+static size_t readBytewise(const char * text, size_t text_len, int64_t * numbers);
+
+static double outTime(const std_image_t * image, const int64_t * numbers, size_t numbers_num, int out_fd);
+
+static double inTime(const std_image_t * image, int64_t * numbers, size_t numbers_num, int in_fd);
+
+static void * callInit(const void * func);
+
+static void callExit(const void * func, void * state);
+
+static int64_t callIn(const void * func, void * state);
+
+static void callOut(const void * func, void * state, int64_t value);
+
+static uint64_t nextRandom(uint64_t * seed);
+
+static int64_t makeSmall(uint64_t random);
+
+static int64_t makeMixed(uint64_t random);
+
+static int64_t makeWide(uint64_t random);
+
+static double getTime();
+
+// ARGS
+// [std lib images] - ../backend_x64/std_funcs.bin by default
+int main(int argc, char ** argv)
+{
+    const char * default_names[] = {DEFAULT_STD_LIB_NAME};
+
+    const char * const * image_names = (argc > 1) ? (const char * const *)(argv + 1) : default_names;
+    size_t images_num = (argc > 1) ? (size_t)(argc - 1) : 1;
+
+    const numbers_kind_t kinds[] = {
+        {"0..999",        makeSmall},
+        {"mixed lengths", makeMixed},
+        {"full int64",    makeWide}
+    };
+    const size_t kinds_num = sizeof(kinds) / sizeof(kinds[0]);
+
+    int64_t * numbers = (int64_t *)calloc(NUMBERS_NUM, sizeof(int64_t));
+    int64_t * read_numbers = (int64_t *)calloc(NUMBERS_NUM, sizeof(int64_t));
+
+    int null_fd = open("/dev/null", O_WRONLY);
+    int saved_stdin  = dup(STDIN_FILENO);
+    int saved_stdout = dup(STDOUT_FILENO);
+
+    // stdout of the std lib is moved to the files, the table goes to the copy of it
+    FILE * report = fdopen(saved_stdout, "w");
+    setvbuf(report, NULL, _IOLBF, 0);
+
+    int status = 0;
+
+    fprintf(report, "%-32s %-14s %12s %12s\n", "std lib", "numbers", "out ns/num", "in ns/num");
+
+    for (size_t image_index = 0; image_index < images_num; image_index++){
+        std_image_t image = {};
+
+        if (!loadImage(image_names[image_index], &image)){
+            status = 1;
+            continue;
+        }
+
+        if (!checkEdgeCases(&image)){
+            fprintf(stderr, "STD_IO: %s prints or reads the edge cases wrong\n", image_names[image_index]);
+            status = 1;
+            freeImage(&image);
+            continue;
+        }
+
+        for (size_t kind_index = 0; kind_index < kinds_num; kind_index++){
+            uint64_t seed = 2025 + kind_index;
+
+            for (size_t number_index = 0; number_index < NUMBERS_NUM; number_index++)
+                numbers[number_index] = kinds[kind_index].make(nextRandom(&seed));
+
+            writeNumbers(numbers, NUMBERS_NUM, NUMBERS_FILE_NAME);
+
+            if (!checkImage(&image, numbers, NUMBERS_NUM)){
+                fprintf(stderr, "STD_IO: %s prints or reads %s numbers wrong\n", image_names[image_index], kinds[kind_index].name);
+                status = 1;
+                continue;
+            }
+
+            int in_fd = open(NUMBERS_FILE_NAME, O_RDONLY);
+
+            double out_time = outTime(&image, numbers, NUMBERS_NUM, null_fd);
+            double in_time  = inTime(&image, read_numbers, NUMBERS_NUM, in_fd);
+
+            close(in_fd);
+
+            fprintf(report, "%-32s %-14s %12.2f %12.2f\n", image_names[image_index], kinds[kind_index].name,
+                    out_time * 1e9 / (double)NUMBERS_NUM, in_time * 1e9 / (double)NUMBERS_NUM);
+        }
+
+        freeImage(&image);
+    }
+
+    dup2(saved_stdin, STDIN_FILENO);
+    dup2(saved_stdout, STDOUT_FILENO);
+
+    close(saved_stdin);
+    fclose(report);
+    close(null_fd);
+
+    unlink(NUMBERS_FILE_NAME);
+    unlink(OUT_FILE_NAME);
+
+    free(numbers);
+    free(read_numbers);
+
+    return status;
+}
+
+
+static bool loadImage(const char * file_name, std_image_t * image)
+{
+    assert(file_name);
+    assert(image);
+
+    FILE * file = fopen(file_name, "rb");
+    if (file == NULL){
+        fprintf(stderr, "STD_IO: cannot open '%s'\n", file_name);
+        return false;
+    }
+
+    Elf64_Ehdr header = {};
+    Elf64_Phdr code_header = {};
+    bool found = false;
+
+    if (fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.e_ident, ELFMAG, SELFMAG) == 0){
+        for (size_t phdr_index = 0; phdr_index < header.e_phnum && !found; phdr_index++){
+            fseek(file, (long)(header.e_phoff + phdr_index * sizeof(Elf64_Phdr)), SEEK_SET);
+
+            if (fread(&code_header, sizeof(code_header), 1, file) == 1)
+                found = (code_header.p_type == PT_LOAD && (code_header.p_flags & PF_X) != 0);
+        }
+    }
+
+    if (!found || code_header.p_filesz < 4 * sizeof(uint64_t)){
+        fprintf(stderr, "STD_IO: '%s' has no code segment\n", file_name);
+        fclose(file);
+        return false;
+    }
+
+    image->code_size = code_header.p_filesz;
+
+    void * code = mmap(NULL, image->code_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code == MAP_FAILED){
+        fclose(file);
+        return false;
+    }
+
+    image->code = (char *)code;
+
+    fseek(file, (long)code_header.p_offset, SEEK_SET);
+    size_t read_size = fread(image->code, sizeof(char), image->code_size, file);
+
+    fclose(file);
+
+    if (read_size != image->code_size || mprotect(image->code, image->code_size, PROT_READ | PROT_EXEC) != 0){
+        fprintf(stderr, "STD_IO: cannot load the code of '%s'\n", file_name);
+        freeImage(image);
+        return false;
+    }
+
+    uint64_t addrs[4] = {};
+    memcpy(addrs, image->code, sizeof(addrs));
+
+    // images before buffered in and out have only std_in and std_out there, the code starts right after them
+    for (size_t addr_index = 0; addr_index < sizeof(addrs) / sizeof(addrs[0]); addr_index++){
+        if (addrs[addr_index] < sizeof(addrs) || addrs[addr_index] >= image->code_size){
+            fprintf(stderr, "STD_IO: '%s' has no std_in, std_out, io_init and io_exit entries, "
+                            "it is older than buffered in and out\n", file_name);
+            freeImage(image);
+            return false;
+        }
+    }
+
+    image->in   = image->code + addrs[0];
+    image->out  = image->code + addrs[1];
+    image->init = image->code + addrs[2];
+    image->exit = image->code + addrs[3];
+
+    return true;
+}
+
+
+static void freeImage(std_image_t * image)
+{
+    assert(image);
+
+    if (image->code != NULL)
+        munmap(image->code, image->code_size);
+
+    image->code = NULL;
+    image->code_size = 0;
+}
+
+
+static void writeNumbers(const int64_t * numbers, size_t numbers_num, const char * file_name)
+{
+    assert(numbers);
+    assert(file_name);
+
+    FILE * file = fopen(file_name, "w");
+    assert(file);
+
+    for (size_t number_index = 0; number_index < numbers_num; number_index++)
+        fprintf(file, "%" PRId64 "\n", numbers[number_index]);
+
+    fclose(file);
+}
+
+
+// std_out prints to a file that must be the same as the one of printf, std_in reads it back
+static bool checkImage(const std_image_t * image, const int64_t * numbers, size_t numbers_num)
+{
+    assert(image);
+    assert(numbers);
+
+    int out_fd = open(OUT_FILE_NAME, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    assert(out_fd >= 0);
+
+    outTime(image, numbers, numbers_num, out_fd);
+    close(out_fd);
+
+    FILE * expected = fopen(NUMBERS_FILE_NAME, "rb");
+    FILE * printed  = fopen(OUT_FILE_NAME, "rb");
+    assert(expected && printed);
+
+    bool same = true;
+    int expected_symbol = 0;
+
+    while (same && (expected_symbol = getc(expected)) != EOF)
+        same = (getc(printed) == expected_symbol);
+
+    same = same && getc(printed) == EOF;
+
+    fclose(expected);
+    fclose(printed);
+
+    int64_t * read_numbers = (int64_t *)calloc(numbers_num, sizeof(int64_t));
+
+    int in_fd = open(OUT_FILE_NAME, O_RDONLY);
+    assert(in_fd >= 0);
+
+    inTime(image, read_numbers, numbers_num, in_fd);
+    close(in_fd);
+
+    same = same && memcmp(numbers, read_numbers, numbers_num * sizeof(int64_t)) == 0;
+
+    free(read_numbers);
+
+    return same;
+}
+
+
+// the edge numbers are checked as the random ones, then std_in reads the edge lines as the byte by byte reader
+static bool checkEdgeCases(const std_image_t * image)
+{
+    assert(image);
+
+    writeNumbers(EDGE_NUMBERS, EDGE_NUMBERS_NUM, NUMBERS_FILE_NAME);
+
+    if (!checkImage(image, EDGE_NUMBERS, EDGE_NUMBERS_NUM))
+        return false;
+
+    char * text = (char *)calloc(STD_IN_BUF_SIZE + 1024, sizeof(char));
+    size_t text_len = makeEdgeText(text);
+
+    int64_t * expected     = (int64_t *)calloc(text_len, sizeof(int64_t));
+    int64_t * read_numbers = (int64_t *)calloc(text_len, sizeof(int64_t));
+
+    size_t numbers_num = readBytewise(text, text_len, expected);
+
+    FILE * file = fopen(NUMBERS_FILE_NAME, "wb");
+    assert(file);
+
+    fwrite(text, sizeof(char), text_len, file);
+    fclose(file);
+
+    int in_fd = open(NUMBERS_FILE_NAME, O_RDONLY);
+    assert(in_fd >= 0);
+
+    inTime(image, read_numbers, numbers_num, in_fd);
+    close(in_fd);
+
+    bool same = true;
+
+    for (size_t number_index = 0; number_index < numbers_num && same; number_index++){
+        same = (read_numbers[number_index] == expected[number_index]);
+
+        if (!same)
+            fprintf(stderr, "STD_IO: number %zu of the edge lines is read as %" PRId64 " instead of %" PRId64 "\n",
+                    number_index, read_numbers[number_index], expected[number_index]);
+    }
+
+    free(text);
+    free(expected);
+    free(read_numbers);
+
+    return same;
+}
+
+
+// the edge lines, short lines up to the split line and the last line without '\n'
+static size_t makeEdgeText(char * text)
+{
+    assert(text);
+
+    size_t text_len = 0;
+
+    for (size_t line_index = 0; line_index < EDGE_LINES_NUM; line_index++)
+        text_len += (size_t)sprintf(text + text_len, "%s\n", EDGE_LINES[line_index]);
+
+    size_t split_start = STD_IN_BUF_SIZE - strlen(EDGE_SPLIT_LINE) / 2;
+
+    while (split_start - text_len > 19)
+        text_len += (size_t)sprintf(text + text_len, "7\n");
+
+    // the padding ends exactly at the split line
+    memset(text + text_len, '7', split_start - text_len - 1);
+    text[split_start - 1] = '\n';
+    text_len = split_start;
+
+    text_len += (size_t)sprintf(text + text_len, "%s\n%s", EDGE_SPLIT_LINE, EDGE_LAST_LINE);
+
+    return text_len;
+}
+
+
+// the old std_in: '-' first makes the number negative, every other symbol up to '\n' is added as a digit
+static size_t readBytewise(const char * text, size_t text_len, int64_t * numbers)
+{
+    assert(text);
+    assert(numbers);
+
+    size_t numbers_num = 0;
+    size_t pos = 0;
+
+    while (pos < text_len){
+        bool negative = (text[pos] == '-');
+        uint64_t value = 0;
+
+        if (negative)
+            pos++;
+
+        for (bool first = !negative; pos < text_len && (first || text[pos] != '\n'); first = false, pos++)
+            value = value * 10 + (uint8_t)(text[pos] - '0');
+
+        if (pos < text_len)
+            pos++;
+
+        numbers[numbers_num++] = (int64_t)(negative ? 0 - value : value);
+    }
+
+    return numbers_num;
+}
+
+
+// the best of the runs, the buffers are written to out_fd by io_exit as the program does it
+static double outTime(const std_image_t * image, const int64_t * numbers, size_t numbers_num, int out_fd)
+{
+    assert(image);
+    assert(numbers);
+
+    double best_time = 0;
+
+    for (size_t run_index = 0; run_index < RUNS_NUM; run_index++){
+        dup2(out_fd, STDOUT_FILENO);
+        lseek(out_fd, 0, SEEK_SET);
+
+        double start = getTime();
+
+        void * state = callInit(image->init);
+
+        for (size_t number_index = 0; number_index < numbers_num; number_index++)
+            callOut(image->out, state, numbers[number_index]);
+
+        callExit(image->exit, state);
+
+        double run_time = getTime() - start;
+
+        if (run_index == 0 || run_time < best_time)
+            best_time = run_time;
+    }
+
+    return best_time;
+}
+
+
+static double inTime(const std_image_t * image, int64_t * numbers, size_t numbers_num, int in_fd)
+{
+    assert(image);
+    assert(numbers);
+
+    double best_time = 0;
+
+    for (size_t run_index = 0; run_index < RUNS_NUM; run_index++){
+        dup2(in_fd, STDIN_FILENO);
+        lseek(in_fd, 0, SEEK_SET);
+
+        double start = getTime();
+
+        void * state = callInit(image->init);
+
+        for (size_t number_index = 0; number_index < numbers_num; number_index++)
+            numbers[number_index] = callIn(image->in, state);
+
+        callExit(image->exit, state);
+
+        double run_time = getTime() - start;
+
+        if (run_index == 0 || run_time < best_time)
+            best_time = run_time;
+    }
+
+    return best_time;
+}
+
+
+// the std lib keeps its state in r14 and spoils the registers the compiled code does not keep,
+// the red zone of this function is skipped before the call
+#define STD_CALL_CLOBBERS "rcx", "rdx", "rsi", "rdi", "r8", "r9", "r10", "r11", "r14", "xmm0", "xmm1", "memory", "cc"
+
+static void * callInit(const void * func)
+{
+    void * state = NULL;
+
+    asm volatile("sub $128, %%rsp\n\t"
+                 "call *%[func]\n\t"
+                 "add $128, %%rsp"
+                 : "=a"(state)
+                 : [func] "r"(func)
+                 : STD_CALL_CLOBBERS);
+
+    return state;
+}
+
+
+static void callExit(const void * func, void * state)
+{
+    asm volatile("sub $128, %%rsp\n\t"
+                 "mov %[state], %%r14\n\t"
+                 "call *%[func]\n\t"
+                 "add $128, %%rsp"
+                 :
+                 : [func] "r"(func), [state] "r"(state)
+                 : "rax", STD_CALL_CLOBBERS);
+}
+
+
+static int64_t callIn(const void * func, void * state)
+{
+    int64_t value = 0;
+
+    asm volatile("sub $128, %%rsp\n\t"
+                 "mov %[state], %%r14\n\t"
+                 "call *%[func]\n\t"
+                 "add $128, %%rsp"
+                 : "=a"(value)
+                 : [func] "r"(func), [state] "r"(state)
+                 : STD_CALL_CLOBBERS);
+
+    return value;
+}
+
+
+// the arg is pushed and taken back by the caller
+static void callOut(const void * func, void * state, int64_t value)
+{
+    asm volatile("sub $128, %%rsp\n\t"
+                 "mov %[state], %%r14\n\t"
+                 "push %[value]\n\t"
+                 "call *%[func]\n\t"
+                 "add $136, %%rsp"
+                 :
+                 : [func] "r"(func), [state] "r"(state), [value] "r"(value)
+                 : "rax", STD_CALL_CLOBBERS);
+}
+
+#undef STD_CALL_CLOBBERS
+
+
+// xorshift64*
+static uint64_t nextRandom(uint64_t * seed)
+{
+    assert(seed);
+
+    *seed ^= *seed >> 12;
+    *seed ^= *seed << 25;
+    *seed ^= *seed >> 27;
+
+    return *seed * 0x2545F4914F6CDD1DULL;
+}
+
+
+static int64_t makeSmall(uint64_t random)
+{
+    return (int64_t)(random % 1000);
+}
+
+
+// every length from 1 to 19 digits is as frequent as the others, half of the numbers are negative
+static int64_t makeMixed(uint64_t random)
+{
+    uint64_t limit = 10;
+    for (uint64_t digits = 1 + (random >> 8) % 19; digits > 1; digits--)
+        limit *= 10;
+
+    int64_t value = (int64_t)((random >> 16) % limit);
+
+    return (random & 1) ? -value : value;
+}
+
+
+static int64_t makeWide(uint64_t random)
+{
+    return (int64_t)random;
+}
+
+
+static double getTime()
+{
+    struct timespec time_spec = {};
+    clock_gettime(CLOCK_MONOTONIC, &time_spec);
+
+    return (double)time_spec.tv_sec + (double)time_spec.tv_nsec * 1e-9;
+}
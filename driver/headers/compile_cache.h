@@ -0,0 +1,54 @@
+#ifndef COMPILE_CACHE_INCLUDED
+#define COMPILE_CACHE_INCLUDED
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "sha256.h"
+#include "x64_compile.h"
+#include "driver.h"
+
+// cache_dir/entries/<key>/program.elf (.asm, .fe.ast, .ast) - one entry per key, entries are whole directories
+// cache_dir/tmp/      - entries are assembled here and renamed to entries/ in one step
+// cache_dir/lock      - flock for statistics and eviction
+// cache_dir/stats     - hits, misses and the running size of the entries, eviction scans entries only above max_size
+
+const char * const CACHE_FORMAT_VERSION   = "IR312 compile cache 1";
+
+const char * const CACHE_ENTRIES_DIR_NAME = "entries";
+const char * const CACHE_TMP_DIR_NAME     = "tmp";
+const char * const CACHE_LOCK_FILE_NAME   = "lock";
+const char * const CACHE_STATS_FILE_NAME  = "stats";
+const char * const CACHE_ENTRY_FILE_NAME  = "program";
+
+const size_t DEFAULT_CACHE_SIZE_MB = 256;
+
+const size_t CACHE_KEY_LEN      = 2 * SHA256_DIGEST_SIZE;
+const size_t CACHE_MAX_PATH_LEN = 1024;
+
+/// @brief on-disk cache of compiled programs, it is safe to share one cache directory between processes
+typedef struct compile_cache {
+    char * dir;                                 //< NULL if the cache cannot be used
+    size_t max_size;                            //< bytes, least recently used entries are evicted above it
+
+    uint8_t base_digest[SHA256_DIGEST_SIZE];    //< compiler binary identity and std lib, a part of every key
+} compile_cache_t;
+
+/// @brief opens (creates) cache in the directory, with NULL std_lib the cache can only print its statistics
+compile_cache_t compileCacheCtor(const char * dir, size_t max_size, const std_lib_t * std_lib);
+
+void compileCacheDtor(compile_cache_t * cache);
+
+/// @brief writes key (CACHE_KEY_LEN hex digits and zero) of the program compiled with the options
+void compileCacheKey(const compile_cache_t * cache, const char * code, const driver_options_t * options, char * key);
+
+/// @brief copies cached outputs to out_base.* files, returns false on a miss
+bool compileCacheLookup(compile_cache_t * cache, const char * key, const char * out_base, const driver_options_t * options);
+
+/// @brief puts out_base.* outputs to the cache and evicts old entries if the cache is too big
+void compileCacheStore(compile_cache_t * cache, const char * key, const char * out_base, const driver_options_t * options);
+
+/// @brief prints hits, misses, number of entries and size
+void compileCachePrintStats(compile_cache_t * cache, FILE * out_file);
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef COMPILE_SERVER_INCLUDED
+#define COMPILE_SERVER_INCLUDED
+
+#include "x64_compile.h"
+#include "compile_protocol.h"
+
+const int COMPILE_SERVER_BACKLOG = 64;
+
+/// @brief serves compile requests (see compile_protocol.h) on the unix socket until SIGINT or SIGTERM
+///        idle connections are polled by the calling thread, a worker takes a connection for one request only
+/// @param threads_num number of worker threads, each of them compiles one program at a time with its own warm compiler
+/// @return 0 if the server was stopped by a signal
+int compileServerRun(const char * socket_path, const std_lib_t * std_lib, size_t threads_num);
+
+#endif
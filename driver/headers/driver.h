@@ -0,0 +1,73 @@
+#ifndef DRIVER_INCLUDED
+#define DRIVER_INCLUDED
+
+#include <stdio.h>
+
+#include "frontend.h"
+#include "middleend.h"
+#include "x64_compile.h"
+
+const char * const DRIVER_LOG_FOLDER_NAME = "driver_logs";
+const char * const DRIVER_LOG_FILE_NAME   = "driver_logs/log.html";
+
+const char * const DEFAULT_STD_LIB_FILE_NAME = "backend_x64/std_funcs.bin";
+
+const char * const ELF_EXTENSION     = ".elf";
+const char * const OBJ_EXTENSION     = ".o";
+const char * const HEADER_EXTENSION  = ".h";         // C header of the library in --c-abi mode
+const char * const ASM_EXTENSION     = ".asm";
+const char * const FE_AST_EXTENSION  = ".fe";        // added before the IR extension of the frontend tree
+
+/// @brief what the driver does besides translating the program to elf
+typedef struct {
+    size_t workers_num;
+
+    bool optimize;                  //< run middleend
+    bool listing;                   //< write .asm next to the elf
+    bool object;                    //< write relocatable .o instead of the elf, calls of undeclared functions go to the linker
+
+    bool c_abi;                     //< the object is a library for C code, .h with the prototypes is written next to it
+    const char * const * exports;   //< functions the library exports, all top-level functions if exports_num == 0
+    size_t exports_num;
+
+    const char * ast_extension;     //< dump the trees of the stages with this extension (.ast or .astb), NULL - no dumps
+} driver_options_t;
+
+struct compile_cache;
+struct incremental;
+
+/// @brief state that is kept between the programs: operator table, token array, middleend arenas and std lib
+typedef struct {
+    fe_context_t fe;
+    me_context_t me;
+
+    const std_lib_t * std_lib;
+
+    FILE * diag_file;               //< errors in the programs go here
+
+    struct compile_cache * cache;   //< compileProgramFile takes outputs from it if it is not NULL
+
+    struct incremental * incremental;   //< code of the unchanged functions of the program is reused if it is not NULL
+} compiler_t;
+
+/// @brief creates compiler, stages use workers_num threads for one program
+compiler_t compilerCtor(const std_lib_t * std_lib, size_t workers_num);
+
+void compilerDtor(compiler_t * compiler);
+
+/// @brief extension of the main output: .o for the objects, .elf otherwise
+const char * outExtension(const driver_options_t * options);
+
+/// @brief translates program text to elf (or object) without touching the disk in between, returns 0 if succeeded
+/// @param asm_file listing, can be NULL
+/// @param dump_base trees of the stages are dumped to dump_base.* files if options ask for it
+int compilerRun(compiler_t * compiler, const char * code, const driver_options_t * options,
+                FILE * elf_file, FILE * asm_file, const char * dump_base);
+
+/// @brief reads the program from the file and compiles it to out_base.elf (out_base.o), returns 0 if succeeded
+int compileProgramFile(compiler_t * compiler, const char * program_file_name, const char * out_base, const driver_options_t * options);
+
+/// @brief links the objects with the std lib to elf_file_name, returns 0 if succeeded
+int linkProgramFiles(const std_lib_t * std_lib, const char * const * object_file_names, size_t objects_num, const char * elf_file_name);
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef INCREMENTAL_INCLUDED
+#define INCREMENTAL_INCLUDED
+
+#include <stdint.h>
+
+#include "sha256.h"
+#include "tree.h"
+#include "backend_x64.h"
+
+// key of a top-level function: its frontend tree with the names instead of the ids, the arguments number
+// of every function it calls and the names of the global variables declared before it (they set its addresses)
+
+const char * const UNIT_KEY_VERSION = "IR312 unit 1";
+
+typedef struct {
+    uint8_t key[SHA256_DIGEST_SIZE];
+    unit_code_t * code;
+
+    bool used;                          //< for the units of the previous compilation
+    bool fresh;                         //< for the units of the current one: the code is made by this compilation
+} inc_unit_t;
+
+typedef struct {
+    inc_unit_t * units;
+    size_t size;
+    size_t capacity;
+} inc_units_t;
+
+/// @brief code of the top-level functions of one program, it is reused by the next compilations of the program
+typedef struct incremental {
+    inc_units_t prev;                           //< units of the last successful compilation, sorted by key
+    inc_units_t next;                           //< units of the current compilation
+
+    uint8_t (* keys)[SHA256_DIGEST_SIZE];       //< by the order of top-level functions of the current compilation
+    unit_code_t ** cached;                      //< NULL if the function has to be compiled
+    size_t funcs_num;
+    size_t funcs_capacity;
+
+    bool * skip_statements;                     //< by the order of top-level statements, for the middleend
+    size_t statements_capacity;
+
+    bool prepared;
+
+    size_t reused_num;                          //< functions whose code was reused by the last compilation
+} incremental_t;
+
+incremental_t incrementalCtor();
+
+void incrementalDtor(incremental_t * inc);
+
+/// @brief finds the code of the functions of the frontend tree that did not change since the previous compilation
+void incrementalPrepare(incremental_t * inc, node_t * root, const idr_t * ids, bool optimize);
+
+/// @brief takes the code of the compiled functions from the backend
+void incrementalCollect(incremental_t * inc, backend_ctx_t * be);
+
+/// @brief the code of the current compilation replaces the previous one if it succeeded, otherwise it is dropped
+void incrementalFinish(incremental_t * inc, bool succeeded);
+
+#endif
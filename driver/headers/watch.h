@@ -0,0 +1,16 @@
+#ifndef WATCH_INCLUDED
+#define WATCH_INCLUDED
+
+#include "driver.h"
+
+const int WATCH_POLL_TIMEOUT_MS = 200;          // how often the stop flag is checked
+const size_t WATCH_EVENTS_BUFFER_SIZE = 4096;
+
+/// @brief compiles the programs and recompiles every one of them when its file is written, until SIGINT or SIGTERM
+/// @details code of the functions that did not change is reused, so an edit of one function costs as much as this function
+/// @param out_bases programs are compiled to out_base.elf
+/// @return 0 if the driver was stopped by a signal
+int watchPrograms(compiler_t * compiler, const char * const * program_files, const char * const * out_bases,
+                  size_t programs_num, const driver_options_t * options);
+
+#endif
@@ -0,0 +1,592 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <errno.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+
+#include "compile_cache.h"
+#include "sha256.h"
+#include "logger.h"
+
+const size_t CACHE_MAX_OUTPUTS_NUM   = 5;
+const size_t CACHE_MAX_SUFFIX_LEN    = 64;
+const size_t CACHE_ENTRIES_START_CAP = 64;
+
+const size_t COPY_BUFFER_SIZE = 1 << 16;
+
+typedef struct {
+    char name[CACHE_KEY_LEN + 1];
+    size_t size;
+    struct timespec used_time;          // mtime of the entry directory
+} cache_entry_info_t;
+
+typedef struct {
+    cache_entry_info_t * entries;
+    size_t size;
+    size_t capacity;
+
+    size_t total_size;
+} cache_entries_t;
+
+typedef struct {
+    char suffixes[CACHE_MAX_OUTPUTS_NUM][CACHE_MAX_SUFFIX_LEN];
+    size_t size;
+} cache_outputs_t;
+
+// contents of the stats file, the size is a running total of the entries, SIZE_MAX if it is not known
+typedef struct {
+    size_t hits;
+    size_t misses;
+    size_t size;
+} cache_stats_t;
+
+static bool hashFileIdentity(sha256_ctx_t * sha, const char * file_name);
+
+static bool pathFits(int path_len);
+
+static cache_outputs_t getOutputs(const driver_options_t * options);
+
+static bool copyFile(const char * src_file_name, const char * dst_file_name, mode_t mode);
+
+static int lockCache(const compile_cache_t * cache);
+
+static void unlockCache(int lock_fd);
+
+static void updateStats(const compile_cache_t * cache, size_t new_hits, size_t new_misses);
+
+static cache_stats_t readStats(const compile_cache_t * cache);
+
+static void writeStats(const compile_cache_t * cache, const cache_stats_t * stats);
+
+static cache_entries_t scanEntries(const compile_cache_t * cache);
+
+static size_t getDirFilesSize(const char * dir_name);
+
+static size_t evictEntries(compile_cache_t * cache);
+
+static void removeEntryDir(const char * dir_name);
+
+static int compareEntriesByTime(const void * first, const void * second);
+
+compile_cache_t compileCacheCtor(const char * dir, size_t max_size, const std_lib_t * std_lib)
+{
+    assert(dir);
+
+    compile_cache_t cache = {};
+    cache.max_size = max_size;
+
+    char path[CACHE_MAX_PATH_LEN] = {};
+
+    mkdir(dir, 0777);
+
+    snprintf(path, CACHE_MAX_PATH_LEN, "%s/%s", dir, CACHE_ENTRIES_DIR_NAME);
+    mkdir(path, 0777);
+
+    snprintf(path, CACHE_MAX_PATH_LEN, "%s/%s", dir, CACHE_TMP_DIR_NAME);
+    if (mkdir(path, 0777) != 0 && errno != EEXIST){
+        fprintf(stderr, "CACHE: ERROR: cannot use cache directory '%s'\n", dir);
+        return cache;
+    }
+
+    if (std_lib == NULL){
+        cache.dir = strdup(dir);
+        return cache;
+    }
+
+    // any change of the compiler or of the std lib makes all the old entries unreachable
+    sha256_ctx_t sha = sha256Ctor();
+
+    sha256Update(&sha, CACHE_FORMAT_VERSION, strlen(CACHE_FORMAT_VERSION) + 1);
+
+    if (! hashFileIdentity(&sha, "/proc/self/exe")){
+        fprintf(stderr, "CACHE: ERROR: cannot read the compiler binary\n");
+        return cache;
+    }
+
+    sha256Update(&sha, &std_lib->in_addr,  sizeof(std_lib->in_addr));
+    sha256Update(&sha, &std_lib->out_addr, sizeof(std_lib->out_addr));
+    sha256Update(&sha, std_lib->code, std_lib->code_size);
+
+    sha256Final(&sha, cache.base_digest);
+
+    cache.dir = strdup(dir);
+
+    return cache;
+}
+
+void compileCacheDtor(compile_cache_t * cache)
+{
+    assert(cache);
+
+    free(cache->dir);
+    cache->dir = NULL;
+}
+
+void compileCacheKey(const compile_cache_t * cache, const char * code, const driver_options_t * options, char * key)
+{
+    assert(cache);
+    assert(code);
+    assert(options);
+    assert(key);
+
+    sha256_ctx_t sha = sha256Ctor();
+
+    sha256Update(&sha, cache->base_digest, SHA256_DIGEST_SIZE);
+
+    uint8_t flags[4] = {options->optimize, options->listing, options->object, options->c_abi};
+    sha256Update(&sha, flags, sizeof(flags));
+
+    for (size_t export_index = 0; export_index < options->exports_num; export_index++)
+        sha256Update(&sha, options->exports[export_index], strlen(options->exports[export_index]) + 1);
+
+    const char * ast_extension = (options->ast_extension == NULL) ? "" : options->ast_extension;
+    sha256Update(&sha, ast_extension, strlen(ast_extension) + 1);
+
+    sha256Update(&sha, code, strlen(code));
+
+    uint8_t digest[SHA256_DIGEST_SIZE] = {};
+    sha256Final(&sha, digest);
+
+    sha256ToHex(digest, key);
+}
+
+bool compileCacheLookup(compile_cache_t * cache, const char * key, const char * out_base, const driver_options_t * options)
+{
+    assert(cache);
+    assert(key);
+    assert(out_base);
+    assert(options);
+
+    char entry_dir[CACHE_MAX_PATH_LEN] = {};
+    bool hit = pathFits(snprintf(entry_dir, CACHE_MAX_PATH_LEN, "%s/%s/%s", cache->dir, CACHE_ENTRIES_DIR_NAME, key));
+
+    cache_outputs_t outputs = getOutputs(options);
+
+    for (size_t output_index = 0; output_index < outputs.size && hit; output_index++){
+        const char * suffix = outputs.suffixes[output_index];
+
+        char src[CACHE_MAX_PATH_LEN] = {};
+        char dst[CACHE_MAX_PATH_LEN] = {};
+
+        hit = pathFits(snprintf(src, CACHE_MAX_PATH_LEN, "%s/%s%s", entry_dir, CACHE_ENTRY_FILE_NAME, suffix)) &&
+              pathFits(snprintf(dst, CACHE_MAX_PATH_LEN, "%s%s", out_base, suffix)) &&
+              copyFile(src, dst, (strcmp(suffix, ELF_EXTENSION) == 0) ? 0755 : 0644);
+    }
+
+    // mtime of the entry is its last use
+    if (hit)
+        utimensat(AT_FDCWD, entry_dir, NULL, 0);
+
+    logPrint(LOG_DEBUG, "cache %s: %s\n", hit ? "hit" : "miss", key);
+
+    updateStats(cache, hit ? 1 : 0, hit ? 0 : 1);
+
+    return hit;
+}
+
+void compileCacheStore(compile_cache_t * cache, const char * key, const char * out_base, const driver_options_t * options)
+{
+    assert(cache);
+    assert(key);
+    assert(out_base);
+    assert(options);
+
+    char tmp_dir[CACHE_MAX_PATH_LEN] = {};
+    if (!pathFits(snprintf(tmp_dir, CACHE_MAX_PATH_LEN, "%s/%s/%s.%d", cache->dir, CACHE_TMP_DIR_NAME, key, getpid())))
+        return;
+
+    if (mkdir(tmp_dir, 0777) != 0)
+        return;
+
+    cache_outputs_t outputs = getOutputs(options);
+
+    bool copied = true;
+
+    for (size_t output_index = 0; output_index < outputs.size && copied; output_index++){
+        const char * suffix = outputs.suffixes[output_index];
+
+        char src[CACHE_MAX_PATH_LEN] = {};
+        char dst[CACHE_MAX_PATH_LEN] = {};
+
+        copied = pathFits(snprintf(src, CACHE_MAX_PATH_LEN, "%s%s", out_base, suffix)) &&
+                 pathFits(snprintf(dst, CACHE_MAX_PATH_LEN, "%s/%s%s", tmp_dir, CACHE_ENTRY_FILE_NAME, suffix)) &&
+                 copyFile(src, dst, 0644);
+    }
+
+    char entry_dir[CACHE_MAX_PATH_LEN] = {};
+    copied = copied && pathFits(snprintf(entry_dir, CACHE_MAX_PATH_LEN, "%s/%s/%s", cache->dir, CACHE_ENTRIES_DIR_NAME, key));
+
+    size_t entry_size = copied ? getDirFilesSize(tmp_dir) : 0;
+
+    // the entry is renamed under the lock, so the running size always counts every entry
+    int lock_fd = lockCache(cache);
+
+    // other process could have stored the same entry, then rename fails and ours is dropped
+    if (! copied || rename(tmp_dir, entry_dir) != 0){
+        removeEntryDir(tmp_dir);
+        entry_size = 0;
+    }
+
+    cache_stats_t stats = readStats(cache);
+
+    if (stats.size != SIZE_MAX)
+        stats.size += entry_size;
+
+    // entries are scanned only when the cache may be too big
+    if (stats.size > cache->max_size)
+        stats.size = evictEntries(cache);
+
+    writeStats(cache, &stats);
+
+    unlockCache(lock_fd);
+}
+
+void compileCachePrintStats(compile_cache_t * cache, FILE * out_file)
+{
+    assert(cache);
+    assert(out_file);
+
+    int lock_fd = lockCache(cache);
+
+    cache_stats_t stats = readStats(cache);
+
+    cache_entries_t entries = scanEntries(cache);
+
+    unlockCache(lock_fd);
+
+    double hit_rate = (stats.hits + stats.misses == 0) ? 0. : 100. * (double)stats.hits / (double)(stats.hits + stats.misses);
+
+    fprintf(out_file, "cache:   %s\n", cache->dir);
+    fprintf(out_file, "hits:    %zu\n", stats.hits);
+    fprintf(out_file, "misses:  %zu\n", stats.misses);
+    fprintf(out_file, "hit rate: %.1f%%\n", hit_rate);
+    fprintf(out_file, "entries: %zu\n", entries.size);
+    fprintf(out_file, "size:    %.2f MB of %.2f MB\n", (double)entries.total_size / 1e6, (double)cache->max_size / 1e6);
+
+    free(entries.entries);
+}
+
+// like ccache's default compiler check: hashing the whole binary on every start costs more than a hit saves,
+// and any rebuild or reinstall of the compiler changes its mtime or inode anyway
+static bool hashFileIdentity(sha256_ctx_t * sha, const char * file_name)
+{
+    assert(sha);
+    assert(file_name);
+
+    struct stat file_stat = {};
+    if (stat(file_name, &file_stat) != 0)
+        return false;
+
+    uint64_t identity[] = {file_stat.st_dev, file_stat.st_ino, (uint64_t)file_stat.st_size,
+                           (uint64_t)file_stat.st_mtim.tv_sec, (uint64_t)file_stat.st_mtim.tv_nsec};
+
+    sha256Update(sha, identity, sizeof(identity));
+
+    return true;
+}
+
+// a longer path is cut by snprintf and would name another file, the entry is skipped then
+static bool pathFits(int path_len)
+{
+    return path_len >= 0 && (size_t)path_len < CACHE_MAX_PATH_LEN;
+}
+
+static cache_outputs_t getOutputs(const driver_options_t * options)
+{
+    assert(options);
+
+    cache_outputs_t outputs = {};
+
+    snprintf(outputs.suffixes[outputs.size++], CACHE_MAX_SUFFIX_LEN, "%s", outExtension(options));
+
+    if (options->listing)
+        snprintf(outputs.suffixes[outputs.size++], CACHE_MAX_SUFFIX_LEN, "%s", ASM_EXTENSION);
+
+    if (options->c_abi)
+        snprintf(outputs.suffixes[outputs.size++], CACHE_MAX_SUFFIX_LEN, "%s", HEADER_EXTENSION);
+
+    if (options->ast_extension != NULL){
+        snprintf(outputs.suffixes[outputs.size++], CACHE_MAX_SUFFIX_LEN, "%s%s", FE_AST_EXTENSION, options->ast_extension);
+        snprintf(outputs.suffixes[outputs.size++], CACHE_MAX_SUFFIX_LEN, "%s", options->ast_extension);
+    }
+
+    return outputs;
+}
+
+// the copy is written to a temporary file and renamed, so nobody sees a half-written file
+static bool copyFile(const char * src_file_name, const char * dst_file_name, mode_t mode)
+{
+    assert(src_file_name);
+    assert(dst_file_name);
+
+    int src_fd = open(src_file_name, O_RDONLY);
+    if (src_fd < 0)
+        return false;
+
+    char tmp_file_name[CACHE_MAX_PATH_LEN] = {};
+    snprintf(tmp_file_name, CACHE_MAX_PATH_LEN, "%s.%d.tmp", dst_file_name, getpid());
+
+    int dst_fd = open(tmp_file_name, O_WRONLY | O_CREAT | O_TRUNC, mode);
+    if (dst_fd < 0){
+        close(src_fd);
+        return false;
+    }
+
+    char * buffer = (char *)calloc(COPY_BUFFER_SIZE, sizeof(char));
+    ssize_t read_size = 0;
+    bool copied = true;
+
+    while (copied && (read_size = read(src_fd, buffer, COPY_BUFFER_SIZE)) > 0)
+        copied = write(dst_fd, buffer, (size_t)read_size) == read_size;
+
+    copied = copied && read_size == 0;
+
+    free(buffer);
+    close(src_fd);
+
+    // umask could have cut the mode
+    fchmod(dst_fd, mode);
+
+    if (close(dst_fd) != 0)
+        copied = false;
+
+    if (copied && rename(tmp_file_name, dst_file_name) == 0)
+        return true;
+
+    unlink(tmp_file_name);
+
+    return false;
+}
+
+static int lockCache(const compile_cache_t * cache)
+{
+    assert(cache);
+
+    char lock_file_name[CACHE_MAX_PATH_LEN] = {};
+    snprintf(lock_file_name, CACHE_MAX_PATH_LEN, "%s/%s", cache->dir, CACHE_LOCK_FILE_NAME);
+
+    int lock_fd = open(lock_file_name, O_RDWR | O_CREAT, 0666);
+
+    if (lock_fd >= 0)
+        flock(lock_fd, LOCK_EX);
+
+    return lock_fd;
+}
+
+static void unlockCache(int lock_fd)
+{
+    if (lock_fd < 0)
+        return;
+
+    flock(lock_fd, LOCK_UN);
+    close(lock_fd);
+}
+
+static void updateStats(const compile_cache_t * cache, size_t new_hits, size_t new_misses)
+{
+    assert(cache);
+
+    int lock_fd = lockCache(cache);
+
+    cache_stats_t stats = readStats(cache);
+
+    stats.hits   += new_hits;
+    stats.misses += new_misses;
+
+    writeStats(cache, &stats);
+
+    unlockCache(lock_fd);
+}
+
+// a cache without the stats file is empty, a damaged or older file has no size and the next store scans entries
+static cache_stats_t readStats(const compile_cache_t * cache)
+{
+    assert(cache);
+
+    cache_stats_t stats = {};
+
+    char stats_file_name[CACHE_MAX_PATH_LEN] = {};
+    snprintf(stats_file_name, CACHE_MAX_PATH_LEN, "%s/%s", cache->dir, CACHE_STATS_FILE_NAME);
+
+    FILE * stats_file = fopen(stats_file_name, "r");
+    if (stats_file == NULL)
+        return stats;
+
+    int read_num = fscanf(stats_file, "hits %zu misses %zu size %zu", &stats.hits, &stats.misses, &stats.size);
+
+    if (read_num < 2){
+        stats.hits = 0;
+        stats.misses = 0;
+    }
+
+    if (read_num < 3)
+        stats.size = SIZE_MAX;
+
+    fclose(stats_file);
+
+    return stats;
+}
+
+static void writeStats(const compile_cache_t * cache, const cache_stats_t * stats)
+{
+    assert(cache);
+    assert(stats);
+
+    char stats_file_name[CACHE_MAX_PATH_LEN] = {};
+    snprintf(stats_file_name, CACHE_MAX_PATH_LEN, "%s/%s", cache->dir, CACHE_STATS_FILE_NAME);
+
+    FILE * stats_file = fopen(stats_file_name, "w");
+    if (stats_file == NULL)
+        return;
+
+    fprintf(stats_file, "hits %zu\nmisses %zu\n", stats->hits, stats->misses);
+
+    if (stats->size != SIZE_MAX)
+        fprintf(stats_file, "size %zu\n", stats->size);
+
+    fclose(stats_file);
+}
+
+static cache_entries_t scanEntries(const compile_cache_t * cache)
+{
+    assert(cache);
+
+    cache_entries_t entries = {};
+
+    char entries_dir_name[CACHE_MAX_PATH_LEN] = {};
+    snprintf(entries_dir_name, CACHE_MAX_PATH_LEN, "%s/%s", cache->dir, CACHE_ENTRIES_DIR_NAME);
+
+    DIR * entries_dir = opendir(entries_dir_name);
+    if (entries_dir == NULL)
+        return entries;
+
+    entries.entries = (cache_entry_info_t *)calloc(CACHE_ENTRIES_START_CAP, sizeof(cache_entry_info_t));
+    entries.capacity = CACHE_ENTRIES_START_CAP;
+
+    struct dirent * dir_entry = NULL;
+
+    while ((dir_entry = readdir(entries_dir)) != NULL){
+        if (strlen(dir_entry->d_name) != CACHE_KEY_LEN)
+            continue;
+
+        char entry_dir_name[CACHE_MAX_PATH_LEN] = {};
+        if (!pathFits(snprintf(entry_dir_name, CACHE_MAX_PATH_LEN, "%s/%s", entries_dir_name, dir_entry->d_name)))
+            continue;
+
+        struct stat entry_stat = {};
+        if (stat(entry_dir_name, &entry_stat) != 0)
+            continue;
+
+        if (entries.size >= entries.capacity){
+            entries.capacity *= 2;
+            entries.entries = (cache_entry_info_t *)realloc(entries.entries, entries.capacity * sizeof(cache_entry_info_t));
+        }
+
+        cache_entry_info_t * info = entries.entries + entries.size;
+        entries.size++;
+
+        strcpy(info->name, dir_entry->d_name);
+        info->used_time = entry_stat.st_mtim;
+        info->size = getDirFilesSize(entry_dir_name);
+
+        entries.total_size += info->size;
+    }
+
+    closedir(entries_dir);
+
+    return entries;
+}
+
+static size_t getDirFilesSize(const char * dir_name)
+{
+    assert(dir_name);
+
+    DIR * dir = opendir(dir_name);
+    if (dir == NULL)
+        return 0;
+
+    size_t size = 0;
+    struct dirent * file_entry = NULL;
+
+    while ((file_entry = readdir(dir)) != NULL){
+        struct stat file_stat = {};
+
+        if (file_entry->d_name[0] != '.' && fstatat(dirfd(dir), file_entry->d_name, &file_stat, 0) == 0)
+            size += (size_t)file_stat.st_size;
+    }
+
+    closedir(dir);
+
+    return size;
+}
+
+// least recently used entries go first, the cache must be locked, returns the size of the entries left
+static size_t evictEntries(compile_cache_t * cache)
+{
+    assert(cache);
+
+    cache_entries_t entries = scanEntries(cache);
+
+    if (entries.total_size > cache->max_size){
+        qsort(entries.entries, entries.size, sizeof(cache_entry_info_t), compareEntriesByTime);
+
+        for (size_t entry_index = 0; entry_index < entries.size && entries.total_size > cache->max_size; entry_index++){
+            char entry_dir[CACHE_MAX_PATH_LEN] = {};
+            char evicted_dir[CACHE_MAX_PATH_LEN] = {};
+
+            snprintf(entry_dir, CACHE_MAX_PATH_LEN, "%s/%s/%s", cache->dir, CACHE_ENTRIES_DIR_NAME, entries.entries[entry_index].name);
+            snprintf(evicted_dir, CACHE_MAX_PATH_LEN, "%s/%s/evicted.%d", cache->dir, CACHE_TMP_DIR_NAME, getpid());
+
+            // readers either find the whole entry or do not find it at all
+            if (rename(entry_dir, evicted_dir) != 0)
+                continue;
+
+            removeEntryDir(evicted_dir);
+
+            entries.total_size -= entries.entries[entry_index].size;
+
+            logPrint(LOG_DEBUG, "cache: evicted %s\n", entries.entries[entry_index].name);
+        }
+    }
+
+    free(entries.entries);
+
+    return entries.total_size;
+}
+
+static void removeEntryDir(const char * dir_name)
+{
+    assert(dir_name);
+
+    DIR * dir = opendir(dir_name);
+
+    if (dir != NULL){
+        struct dirent * dir_entry = NULL;
+
+        while ((dir_entry = readdir(dir)) != NULL)
+            if (dir_entry->d_name[0] != '.')
+                unlinkat(dirfd(dir), dir_entry->d_name, 0);
+
+        closedir(dir);
+    }
+
+    rmdir(dir_name);
+}
+
+static int compareEntriesByTime(const void * first, const void * second)
+{
+    const struct timespec * first_time  = &((const cache_entry_info_t *)first)->used_time;
+    const struct timespec * second_time = &((const cache_entry_info_t *)second)->used_time;
+
+    if (first_time->tv_sec != second_time->tv_sec)
+        return (first_time->tv_sec > second_time->tv_sec) - (first_time->tv_sec < second_time->tv_sec);
+
+    return (first_time->tv_nsec > second_time->tv_nsec) - (first_time->tv_nsec < second_time->tv_nsec);
+}
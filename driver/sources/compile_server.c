@@ -0,0 +1,529 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+
+#include <pthread.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "compile_server.h"
+#include "compile_protocol.h"
+#include "driver.h"
+#include "logger.h"
+
+const size_t CONNECTION_QUEUE_START_CAP = 16;
+const size_t CLIENTS_START_CAP          = 16;
+
+// connections passed between the poll loop and the workers
+typedef struct {
+    int * fds;
+    size_t head;
+    size_t size;
+    size_t capacity;
+
+    bool closed;
+
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+} connection_queue_t;
+
+// the poll loop waits for the next request of an idle connection, a busy one is served by a worker
+typedef struct {
+    int fd;
+    bool busy;
+} client_t;
+
+typedef struct {
+    client_t * clients;
+    size_t size;
+    size_t capacity;
+} client_list_t;
+
+typedef struct {
+    connection_queue_t * requests;      //< connections with a request to read
+    connection_queue_t * served;        //< connections that wait for the next request
+    connection_queue_t * finished;      //< connections to close
+    int wake_fd;                        //< the poll loop wakes up when a byte is written here
+    const std_lib_t * std_lib;
+} server_shared_t;
+
+static volatile sig_atomic_t stop_server = 0;
+static int server_wake_fd = -1;
+
+static void stopServerHandler(int signal_num);
+
+static int listenSocket(const char * socket_path);
+
+static void queueInit(connection_queue_t * queue);
+
+static void queueDestroy(connection_queue_t * queue);
+
+static void queuePush(connection_queue_t * queue, int fd);
+
+static bool queuePop(connection_queue_t * queue, int * fd);
+
+static bool queueTryPop(connection_queue_t * queue, int * fd);
+
+static void queueClose(connection_queue_t * queue);
+
+static void clientAdd(client_list_t * list, int fd);
+
+static client_t * clientFind(client_list_t * list, int fd);
+
+static void clientRemove(client_list_t * list, int fd);
+
+static void pollClients(server_shared_t * shared, client_list_t * list, int listen_fd, int wake_read_fd);
+
+static void * serverWorkerMain(void * arg);
+
+static bool serveRequest(compiler_t * compiler, int fd);
+
+static bool sendResponse(int fd, uint32_t status, const char * elf, size_t elf_size, const char * diag, size_t diag_size);
+
+int compileServerRun(const char * socket_path, const std_lib_t * std_lib, size_t threads_num)
+{
+    assert(socket_path);
+    assert(std_lib);
+    assert(threads_num > 0);
+
+    int listen_fd = listenSocket(socket_path);
+    if (listen_fd < 0)
+        return 1;
+
+    // the connection can be gone between poll and accept, then accept must not wait for the next one
+    fcntl(listen_fd, F_SETFL, O_NONBLOCK);
+
+    // workers must not get the signals, only poll() in this thread is interrupted by them
+    sigset_t stop_signals = {};
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+
+    struct sigaction stop_action = {};
+    stop_action.sa_handler = stopServerHandler;
+    sigemptyset(&stop_action.sa_mask);
+    sigaction(SIGINT,  &stop_action, NULL);
+    sigaction(SIGTERM, &stop_action, NULL);
+
+    signal(SIGPIPE, SIG_IGN);
+
+    int wake_pipe[2] = {-1, -1};
+    if (pipe2(wake_pipe, O_NONBLOCK | O_CLOEXEC) != 0){
+        perror("pipe");
+        close(listen_fd);
+        return 1;
+    }
+
+    server_wake_fd = wake_pipe[1];
+
+    connection_queue_t requests = {};
+    connection_queue_t served   = {};
+    connection_queue_t finished = {};
+    queueInit(&requests);
+    queueInit(&served);
+    queueInit(&finished);
+
+    server_shared_t shared = {
+        .requests = &requests,
+        .served   = &served,
+        .finished = &finished,
+        .wake_fd  = wake_pipe[1],
+        .std_lib  = std_lib
+    };
+
+    pthread_sigmask(SIG_BLOCK, &stop_signals, NULL);
+
+    pthread_t * threads = (pthread_t *)calloc(threads_num, sizeof(pthread_t));
+    for (size_t thread_index = 0; thread_index < threads_num; thread_index++)
+        pthread_create(threads + thread_index, NULL, serverWorkerMain, &shared);
+
+    pthread_sigmask(SIG_UNBLOCK, &stop_signals, NULL);
+
+    logPrint(LOG_RELEASE, "compile server is listening on '%s' with %zu workers\n", socket_path, threads_num);
+    fprintf(stderr, "compile server is listening on '%s' with %zu workers\n", socket_path, threads_num);
+
+    client_list_t clients = {};
+
+    while (! stop_server)
+        pollClients(&shared, &clients, listen_fd, wake_pipe[0]);
+
+    close(listen_fd);
+    unlink(socket_path);
+
+    // a worker waiting for the rest of a request gets the end of file, so every worker can be joined
+    queueClose(&requests);
+
+    for (size_t client_index = 0; client_index < clients.size; client_index++)
+        if (clients.clients[client_index].busy)
+            shutdown(clients.clients[client_index].fd, SHUT_RDWR);
+
+    for (size_t thread_index = 0; thread_index < threads_num; thread_index++)
+        pthread_join(threads[thread_index], NULL);
+
+    free(threads);
+
+    for (size_t client_index = 0; client_index < clients.size; client_index++)
+        close(clients.clients[client_index].fd);
+
+    free(clients.clients);
+
+    queueDestroy(&requests);
+    queueDestroy(&served);
+    queueDestroy(&finished);
+
+    server_wake_fd = -1;
+    close(wake_pipe[0]);
+    close(wake_pipe[1]);
+
+    logPrint(LOG_RELEASE, "compile server is stopped\n");
+
+    return 0;
+}
+
+// waits for new connections, requests of idle connections and connections given back by the workers
+static void pollClients(server_shared_t * shared, client_list_t * list, int listen_fd, int wake_read_fd)
+{
+    assert(shared);
+    assert(list);
+
+    struct pollfd * poll_fds = (struct pollfd *)calloc(list->size + 2, sizeof(struct pollfd));
+    nfds_t poll_num = 0;
+
+    poll_fds[poll_num++] = {.fd = wake_read_fd, .events = POLLIN, .revents = 0};
+    poll_fds[poll_num++] = {.fd = listen_fd,    .events = POLLIN, .revents = 0};
+
+    for (size_t client_index = 0; client_index < list->size; client_index++)
+        if (! list->clients[client_index].busy)
+            poll_fds[poll_num++] = {.fd = list->clients[client_index].fd, .events = POLLIN, .revents = 0};
+
+    if (poll(poll_fds, poll_num, -1) < 0){
+        if (errno != EINTR)
+            perror("poll");
+
+        free(poll_fds);
+        return;
+    }
+
+    if (poll_fds[0].revents != 0){
+        char wake_bytes[64] = {};
+        while (read(wake_read_fd, wake_bytes, sizeof(wake_bytes)) > 0)
+            ;
+    }
+
+    int fd = -1;
+
+    while (queueTryPop(shared->served, &fd))
+        clientFind(list, fd)->busy = false;
+
+    while (queueTryPop(shared->finished, &fd)){
+        clientRemove(list, fd);
+        close(fd);
+    }
+
+    // end of file and errors are found by the worker that reads the request
+    for (nfds_t poll_index = 2; poll_index < poll_num; poll_index++){
+        if (poll_fds[poll_index].revents == 0)
+            continue;
+
+        clientFind(list, poll_fds[poll_index].fd)->busy = true;
+        queuePush(shared->requests, poll_fds[poll_index].fd);
+    }
+
+    if (poll_fds[1].revents != 0){
+        int client_fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+
+        if (client_fd >= 0){
+            logPrint(LOG_DEBUG, "new connection %d\n", client_fd);
+            clientAdd(list, client_fd);
+        }
+        else if (errno != EINTR && errno != EAGAIN)
+            perror("accept");
+    }
+
+    free(poll_fds);
+}
+
+// the byte wakes up the poll loop even if the signal came right before poll
+static void stopServerHandler(int /*signal_num*/)
+{
+    int saved_errno = errno;
+
+    stop_server = 1;
+    writeAll(server_wake_fd, "", 1);
+
+    errno = saved_errno;
+}
+
+static int listenSocket(const char * socket_path)
+{
+    assert(socket_path);
+
+    struct sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+
+    if (strlen(socket_path) >= sizeof(address.sun_path)){
+        fprintf(stderr, "COMPILE SERVER: ERROR: socket path '%s' is too long\n", socket_path);
+        return -1;
+    }
+
+    strcpy(address.sun_path, socket_path);
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0){
+        perror("socket");
+        return -1;
+    }
+
+    // socket file of the previous run
+    unlink(socket_path);
+
+    if (bind(listen_fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(listen_fd, COMPILE_SERVER_BACKLOG) != 0){
+        perror("bind");
+        close(listen_fd);
+
+        return -1;
+    }
+
+    return listen_fd;
+}
+
+static void queueInit(connection_queue_t * queue)
+{
+    assert(queue);
+
+    queue->fds = (int *)calloc(CONNECTION_QUEUE_START_CAP, sizeof(int));
+    queue->capacity = CONNECTION_QUEUE_START_CAP;
+
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->not_empty, NULL);
+}
+
+static void queueDestroy(connection_queue_t * queue)
+{
+    assert(queue);
+
+    pthread_cond_destroy(&queue->not_empty);
+    pthread_mutex_destroy(&queue->lock);
+
+    free(queue->fds);
+    queue->fds = NULL;
+}
+
+static void queuePush(connection_queue_t * queue, int fd)
+{
+    assert(queue);
+
+    pthread_mutex_lock(&queue->lock);
+
+    if (queue->size >= queue->capacity){
+        int * new_fds = (int *)calloc(queue->capacity * 2, sizeof(int));
+
+        for (size_t fd_index = 0; fd_index < queue->size; fd_index++)
+            new_fds[fd_index] = queue->fds[(queue->head + fd_index) % queue->capacity];
+
+        free(queue->fds);
+
+        queue->fds = new_fds;
+        queue->head = 0;
+        queue->capacity *= 2;
+    }
+
+    queue->fds[(queue->head + queue->size) % queue->capacity] = fd;
+    queue->size++;
+
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+// returns false when the queue is closed
+static bool queuePop(connection_queue_t * queue, int * fd)
+{
+    assert(queue);
+    assert(fd);
+
+    pthread_mutex_lock(&queue->lock);
+
+    while (queue->size == 0 && ! queue->closed)
+        pthread_cond_wait(&queue->not_empty, &queue->lock);
+
+    bool popped = ! queue->closed;
+
+    if (popped){
+        *fd = queue->fds[queue->head];
+
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->size--;
+    }
+
+    pthread_mutex_unlock(&queue->lock);
+
+    return popped;
+}
+
+// returns false if the queue is empty
+static bool queueTryPop(connection_queue_t * queue, int * fd)
+{
+    assert(queue);
+    assert(fd);
+
+    pthread_mutex_lock(&queue->lock);
+
+    bool popped = (queue->size > 0);
+
+    if (popped){
+        *fd = queue->fds[queue->head];
+
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->size--;
+    }
+
+    pthread_mutex_unlock(&queue->lock);
+
+    return popped;
+}
+
+// the connections left in the queue are not served, the poll loop closes them with the others
+static void queueClose(connection_queue_t * queue)
+{
+    assert(queue);
+
+    pthread_mutex_lock(&queue->lock);
+
+    queue->closed = true;
+    queue->size = 0;
+
+    pthread_cond_broadcast(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+static void clientAdd(client_list_t * list, int fd)
+{
+    assert(list);
+
+    if (list->size >= list->capacity){
+        list->capacity = (list->capacity == 0) ? CLIENTS_START_CAP : list->capacity * 2;
+        list->clients = (client_t *)realloc(list->clients, list->capacity * sizeof(client_t));
+    }
+
+    list->clients[list->size++] = {.fd = fd, .busy = false};
+}
+
+static client_t * clientFind(client_list_t * list, int fd)
+{
+    assert(list);
+
+    for (size_t client_index = 0; client_index < list->size; client_index++)
+        if (list->clients[client_index].fd == fd)
+            return list->clients + client_index;
+
+    assert(0 && "connection is not in the list");
+    return NULL;
+}
+
+static void clientRemove(client_list_t * list, int fd)
+{
+    assert(list);
+
+    *clientFind(list, fd) = list->clients[list->size - 1];
+    list->size--;
+}
+
+// requests are independent, so every worker compiles its program on one thread;
+// a worker serves one request and gives the connection back, so idle clients do not keep the workers
+static void * serverWorkerMain(void * arg)
+{
+    server_shared_t * shared = (server_shared_t *)arg;
+
+    compiler_t compiler = compilerCtor(shared->std_lib, 1);
+
+    int fd = -1;
+
+    while (queuePop(shared->requests, &fd)){
+        queuePush(serveRequest(&compiler, fd) ? shared->served : shared->finished, fd);
+        writeAll(shared->wake_fd, "", 1);
+    }
+
+    compilerDtor(&compiler);
+
+    return NULL;
+}
+
+// returns false when the connection has to be closed
+static bool serveRequest(compiler_t * compiler, int fd)
+{
+    assert(compiler);
+
+    compile_request_t request = {};
+
+    if (! readAll(fd, &request, sizeof(request)))
+        return false;
+
+    if (request.magic != COMPILE_REQUEST_MAGIC || request.code_size > COMPILE_MAX_CODE_SIZE){
+        const char message[] = "COMPILE SERVER: ERROR: invalid request\n";
+        sendResponse(fd, COMPILE_BAD_REQUEST, NULL, 0, message, sizeof(message) - 1);
+
+        return false;
+    }
+
+    char * code = (char *)calloc(request.code_size + 1, sizeof(char));
+
+    if (! readAll(fd, code, request.code_size)){
+        free(code);
+        return false;
+    }
+
+    driver_options_t options = {
+        .workers_num   = 1,
+        .optimize      = (request.flags & COMPILE_NO_OPTIMIZE) == 0,
+        .listing       = false,
+        .ast_extension = NULL
+    };
+
+    char * elf = NULL;
+    size_t elf_size = 0;
+    FILE * elf_file = open_memstream(&elf, &elf_size);
+
+    char * diag = NULL;
+    size_t diag_size = 0;
+    FILE * diag_file = open_memstream(&diag, &diag_size);
+
+    compiler->diag_file = diag_file;
+
+    int run_status = compilerRun(compiler, code, &options, elf_file, NULL, NULL);
+
+    compiler->diag_file = stderr;
+
+    fclose(elf_file);
+    fclose(diag_file);
+
+    // every diagnostic is an error, elf of such program is not sent
+    uint32_t status = (run_status == 0 && diag_size == 0) ? COMPILE_SUCCESS : COMPILE_ERROR;
+    if (status != COMPILE_SUCCESS)
+        elf_size = 0;
+
+    bool sent = sendResponse(fd, status, elf, elf_size, diag, diag_size);
+
+    free(elf);
+    free(diag);
+    free(code);
+
+    return sent;
+}
+
+static bool sendResponse(int fd, uint32_t status, const char * elf, size_t elf_size, const char * diag, size_t diag_size)
+{
+    compile_response_t response = {
+        .magic = COMPILE_RESPONSE_MAGIC,
+        .status = status,
+        .elf_size = elf_size,
+        .diag_size = diag_size
+    };
+
+    return writeAll(fd, &response, sizeof(response)) && writeAll(fd, elf, elf_size) && writeAll(fd, diag, diag_size);
+}
@@ -0,0 +1,531 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "driver.h"
+#include "compile_cache.h"
+#include "incremental.h"
+#include "frontend.h"
+#include "middleend.h"
+#include "backend_x64.h"
+#include "x64_compile.h"
+#include "x64_object.h"
+#include "x64_linker.h"
+#include "x64_c_abi.h"
+#include "IR_handler.h"
+#include "logger.h"
+
+const size_t NAME_CHECK_START_CAP = 64;
+
+// names visible at the current statement, the backend asserts on a name it cannot find
+typedef struct {
+    const idr_t * ids;
+    FILE * diag_file;
+
+    size_t * declared;          //< visible declarations of every id
+    size_t * scope_ids;         //< declared ids in order, a scope is left by cutting them back
+    size_t scope_size;
+    size_t scope_capacity;
+
+    bool correct;
+} name_check_t;
+
+static bool checkNames(FILE * diag_file, const idr_t * ids, unsigned int id_size, node_t * root);
+
+static void checkStatementNames(name_check_t * check, node_t * node);
+
+static void checkScopeNames(name_check_t * check, node_t * node);
+
+static void checkExpressionNames(name_check_t * check, node_t * node);
+
+static void checkNameDeclared(name_check_t * check, node_t * id_node);
+
+static void declareName(name_check_t * check, node_t * id_node);
+
+static void leaveNames(name_check_t * check, size_t scope_start);
+
+static void dumpStageTree(const char * out_base, const char * stage_extension, const char * ast_extension,
+                          idr_t * ids, unsigned int id_size, node_t * root);
+
+static int compileLibrary(backend_ctx_t * be, const driver_options_t * options, FILE * obj_file, const char * out_base);
+
+static int compileToFiles(compiler_t * compiler, const char * code, const char * out_base, const driver_options_t * options);
+
+compiler_t compilerCtor(const std_lib_t * std_lib, size_t workers_num)
+{
+    assert(std_lib);
+
+    compiler_t compiler = {};
+
+    compiler.fe = frontendInit(MAX_TOKEN_NUM);
+    compiler.fe.workers_num = workers_num;
+    compiler.me = middleendCtor(NULL, NULL, 0, workers_num);
+
+    compiler.std_lib = std_lib;
+    compiler.diag_file = stderr;
+    compiler.cache = NULL;
+    compiler.incremental = NULL;
+
+    return compiler;
+}
+
+void compilerDtor(compiler_t * compiler)
+{
+    assert(compiler);
+
+    middleendDestroy(&compiler->me);
+    frontendDtor(&compiler->fe);
+
+    compiler->std_lib = NULL;
+}
+
+const char * outExtension(const driver_options_t * options)
+{
+    assert(options);
+
+    return options->object ? OBJ_EXTENSION : ELF_EXTENSION;
+}
+
+// every stage works with the tree of the previous one, nodes stay in the frontend and middleend arenas;
+// reused code has neither listing nor simplified tree, so listings and dumps turn incremental compilation off;
+// objects are always compiled from scratch
+int compilerRun(compiler_t * compiler, const char * code, const driver_options_t * options,
+                FILE * elf_file, FILE * asm_file, const char * dump_base)
+{
+    assert(compiler);
+    assert(code);
+    assert(options);
+    assert(elf_file);
+    assert(dump_base || (options->ast_extension == NULL && ! options->c_abi));
+
+    fe_context_t * fe = &compiler->fe;
+    me_context_t * me = &compiler->me;
+
+    frontendReset(fe);
+    fe->diag_file = compiler->diag_file;
+
+    node_t * root = frontendParse(fe, code);
+    if (root == NULL)
+        return 1;
+
+    if (! checkNames(compiler->diag_file, fe->ids, fe->id_size, root))
+        return 1;
+
+    if (options->ast_extension != NULL)
+        dumpStageTree(dump_base, FE_AST_EXTENSION, options->ast_extension, fe->ids, fe->id_size, root);
+
+    incremental_t * inc = (asm_file == NULL && options->ast_extension == NULL && ! options->object) ? compiler->incremental : NULL;
+
+    if (inc != NULL)
+        incrementalPrepare(inc, root, fe->ids, options->optimize);
+
+    middleendReset(me, root, fe->ids, fe->id_size);
+
+    if (inc != NULL)
+        me->skip_statements = inc->skip_statements;
+
+    if (options->optimize)
+        me->root = simplifyProgram(me, me->root);
+
+    if (options->ast_extension != NULL)
+        dumpStageTree(dump_base, "", options->ast_extension, me->ids, me->id_size, me->root);
+
+    backend_ctx_t be = backendCtor(me->root, me->ids, me->id_size, me->workers_num);
+    be.diag_file = compiler->diag_file;
+    be.relocatable = options->object;
+
+    if (inc != NULL){
+        be.cached_units     = inc->cached;
+        be.cached_units_num = inc->funcs_num;
+        be.keep_unit_codes  = true;
+    }
+
+    makeIR(&be);
+
+    int status = 0;
+
+    if (options->c_abi)
+        status = compileLibrary(&be, options, elf_file, dump_base);
+    else if (options->object){
+        x64_object_t object = objectCtor();
+
+        compileObject(&be, &object);
+        objectWrite(&object, elf_file);
+
+        objectDtor(&object);
+    }
+    else
+        compileProgram(&be, compiler->std_lib, elf_file, asm_file);
+
+    if (inc != NULL)
+        incrementalCollect(inc, &be);
+
+    backendDestroy(&be);
+
+    return status;
+}
+
+
+// the header goes next to the object like the dumps of the trees
+static int compileLibrary(backend_ctx_t * be, const driver_options_t * options, FILE * obj_file, const char * out_base)
+{
+    assert(be);
+    assert(options);
+    assert(obj_file);
+    assert(out_base);
+
+    char header_file_name[FILENAME_MAX] = {};
+    snprintf(header_file_name, FILENAME_MAX, "%s%s", out_base, HEADER_EXTENSION);
+
+    FILE * header_file = fopen(header_file_name, "w");
+    if (header_file == NULL){
+        fprintf(stderr, "DRIVER: ERROR: cannot open '%s'\n", header_file_name);
+        return 1;
+    }
+
+    x64_object_t object = objectCtor();
+
+    int status = compileCLibrary(be, &object, options->exports, options->exports_num, header_file);
+
+    if (status == 0)
+        objectWrite(&object, obj_file);
+
+    objectDtor(&object);
+    fclose(header_file);
+
+    if (status != 0)
+        unlink(header_file_name);
+
+    return status;
+}
+
+int compileProgramFile(compiler_t * compiler, const char * program_file_name, const char * out_base, const driver_options_t * options)
+{
+    assert(compiler);
+    assert(program_file_name);
+    assert(out_base);
+    assert(options);
+
+    program_text_t program = {};
+    if (!programTextOpen(&program, program_file_name)){
+        fprintf(stderr, "DRIVER: ERROR: cannot read '%s'\n", program_file_name);
+        return 1;
+    }
+
+    logPrint(LOG_RELEASE, "compiling '%s'\n", program_file_name);
+
+    const char * code = program.text;
+
+    char cache_key[CACHE_KEY_LEN + 1] = {};
+
+    if (compiler->cache != NULL){
+        compileCacheKey(compiler->cache, code, options, cache_key);
+
+        if (compileCacheLookup(compiler->cache, cache_key, out_base, options)){
+            programTextClose(&program);
+            return 0;
+        }
+    }
+
+    int status = compileToFiles(compiler, code, out_base, options);
+
+    programTextClose(&program);
+
+    if (status != 0){
+        fprintf(stderr, "DRIVER: ERROR: cannot compile '%s'\n", program_file_name);
+
+        char elf_file_name[FILENAME_MAX] = {};
+        snprintf(elf_file_name, FILENAME_MAX, "%s%s", out_base, outExtension(options));
+        unlink(elf_file_name);
+    }
+    else if (compiler->cache != NULL)
+        compileCacheStore(compiler->cache, cache_key, out_base, options);
+
+    return status;
+}
+
+// with the cache every diagnostic fails the compilation, so programs with errors never get to the cache
+static int compileToFiles(compiler_t * compiler, const char * code, const char * out_base, const driver_options_t * options)
+{
+    assert(compiler);
+    assert(code);
+    assert(out_base);
+    assert(options);
+
+    char file_name[FILENAME_MAX] = {};
+    snprintf(file_name, FILENAME_MAX, "%s%s", out_base, outExtension(options));
+
+    FILE * elf_file = fopen(file_name, "wb");
+    if (elf_file == NULL){
+        fprintf(stderr, "DRIVER: ERROR: cannot open '%s'\n", file_name);
+        return 1;
+    }
+
+    if (! options->object)
+        fchmod(fileno(elf_file), 0755);
+
+    FILE * asm_file = NULL;
+
+    if (options->listing){
+        snprintf(file_name, FILENAME_MAX, "%s%s", out_base, ASM_EXTENSION);
+        asm_file = fopen(file_name, "w");
+    }
+
+    char * diag = NULL;
+    size_t diag_size = 0;
+
+    bool collect_diag = (compiler->cache != NULL || compiler->incremental != NULL);
+
+    FILE * diag_file = compiler->diag_file;
+    if (collect_diag)
+        compiler->diag_file = open_memstream(&diag, &diag_size);
+
+    int status = compilerRun(compiler, code, options, elf_file, asm_file, out_base);
+
+    if (collect_diag){
+        fclose(compiler->diag_file);
+        compiler->diag_file = diag_file;
+
+        fwrite(diag, sizeof(char), diag_size, diag_file);
+        free(diag);
+
+        if (diag_size > 0 && compiler->cache != NULL)
+            status = 1;
+    }
+
+    // code of a program with errors is not reused, the next compilation reports them again
+    if (compiler->incremental != NULL)
+        incrementalFinish(compiler->incremental, status == 0 && diag_size == 0);
+
+    if (asm_file != NULL)
+        fclose(asm_file);
+    fclose(elf_file);
+
+    return status;
+}
+
+int linkProgramFiles(const std_lib_t * std_lib, const char * const * object_file_names, size_t objects_num, const char * elf_file_name)
+{
+    assert(std_lib);
+    assert(object_file_names);
+    assert(elf_file_name);
+
+    x64_object_t * objects = (x64_object_t *)calloc(objects_num + 1, sizeof(x64_object_t));
+    size_t loaded_num = 0;
+
+    int status = 0;
+
+    for (; loaded_num < objects_num; loaded_num++){
+        objects[loaded_num] = objectLoad(object_file_names[loaded_num]);
+
+        if (objects[loaded_num].sections == NULL){
+            fprintf(stderr, "DRIVER: ERROR: cannot load object '%s'\n", object_file_names[loaded_num]);
+            status = 1;
+            break;
+        }
+    }
+
+    FILE * elf_file = NULL;
+
+    if (status == 0){
+        elf_file = fopen(elf_file_name, "wb");
+
+        if (elf_file == NULL){
+            fprintf(stderr, "DRIVER: ERROR: cannot open '%s'\n", elf_file_name);
+            status = 1;
+        }
+    }
+
+    if (status == 0){
+        fchmod(fileno(elf_file), 0755);
+
+        status = linkObjects(objects, objects_num, std_lib, elf_file, stderr);
+        fclose(elf_file);
+
+        if (status != 0){
+            fprintf(stderr, "DRIVER: ERROR: cannot link '%s'\n", elf_file_name);
+            unlink(elf_file_name);
+        }
+    }
+
+    for (size_t object_index = 0; object_index < loaded_num; object_index++)
+        objectDtor(objects + object_index);
+
+    free(objects);
+
+    return status;
+}
+
+// scopes are the ones of the backend: bodies of if, else and while, functions see the names declared before them;
+// names of the called functions are not checked, the backend reports them and objects resolve them by the linker
+static bool checkNames(FILE * diag_file, const idr_t * ids, unsigned int id_size, node_t * root)
+{
+    assert(diag_file);
+    assert(ids);
+
+    name_check_t check = {
+        .ids            = ids,
+        .diag_file      = diag_file,
+        .declared       = (size_t *)calloc(id_size + 1, sizeof(size_t)),
+        .scope_ids      = (size_t *)calloc(NAME_CHECK_START_CAP, sizeof(size_t)),
+        .scope_size     = 0,
+        .scope_capacity = NAME_CHECK_START_CAP,
+        .correct        = true
+    };
+
+    checkStatementNames(&check, root);
+
+    free(check.declared);
+    free(check.scope_ids);
+
+    return check.correct;
+}
+
+static void checkStatementNames(name_check_t * check, node_t * node)
+{
+    assert(check);
+
+    // statement chains are right-leaning and may be very long, so they are walked by a loop
+    while (node != NULL && node->type == OPR && node->val.op == SEP){
+        checkStatementNames(check, node->left);
+        node = node->right;
+    }
+
+    if (node == NULL)
+        return;
+
+    if (node->type != OPR){
+        checkExpressionNames(check, node);
+        return;
+    }
+
+    enum oper op = node->val.op;
+
+    if (op == VAR_DECL)
+        declareName(check, node->left);
+
+    else if (op == ASSIGN){
+        checkExpressionNames(check, node->right);
+        checkNameDeclared(check, node->left);
+    }
+
+    else if (op == IN)
+        checkNameDeclared(check, node->left);
+
+    else if (op == IF){
+        checkExpressionNames(check, node->left);
+
+        if (node->right != NULL && node->right->type == OPR && node->right->val.op == IF_ELSE){
+            checkScopeNames(check, node->right->left);
+            checkScopeNames(check, node->right->right);
+        }
+        else
+            checkScopeNames(check, node->right);
+    }
+
+    else if (op == WHILE){
+        checkExpressionNames(check, node->left);
+        checkScopeNames(check, node->right);
+    }
+
+    else if (op == FUNC_DECL){
+        size_t scope_start = check->scope_size;
+
+        for (node_t * arg_node = node->left->right; arg_node != NULL; arg_node = arg_node->right)
+            declareName(check, arg_node->left);
+
+        checkStatementNames(check, node->right);
+        leaveNames(check, scope_start);
+    }
+
+    else
+        checkExpressionNames(check, node);
+}
+
+static void checkScopeNames(name_check_t * check, node_t * node)
+{
+    assert(check);
+
+    size_t scope_start = check->scope_size;
+
+    checkStatementNames(check, node);
+    leaveNames(check, scope_start);
+}
+
+static void checkExpressionNames(name_check_t * check, node_t * node)
+{
+    assert(check);
+
+    if (node == NULL)
+        return;
+
+    if (node->type == IDR){
+        checkNameDeclared(check, node);
+        return;
+    }
+
+    // the name of the function is not a variable, only the args are checked
+    if (node->type == OPR && node->val.op == CALL){
+        checkExpressionNames(check, node->right);
+        return;
+    }
+
+    checkExpressionNames(check, node->left);
+    checkExpressionNames(check, node->right);
+}
+
+static void checkNameDeclared(name_check_t * check, node_t * id_node)
+{
+    assert(check);
+
+    if (id_node == NULL || id_node->type != IDR || check->declared[id_node->val.id] > 0)
+        return;
+
+    fprintf(check->diag_file, "DRIVER: ERROR: variable %s is not declared in this scope\n", check->ids[id_node->val.id].name);
+    check->correct = false;
+}
+
+static void declareName(name_check_t * check, node_t * id_node)
+{
+    assert(check);
+
+    if (id_node == NULL || id_node->type != IDR)
+        return;
+
+    if (check->scope_size >= check->scope_capacity){
+        check->scope_capacity *= 2;
+        check->scope_ids = (size_t *)realloc(check->scope_ids, check->scope_capacity * sizeof(size_t));
+    }
+
+    check->scope_ids[check->scope_size++] = id_node->val.id;
+    check->declared[id_node->val.id]++;
+}
+
+static void leaveNames(name_check_t * check, size_t scope_start)
+{
+    assert(check);
+
+    for ( ; check->scope_size > scope_start; check->scope_size--)
+        check->declared[check->scope_ids[check->scope_size - 1]]--;
+}
+
+static void dumpStageTree(const char * out_base, const char * stage_extension, const char * ast_extension,
+                          idr_t * ids, unsigned int id_size, node_t * root)
+{
+    assert(out_base);
+    assert(stage_extension);
+    assert(ast_extension);
+
+    char file_name[FILENAME_MAX] = {};
+    snprintf(file_name, FILENAME_MAX, "%s%s%s", out_base, stage_extension, ast_extension);
+
+    tree_context_t tree = {};
+    tree.ids = ids;
+    tree.id_size = id_size;
+
+    writeTreeToFile(&tree, root, file_name);
+}
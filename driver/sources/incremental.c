@@ -0,0 +1,311 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+
+#include "incremental.h"
+#include "node_stack.h"
+#include "logger.h"
+
+const size_t INC_START_CAP = 64;
+
+const uint8_t KEY_NULL_NODE  = 0xFF;        // no child, it keeps the shape of the tree in the key
+const uint8_t KEY_GLOBALS_END = '\n';       // names consist of [a-z0-9_], so it cannot be a part of them
+
+static void hashFuncTree(sha256_ctx_t * sha, node_stack_t * stack, node_t * func, const idr_t * ids);
+
+static void addFunc(incremental_t * inc, const uint8_t * key, unit_code_t * cached);
+
+static void addUnit(inc_units_t * units, const uint8_t * key, unit_code_t * code, bool fresh);
+
+static void freeUnusedUnits(inc_units_t * units);
+
+static int compareUnitsByKey(const void * first, const void * second);
+
+static int compareKeyWithUnit(const void * key, const void * unit);
+
+incremental_t incrementalCtor()
+{
+    incremental_t inc = {};
+
+    inc.funcs_capacity = INC_START_CAP;
+    inc.keys   = (uint8_t (*)[SHA256_DIGEST_SIZE])calloc(inc.funcs_capacity, SHA256_DIGEST_SIZE);
+    inc.cached = (unit_code_t **)calloc(inc.funcs_capacity, sizeof(unit_code_t *));
+
+    inc.statements_capacity = INC_START_CAP;
+    inc.skip_statements = (bool *)calloc(inc.statements_capacity, sizeof(bool));
+
+    return inc;
+}
+
+void incrementalDtor(incremental_t * inc)
+{
+    assert(inc);
+
+    incrementalFinish(inc, false);
+
+    for (size_t unit_index = 0; unit_index < inc->prev.size; unit_index++)
+        unitCodeDtor(inc->prev.units[unit_index].code);
+
+    free(inc->prev.units);
+    free(inc->next.units);
+
+    free(inc->keys);
+    free(inc->cached);
+    free(inc->skip_statements);
+
+    *inc = {};
+}
+
+// top-level functions are numbered in the same order as the backend makes their units
+void incrementalPrepare(incremental_t * inc, node_t * root, const idr_t * ids, bool optimize)
+{
+    assert(inc);
+    assert(ids);
+
+    inc->funcs_num  = 0;
+    inc->reused_num = 0;
+    inc->prepared   = true;
+
+    node_stack_t stack = nodeStackCtor();
+
+    // global variables are only added at the top level, so the key of every function starts with the same prefix
+    sha256_ctx_t globals_sha = sha256Ctor();
+
+    sha256Update(&globals_sha, UNIT_KEY_VERSION, strlen(UNIT_KEY_VERSION) + 1);
+    sha256Update(&globals_sha, &optimize, sizeof(optimize));
+
+    size_t statement_index = 0;
+
+    for (node_t * sep = root; sep != NULL && sep->type == OPR && sep->val.op == SEP; sep = sep->right, statement_index++){
+        if (statement_index >= inc->statements_capacity){
+            inc->statements_capacity *= 2;
+            inc->skip_statements = (bool *)realloc(inc->skip_statements, inc->statements_capacity * sizeof(bool));
+        }
+
+        inc->skip_statements[statement_index] = false;
+
+        node_t * statement = sep->left;
+
+        if (statement == NULL || statement->type != OPR)
+            continue;
+
+        if (statement->val.op == VAR_DECL){
+            const char * name = ids[statement->left->val.id].name;
+            sha256Update(&globals_sha, name, strlen(name) + 1);
+
+            continue;
+        }
+
+        if (statement->val.op != FUNC_DECL)
+            continue;
+
+        sha256_ctx_t func_sha = globals_sha;
+        sha256Update(&func_sha, &KEY_GLOBALS_END, sizeof(KEY_GLOBALS_END));
+
+        hashFuncTree(&func_sha, &stack, statement, ids);
+
+        uint8_t key[SHA256_DIGEST_SIZE] = {};
+        sha256Final(&func_sha, key);
+
+        inc_unit_t * found = NULL;
+        if (inc->prev.size > 0)
+            found = (inc_unit_t *)bsearch(key, inc->prev.units, inc->prev.size, sizeof(inc_unit_t), compareKeyWithUnit);
+
+        if (found != NULL){
+            found->used = true;
+            inc->reused_num++;
+
+            inc->skip_statements[statement_index] = true;
+        }
+
+        addFunc(inc, key, (found == NULL) ? NULL : found->code);
+    }
+
+    nodeStackDtor(&stack);
+
+    logPrint(LOG_DEBUG, "incremental: %zu of %zu functions are reused\n", inc->reused_num, inc->funcs_num);
+}
+
+void incrementalCollect(incremental_t * inc, backend_ctx_t * be)
+{
+    assert(inc);
+    assert(be);
+
+    if (! inc->prepared)
+        return;
+
+    for (size_t func_index = 0; func_index < inc->funcs_num && func_index < be->units_num; func_index++){
+        func_unit_t * unit = be->units + func_index;
+
+        if (inc->cached[func_index] != NULL){
+            // the code is owned by the previous units, they give it to the next ones when the compilation finishes
+            addUnit(&inc->next, inc->keys[func_index], inc->cached[func_index], false);
+        }
+        else if (unit->code != NULL){
+            addUnit(&inc->next, inc->keys[func_index], unit->code, true);
+            unit->code = NULL;
+        }
+    }
+}
+
+void incrementalFinish(incremental_t * inc, bool succeeded)
+{
+    assert(inc);
+
+    if (! inc->prepared)
+        return;
+
+    inc->prepared = false;
+
+    if (! succeeded){
+        for (size_t unit_index = 0; unit_index < inc->next.size; unit_index++)
+            if (inc->next.units[unit_index].fresh)
+                unitCodeDtor(inc->next.units[unit_index].code);
+
+        for (size_t unit_index = 0; unit_index < inc->prev.size; unit_index++)
+            inc->prev.units[unit_index].used = false;
+
+        inc->next.size = 0;
+
+        return;
+    }
+
+    freeUnusedUnits(&inc->prev);
+
+    qsort(inc->next.units, inc->next.size, sizeof(inc_unit_t), compareUnitsByKey);
+
+    // equal functions have equal keys, one code is enough for all of them
+    size_t unique_size = 0;
+
+    for (size_t unit_index = 0; unit_index < inc->next.size; unit_index++){
+        inc_unit_t * unit = inc->next.units + unit_index;
+
+        if (unique_size > 0 && memcmp(inc->next.units[unique_size - 1].key, unit->key, SHA256_DIGEST_SIZE) == 0){
+            if (unit->code != inc->next.units[unique_size - 1].code)
+                unitCodeDtor(unit->code);
+
+            continue;
+        }
+
+        inc->next.units[unique_size++] = *unit;
+    }
+
+    inc->next.size = unique_size;
+
+    for (size_t unit_index = 0; unit_index < inc->next.size; unit_index++){
+        inc->next.units[unit_index].used  = false;
+        inc->next.units[unit_index].fresh = false;
+    }
+
+    inc_units_t old_prev = inc->prev;
+
+    inc->prev = inc->next;
+    inc->next = old_prev;
+    inc->next.size = 0;
+}
+
+// preorder with the markers of the missing children, names and signatures go instead of the ids
+static void hashFuncTree(sha256_ctx_t * sha, node_stack_t * stack, node_t * func, const idr_t * ids)
+{
+    assert(sha);
+    assert(stack);
+    assert(func);
+    assert(ids);
+
+    nodeStackPush(stack, func, NULL, 0);
+
+    while (! nodeStackEmpty(stack)){
+        node_t * node = nodeStackPop(stack).node;
+
+        if (node == NULL){
+            sha256Update(sha, &KEY_NULL_NODE, sizeof(KEY_NULL_NODE));
+            continue;
+        }
+
+        uint8_t type = (uint8_t)node->type;
+        sha256Update(sha, &type, sizeof(type));
+
+        switch (node->type){
+            case NUM:
+                sha256Update(sha, &node->val.number, sizeof(node->val.number));
+                break;
+            case OPR:
+                sha256Update(sha, &node->val.op, sizeof(node->val.op));
+                break;
+            case IDR: {
+                const idr_t * id = ids + node->val.id;
+
+                // arguments number of a function is a part of the code of its calls
+                sha256Update(sha, id->name, strlen(id->name) + 1);
+                sha256Update(sha, &id->type, sizeof(id->type));
+                sha256Update(sha, &id->num_of_args, sizeof(id->num_of_args));
+                break;
+            }
+            case END:
+            default:
+                break;
+        }
+
+        nodeStackPush(stack, node->right, NULL, 0);
+        nodeStackPush(stack, node->left,  NULL, 0);
+    }
+}
+
+static void addFunc(incremental_t * inc, const uint8_t * key, unit_code_t * cached)
+{
+    assert(inc);
+    assert(key);
+
+    if (inc->funcs_num >= inc->funcs_capacity){
+        inc->funcs_capacity *= 2;
+        inc->keys   = (uint8_t (*)[SHA256_DIGEST_SIZE])realloc(inc->keys, inc->funcs_capacity * SHA256_DIGEST_SIZE);
+        inc->cached = (unit_code_t **)realloc(inc->cached, inc->funcs_capacity * sizeof(unit_code_t *));
+    }
+
+    memcpy(inc->keys[inc->funcs_num], key, SHA256_DIGEST_SIZE);
+    inc->cached[inc->funcs_num] = cached;
+
+    inc->funcs_num++;
+}
+
+static void addUnit(inc_units_t * units, const uint8_t * key, unit_code_t * code, bool fresh)
+{
+    assert(units);
+    assert(key);
+    assert(code);
+
+    if (units->size >= units->capacity){
+        units->capacity = (units->capacity == 0) ? INC_START_CAP : units->capacity * 2;
+        units->units = (inc_unit_t *)realloc(units->units, units->capacity * sizeof(inc_unit_t));
+    }
+
+    inc_unit_t * unit = units->units + units->size;
+    units->size++;
+
+    memcpy(unit->key, key, SHA256_DIGEST_SIZE);
+    unit->code  = code;
+    unit->used  = false;
+    unit->fresh = fresh;
+}
+
+static void freeUnusedUnits(inc_units_t * units)
+{
+    assert(units);
+
+    for (size_t unit_index = 0; unit_index < units->size; unit_index++)
+        if (! units->units[unit_index].used)
+            unitCodeDtor(units->units[unit_index].code);
+
+    units->size = 0;
+}
+
+static int compareUnitsByKey(const void * first, const void * second)
+{
+    return memcmp(((const inc_unit_t *)first)->key, ((const inc_unit_t *)second)->key, SHA256_DIGEST_SIZE);
+}
+
+static int compareKeyWithUnit(const void * key, const void * unit)
+{
+    return memcmp(key, ((const inc_unit_t *)unit)->key, SHA256_DIGEST_SIZE);
+}
@@ -0,0 +1,245 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "driver.h"
+#include "compile_server.h"
+#include "compile_cache.h"
+#include "watch.h"
+#include "x64_compile.h"
+#include "logger.h"
+#include "thread_pool.h"
+
+static int compileProgramArg(compiler_t * compiler, const char * program_file_name, const char * out_name, const driver_options_t * options);
+
+static const char * makeOutBase(const char * file_name, char * out_base);
+
+// ARGS
+// [-j threads_num]        - number of worker threads (number of cores by default)
+// [-O0]                   - do not run middleend
+// [-S]                    - write asm listing next to the elf
+// [-c]                    - write relocatable objects (name.o) instead of the elfs, they are linked by --link
+// [--link]                - link the given objects with the std lib to one elf (-o or the name of the first object)
+// [--c-abi]               - write objects that C code links, their functions are called with SysV ABI, prototypes go to name.h
+// [--export func]         - only for --c-abi, export only the given functions (can be repeated), all of them by default
+// [--dump-ast ext]        - write trees of the frontend (name.fe.ext) and of the middleend (name.ext), ext is .ast or .astb
+// [--std std lib file]    - backend_x64/std_funcs.bin by default
+// [-o out file name]      - only for one program, its extension is replaced by .elf; name.elf near the program by default
+// [--server socket path]  - serve compile requests on the unix socket, -j is the number of worker threads then
+// [--cache dir]           - take outputs of the programs compiled before from the cache in dir
+// [--cache-size MB]       - size limit of the cache, 256 MB by default
+// [--cache-stats]         - print statistics of the cache (programs are not needed then)
+// [--watch]               - recompile the programs when they are written, code of unchanged functions is reused
+// program file names      - std lib is read once for all of them
+int main(int argc, char ** argv)
+{
+    driver_options_t options = {
+        .workers_num   = getCoresNum(),
+        .optimize      = true,
+        .listing       = false,
+        .object        = false,
+        .c_abi         = false,
+        .exports       = NULL,
+        .exports_num   = 0,
+        .ast_extension = NULL
+    };
+
+    const char * std_lib_file_name = DEFAULT_STD_LIB_FILE_NAME;
+    const char * elf_file_name = NULL;
+    const char * socket_path = NULL;
+
+    const char * cache_dir = NULL;
+    double cache_size_mb = (double)DEFAULT_CACHE_SIZE_MB;
+    bool print_cache_stats = false;
+    bool watch = false;
+    bool link = false;
+
+    const char ** exports = (const char **)calloc((size_t)argc, sizeof(const char *));
+
+    int arg_index = 1;
+
+    for (; arg_index < argc && argv[arg_index][0] == '-'; arg_index++){
+        const char * arg = argv[arg_index];
+        bool has_value = arg_index + 1 < argc;
+
+        if (strcmp(arg, "-j") == 0 && has_value){
+            options.workers_num = strtoul(argv[++arg_index], NULL, 10);
+            if (options.workers_num == 0)
+                options.workers_num = 1;
+        }
+        else if (strcmp(arg, "-O0") == 0)
+            options.optimize = false;
+        else if (strcmp(arg, "-S") == 0)
+            options.listing = true;
+        else if (strcmp(arg, "-c") == 0)
+            options.object = true;
+        else if (strcmp(arg, "--link") == 0)
+            link = true;
+        else if (strcmp(arg, "--c-abi") == 0){
+            options.c_abi  = true;
+            options.object = true;
+        }
+        else if (strcmp(arg, "--export") == 0 && has_value)
+            exports[options.exports_num++] = argv[++arg_index];
+        else if (strcmp(arg, "--dump-ast") == 0 && has_value)
+            options.ast_extension = argv[++arg_index];
+        else if (strcmp(arg, "--std") == 0 && has_value)
+            std_lib_file_name = argv[++arg_index];
+        else if (strcmp(arg, "-o") == 0 && has_value)
+            elf_file_name = argv[++arg_index];
+        else if (strcmp(arg, "--server") == 0 && has_value)
+            socket_path = argv[++arg_index];
+        else if (strcmp(arg, "--cache") == 0 && has_value)
+            cache_dir = argv[++arg_index];
+        else if (strcmp(arg, "--cache-size") == 0 && has_value)
+            cache_size_mb = strtod(argv[++arg_index], NULL);
+        else if (strcmp(arg, "--cache-stats") == 0)
+            print_cache_stats = true;
+        else if (strcmp(arg, "--watch") == 0)
+            watch = true;
+        else {
+            fprintf(stderr, "DRIVER: unknown option '%s'\n", arg);
+            free(exports);
+            return 1;
+        }
+    }
+
+    options.exports = exports;
+
+    int programs_num = argc - arg_index;
+
+    bool only_stats = print_cache_stats && programs_num == 0 && socket_path == NULL;
+
+    if ((socket_path == NULL && programs_num == 0 && ! only_stats) || (socket_path != NULL && programs_num != 0) ||
+        (elf_file_name != NULL && programs_num != 1 && ! link) || (print_cache_stats && cache_dir == NULL) ||
+        (watch && (socket_path != NULL || programs_num == 0)) || (options.object && (options.listing || socket_path != NULL)) ||
+        (link && (programs_num == 0 || options.object || watch || socket_path != NULL || cache_dir != NULL)) ||
+        (options.exports_num > 0 && ! options.c_abi)){
+        fprintf(stderr, "DRIVER: incorrect number of args given!\n");
+        free(exports);
+        return 1;
+    }
+
+    mkdir(DRIVER_LOG_FOLDER_NAME, 0777);
+    logStart(DRIVER_LOG_FILE_NAME, LOG_RELEASE, LOG_HTML);
+
+    // nothing is compiled, so the std lib is not needed
+    if (only_stats){
+        compile_cache_t cache = compileCacheCtor(cache_dir, (size_t)(cache_size_mb * 1e6), NULL);
+
+        if (cache.dir != NULL)
+            compileCachePrintStats(&cache, stdout);
+
+        int stats_status = (cache.dir != NULL) ? 0 : 1;
+
+        compileCacheDtor(&cache);
+        free(exports);
+        logExit();
+
+        return stats_status;
+    }
+
+    std_lib_t std_lib = stdLibLoad(std_lib_file_name);
+    if (std_lib.code == NULL){
+        free(exports);
+        logExit();
+        return 1;
+    }
+
+    if (socket_path != NULL){
+        int server_status = compileServerRun(socket_path, &std_lib, options.workers_num);
+
+        free(exports);
+        stdLibFree(&std_lib);
+        logExit();
+
+        return server_status;
+    }
+
+    if (link){
+        char out_base[FILENAME_MAX] = {};
+        makeOutBase((elf_file_name != NULL) ? elf_file_name : argv[arg_index], out_base);
+        strncat(out_base, ELF_EXTENSION, FILENAME_MAX - strlen(out_base) - 1);
+
+        int link_status = linkProgramFiles(&std_lib, argv + arg_index, (size_t)programs_num, out_base);
+
+        free(exports);
+        stdLibFree(&std_lib);
+        logExit();
+
+        return link_status;
+    }
+
+    compile_cache_t cache = {};
+
+    if (cache_dir != NULL)
+        cache = compileCacheCtor(cache_dir, (size_t)(cache_size_mb * 1e6), &std_lib);
+
+    compiler_t compiler = compilerCtor(&std_lib, options.workers_num);
+
+    if (cache.dir != NULL)
+        compiler.cache = &cache;
+
+    int status = 0;
+
+    if (watch){
+        char (* out_bases)[FILENAME_MAX] = (char (*)[FILENAME_MAX])calloc((size_t)programs_num, FILENAME_MAX);
+        const char ** out_base_ptrs = (const char **)calloc((size_t)programs_num, sizeof(const char *));
+
+        for (int program_index = 0; program_index < programs_num; program_index++){
+            const char * out_name = (elf_file_name != NULL) ? elf_file_name : argv[arg_index + program_index];
+            out_base_ptrs[program_index] = makeOutBase(out_name, out_bases[program_index]);
+        }
+
+        status = watchPrograms(&compiler, argv + arg_index, out_base_ptrs, (size_t)programs_num, &options);
+
+        free(out_base_ptrs);
+        free(out_bases);
+
+        arg_index = argc;
+    }
+
+    for (; arg_index < argc; arg_index++){
+        const char * out_name = (elf_file_name != NULL) ? elf_file_name : argv[arg_index];
+
+        if (compileProgramArg(&compiler, argv[arg_index], out_name, &options) != 0)
+            status = 1;
+    }
+
+    if (print_cache_stats && cache.dir != NULL)
+        compileCachePrintStats(&cache, stdout);
+
+    compilerDtor(&compiler);
+    compileCacheDtor(&cache);
+    stdLibFree(&std_lib);
+    free(exports);
+
+    logExit();
+
+    return status;
+}
+
+static int compileProgramArg(compiler_t * compiler, const char * program_file_name, const char * out_name, const driver_options_t * options)
+{
+    char out_base[FILENAME_MAX] = {};
+    makeOutBase(out_name, out_base);
+
+    return compileProgramFile(compiler, program_file_name, out_base, options);
+}
+
+// file name without the extension
+static const char * makeOutBase(const char * file_name, char * out_base)
+{
+    strncpy(out_base, file_name, FILENAME_MAX - 1);
+
+    char * dot   = strrchr(out_base, '.');
+    char * slash = strrchr(out_base, '/');
+
+    if (dot != NULL && (slash == NULL || dot > slash))
+        *dot = '\0';
+
+    return out_base;
+}
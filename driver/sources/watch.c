@@ -0,0 +1,178 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+
+#include <poll.h>
+#include <unistd.h>
+#include <libgen.h>
+#include <sys/inotify.h>
+
+#include "watch.h"
+#include "incremental.h"
+#include "logger.h"
+
+typedef struct {
+    const char * file_name;
+    const char * out_base;
+
+    char * dir_name;
+    char * base_name;
+    int watch_fd;
+
+    incremental_t inc;
+
+    bool changed;
+} watched_program_t;
+
+static volatile sig_atomic_t stop_watching = 0;
+
+static void stopWatchingHandler(int signal_num);
+
+static void compileWatched(compiler_t * compiler, watched_program_t * program, const driver_options_t * options);
+
+static void readWatchEvents(int inotify_fd, watched_program_t * programs, size_t programs_num);
+
+static double getTimeMs();
+
+int watchPrograms(compiler_t * compiler, const char * const * program_files, const char * const * out_bases,
+                  size_t programs_num, const driver_options_t * options)
+{
+    assert(compiler);
+    assert(program_files);
+    assert(out_bases);
+    assert(options);
+
+    struct sigaction stop_action = {};
+    stop_action.sa_handler = stopWatchingHandler;
+    sigemptyset(&stop_action.sa_mask);
+    sigaction(SIGINT,  &stop_action, NULL);
+    sigaction(SIGTERM, &stop_action, NULL);
+
+    int inotify_fd = inotify_init1(IN_CLOEXEC);
+    if (inotify_fd < 0){
+        perror("inotify_init1");
+        return 1;
+    }
+
+    watched_program_t * programs = (watched_program_t *)calloc(programs_num, sizeof(watched_program_t));
+
+    for (size_t program_index = 0; program_index < programs_num; program_index++){
+        watched_program_t * program = programs + program_index;
+
+        program->file_name = program_files[program_index];
+        program->out_base  = out_bases[program_index];
+
+        // editors often write a new file and rename it over the old one, so the directory is watched
+        char * dir_copy  = strdup(program->file_name);
+        char * base_copy = strdup(program->file_name);
+
+        program->dir_name  = strdup(dirname(dir_copy));
+        program->base_name = strdup(basename(base_copy));
+
+        free(dir_copy);
+        free(base_copy);
+
+        program->watch_fd = inotify_add_watch(inotify_fd, program->dir_name, IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (program->watch_fd < 0)
+            fprintf(stderr, "DRIVER: ERROR: cannot watch '%s': %s\n", program->dir_name, strerror(errno));
+
+        program->inc = incrementalCtor();
+
+        compileWatched(compiler, program, options);
+    }
+
+    while (! stop_watching){
+        struct pollfd poll_fd = {.fd = inotify_fd, .events = POLLIN, .revents = 0};
+
+        if (poll(&poll_fd, 1, WATCH_POLL_TIMEOUT_MS) <= 0)
+            continue;
+
+        readWatchEvents(inotify_fd, programs, programs_num);
+
+        for (size_t program_index = 0; program_index < programs_num; program_index++){
+            if (! programs[program_index].changed)
+                continue;
+
+            programs[program_index].changed = false;
+            compileWatched(compiler, programs + program_index, options);
+        }
+    }
+
+    close(inotify_fd);
+
+    for (size_t program_index = 0; program_index < programs_num; program_index++){
+        incrementalDtor(&programs[program_index].inc);
+
+        free(programs[program_index].dir_name);
+        free(programs[program_index].base_name);
+    }
+
+    free(programs);
+
+    compiler->incremental = NULL;
+
+    return 0;
+}
+
+static void stopWatchingHandler(int /*signal_num*/)
+{
+    stop_watching = 1;
+}
+
+static void compileWatched(compiler_t * compiler, watched_program_t * program, const driver_options_t * options)
+{
+    assert(compiler);
+    assert(program);
+    assert(options);
+
+    compiler->incremental = &program->inc;
+
+    double start_time = getTimeMs();
+
+    int status = compileProgramFile(compiler, program->file_name, program->out_base, options);
+
+    double compile_time = getTimeMs() - start_time;
+
+    logPrint(LOG_RELEASE, "watch: '%s' is compiled in %.2lf ms, %zu of %zu functions are reused\n",
+             program->file_name, compile_time, program->inc.reused_num, program->inc.funcs_num);
+
+    if (status == 0)
+        printf("DRIVER: '%s' is compiled in %.2lf ms, %zu of %zu functions are reused\n",
+               program->file_name, compile_time, program->inc.reused_num, program->inc.funcs_num);
+
+    fflush(stdout);
+}
+
+static void readWatchEvents(int inotify_fd, watched_program_t * programs, size_t programs_num)
+{
+    assert(programs);
+
+    alignas(struct inotify_event) char buffer[WATCH_EVENTS_BUFFER_SIZE] = {};
+
+    ssize_t read_size = read(inotify_fd, buffer, WATCH_EVENTS_BUFFER_SIZE);
+
+    for (ssize_t offset = 0; offset < read_size; ){
+        const struct inotify_event * event = (const struct inotify_event *)(buffer + offset);
+
+        for (size_t program_index = 0; program_index < programs_num; program_index++){
+            watched_program_t * program = programs + program_index;
+
+            if (event->len > 0 && event->wd == program->watch_fd && strcmp(event->name, program->base_name) == 0)
+                program->changed = true;
+        }
+
+        offset += (ssize_t)(sizeof(struct inotify_event) + event->len);
+    }
+}
+
+static double getTimeMs()
+{
+    struct timespec time_spec = {};
+    clock_gettime(CLOCK_MONOTONIC, &time_spec);
+
+    return (double)time_spec.tv_sec * 1e3 + (double)time_spec.tv_nsec * 1e-6;
+}
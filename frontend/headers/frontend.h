@@ -1,29 +1,36 @@
 #ifndef FRONTEND_INCLUDED
 #define FRONTEND_INCLUDED
 
+#include <stdio.h>
 #include <stdbool.h>
 
-#include "hashtable.h"
 #include "tree.h"
 #include "IR_handler.h"
+#include "node_arena.h"
 
 const size_t MAX_CODE_LEN   = 1024;
-const size_t MAX_TOKEN_NUM  = 1024;
+const size_t MAX_TOKEN_NUM  = 1024;         //< initial capacity of the token buffer, it grows twice when full
 
 const char * const LOG_FOLDER_NAME = "frontend_logs";
 const char * const LOG_FILE_NAME   = "frontend_logs/log.html";
 
+const char * const GRAPHS_FLAG     = "--graphs";      //< first argument that enables graph dumps
+
 const char COMMENT_START = '#';
 const char COMMENT_END   = '#';
 
-// const size_t MAX_TOKEN_NUM = 1024;
-const size_t MAX_IDR_NUM = 64;
-const size_t NAME_MAX_LEN = 64;
+const size_t IDS_START_CAP = 64;           //< ids grow twice when full, there is no limit on their number
+
+const size_t ID_MAX_LEN = NAME_MAX_LENGTH;
 
-const size_t IDR_TABLE_SIZE = 128;
-const size_t OPR_TABLE_SIZE = 128;
+const size_t PARALLEL_PARSE_MIN_SIZE = 1024 * 1024;    //< smaller sources are parsed by one thread
+const size_t PARSE_PARTS_PER_WORKER  = 4;              //< parts differ in size, so there are more of them than workers
 
-const size_t ID_MAX_LEN = 64;
+/// @brief fields of an id that the parser has set, parts of parallel parsing are merged by them
+enum id_set_field {
+    ID_SET_TYPE = 1,
+    ID_SET_ARGS = 2
+};
 
 typedef enum {
     SUCCESS = 0,
@@ -31,29 +38,55 @@ typedef enum {
     HARD_ERROR
 } parser_status_t;
 
+/// @brief token of the lexer (16 bytes), the parser makes tree nodes of the ones that get to the tree
 typedef struct {
-    node_t * tokens;
+    enum elem_type type;
+    union value val;
+} token_t;
+
+typedef struct fe_context {
+    token_t * tokens;
     size_t tokens_size;
+    size_t tokens_capacity;
 
-    node_t * cur_node;
+    token_t * cur_token;
 
-    table_t oper_table;
-    table_t  idr_table;
+    node_arena_t nodes;             // nodes of the parsed tree
 
-    idr_t ids[MAX_IDR_NUM];
+    interner_t names;               // id of a name is the index of its id
+
+    idr_t * ids;
+    unsigned char * ids_set;        // id_set_field flags of the ids
     unsigned int id_size;
+    unsigned int ids_capacity;
 
     parser_status_t status;
+    size_t errors_num;              // syntax errors, also the ones the parser has got over
+
+    FILE * diag_file;               // lexical and syntax errors go here, stderr by default, NULL - not printed
+
+    size_t workers_num;             // threads of parallel parsing, 1 by default
+    struct fe_context * parts;      // contexts of the parts of the source, kept for the next programs
+    size_t parts_capacity;
 } fe_context_t;
 
-/// @brief initialise frontend context
+/// @brief initialise frontend context, token_num is the initial capacity of the token buffer
 fe_context_t frontendInit(size_t token_num);
 
 /// @brief destruct frontend context
 void frontendDtor(fe_context_t * frontend);
 
-/// @brief main function for frontend
-void frontendRun(const char * in_file_name, const char * out_file_name);
+/// @brief forgets the names, tokens and nodes of the previous program
+void frontendReset(fe_context_t * frontend);
+
+/// @brief main function for frontend, long sources are parsed on threads_num threads
+void frontendRun(const char * in_file_name, const char * out_file_name, size_t threads_num);
+
+/// @brief translates the code to the tree, returns NULL on errors (nodes and names live in the frontend context),
+///        code must end with '\0';
+///        sources longer than PARALLEL_PARSE_MIN_SIZE are split at top-level functions and parsed on workers_num threads,
+///        the tree and ids are the same as of one thread
+node_t * frontendParse(fe_context_t * frontend, const char * code);
 
 /// @brief dump frontend info
 void frontendDump(fe_context_t * frontend);
@@ -61,6 +94,18 @@ void frontendDump(fe_context_t * frontend);
 /// @brief do lexical analysis of the source code, returns 0 if succeeded
 int lexicalAnalysis(fe_context_t * frontend, const char * code);
 
+/// @brief lexical analysis of the part of the code, code_end must be the start of a token or the end of the code
+int lexicalAnalysisPart(fe_context_t * frontend, const char * code, const char * code_end);
+
+/// @brief finds the top-level function declarations (the code is scanned as the lexer does, names are not kept)
+///        and splits the code at them to at most max_parts parts of at least part_size bytes
+/// @return number of parts, part_starts[i] is the start of the i-th one, it ends where the next one starts;
+///         0 if the code has a lexical error
+size_t lexicalSplit(const char * code, size_t part_size, const char ** part_starts, size_t max_parts);
+
+/// @brief returns id of the name, adds it as VAR if it is new
+unsigned int getIdentifier(fe_context_t * frontend, const char * name, size_t name_len);
+
 /// @brief start syntax analysis
 node_t * parseCode(fe_context_t * frontend);
 
@@ -0,0 +1,29 @@
+#ifndef LEXER_SCAN_INCLUDED
+#define LEXER_SCAN_INCLUDED
+
+#include <stdbool.h>
+
+/// @brief instruction sets of the scanning functions of the lexer
+typedef enum {
+    SCAN_SCALAR,
+    SCAN_SSE2,
+    SCAN_AVX2
+} scan_isa_t;
+
+/// @brief skips whitespace and comments, stops at the first char of a token or at '\0'
+const char * scanSkipSpaces(const char * str);
+
+/// @brief returns the end of the identifier that starts at str (letters, digits and '_')
+const char * scanSkipWord(const char * str);
+
+/// @brief returns instruction set used by the scanning functions, the widest the CPU supports by default
+scan_isa_t scanGetIsa();
+
+/// @brief makes the scanning functions use the instruction set (for benchmarks)
+/// @return false if the CPU does not support it
+bool scanSetIsa(scan_isa_t isa);
+
+/// @brief name of the instruction set for reports
+const char * scanIsaName(scan_isa_t isa);
+
+#endif
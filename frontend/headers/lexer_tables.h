@@ -0,0 +1,120 @@
+#ifndef LEXER_TABLES_INCLUDED
+#define LEXER_TABLES_INCLUDED
+
+#include <stdlib.h>
+
+#include "tree.h"
+
+// tables of the lexer are built from opers[] by the compiler, a new operator needs no changes here
+
+const size_t KEYWORD_HASH_SIZE    = 32;
+const size_t KEYWORD_MAX_MUL      = 64;     //< bound of the search of the hash parameters
+
+/// @brief perfect hash of the keywords: (first + last_mul * last + len_mul * length) % KEYWORD_HASH_SIZE
+typedef struct {
+    size_t last_mul;
+    size_t len_mul;
+
+    signed char   opers[KEYWORD_HASH_SIZE];     //< operator of the keyword in the slot, -1 if the slot is empty
+    unsigned char lengths[KEYWORD_HASH_SIZE];
+
+    bool found;
+} keyword_hash_t;
+
+/// @brief DFA of the operators made of symbols, a state is the first char, the second one can extend it
+typedef struct {
+    signed char single[256];        //< operator of the one-char spelling, -1 if there is none
+    char        second[256];        //< char that extends the first one to a two-char operator, 0 if there is none
+    signed char pair[256];          //< that two-char operator
+
+    bool valid;
+} symbol_dfa_t;
+
+constexpr bool isWordStart(char symbol)
+{
+    return (symbol >= 'a' && symbol <= 'z') || (symbol >= 'A' && symbol <= 'Z') || symbol == '_';
+}
+
+constexpr size_t constStrlen(const char * str)
+{
+    size_t len = 0;
+    while (str[len] != '\0')
+        len++;
+
+    return len;
+}
+
+constexpr size_t keywordHash(unsigned char first, unsigned char last, size_t len, size_t last_mul, size_t len_mul)
+{
+    return (first + last_mul * last + len_mul * len) % KEYWORD_HASH_SIZE;
+}
+
+constexpr keyword_hash_t makeKeywordHash()
+{
+    for (size_t last_mul = 1; last_mul < KEYWORD_MAX_MUL; last_mul++){
+        for (size_t len_mul = 0; len_mul < KEYWORD_MAX_MUL; len_mul++){
+            keyword_hash_t hash = {last_mul, len_mul, {}, {}, true};
+
+            for (size_t slot = 0; slot < KEYWORD_HASH_SIZE; slot++)
+                hash.opers[slot] = -1;
+
+            for (size_t oper_index = 0; oper_index < opers_size && hash.found; oper_index++){
+                const char * name = opers[oper_index].name;
+                if (name == NULL || !isWordStart(name[0]))
+                    continue;
+
+                size_t len = constStrlen(name);
+                size_t slot = keywordHash((unsigned char)name[0], (unsigned char)name[len - 1], len, last_mul, len_mul);
+
+                if (hash.opers[slot] != -1)
+                    hash.found = false;
+
+                hash.opers[slot]   = (signed char)opers[oper_index].num;
+                hash.lengths[slot] = (unsigned char)len;
+            }
+
+            if (hash.found)
+                return hash;
+        }
+    }
+
+    return {0, 0, {}, {}, false};
+}
+
+constexpr symbol_dfa_t makeSymbolDFA()
+{
+    symbol_dfa_t dfa = {{}, {}, {}, true};
+
+    for (size_t symbol = 0; symbol < 256; symbol++){
+        dfa.single[symbol] = -1;
+        dfa.pair[symbol]   = -1;
+    }
+
+    for (size_t oper_index = 0; oper_index < opers_size; oper_index++){
+        const char * name = opers[oper_index].name;
+        if (name == NULL || isWordStart(name[0]))
+            continue;
+
+        size_t len = constStrlen(name);
+        unsigned char first = (unsigned char)name[0];
+
+        if (len == 1 && dfa.single[first] == -1)
+            dfa.single[first] = (signed char)opers[oper_index].num;
+        else if (len == 2 && dfa.second[first] == 0){
+            dfa.second[first] = name[1];
+            dfa.pair[first]   = (signed char)opers[oper_index].num;
+        }
+        else
+            dfa.valid = false;
+    }
+
+    return dfa;
+}
+
+constexpr keyword_hash_t KEYWORD_HASH = makeKeywordHash();
+constexpr symbol_dfa_t   SYMBOL_DFA   = makeSymbolDFA();
+
+static_assert(KEYWORD_HASH.found, "no perfect hash of the keywords, increase KEYWORD_HASH_SIZE");
+static_assert(SYMBOL_DFA.valid, "symbol operators must be one or two chars long, two-char ones must differ in the first char");
+
+#endif
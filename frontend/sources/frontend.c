@@ -9,23 +9,41 @@
 #include "frontend.h"
 #include "logger.h"
 #include "IR_handler.h"
+#include "thread_pool.h"
+
+typedef struct {
+    fe_context_t * parts;
+    const char ** part_starts;      // part i ends where part i + 1 starts
+
+    node_t ** roots;                // SEP chains of the parts
+    node_t ** last_seps;
+
+    unsigned int ** part_ids;       // ids of the frontend by the ids of the parts
+} parallel_parse_t;
+
+static node_t * frontendParseParallel(fe_context_t * frontend, const char * code, size_t code_len);
+
+static void parsePartTask(void * shared, size_t task_index, size_t worker_index);
+
+static void mergePartIds(fe_context_t * frontend, const fe_context_t * part, unsigned int * part_ids);
+
+static void remapPartIdsTask(void * shared, size_t task_index, size_t worker_index);
 
 fe_context_t frontendInit(size_t token_num)
 {
     fe_context_t frontend = {};
 
-    frontend.tokens = (node_t *)calloc(token_num, sizeof(node_t));
-    frontend.cur_node = frontend.tokens;
+    frontend.tokens = (token_t *)calloc(token_num, sizeof(token_t));
+    frontend.tokens_capacity = token_num;
+    frontend.cur_token = frontend.tokens;
 
+    frontend.nodes = nodeArenaCtor();
 
-    frontend.oper_table = tableCtor(OPR_TABLE_SIZE);
-    for (size_t oper_index = 0; oper_index < opers_size; oper_index++){
-        // name can be NULL when we actually do not want this operator in program text
-        if (opers[oper_index].name != NULL)
-            tableInsert(&(frontend.oper_table), opers[oper_index].name, &(opers[oper_index].num), sizeof(opers[oper_index].num));
-    }
+    frontend.diag_file = stderr;
+
+    frontend.names = internerCtor();
 
-    frontend.idr_table  = tableCtor(IDR_TABLE_SIZE);
+    frontend.workers_num = 1;
 
     return frontend;
 }
@@ -34,62 +52,257 @@ void frontendDtor(fe_context_t * frontend)
 {
     assert(frontend);
 
-    tableDtor(&(frontend->oper_table));
-    tableDtor(&(frontend->idr_table));
+    internerDtor(&(frontend->names));
+
+    free(frontend->ids);
+    frontend->ids = NULL;
+
+    free(frontend->ids_set);
+    frontend->ids_set = NULL;
 
     free(frontend->tokens);
     frontend->tokens = NULL;
+
+    nodeArenaDtor(&(frontend->nodes));
+
+    for (size_t part_index = 0; part_index < frontend->parts_capacity; part_index++)
+        frontendDtor(frontend->parts + part_index);
+
+    free(frontend->parts);
+    frontend->parts = NULL;
+    frontend->parts_capacity = 0;
 }
 
-void frontendRun(const char * in_file_name, const char * out_file_name)
+void frontendReset(fe_context_t * frontend)
+{
+    assert(frontend);
+
+    frontend->tokens_size = 0;
+    frontend->cur_token = frontend->tokens;
+
+    nodeArenaReset(&(frontend->nodes));
+
+    frontend->id_size = 0;
+    internerReset(&(frontend->names));
+
+    frontend->status = SUCCESS;
+    frontend->errors_num = 0;
+
+    for (size_t part_index = 0; part_index < frontend->parts_capacity; part_index++)
+        frontendReset(frontend->parts + part_index);
+}
+
+void frontendRun(const char * in_file_name, const char * out_file_name, size_t threads_num)
 {
     assert(in_file_name);
     assert(out_file_name);
 
     fe_context_t fe = frontendInit(MAX_TOKEN_NUM);
+    fe.workers_num = threads_num;
 
-    char * str = readProgramText(in_file_name);
-
-    if (lexicalAnalysis(&fe, str) != 0){
+    program_text_t program = {};
+    if (!programTextOpen(&program, in_file_name)){
+        fprintf(stderr, "FRONTEND: ERROR: cannot read '%s'\n", in_file_name);
         frontendDtor(&fe);
-        free(str);
 
         return;
     }
 
-    frontendDump(&fe);
+    node_t * tree = frontendParse(&fe, program.text);
 
-    tree_context_t tr = {};         // TODO: GET RID OF THAT
-    tr.cur_node = fe.cur_node;
-    tr.ids = fe.ids;
-    tr.id_size = fe.id_size;
+    frontendDump(&fe);
 
-    node_t * tree = parseCode(&fe);
     if (tree == NULL){
         frontendDtor(&fe);
-        free(str);
+        programTextClose(&program);
 
         return;
     }
 
+    tree_context_t tr = {};         // TODO: GET RID OF THAT
+    tr.ids = fe.ids;
+    tr.id_size = fe.id_size;
+
     treeDumpGraph(&tr, tree, LOG_FOLDER_NAME);
 
     printTreePrefix(&tr, tree);
     printf("\n");
 
-    FILE * out = fopen(out_file_name, "w");
-
-    writeTreeToFile(&tr, tree, out);
-    fclose(out);
+    writeTreeToFile(&tr, tree, out_file_name);
 
     frontendDtor(&fe);
-    free(str);
+    programTextClose(&program);
+}
+
+node_t * frontendParse(fe_context_t * frontend, const char * code)
+{
+    assert(frontend);
+    assert(code);
+
+    if (frontend->workers_num > 1){
+        size_t code_len = strlen(code);
+
+        if (code_len >= PARALLEL_PARSE_MIN_SIZE){
+            node_t * root = frontendParseParallel(frontend, code, code_len);
+            if (root != NULL)
+                return root;
+        }
+    }
+
+    if (lexicalAnalysis(frontend, code) != 0)
+        return NULL;
+
+    return parseCode(frontend);
+}
+
+// parts are lexed and parsed by their own contexts, then their ids are added to the frontend in the order of the parts,
+// so the ids get the same numbers as with one thread; errors are left to the parsing by one thread,
+// it reports them as usual, so the parts print nothing
+static node_t * frontendParseParallel(fe_context_t * frontend, const char * code, size_t code_len)
+{
+    assert(frontend);
+    assert(code);
+
+    size_t max_parts = frontend->workers_num * PARSE_PARTS_PER_WORKER;
+
+    const char ** part_starts = (const char **)calloc(max_parts + 1, sizeof(*part_starts));
+
+    size_t parts_num = lexicalSplit(code, code_len / max_parts, part_starts, max_parts);
+    if (parts_num <= 1){
+        free(part_starts);
+        return NULL;
+    }
+
+    part_starts[parts_num] = code + code_len;
+
+    if (frontend->parts_capacity < parts_num){
+        frontend->parts = (fe_context_t *)realloc(frontend->parts, parts_num * sizeof(*frontend->parts));
+
+        for (size_t part_index = frontend->parts_capacity; part_index < parts_num; part_index++)
+            frontend->parts[part_index] = frontendInit(MAX_TOKEN_NUM);
+
+        frontend->parts_capacity = parts_num;
+    }
+
+    parallel_parse_t parse = {
+        .parts       = frontend->parts,
+        .part_starts = part_starts,
+        .roots       = (node_t **)calloc(parts_num, sizeof(node_t *)),
+        .last_seps   = (node_t **)calloc(parts_num, sizeof(node_t *)),
+        .part_ids    = (unsigned int **)calloc(parts_num, sizeof(unsigned int *))
+    };
+
+    logPrint(LOG_DEBUG, "parsing %zu parts of the code on %zu workers\n", parts_num, frontend->workers_num);
+
+    parallelFor(parts_num, frontend->workers_num, parsePartTask, &parse);
+
+    node_t * root = NULL;
+
+    bool parsed = true;
+    for (size_t part_index = 0; part_index < parts_num; part_index++)
+        parsed = parsed && (parse.roots[part_index] != NULL);
+
+    if (parsed){
+        for (size_t part_index = 0; part_index < parts_num; part_index++){
+            parse.part_ids[part_index] = (unsigned int *)calloc(frontend->parts[part_index].id_size, sizeof(unsigned int));
+
+            mergePartIds(frontend, frontend->parts + part_index, parse.part_ids[part_index]);
+        }
+
+        parallelFor(parts_num, frontend->workers_num, remapPartIdsTask, &parse);
+
+        for (size_t part_index = 0; part_index + 1 < parts_num; part_index++)
+            parse.last_seps[part_index]->right = parse.roots[part_index + 1];
+
+        root = parse.roots[0];
+    }
+
+    for (size_t part_index = 0; part_index < parts_num; part_index++)
+        free(parse.part_ids[part_index]);
+
+    free(parse.part_ids);
+    free(parse.last_seps);
+    free(parse.roots);
+    free(part_starts);
+
+    return root;
+}
+
+static void parsePartTask(void * shared, size_t task_index, size_t /*worker_index*/)
+{
+    parallel_parse_t * parse = (parallel_parse_t *)shared;
+    fe_context_t * part = parse->parts + task_index;
+
+    frontendReset(part);
+    part->diag_file = NULL;
+
+    if (lexicalAnalysisPart(part, parse->part_starts[task_index], parse->part_starts[task_index + 1]) != 0)
+        return;
+
+    node_t * root = parseCode(part);
+
+    // the part is parsed as in the whole code only if no statement has stumbled on its END,
+    // so the last one has not started at all; the parser gets over some errors, but they have to be reported
+    if (root == NULL || part->status != SOFT_ERROR || part->errors_num != 0)
+        return;
+
+    node_t * last_sep = root;
+    while (last_sep->right != NULL)
+        last_sep = last_sep->right;
+
+    parse->roots[task_index] = root;
+    parse->last_seps[task_index] = last_sep;
+}
+
+// the parser of one thread would set the fields of the ids in the order of the parts, so the last set one wins
+static void mergePartIds(fe_context_t * frontend, const fe_context_t * part, unsigned int * part_ids)
+{
+    assert(frontend);
+    assert(part);
+    assert(part_ids);
+
+    for (unsigned int part_id = 0; part_id < part->id_size; part_id++){
+        unsigned int id = getIdentifier(frontend, internerName(&part->names, part_id), internerLength(&part->names, part_id));
+        part_ids[part_id] = id;
+
+        unsigned char set = part->ids_set[part_id];
+
+        if (set & ID_SET_TYPE)
+            frontend->ids[id].type = part->ids[part_id].type;
+
+        if (set & ID_SET_ARGS)
+            frontend->ids[id].num_of_args = part->ids[part_id].num_of_args;
+
+        frontend->ids_set[id] |= set;
+    }
+}
+
+// all nodes of the part belong to its tree, so they are renumbered right in its arena
+static void remapPartIdsTask(void * shared, size_t task_index, size_t /*worker_index*/)
+{
+    parallel_parse_t * parse = (parallel_parse_t *)shared;
+
+    const node_arena_t * nodes = &(parse->parts[task_index].nodes);
+    const unsigned int * part_ids = parse->part_ids[task_index];
+
+    for (size_t chunk_index = 0; chunk_index < nodes->chunks_num; chunk_index++){
+        size_t chunk_size = (chunk_index + 1 == nodes->chunks_num) ? nodes->last_chunk_size : NODE_ARENA_CHUNK_SIZE;
+        node_t * chunk = nodes->chunks[chunk_index];
+
+        for (size_t node_index = 0; node_index < chunk_size; node_index++){
+            if (chunk[node_index].type == IDR)
+                chunk[node_index].val.id = part_ids[chunk[node_index].val.id];
+        }
+    }
 }
 
 void frontendDump(fe_context_t * frontend)
 {
     assert(frontend);
 
+    if (!logIsEnabled(LOG_DEBUG))
+        return;
+
     logPrint(LOG_DEBUG, "------------frontend context dump-----------\n");
 
     logPrint(LOG_DEBUG, "\ttokens size: %zu\n", frontend->tokens_size);
@@ -97,7 +310,7 @@ void frontendDump(fe_context_t * frontend)
 
     for (size_t token_index = 0; token_index < frontend->tokens_size; token_index++){
         logPrint(LOG_DEBUG, "\t\ttoken #%zu:\n", token_index);
-        node_t cur_token = frontend->tokens[token_index];
+        token_t cur_token = frontend->tokens[token_index];
 
         if (cur_token.type == NUM){
             logPrint(LOG_DEBUG, "\t\t\ttype = NUM\n\t\t\tvalue = %lg\n", cur_token.val.number);
@@ -113,7 +326,7 @@ void frontendDump(fe_context_t * frontend)
         }
     }
 
-    logPrint(LOG_DEBUG, "\tids size: %zu\n", frontend->id_size);
+    logPrint(LOG_DEBUG, "\tids size: %u\n", frontend->id_size);
     logPrint(LOG_DEBUG, "\tids:\n");
 
     for (size_t id_index = 0; id_index < frontend->id_size; id_index++){
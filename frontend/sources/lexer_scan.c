@@ -0,0 +1,293 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCAN_X86
+#endif
+
+#include "frontend.h"
+#include "lexer_scan.h"
+
+// vector versions load whole aligned blocks: such a load never crosses a page, and the text ends with '\0'
+// that stops every scan, so the bytes after the end are read but never used (ASan would report them)
+#define SCAN_VECTOR_FUNC __attribute__((no_sanitize_address))
+
+typedef const char * (* scan_func_t)(const char * str);
+
+typedef struct {
+    scan_isa_t isa;
+
+    scan_func_t space_run_end;      //< first char that is not whitespace
+    scan_func_t comment_end;        //< first COMMENT_END or '\0'
+    scan_func_t word_end;           //< first char that is not a letter, a digit or '_'
+} scan_funcs_t;
+
+static scan_funcs_t scanFuncsFor(scan_isa_t isa);
+
+static scan_isa_t getBestIsa();
+
+static scan_funcs_t scan_funcs = scanFuncsFor(getBestIsa());
+
+const char * scanSkipSpaces(const char * str)
+{
+    assert(str);
+
+    while (1){
+        str = scan_funcs.space_run_end(str);
+
+        if (*str != COMMENT_START)
+            return str;
+
+        str = scan_funcs.comment_end(str + 1);
+
+        // unterminated comment lasts till the end of the text
+        if (*str == COMMENT_END)
+            str++;
+    }
+}
+
+const char * scanSkipWord(const char * str)
+{
+    assert(str);
+
+    return scan_funcs.word_end(str);
+}
+
+scan_isa_t scanGetIsa()
+{
+    return scan_funcs.isa;
+}
+
+bool scanSetIsa(scan_isa_t isa)
+{
+    if (isa > getBestIsa())
+        return false;
+
+    scan_funcs = scanFuncsFor(isa);
+
+    return true;
+}
+
+const char * scanIsaName(scan_isa_t isa)
+{
+    switch (isa){
+        case SCAN_SCALAR: return "scalar";
+        case SCAN_SSE2:   return "sse2";
+        case SCAN_AVX2:   return "avx2";
+        default:          return "unknown";
+    }
+}
+
+//--------------------------------------------------scalar----------------------------------------------------
+
+static bool isScanSpace(char symbol)
+{
+    return symbol == ' ' || (unsigned char)(symbol - '\t') <= '\r' - '\t';
+}
+
+static bool isScanWordChar(char symbol)
+{
+    return (unsigned char)((symbol | 0x20) - 'a') <= 'z' - 'a' || (unsigned char)(symbol - '0') <= 9 || symbol == '_';
+}
+
+static const char * spaceRunEndScalar(const char * str)
+{
+    while (isScanSpace(*str))
+        str++;
+
+    return str;
+}
+
+static const char * commentEndScalar(const char * str)
+{
+    while (*str != COMMENT_END && *str != '\0')
+        str++;
+
+    return str;
+}
+
+static const char * wordEndScalar(const char * str)
+{
+    while (isScanWordChar(*str))
+        str++;
+
+    return str;
+}
+
+#ifdef SCAN_X86
+
+//---------------------------------------------------sse2-----------------------------------------------------
+
+const size_t SSE2_BLOCK = 16;
+
+// masks have bits of the bytes that stop the scan
+
+static inline unsigned spaceStopsSSE2(__m128i block)
+{
+    // '\t'..'\r' become 0..4 after the subtraction, other chars wrap above 4
+    __m128i shifted  = _mm_sub_epi8(block, _mm_set1_epi8('\t'));
+    __m128i is_ctrl  = _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8('\r' - '\t')), shifted);
+    __m128i is_space = _mm_or_si128(is_ctrl, _mm_cmpeq_epi8(block, _mm_set1_epi8(' ')));
+
+    return ~(unsigned)_mm_movemask_epi8(is_space) & 0xFFFFu;
+}
+
+static inline unsigned commentStopsSSE2(__m128i block)
+{
+    __m128i is_end = _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(COMMENT_END)), _mm_cmpeq_epi8(block, _mm_setzero_si128()));
+
+    return (unsigned)_mm_movemask_epi8(is_end);
+}
+
+static inline unsigned wordStopsSSE2(__m128i block)
+{
+    __m128i letter = _mm_sub_epi8(_mm_or_si128(block, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    __m128i digit  = _mm_sub_epi8(block, _mm_set1_epi8('0'));
+
+    __m128i is_letter = _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8('z' - 'a')), letter);
+    __m128i is_digit  = _mm_cmpeq_epi8(_mm_min_epu8(digit,  _mm_set1_epi8(9)), digit);
+    __m128i is_under  = _mm_cmpeq_epi8(block, _mm_set1_epi8('_'));
+
+    __m128i is_word = _mm_or_si128(_mm_or_si128(is_letter, is_digit), is_under);
+
+    return ~(unsigned)_mm_movemask_epi8(is_word) & 0xFFFFu;
+}
+
+#define SCAN_SSE2_LOOP(stops_func)                                                  \
+    do {                                                                            \
+        size_t misalign = (uintptr_t)str % SSE2_BLOCK;                              \
+        const char * block = str - misalign;                                        \
+                                                                                    \
+        unsigned stops = stops_func(_mm_load_si128((const __m128i *)block));        \
+        stops &= ~0u << misalign;                                                   \
+                                                                                    \
+        while (stops == 0){                                                         \
+            block += SSE2_BLOCK;                                                    \
+            stops = stops_func(_mm_load_si128((const __m128i *)block));             \
+        }                                                                           \
+                                                                                    \
+        return block + __builtin_ctz(stops);                                        \
+    } while (0)
+
+SCAN_VECTOR_FUNC static const char * spaceRunEndSSE2(const char * str)
+{
+    SCAN_SSE2_LOOP(spaceStopsSSE2);
+}
+
+SCAN_VECTOR_FUNC static const char * commentEndSSE2(const char * str)
+{
+    SCAN_SSE2_LOOP(commentStopsSSE2);
+}
+
+SCAN_VECTOR_FUNC static const char * wordEndSSE2(const char * str)
+{
+    SCAN_SSE2_LOOP(wordStopsSSE2);
+}
+
+#undef SCAN_SSE2_LOOP
+
+//---------------------------------------------------avx2-----------------------------------------------------
+
+const size_t AVX2_BLOCK = 32;
+
+#define SCAN_AVX2_FUNC __attribute__((target("avx2"))) SCAN_VECTOR_FUNC
+
+SCAN_AVX2_FUNC static inline unsigned spaceStopsAVX2(__m256i block)
+{
+    __m256i shifted  = _mm256_sub_epi8(block, _mm256_set1_epi8('\t'));
+    __m256i is_ctrl  = _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8('\r' - '\t')), shifted);
+    __m256i is_space = _mm256_or_si256(is_ctrl, _mm256_cmpeq_epi8(block, _mm256_set1_epi8(' ')));
+
+    return ~(unsigned)_mm256_movemask_epi8(is_space);
+}
+
+SCAN_AVX2_FUNC static inline unsigned commentStopsAVX2(__m256i block)
+{
+    __m256i is_end = _mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8(COMMENT_END)),
+                                     _mm256_cmpeq_epi8(block, _mm256_setzero_si256()));
+
+    return (unsigned)_mm256_movemask_epi8(is_end);
+}
+
+SCAN_AVX2_FUNC static inline unsigned wordStopsAVX2(__m256i block)
+{
+    __m256i letter = _mm256_sub_epi8(_mm256_or_si256(block, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+    __m256i digit  = _mm256_sub_epi8(block, _mm256_set1_epi8('0'));
+
+    __m256i is_letter = _mm256_cmpeq_epi8(_mm256_min_epu8(letter, _mm256_set1_epi8('z' - 'a')), letter);
+    __m256i is_digit  = _mm256_cmpeq_epi8(_mm256_min_epu8(digit,  _mm256_set1_epi8(9)), digit);
+    __m256i is_under  = _mm256_cmpeq_epi8(block, _mm256_set1_epi8('_'));
+
+    __m256i is_word = _mm256_or_si256(_mm256_or_si256(is_letter, is_digit), is_under);
+
+    return ~(unsigned)_mm256_movemask_epi8(is_word);
+}
+
+#define SCAN_AVX2_LOOP(stops_func)                                                  \
+    do {                                                                            \
+        size_t misalign = (uintptr_t)str % AVX2_BLOCK;                              \
+        const char * block = str - misalign;                                        \
+                                                                                    \
+        unsigned stops = stops_func(_mm256_load_si256((const __m256i *)block));     \
+        stops &= ~0u << misalign;                                                   \
+                                                                                    \
+        while (stops == 0){                                                         \
+            block += AVX2_BLOCK;                                                    \
+            stops = stops_func(_mm256_load_si256((const __m256i *)block));          \
+        }                                                                           \
+                                                                                    \
+        return block + __builtin_ctz(stops);                                        \
+    } while (0)
+
+SCAN_AVX2_FUNC static const char * spaceRunEndAVX2(const char * str)
+{
+    SCAN_AVX2_LOOP(spaceStopsAVX2);
+}
+
+SCAN_AVX2_FUNC static const char * commentEndAVX2(const char * str)
+{
+    SCAN_AVX2_LOOP(commentStopsAVX2);
+}
+
+SCAN_AVX2_FUNC static const char * wordEndAVX2(const char * str)
+{
+    SCAN_AVX2_LOOP(wordStopsAVX2);
+}
+
+#undef SCAN_AVX2_LOOP
+#undef SCAN_AVX2_FUNC
+
+#endif
+
+//-------------------------------------------------dispatch---------------------------------------------------
+
+static scan_funcs_t scanFuncsFor(scan_isa_t isa)
+{
+#ifdef SCAN_X86
+    if (isa == SCAN_AVX2)
+        return {SCAN_AVX2, spaceRunEndAVX2, commentEndAVX2, wordEndAVX2};
+
+    if (isa == SCAN_SSE2)
+        return {SCAN_SSE2, spaceRunEndSSE2, commentEndSSE2, wordEndSSE2};
+#endif
+
+    return {SCAN_SCALAR, spaceRunEndScalar, commentEndScalar, wordEndScalar};
+}
+
+// runs before main, so cpu info has to be initialised by hand
+static scan_isa_t getBestIsa()
+{
+#ifdef SCAN_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+        return SCAN_AVX2;
+
+    if (__builtin_cpu_supports("sse2"))
+        return SCAN_SSE2;
+#endif
+
+    return SCAN_SCALAR;
+}
@@ -6,28 +6,38 @@
 
 #include "logger.h"
 #include "frontend.h"
+#include "lexer_tables.h"
+#include "lexer_scan.h"
 
-enum id_stat {
-    IS_IDR,
-    IS_OPR,
-    IS_IDR_OR_OPR
-};
+static int getKeyword(const char * word, size_t word_len);
 
-static enum id_stat getIdName(const char ** src_str, char * buffer);
+static size_t getSymbolOper(const char * str, enum oper * op_num);
 
-static void skipSpaces(const char ** code);
+static token_t * newToken(fe_context_t * frontend);
 
 int lexicalAnalysis(fe_context_t * frontend, const char * code)
 {
     assert(frontend);
     assert(code);
 
-    size_t token_index = 0;
+    return lexicalAnalysisPart(frontend, code, code + strlen(code));
+}
+
+// tokens never cross code_end, so the scanners stop before it or at the '\0' of the code
+int lexicalAnalysisPart(fe_context_t * frontend, const char * code, const char * code_end)
+{
+    assert(frontend);
+    assert(code);
+    assert(code_end);
+
+    frontend->tokens_size = 0;
     const char * cur_ch = code;
 
-    skipSpaces(&cur_ch);
+    cur_ch = scanSkipSpaces(cur_ch);
+
+    while (cur_ch < code_end){
+        token_t * token = newToken(frontend);
 
-    while (*cur_ch != '\0'){
         if (isdigit(*cur_ch)){
 
             char * end = NULL;
@@ -35,119 +45,217 @@ int lexicalAnalysis(fe_context_t * frontend, const char * code)
 
             cur_ch = end;
 
-            frontend->tokens[token_index].type = NUM;
-            frontend->tokens[token_index].val.number = number;
+            token->type = NUM;
+            token->val.number = number;
 
             logPrint(LOG_DEBUG_PLUS, "LEXIC: scanned number: %lg\n", number);
         }
 
-        else if (*cur_ch == '(' || *cur_ch == ')'){
-            enum oper op_num = (*cur_ch == '(') ? LBRACKET : RBRACKET;
-            cur_ch++;
+        else if (isWordStart(*cur_ch)){
+            const char * word = cur_ch;
 
-            frontend->tokens[token_index].type = OPR;
-            frontend->tokens[token_index].val.op = op_num;
-        }
+            cur_ch = scanSkipWord(word);
+            size_t word_len = (size_t)(cur_ch - word);
 
-        else {
-            char buffer[ID_MAX_LEN] = {};
+            if (word_len >= ID_MAX_LEN){
+                logPrint(LOG_RELEASE, "LEXIC ERROR: name '%.*s...' is longer than %zu\n", (int)(ID_MAX_LEN - 1), word, ID_MAX_LEN - 1);
+                if (frontend->diag_file != NULL)
+                    fprintf(frontend->diag_file, "LEXIC ERROR: name '%.*s...' is longer than %zu\n", (int)(ID_MAX_LEN - 1), word, ID_MAX_LEN - 1);
 
-            enum id_stat id_status = getIdName(&cur_ch, buffer);
+                return 1;
+            }
 
-            logPrint(LOG_DEBUG_PLUS, "LEXIC: scanned identificator: %s\n", buffer);
+            logPrint(LOG_DEBUG_PLUS, "LEXIC: scanned identificator: %.*s\n", (int)word_len, word);
 
-            name_t * identifier = NULL;
+            int keyword = getKeyword(word, word_len);
 
-            // can be operator
-            if ((id_status == IS_IDR_OR_OPR || id_status == IS_OPR) && (identifier = tableLookup(&(frontend->oper_table), buffer)) != NULL){
+            if (keyword >= 0){
                 logPrint(LOG_DEBUG_PLUS, "\tis an operator\n");
 
-                enum oper op_num = *((enum oper *)(identifier->data));
-
-                frontend->tokens[token_index].type = OPR;
-                frontend->tokens[token_index].val.op = op_num;
+                token->type = OPR;
+                token->val.op = (enum oper)keyword;
             }
 
             // so it is an id
-            else if (id_status == IS_IDR || id_status == IS_IDR_OR_OPR){
+            else {
                 logPrint(LOG_DEBUG_PLUS, "\tis a identifier\n");
 
-                unsigned int id_index = 0;
+                token->type = IDR;
+                token->val.id = getIdentifier(frontend, word, word_len);
+            }
+        }
+
+        else {
+            enum oper op_num = NO_OP;
+            size_t oper_len = getSymbolOper(cur_ch, &op_num);
+
+            if (oper_len == 0){
+                logPrint(LOG_RELEASE, "LEXIC ERROR: unknown opeator '%c'\n", *cur_ch);
+                if (frontend->diag_file != NULL)
+                    fprintf(frontend->diag_file, "LEXIC ERROR: unknown operator '%c'\n", *cur_ch);
 
-                if ((identifier = tableLookup(&(frontend->idr_table), buffer)) == NULL){
-                    logPrint(LOG_DEBUG_PLUS, "\t\tcreating new\n");
+                return 1;
+            }
 
-                    id_index = frontend->id_size;
+            cur_ch += oper_len;
 
-                    strcpy(frontend->ids[id_index].name, buffer);
-                    frontend->ids[id_index].type = VAR; // VAR is default value
+            token->type = OPR;
+            token->val.op = op_num;
+        }
 
-                    frontend->id_size++;
+        cur_ch = scanSkipSpaces(cur_ch);
+    }
 
-                    tableInsert(&frontend->idr_table, buffer, &id_index, sizeof(id_index));
-                }
-                else {
-                    logPrint(LOG_DEBUG_PLUS, "\t\talready exists\n");
+    newToken(frontend)->type = END;
 
-                    id_index = *((unsigned int *)(identifier->data));
-                }
+    return 0;
+}
 
-                frontend->tokens[token_index].type = IDR;
-                frontend->tokens[token_index].val.id = id_index;
-            }
-            else {
-                logPrint(LOG_RELEASE, "LEXIC ERROR: unknown opeator '%s'\n", buffer);
-                fprintf(stderr, "LEXIC ERROR: unknown operator '%s'\n", buffer);
+// tokens are skipped by the same rules as in lexicalAnalysisPart(), so the parts start at the tokens of the whole code;
+// a function declaration is top-level if every begin before it has its end
+size_t lexicalSplit(const char * code, size_t part_size, const char ** part_starts, size_t max_parts)
+{
+    assert(code);
+    assert(part_starts);
+    assert(max_parts > 0);
 
-                return 1;
+    size_t parts_num = 1;
+    part_starts[0] = code;
+
+    long depth = 0;
+
+    const char * cur_ch = scanSkipSpaces(code);
+
+    while (*cur_ch != '\0'){
+        if (isdigit(*cur_ch)){
+            char * end = NULL;
+            strtod(cur_ch, &end);
+
+            cur_ch = end;
+        }
+
+        else if (isWordStart(*cur_ch)){
+            const char * word = cur_ch;
+
+            cur_ch = scanSkipWord(word);
+
+            int keyword = getKeyword(word, (size_t)(cur_ch - word));
+
+            if (keyword == BEGIN)
+                depth++;
+            else if (keyword == ENDING)
+                depth--;
+            else if (keyword == FUNC_DECL && depth == 0 && parts_num < max_parts &&
+                     (size_t)(word - part_starts[parts_num - 1]) >= part_size){
+                part_starts[parts_num] = word;
+                parts_num++;
             }
         }
-        skipSpaces(&cur_ch);
 
-        token_index++;
-    }
+        else {
+            enum oper op_num = NO_OP;
+            size_t oper_len = getSymbolOper(cur_ch, &op_num);
 
-    frontend->tokens[token_index++].type = END;
+            if (oper_len == 0)
+                return 0;
 
-    frontend->tokens_size = token_index;
+            cur_ch += oper_len;
+        }
 
-    return 0;
+        cur_ch = scanSkipSpaces(cur_ch);
+    }
+
+    return parts_num;
 }
 
-static enum id_stat getIdName(const char ** src_str, char * buffer)
+// the name is interned straight from the code, ids of the frontend are the ids of their names
+unsigned int getIdentifier(fe_context_t * frontend, const char * word, size_t word_len)
 {
-    assert(src_str);
-    assert(buffer);
+    assert(frontend);
+    assert(word);
+
+    uint32_t id_index = internerIntern(&frontend->names, word, word_len);
 
-    // for identificators or operators with normal names
-    if (isalpha(**src_str) || **src_str == '_'){
-        while((**src_str != '\0') && (**src_str != COMMENT_START) && (isalpha(**src_str) || **src_str == '_' || isdigit(**src_str)))
-            *(buffer++) = *((*src_str)++);
+    if (id_index < frontend->id_size){
+        logPrint(LOG_DEBUG_PLUS, "\t\talready exists\n");
 
-        return IS_IDR_OR_OPR;
+        return id_index;
     }
 
-    // for operators as != <= == >= ...
-    while ((**src_str != '\0') && (**src_str != COMMENT_START) && (!isalpha(**src_str) && !isdigit(**src_str) && !isspace(**src_str) && **src_str != '_'))
-        *(buffer++) = *((*src_str)++);
+    logPrint(LOG_DEBUG_PLUS, "\t\tcreating new\n");
+
+    if (frontend->id_size == frontend->ids_capacity){
+        frontend->ids_capacity = (frontend->ids_capacity == 0) ? IDS_START_CAP : 2 * frontend->ids_capacity;
+        frontend->ids = (idr_t *)realloc(frontend->ids, frontend->ids_capacity * sizeof(idr_t));
+        frontend->ids_set = (unsigned char *)realloc(frontend->ids_set, frontend->ids_capacity * sizeof(unsigned char));
+    }
 
-    return IS_OPR;
+    idr_t * id = frontend->ids + id_index;
+
+    *id = {};
+    frontend->ids_set[id_index] = 0;
+    id->name = internerName(&frontend->names, id_index);
+    id->type = VAR;     // VAR is default value
+
+    frontend->id_size++;
+
+    return id_index;
 }
 
-static void skipSpaces(const char ** code)
+// one probe of the perfect hash and one compare, returns the operator or -1 for identifiers
+static int getKeyword(const char * word, size_t word_len)
 {
-    assert(code);
-    assert(*code);
+    assert(word);
+    assert(word_len > 0);
 
-    bool in_comment = false;
+    size_t slot = keywordHash((unsigned char)word[0], (unsigned char)word[word_len - 1], word_len,
+                              KEYWORD_HASH.last_mul, KEYWORD_HASH.len_mul);
 
-    while ((**code != '\0') && (in_comment || isspace(**code) || **code == COMMENT_START)){
-        if (in_comment && **code == COMMENT_END)
-            in_comment = false;
-        else if (**code == COMMENT_START)
-            in_comment = true;
+    int keyword = KEYWORD_HASH.opers[slot];
 
+    if (keyword < 0 || KEYWORD_HASH.lengths[slot] != word_len || memcmp(opers[keyword].name, word, word_len) != 0)
+        return -1;
 
-        (*code)++;
+    return keyword;
+}
+
+// runs the DFA of the symbol operators (longest match), returns the length of the operator or 0 if there is none
+static size_t getSymbolOper(const char * str, enum oper * op_num)
+{
+    assert(str);
+    assert(op_num);
+
+    unsigned char first = (unsigned char)str[0];
+
+    if (SYMBOL_DFA.second[first] != 0 && str[1] == SYMBOL_DFA.second[first]){
+        *op_num = (enum oper)SYMBOL_DFA.pair[first];
+        return 2;
+    }
+
+    if (SYMBOL_DFA.single[first] < 0)
+        return 0;
+
+    *op_num = (enum oper)SYMBOL_DFA.single[first];
+
+    return 1;
+}
+
+// the buffer grows twice, so lexing is linear in the number of tokens
+static token_t * newToken(fe_context_t * frontend)
+{
+    assert(frontend);
+
+    if (frontend->tokens_size == frontend->tokens_capacity){
+        size_t new_capacity = (frontend->tokens_capacity == 0) ? MAX_TOKEN_NUM : 2 * frontend->tokens_capacity;
+
+        frontend->tokens = (token_t *)realloc(frontend->tokens, new_capacity * sizeof(token_t));
+        frontend->tokens_capacity = new_capacity;
     }
+
+    token_t * token = frontend->tokens + frontend->tokens_size;
+    frontend->tokens_size++;
+
+    *token = {};
+
+    return token;
 }
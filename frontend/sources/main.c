@@ -10,13 +10,35 @@
 #include "reverse_frontend.h"
 #include "frontend.h"
 #include "tree.h"
+#include "thread_pool.h"
 
+// ARGS
+// [--graphs]              - dump graphs of the trees to the log
+// [-j threads_num]        - number of threads of parsing long sources (number of cores by default)
+// [-1 tree file name code file name] - reverse frontend: code of the tree
+// [code file name] [tree file name]
 int main(int argc, char ** argv)
 {
     mkdir(LOG_FOLDER_NAME, 0777);
 
     logStart(LOG_FILE_NAME, LOG_DEBUG_PLUS, LOG_HTML);
-    logCancelBuffer();
+
+    if (argc > 1 && strcmp(argv[1], GRAPHS_FLAG) == 0){
+        treeGraphDumpsEnable(true);
+        argc--;
+        argv++;
+    }
+
+    size_t threads_num = getCoresNum();
+
+    if (argc > 2 && strcmp(argv[1], "-j") == 0){
+        threads_num = strtoul(argv[2], NULL, 10);
+        if (threads_num == 0)
+            threads_num = 1;
+
+        argc -= 2;
+        argv += 2;
+    }
 
     if (argc > 1 && (strcmp(argv[1], "-1") == 0)){
         const char * ir_file_name   = "out.ast";
@@ -29,6 +51,9 @@ int main(int argc, char ** argv)
 
         reverseFrontendRun(ir_file_name, code_file_name);
 
+        treeGraphDumpsWait();
+        logExit();
+
         return 0;
     }
 
@@ -40,8 +65,9 @@ int main(int argc, char ** argv)
         ir_file_name   = argv[2];
     }
 
-    frontendRun(code_file_name, ir_file_name);
+    frontendRun(code_file_name, ir_file_name, threads_num);
 
+    treeGraphDumpsWait();
     logExit();
 
     return 0;
@@ -7,6 +7,7 @@
 #include "logger.h"
 #include "reverse_frontend.h"
 #include "frontend.h"
+#include "node_arena.h"
 
 static void printCodeFromTree(const char * out_file_name, tree_context_t * context, node_t * root);
 
@@ -22,8 +23,10 @@ void reverseFrontendRun(const char * in_file_name, const char * out_file_name)
 {
     fe_context_t fe = frontendInit(MAX_TOKEN_NUM);
 
+    node_arena_t arena = nodeArenaCtor();
+
     tree_context_t tr = {};         //TODO: GET RID OF THAT
-    tr.cur_node = fe.cur_node;
+    tr.arena = &arena;
     tr.ids = fe.ids;
     tr.id_size = fe.id_size;
 
@@ -34,6 +37,10 @@ void reverseFrontendRun(const char * in_file_name, const char * out_file_name)
 
     frontendDump(&fe);
 
+    nodeArenaDtor(&arena);
+    free(tr.ids);
+    internerDtor(&tr.names);
+
     frontendDtor(&fe);
 }
 
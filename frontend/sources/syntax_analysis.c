@@ -4,6 +4,7 @@
 
 #include "logger.h"
 #include "tree.h"
+#include "node_arena.h"
 #include "frontend.h"
 
 typedef node_t * (* syntax_func_t)(fe_context_t * frontend);
@@ -24,7 +25,6 @@ static node_t * getElse(fe_context_t * frontend);
 static node_t * getWhile(fe_context_t * frontend);
 
 static node_t * getAssign(fe_context_t * frontend);
-static node_t * getSTDfunc(fe_context_t * frontend);
 
 static node_t * getInput(fe_context_t * frontend);
 static node_t * getOutput(fe_context_t * frontend);
@@ -32,23 +32,49 @@ static node_t * getOutput(fe_context_t * frontend);
 static node_t * getReturn(fe_context_t * frontend);
 
 static node_t * getExpr(fe_context_t * frontend);
-static node_t * getAddSub(fe_context_t * frontend);
-static node_t * getMulDiv(fe_context_t * frontend);
-static node_t * getPower(fe_context_t * frontend);
+static node_t * getInfixExpr(fe_context_t * frontend, unsigned char min_precedence);
 static node_t * getPrimary(fe_context_t * frontend);
 
-static node_t * getNumber(fe_context_t * frontend);
-
 static node_t * getMathFunc(fe_context_t * frontend);
 static node_t * getId(fe_context_t * frontend);
 
-static void syntaxError(fe_context_t * fe, const char * expected, node_t * node);
+static node_t * tokenNode(fe_context_t * frontend, const token_t * tok);
+static node_t * newOprNode(fe_context_t * frontend, enum oper op);
+
+static void setIdType(fe_context_t * frontend, unsigned int id, enum id_type type);
+
+static void syntaxError(fe_context_t * fe, const char * expected, const token_t * tok);
+
+/// @brief parsers of the statements by their first operator, an identifier starts an assignment
+typedef struct {
+    syntax_func_t by_oper[NO_OP + 1];
+} statement_table_t;
+
+constexpr statement_table_t makeStatementTable()
+{
+    statement_table_t table = {};
+
+    table.by_oper[IN]        = getInput;
+    table.by_oper[OUT]       = getOutput;
+    table.by_oper[IF]        = getIF;
+    table.by_oper[WHILE]     = getWhile;
+    table.by_oper[FUNC_DECL] = getFuncDecl;
+    table.by_oper[VAR_DECL]  = getVarDecl;
+    table.by_oper[RETURN]    = getReturn;
+
+    return table;
+}
+
+constexpr statement_table_t STATEMENT_TABLE = makeStatementTable();
+
+// operands of the infix operators are parsed with the precedence above the lowest one
+const unsigned char MIN_PRECEDENCE = 1;
 
 #define LOG_SYNTAX_FUNC_INFO       \
     logPrint(LOG_DEBUG_PLUS, "SYNTAX: in %-20s (token #%zu)\n", __FUNCTION__, (size_t)(token - frontend->tokens))
 
 
-#define token (frontend->cur_node)
+#define token (frontend->cur_token)
 
 #define SYNTAX_ERROR(expected)              \
     do {                                    \
@@ -80,17 +106,19 @@ node_t * parseCode(fe_context_t * frontend)
 {
     assert(frontend);
 
-    frontend->cur_node = frontend->tokens;
+    frontend->cur_token = frontend->tokens;
 
     node_t * root = getChain(frontend);
 
     if (root == NULL){
-        fprintf(stderr, "failed to parse\n");
+        if (frontend->diag_file != NULL)
+            fprintf(frontend->diag_file, "failed to parse\n");
         return NULL;
     }
 
-    if (frontend->cur_node->type != END){
-        fprintf(stderr, "failed to parse (no end)\n");
+    if (frontend->cur_token->type != END){
+        if (frontend->diag_file != NULL)
+            fprintf(frontend->diag_file, "failed to parse (no end)\n");
         return NULL;
     }
 
@@ -139,7 +167,7 @@ static node_t * getChain(fe_context_t * frontend)
         SYNTAX_ERROR(";");
     }
 
-    node_t * tree = token;
+    node_t * tree = tokenNode(frontend, token);
     tree->left = cur;
     token++;
 
@@ -150,12 +178,12 @@ static node_t * getChain(fe_context_t * frontend)
             SYNTAX_ERROR(";");
         }
 
-        token->left = cur;
-        token->right = NULL;
+        node_t * sep_node = tokenNode(frontend, token);
+        sep_node->left = cur;
 
-        last->right = token;
+        last->right = sep_node;
 
-        last = token;
+        last = sep_node;
 
         token++;
     }
@@ -163,34 +191,26 @@ static node_t * getChain(fe_context_t * frontend)
     return tree;
 }
 
+// the first token selects the only statement that can start with it
 static node_t * getStatement(fe_context_t * frontend)
 {
     assert(frontend);
 
     LOG_SYNTAX_FUNC_INFO;
 
-    const syntax_func_t statement_funcs[] = {
-        getSTDfunc,
-        getIF,
-        getWhile,
-        getFuncDecl,
-        getVarDecl,
-        getAssign,
-        getReturn
-    };
-    const size_t num_of_funcs = sizeof(statement_funcs) / sizeof(statement_funcs[0]);
-
-    for (size_t func_index = 0; func_index < num_of_funcs; func_index++){
-        node_t * tree = statement_funcs[func_index](frontend);
+    syntax_func_t statement_func = NULL;
 
-        if (frontend->status == SUCCESS)
-            return tree;
+    if (token->type == OPR)
+        statement_func = STATEMENT_TABLE.by_oper[token->val.op];
+    else if (token->type == IDR)
+        statement_func = getAssign;
 
-        if (frontend->status == HARD_ERROR)
-            return NULL;
+    if (statement_func == NULL){
+        frontend->status = SOFT_ERROR;
+        return NULL;
     }
 
-    return NULL;
+    return statement_func(frontend);
 }
 
 static node_t * getWhile(fe_context_t * frontend)
@@ -201,12 +221,9 @@ static node_t * getWhile(fe_context_t * frontend)
 
     frontend->status = SUCCESS;
 
-    if (! tokenisOPR(WHILE)){
-        frontend->status = SOFT_ERROR;
-        return NULL;
-    }
+    assert(tokenisOPR(WHILE));
 
-    node_t * while_node = token;
+    node_t * while_node = tokenNode(frontend, token);
     token++;
 
     LBRACKET_SKIP;
@@ -241,44 +258,37 @@ static node_t * getFuncDecl(fe_context_t * frontend)
 
     frontend->status = SUCCESS;
 
-    if (! tokenisOPR(FUNC_DECL)){
-        frontend->status = SOFT_ERROR;
-        return NULL;
-    }
-    node_t * func = token;
+    assert(tokenisOPR(FUNC_DECL));
+    node_t * func = tokenNode(frontend, token);
     token++;
 
     if (token->type != IDR){
         SYNTAX_ERROR("identifier");
     }
-    node_t * id_node = token;
+    node_t * id_node = tokenNode(frontend, token);
     token++;
 
-    // setting type to FUNC in name table
-    frontend->ids[id_node->val.id].type = FUNC;
+    // setting type to FUNC in name table, the number of args is counted below
+    setIdType(frontend, id_node->val.id, FUNC);
+    frontend->ids_set[id_node->val.id] |= ID_SET_ARGS;
 
-    // we will use this node later
-    node_t * arg_tree = token;
+    node_t * arg_tree = NULL;
     LBRACKET_SKIP;
 
     // if there are no arguments given
     if (token->type != IDR){
         // so we do not actually need arg tree
-        arg_tree = NULL;
         frontend->ids[id_node->val.id].num_of_args = 0;
     }
     else {
-        // so we have at least one argument
-
-        // transforming left bracket into ARG_SEP
-        arg_tree->type = OPR;
-        arg_tree->val.op = ARG_SEP;
+        // so we have at least one argument, left bracket stands for the first ARG_SEP
+        arg_tree = newOprNode(frontend, ARG_SEP);
 
         // first arg handling
         if (token->type != IDR){
             SYNTAX_ERROR("identifier");
         }
-        node_t * first_arg_node = token;
+        node_t * first_arg_node = tokenNode(frontend, token);
         token++;
 
         frontend->ids[id_node->val.id].num_of_args = 1;
@@ -288,36 +298,30 @@ static node_t * getFuncDecl(fe_context_t * frontend)
 
         // handling other args
         node_t * last_sep = arg_tree;
-        node_t * cur_sep  = token;
 
-        while (cur_sep->type == OPR && cur_sep->val.op == ARG_SEP){
+        while (tokenisOPR(ARG_SEP)){
+            node_t * cur_sep = tokenNode(frontend, token);
             token++;
+
             if (token->type != IDR){
                 SYNTAX_ERROR("identifier");
             }
-            node_t * cur_arg_node = token;
+            node_t * cur_arg_node = tokenNode(frontend, token);
             token++;
 
             frontend->ids[id_node->val.id].num_of_args++;
 
             last_sep->right = cur_sep;
-
-            cur_sep->left  = cur_arg_node;
-            cur_sep->right = NULL;
+            cur_sep->left   = cur_arg_node;
 
             last_sep = cur_sep;
-
-            cur_sep = token;
         }
     }
 
-    // we will use this node later
-    node_t * func_header = token;
     RBRACKET_SKIP;
 
-    // transforming right bracket into a FUNC_HEADER
-    func_header->type = OPR;
-    func_header->val.op = FUNC_HEADER;
+    // right bracket stands for FUNC_HEADER
+    node_t * func_header = newOprNode(frontend, FUNC_HEADER);
 
     func_header->left = id_node;
 
@@ -348,7 +352,7 @@ static node_t * getElse(fe_context_t * frontend)
         frontend->status = SOFT_ERROR;
         return NULL;
     }
-    node_t * if_else_node = token;
+    node_t * if_else_node = tokenNode(frontend, token);
     token++;
 
     node_t * else_body_tree = getBlock(frontend);
@@ -373,12 +377,9 @@ static node_t * getIF(fe_context_t * frontend)
 
     frontend->status = SUCCESS;
 
-    if (! tokenisOPR(IF)){
-        frontend->status = SOFT_ERROR;
-        return NULL;
-    }
+    assert(tokenisOPR(IF));
 
-    node_t * if_node = token;
+    node_t * if_node = tokenNode(frontend, token);
     token++;
 
     LBRACKET_SKIP;
@@ -417,29 +418,6 @@ static node_t * getIF(fe_context_t * frontend)
     return if_node;
 }
 
-static node_t * getSTDfunc(fe_context_t * frontend)
-{
-    assert(frontend);
-
-    LOG_SYNTAX_FUNC_INFO;
-
-    node_t * func = getInput(frontend);
-
-    if (frontend->status == SUCCESS)
-        return func;
-    if (frontend->status == HARD_ERROR)
-        return NULL;
-
-    func = getOutput(frontend);
-
-    if (frontend->status == SUCCESS)
-        return func;
-    if (frontend->status == HARD_ERROR)
-        return NULL;
-
-    return NULL;
-}
-
 static node_t * getInput(fe_context_t * frontend)
 {
     assert(frontend);
@@ -448,12 +426,9 @@ static node_t * getInput(fe_context_t * frontend)
 
     frontend->status = SUCCESS;
 
-    if (!(token->type == OPR && token->val.op == IN)){
-        frontend->status = SOFT_ERROR;
-        return NULL;
-    }
+    assert(tokenisOPR(IN));
 
-    node_t * input_node = token;
+    node_t * input_node = tokenNode(frontend, token);
     token++;
 
     LBRACKET_SKIP;
@@ -478,12 +453,9 @@ static node_t * getOutput(fe_context_t * frontend)
 
     frontend->status = SUCCESS;
 
-    if (!(token->type == OPR && token->val.op == OUT)){
-        frontend->status = SOFT_ERROR;
-        return NULL;
-    }
+    assert(tokenisOPR(OUT));
 
-    node_t * output_node = token;
+    node_t * output_node = tokenNode(frontend, token);
     token++;
 
     LBRACKET_SKIP;
@@ -508,11 +480,8 @@ static node_t * getReturn(fe_context_t * frontend)
 
     LOG_SYNTAX_FUNC_INFO;
 
-    node_t * ret_node = token;
-    if (! tokenisOPR(RETURN)){
-        frontend->status = SOFT_ERROR;
-        return NULL;
-    }
+    assert(tokenisOPR(RETURN));
+    node_t * ret_node = tokenNode(frontend, token);
     token++;
 
     node_t * expr_tree = getExpr(frontend);
@@ -537,10 +506,10 @@ static node_t * getAssign(fe_context_t * frontend)
         return NULL;
     }
 
-    node_t * assign_node = token;
     if (!(token->type == OPR && token->val.op == ASSIGN)){
         SYNTAX_ERROR("=");
     }
+    node_t * assign_node = tokenNode(frontend, token);
     token++;
 
     node_t * right_part = getExpr(frontend);
@@ -558,49 +527,30 @@ static node_t * getExpr(fe_context_t * frontend)
 {
     assert(frontend);
 
-    LOG_SYNTAX_FUNC_INFO;
-
-    node_t * node = getAddSub(frontend);
-
-    if (frontend->status == HARD_ERROR)
-        return NULL;
-
-    while (tokenisOPR(GREATER) || tokenisOPR(LESS) || tokenisOPR(LESS_EQ) || tokenisOPR(GREATER_EQ) || tokenisOPR(EQUAL) || tokenisOPR(N_EQUAL)){
-        node_t * cur_node = token;
-        token++;
-
-        node_t * node2 = getAddSub(frontend);
-
-        if (frontend->status == HARD_ERROR)
-            return NULL;
-
-        cur_node->left  = node;
-        cur_node->right = node2;
-
-        node = cur_node;
-    }
-
-    frontend->status = SUCCESS;
-
-    return node;
+    return getInfixExpr(frontend, MIN_PRECEDENCE);
 }
 
-static node_t * getAddSub(fe_context_t * frontend)
+// precedence climbing by opers[]: the loop takes the operators that bind at least as tight as min_precedence,
+// their right operands take only tighter ones (or the same for right associative)
+static node_t * getInfixExpr(fe_context_t * frontend, unsigned char min_precedence)
 {
     assert(frontend);
 
     LOG_SYNTAX_FUNC_INFO;
 
-    node_t * node = getMulDiv(frontend);
+    node_t * node = getPrimary(frontend);
 
     if (frontend->status == HARD_ERROR)
         return NULL;
 
-    while (token->type == OPR && (token->val.op == ADD || token->val.op == SUB)){
-        node_t * cur_node = token;
+    while (token->type == OPR && opers[token->val.op].precedence >= min_precedence){
+        unsigned char precedence = opers[token->val.op].precedence;
+        unsigned char right_precedence = opers[token->val.op].right_assoc ? precedence : (unsigned char)(precedence + 1);
+
+        node_t * cur_node = tokenNode(frontend, token);
         token++;
 
-        node_t * node2 = getMulDiv(frontend);
+        node_t * node2 = getInfixExpr(frontend, right_precedence);
 
         if (frontend->status == HARD_ERROR)
             return NULL;
@@ -616,71 +566,27 @@ static node_t * getAddSub(fe_context_t * frontend)
     return node;
 }
 
-static node_t * getMulDiv(fe_context_t * frontend)
-{
-    assert(frontend);
-
-    LOG_SYNTAX_FUNC_INFO;
-
-    node_t * node = getPower(frontend);
-
-    if (frontend->status == HARD_ERROR)
-        return NULL;
-
-    while (token->type == OPR && (token->val.op == MUL || token->val.op == DIV)){
-        node_t * cur_node = token;
-        token++;
-
-        node_t * node2 = getPower(frontend);
-
-        if (frontend->status == HARD_ERROR)
-            return NULL;
-
-        cur_node->left  = node;
-        cur_node->right = node2;
-
-        node = cur_node;
-    }
-
-    return node;
-}
-
-static node_t * getPower(fe_context_t * frontend)
+static node_t * getPrimary(fe_context_t * frontend)
 {
     assert(frontend);
 
     LOG_SYNTAX_FUNC_INFO;
 
-    node_t * node = getPrimary(frontend);
-
-    if (frontend->status == HARD_ERROR)
-        return NULL;
-
-    while (token->type == OPR && token->val.op == POW){
-        node_t * cur_node = token;
-        token++;
-
-        node_t * node2 = getPower(frontend);
-
-        if (frontend->status == HARD_ERROR)
-            return NULL;
+    frontend->status = SUCCESS;
 
-        cur_node->left  = node;
-        cur_node->right = node2;
+    if (token->type == NUM)
+        return tokenNode(frontend, token++);
 
-        node = cur_node;
-    }
+    if (token->type == END)
+        SYNTAX_ERROR("number");
 
-    return node;
-}
+    // the token is not the last one, so the next one can be looked at
+    bool bracket_follows = ((token + 1)->type == OPR && (token + 1)->val.op == LBRACKET);
 
-static node_t * getPrimary(fe_context_t * frontend)
-{
-    assert(frontend);
+    if (token->type == IDR)
+        return bracket_follows ? getFuncCall(frontend) : tokenNode(frontend, token++);
 
-    LOG_SYNTAX_FUNC_INFO;
-
-    if (token->type == OPR && token->val.op == LBRACKET){
+    if (tokenisOPR(LBRACKET)){
         token++;
 
         node_t * node = getExpr(frontend);
@@ -690,27 +596,13 @@ static node_t * getPrimary(fe_context_t * frontend)
         return node;
     }
 
-    node_t * math_func = getMathFunc(frontend);
-    if (frontend->status == SUCCESS)
-        return math_func;
-    else if (frontend->status == HARD_ERROR)
-        return NULL;
-
-    node_t * func = getFuncCall(frontend);
-    if (frontend->status == SUCCESS)
-        return func;
-    else if (frontend->status == HARD_ERROR)
-        return NULL;
-
-    node_t * id = getId(frontend);
-    if (frontend->status == SUCCESS)
-        return id;
-    else if (frontend->status == HARD_ERROR)
-        return NULL;
+    if (bracket_follows){
+        node_t * math_func = getMathFunc(frontend);
+        if (frontend->status != SOFT_ERROR)
+            return math_func;
+    }
 
-    node_t * number = getNumber(frontend);
-    if (frontend->status == SUCCESS)
-        return number;
+    SYNTAX_ERROR("number");
 
     return NULL;
 }
@@ -723,20 +615,17 @@ static node_t * getVarDecl(fe_context_t * frontend)
 
     LOG_SYNTAX_FUNC_INFO;
 
-    if (! tokenisOPR(VAR_DECL)){
-        frontend->status = SOFT_ERROR;
-        return NULL;
-    }
-    node_t * decl_node = token;
+    assert(tokenisOPR(VAR_DECL));
+    node_t * decl_node = tokenNode(frontend, token);
     token++;
 
     if (token->type != IDR){
         SYNTAX_ERROR("identifier");
     }
-    node_t * id_node = token;
+    node_t * id_node = tokenNode(frontend, token);
     token++;
 
-    frontend->ids[id_node->val.id].type = VAR;
+    setIdType(frontend, id_node->val.id, VAR);
     decl_node->left = id_node;
 
     return decl_node;
@@ -750,38 +639,22 @@ static node_t * getFuncCall(fe_context_t * frontend)
 
     LOG_SYNTAX_FUNC_INFO;
 
-    if (token->type != IDR){
-        frontend->status = SOFT_ERROR;
-        return NULL;
-    }
-    node_t * func_node = token;
-    token++;
+    assert(token->type == IDR);
 
-    if (! tokenisOPR(LBRACKET)){
-        frontend->status = SOFT_ERROR;
-        token--;
+    const token_t * func_token = token;
+    token++;
 
-        return NULL;
-    }
+    LBRACKET_SKIP;
 
-    // we will transform this node into ARG_SEP
-    node_t * arg_tree = token;
-    token++;
+    node_t * func_node = tokenNode(frontend, func_token);
+    node_t * arg_tree  = NULL;
 
     // it has left bracket so it is a function
-    frontend->ids[func_node->val.id].type = FUNC;
+    setIdType(frontend, func_node->val.id, FUNC);
 
-    // if there are no arguments given
-    if (tokenisOPR(RBRACKET)){
-        // so we do not actually need arg tree
-        arg_tree = NULL;
-    }
-    else {
-        // so we have at least one argument
-
-        // transforming left bracket into ARG_SEP
-        arg_tree->type = OPR;
-        arg_tree->val.op = ARG_SEP;
+    // if there are arguments, left bracket stands for the first ARG_SEP
+    if (! tokenisOPR(RBRACKET)){
+        arg_tree = newOprNode(frontend, ARG_SEP);
 
         // first arg handling
         node_t * first_arg_node = getExpr(frontend);
@@ -795,9 +668,9 @@ static node_t * getFuncCall(fe_context_t * frontend)
 
         // handling other args
         node_t * last_sep = arg_tree;
-        node_t * cur_sep  = token;
 
-        while (cur_sep->type == OPR && cur_sep->val.op == ARG_SEP){
+        while (tokenisOPR(ARG_SEP)){
+            node_t * cur_sep = tokenNode(frontend, token);
             token++;
 
             node_t * cur_arg_node = getExpr(frontend);
@@ -807,20 +680,16 @@ static node_t * getFuncCall(fe_context_t * frontend)
             }
 
             last_sep->right = cur_sep;
-
-            cur_sep->left  = cur_arg_node;
-            cur_sep->right = NULL;
+            cur_sep->left   = cur_arg_node;
 
             last_sep = cur_sep;
-
-            cur_sep = token;
         }
     }
 
-    node_t * call_node = token;
     RBRACKET_SKIP;
 
-    call_node->val.op = CALL;
+    // right bracket stands for CALL
+    node_t * call_node = newOprNode(frontend, CALL);
     call_node->left = func_node;
 
     // right subtree is arg tree
@@ -829,25 +698,6 @@ static node_t * getFuncCall(fe_context_t * frontend)
     return call_node;
 }
 
-static node_t * getNumber(fe_context_t * frontend)
-{
-    assert(frontend);
-
-    LOG_SYNTAX_FUNC_INFO;
-
-    if (token->type == NUM){
-        frontend->status = SUCCESS;
-
-        node_t * num_node = token;
-        token++;
-
-        return num_node;
-    }
-    SYNTAX_ERROR("number");
-
-    return NULL;
-}
-
 static node_t * getId(fe_context_t * frontend)
 {
     assert(frontend);
@@ -861,7 +711,7 @@ static node_t * getId(fe_context_t * frontend)
     }
     frontend->status = SUCCESS;
 
-    node_t * id_node = token;
+    node_t * id_node = tokenNode(frontend, token);
     token++;
 
     return id_node;
@@ -881,16 +731,10 @@ static node_t * getMathFunc(fe_context_t * frontend)
 
     switch (token->val.op){
         case SIN: case COS: case LN: case TAN: case SQRT:{
-            node_t * func_node = token;
-            token++;
+            const token_t * func_token = token;
+            token += 2;     // the bracket is checked by getPrimary
 
-            if (!(token->type == OPR && token->val.op == LBRACKET)){
-                frontend->status = SOFT_ERROR;
-                token--;
-
-                return NULL;
-            }
-            token++;
+            node_t * func_node = tokenNode(frontend, func_token);
 
             func_node->left = getExpr(frontend);
 
@@ -916,18 +760,58 @@ static node_t * getMathFunc(fe_context_t * frontend)
 #undef LBRACKET_SKIP
 #undef token
 
-static void syntaxError(fe_context_t * fe, const char * expected, node_t * node)
+static node_t * tokenNode(fe_context_t * frontend, const token_t * tok)
+{
+    assert(frontend);
+    assert(tok);
+
+    node_t * node = nodeArenaAlloc(&(frontend->nodes));
+
+    node->type = tok->type;
+    node->val  = tok->val;
+
+    return node;
+}
+
+static node_t * newOprNode(fe_context_t * frontend, enum oper op)
+{
+    assert(frontend);
+
+    node_t * node = nodeArenaAlloc(&(frontend->nodes));
+
+    node->type   = OPR;
+    node->val.op = op;
+
+    return node;
+}
+
+// marked types override the types of the previous parts when the parts are merged
+static void setIdType(fe_context_t * frontend, unsigned int id, enum id_type type)
+{
+    assert(frontend);
+    assert(id < frontend->id_size);
+
+    frontend->ids[id].type = type;
+    frontend->ids_set[id] |= ID_SET_TYPE;
+}
+
+static void syntaxError(fe_context_t * fe, const char * expected, const token_t * tok)
 {
     assert(expected);
 
+    fe->errors_num++;
+
+    if (fe->diag_file == NULL)
+        return;
+
     const char * what_got = NULL;
 
-    if (node->type == OPR)
-        what_got = opers[node->val.op].name;
-    else if (node->type == IDR)
-        what_got = fe->ids[node->val.id].name;
+    if (tok->type == OPR)
+        what_got = opers[tok->val.op].name;
+    else if (tok->type == IDR)
+        what_got = fe->ids[tok->val.id].name;
     else
         what_got = "NUMBER";
 
-    fprintf(stderr, "SYNTAX ERROR: expected %s, but got '%s'\n", expected, what_got);
+    fprintf(fe->diag_file, "SYNTAX ERROR: expected %s, but got '%s'\n", expected, what_got);
 }
@@ -0,0 +1,66 @@
+#ifndef IR_BINARY_INCLUDED
+#define IR_BINARY_INCLUDED
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "tree.h"
+
+// Binary AST file: header, name table (entries point into the string table), string table
+// and flat array of nodes (starts at the cache line boundary).
+// Node records have the layout of node_t, links are (index + 1) of the child, 0 is no child.
+// Reader maps the file and turns links into pointers in place, so there is nothing to parse.
+
+const size_t IR_BIN_MAGIC_LEN = 8;
+const char IR_BIN_MAGIC[IR_BIN_MAGIC_LEN] = {'I', 'R', '3', '1', '2', 'B', '\0', '\0'};
+
+const uint32_t IR_BIN_VERSION = 1;
+
+const size_t IR_BIN_NODES_ALIGN = 64;
+
+const char * const IR_BIN_EXTENSION = ".astb";
+
+typedef struct {
+    char magic[IR_BIN_MAGIC_LEN];
+    uint32_t version;
+    uint32_t ids_num;
+
+    uint64_t nodes_num;
+    uint64_t root;                  // link to the root node
+
+    uint64_t ids_offset;
+    uint64_t strings_offset;
+    uint64_t strings_size;
+    uint64_t nodes_offset;
+} ir_bin_header_t;
+
+typedef struct {
+    uint32_t name_offset;           // offset of zero-terminated name in the string table
+    uint32_t type;                  // enum id_type
+    uint64_t num_of_args;
+} ir_bin_id_t;
+
+typedef struct {
+    int32_t type;                   // enum elem_type
+    uint32_t reserved;
+    union value val;
+
+    uint64_t left;
+    uint64_t right;
+} ir_bin_node_t;
+
+static_assert(sizeof(ir_bin_node_t) == sizeof(node_t), "binary node must have the layout of node_t");
+
+/// @brief returns true if the file starts with the binary IR magic
+bool isBinaryIRfile(const char * file_name);
+
+/// @brief returns true if the file name has binary IR extension
+bool hasBinaryIRextension(const char * file_name);
+
+/// @brief maps binary IR file, nodes are used in place and the mapping is owned by tree->arena
+node_t * readTreeFromBinaryIR(tree_context_t * tree, const char * file_name);
+
+/// @brief writes tree in the binary format (nodes in preorder)
+void writeTreeToBinaryFile(tree_context_t * tree, node_t * root, FILE * out_file);
+
+#endif
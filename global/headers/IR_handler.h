@@ -3,64 +3,82 @@
 
 #include "tree.h"
 
-struct oper_IR_name {
-    enum oper op_num;
-    const char * name;
-};
-
-const struct oper_IR_name oper_names[] = {
-    {ADD,           "ADD"},
-    {SUB,           "SUB"},
-    {MUL,           "MUL"},
-    {DIV,           "DIV"},
-
-    {POW,           "POW"},
-    {SQRT,          "SQRT"},
-
-    {SIN,           "SIN"},
-    {COS,           "COS"},
-    {TAN,           "TAN"},
-
-    {GREATER,       "GREATER"},
-    {LESS,          "LESS"},
-    {GREATER_EQ,    "GREATER_EQ"},
-    {LESS_EQ,       "LESS_EQ"},
-    {EQUAL,         "EQUAL"},
-    {N_EQUAL,       "N_EQUAL"},
-
-    {IN,            "IN"},
-    {OUT,           "OUT"},
-
-    {ASSIGN,        "ASSIGN"},
+// names of the operators in IR, indexed by enum oper (NULL if the operator cannot be in IR)
+const char * const oper_IR_names[] = {
+    "ADD",          // ADD
+    "SUB",          // SUB
+    "MUL",          // MUL
+    "DIV",          // DIV
+    "POW",          // POW
+    "SQRT",         // SQRT
+    "SIN",          // SIN
+    "COS",          // COS
+    "TAN",          // TAN
+    NULL,           // LN
+    NULL,           // LOG
+    NULL,           // FAC
+
+    "GREATER",      // GREATER
+    "LESS",         // LESS
+    "GREATER_EQ",   // GREATER_EQ
+    "LESS_EQ",      // LESS_EQ
+    "EQUAL",        // EQUAL
+    "N_EQUAL",      // N_EQUAL
+
+    "IN",           // IN
+    "OUT",          // OUT
+
+    NULL,           // LBRACKET
+    NULL,           // RBRACKET
+
+    "IF",           // IF
+    "ELSE",         // IF_ELSE
+
+    "WHILE",        // WHILE
+
+    "VAR",          // VAR_DECL
+
+    "CALL",         // CALL
+    "DEF",          // FUNC_DECL
+    "FUNC_HDR",     // FUNC_HEADER
+    "ARG_SEP",      // ARG_SEP
+    "RET",          // RETURN
+
+    NULL,           // BEGIN
+    NULL,           // ENDING
+
+    "ASSIGN",       // ASSIGN
+    "SEP",          // SEP
+    "TEXT",         // TEXT
 
-    {IF,            "IF"},
-    {IF_ELSE,       "ELSE"},
-
-    {WHILE,         "WHILE"},
-
-    {SEP,           "SEP"},
-    {ARG_SEP,       "ARG_SEP"},
+    //! must be the last !!!
+    "__UNKNOWN__"   // NO_OP
+};
+static_assert(sizeof(oper_IR_names) / sizeof(*oper_IR_names) == NO_OP + 1, "every operator must have IR name entry");
 
-    {VAR_DECL,      "VAR"},
-    {FUNC_DECL,     "DEF"},
 
-    {CALL,          "CALL"},
-    {RETURN,        "RET"},
+/// @brief source text of a program, always followed by '\0'
+typedef struct {
+    char * text;
+    size_t size;
 
-    {FUNC_HEADER,   "FUNC_HDR"},
+    size_t mapping_size;        // text is mapped from the file if not 0, allocated otherwise
+} program_text_t;
 
-    {TEXT, "TEXT"},
+/// @brief maps a regular file or reads a pipe ("-" is stdin) in chunks
+/// @return false if the file cannot be read
+bool programTextOpen(program_text_t * program, const char * file_name);
 
-    //! must be the last !!!
-    {NO_OP, "__UNKNOWN__"}
-};
-const size_t oper_names_num = sizeof(oper_names) / sizeof(oper_names[0]);
-const size_t MAX_IR_OPER_NAME_LEN = 64;
+/// @brief unmaps or frees the text
+void programTextClose(program_text_t * program);
 
-char * readProgramText(const char * file_name);
+/// @brief writes tree in the binary format if the file name ends with IR_BIN_EXTENSION, in the text one otherwise
+void writeTreeToFile(tree_context_t * ir, node_t * root, const char * file_name);
 
-void writeTreeToFile(tree_context_t * ir, node_t * root, FILE * out_file);
+/// @brief returns operator by its IR name (NO_OP for unknown names), name is not zero-terminated
+enum oper getOperByIRname(const char * name, size_t name_len);
 
+/// @brief reads text or binary IR (detected by the signature)
 node_t * readTreeFromIR(tree_context_t * ir, const char * file_name);
 
 #endif
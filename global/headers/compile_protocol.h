@@ -0,0 +1,54 @@
+#ifndef COMPILE_PROTOCOL_INCLUDED
+#define COMPILE_PROTOCOL_INCLUDED
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// request:  compile_request_t, then code_size bytes of program text
+// response: compile_response_t, then elf_size bytes of elf and diag_size bytes of diagnostics
+// one connection can send any number of requests one after another
+
+const uint32_t COMPILE_REQUEST_MAGIC  = 0x51523133;      // "31RQ"
+const uint32_t COMPILE_RESPONSE_MAGIC = 0x50523133;      // "31RP"
+
+const uint64_t COMPILE_MAX_CODE_SIZE = 1 << 20;
+
+enum compile_flags {
+    COMPILE_NO_OPTIMIZE = 1 << 0
+};
+
+enum compile_status {
+    COMPILE_SUCCESS     = 0,
+    COMPILE_ERROR       = 1,    //< there are errors in the program, see diagnostics
+    COMPILE_BAD_REQUEST = 2
+};
+
+typedef struct {
+    uint32_t magic;
+    uint32_t flags;             //< enum compile_flags
+    uint64_t code_size;
+} compile_request_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t status;            //< enum compile_status
+    uint64_t elf_size;
+    uint64_t diag_size;
+} compile_response_t;
+
+/// @brief reads exactly size bytes, returns false on errors and end of file
+bool readAll(int fd, void * buffer, size_t size);
+
+/// @brief writes exactly size bytes, returns false on errors
+bool writeAll(int fd, const void * buffer, size_t size);
+
+/// @brief connects to the compile server, returns socket or -1
+int compileServerConnect(const char * socket_path);
+
+/// @brief sends the program to the server, returns false on errors
+bool sendCompileRequest(int socket_fd, const char * code, size_t code_size, uint32_t flags);
+
+/// @brief receives the response, elf and diagnostics are allocated (diagnostics are zero terminated)
+bool recvCompileResponse(int socket_fd, compile_response_t * response, char ** elf, char ** diag);
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef INTERNER_INCLUDED
+#define INTERNER_INCLUDED
+
+#include <stdlib.h>
+#include <stdint.h>
+
+const size_t INTERNER_CHUNK_SIZE      = 64 * 1024;     //< bytes of names in a chunk, longer names get their own one
+const size_t INTERNER_START_SLOTS_NUM = 64;            //< power of two
+
+const uint32_t INTERNER_NO_ID = UINT32_MAX;
+
+/// @brief slot of the open addressing table, the hash is stored so probing and growing do not touch the names
+typedef struct {
+    uint32_t hash;
+    uint32_t id_plus_one;       //< 0 marks empty slot
+} interner_slot_t;
+
+/// @brief string interner: every distinct name gets 32-bit id (0, 1, 2...) and is stored once,
+///        names never move until reset, so pointers to them can be kept;
+///        zeroed interner is a valid empty one, it allocates its tables on the first name
+typedef struct {
+    char ** chunks;
+    size_t chunks_num;
+    size_t chunks_capacity;
+
+    char * free_pos;            // free bytes of the last chunk
+    size_t free_size;
+
+    const char ** names;        // indexed by id
+    uint32_t * lengths;
+    uint32_t names_num;
+    uint32_t names_capacity;
+
+    interner_slot_t * slots;
+    size_t slots_num;           // power of two, kept at most 3/4 full
+} interner_t;
+
+/// @brief creates empty interner
+interner_t internerCtor();
+
+/// @brief frees the interner and all its names
+void internerDtor(interner_t * interner);
+
+/// @brief forgets all the names, ids start from 0 again
+void internerReset(interner_t * interner);
+
+/// @brief returns id of the name, adds the name if it is new (its id is the number of names before it),
+///        name does not need to end with '\0'
+uint32_t internerIntern(interner_t * interner, const char * name, size_t len);
+
+/// @brief returns id of the name or INTERNER_NO_ID if it is not interned, does not change the interner
+///        (so it can be called from many threads)
+uint32_t internerFind(const interner_t * interner, const char * name, size_t len);
+
+/// @brief returns '\0'-terminated name by its id
+const char * internerName(const interner_t * interner, uint32_t id);
+
+/// @brief returns length of the name by its id
+uint32_t internerLength(const interner_t * interner, uint32_t id);
+
+/// @brief returns number of interned names
+uint32_t internerSize(const interner_t * interner);
+
+#endif
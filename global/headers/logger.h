@@ -4,6 +4,33 @@
 /// @brief different levels of logging, IT IS NECESSARY TO WRITE THEM IN ASCENDING ORDER
 enum loglevels{LOG_RELEASE, LOG_DEBUG, LOG_DEBUG_PLUS};
 
+/// @brief the most verbose level compiled into the program, calls above it are removed with their arguments,
+///        can be set with -D LOG_MAX_LEVEL=LOG_DEBUG
+#ifndef LOG_MAX_LEVEL
+#ifdef _DEBUG
+#define LOG_MAX_LEVEL LOG_DEBUG_PLUS
+#else
+#define LOG_MAX_LEVEL LOG_RELEASE
+#endif
+#endif
+
+/// @brief environment variable that overrides the level passed to logStart: release, debug or debug_plus
+const char * const LOG_LEVEL_ENV_NAME = "LANG_LOG_LEVEL";
+
+/// @brief runtime logging level, read it through logGetLevel, it is accessed atomically as logSetLevel can be
+///        called while the pools log
+extern enum loglevels LOGlevel;
+
+/// @brief true if messages of the level are compiled in and enabled at runtime
+#define logIsEnabled(loglevel) ((loglevel) <= LOG_MAX_LEVEL && (loglevel) <= __atomic_load_n(&LOGlevel, __ATOMIC_RELAXED))
+
+/// @brief formats and prints string to log file, arguments are not evaluated if the level is disabled
+#define logPrint(loglevel, ...)                              \
+        do{                                                  \
+                if (logIsEnabled(loglevel))                  \
+                        logPrintMessage(__VA_ARGS__);        \
+        }while(0)
+
 /// @brief enum with logging modes
 typedef enum
 {
@@ -36,23 +63,30 @@ typedef enum
                 printf("\n");                    \
         }while(0)
 
-/// @brief starts logging, initialises inside vars, opens file
+/// @brief starts logging, initialises inside vars, opens file and starts the writer thread,
+///        must be called before any thread that logs is started
 int  logStart(const char * logfilename, enum loglevels loglevel, log_mode_t mode);
 
-/// @brief formats and prints string to log file
-void logPrint(enum loglevels loglevel, const char * fmt, ...);
+/// @brief formats string to the ring buffer the writer thread drains to log file, can be called from any thread
+void logPrintMessage(const char * fmt, ...) __attribute__((format(printf, 1, 2)));
 
 /// @brief prints current time to log file
 void logPrintTime(enum loglevels loglevel);
 
-/// @brief ends logging, closes file
+/// @brief ends logging, writes the rest of the ring buffer, stops the writer thread and closes file,
+///        also called at exit if the program has not called it; the pools must be finished before it,
+///        so a pool that lives until exit finishes in its own atexit handler registered after logStart
 void logExit(void);
 
-/// @brief cancels buffering in log file
+/// @brief stops the writer thread and makes every message go to log file unbuffered, for debugging crashes,
+///        must be called while no other thread logs
 void logCancelBuffer();
 
 /// @brief returns current logging level
 enum loglevels logGetLevel();
 
+/// @brief changes logging level at runtime, levels above LOG_MAX_LEVEL stay disabled, can be called from any thread
+void logSetLevel(enum loglevels loglevel);
+
 
 #endif
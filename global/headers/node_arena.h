@@ -0,0 +1,38 @@
+#ifndef NODE_ARENA_INCLUDED
+#define NODE_ARENA_INCLUDED
+
+#include "tree.h"
+
+const size_t NODE_ARENA_CHUNK_SIZE = 4096;
+
+/// @brief growable arena of tree nodes, allocated nodes never move
+typedef struct node_arena {
+    node_t ** chunks;
+    size_t chunks_num;
+    size_t chunks_capacity;
+
+    size_t last_chunk_size;     // number of used nodes in the last chunk
+
+    void * mapping;             // mapped binary IR file, its nodes live as long as the arena
+    size_t mapping_size;
+} node_arena_t;
+
+/// @brief creates empty arena
+node_arena_t nodeArenaCtor();
+
+/// @brief frees all the nodes of the arena
+void nodeArenaDtor(node_arena_t * arena);
+
+/// @brief frees all the nodes but keeps the first chunk for the next allocations
+void nodeArenaReset(node_arena_t * arena);
+
+/// @brief returns new zeroed node
+node_t * nodeArenaAlloc(node_arena_t * arena);
+
+/// @brief makes the arena own the mapping (it is unmapped by the destructor)
+void nodeArenaAdoptMapping(node_arena_t * arena, void * mapping, size_t mapping_size);
+
+/// @brief returns number of allocated nodes
+size_t nodeArenaSize(const node_arena_t * arena);
+
+#endif
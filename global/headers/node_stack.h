@@ -0,0 +1,37 @@
+#ifndef NODE_STACK_INCLUDED
+#define NODE_STACK_INCLUDED
+
+#include "tree.h"
+
+const size_t NODE_STACK_START_CAP = 64;
+
+/// @brief frame of iterative tree traversal
+typedef struct {
+    node_t * node;
+    node_t ** slot;             // where the result for the node goes (if traversal rebuilds the tree)
+    size_t state;               // meaning depends on the traversal
+} node_frame_t;
+
+/// @brief growable stack of frames, it replaces the C stack in traversals of very long programs
+typedef struct {
+    node_frame_t * frames;
+    size_t size;
+    size_t capacity;
+} node_stack_t;
+
+/// @brief creates empty stack
+node_stack_t nodeStackCtor();
+
+/// @brief frees the stack
+void nodeStackDtor(node_stack_t * stack);
+
+/// @brief pushes new frame
+void nodeStackPush(node_stack_t * stack, node_t * node, node_t ** slot, size_t state);
+
+/// @brief pops the top frame, stack must not be empty
+node_frame_t nodeStackPop(node_stack_t * stack);
+
+/// @brief returns true if there are no frames
+bool nodeStackEmpty(const node_stack_t * stack);
+
+#endif
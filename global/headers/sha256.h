@@ -0,0 +1,30 @@
+#ifndef SHA256_INCLUDED
+#define SHA256_INCLUDED
+
+#include <stdint.h>
+#include <stdlib.h>
+
+const size_t SHA256_BLOCK_SIZE  = 64;
+const size_t SHA256_DIGEST_SIZE = 32;
+
+typedef struct {
+    uint32_t state[8];
+
+    uint8_t block[SHA256_BLOCK_SIZE];
+    size_t block_size;
+
+    uint64_t total_size;
+} sha256_ctx_t;
+
+sha256_ctx_t sha256Ctor();
+
+/// @brief hashes the next size bytes of the message
+void sha256Update(sha256_ctx_t * ctx, const void * data, size_t size);
+
+/// @brief writes SHA256_DIGEST_SIZE bytes of the digest, context must not be updated after it
+void sha256Final(sha256_ctx_t * ctx, uint8_t * digest);
+
+/// @brief writes 2 * SHA256_DIGEST_SIZE hex digits and zero
+void sha256ToHex(const uint8_t * digest, char * hex);
+
+#endif
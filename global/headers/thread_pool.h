@@ -0,0 +1,30 @@
+#ifndef THREAD_POOL_INCLUDED
+#define THREAD_POOL_INCLUDED
+
+#include <stdlib.h>
+
+/// @brief function executed for every task, worker_index is in [0, workers_num)
+typedef void (* task_func_t)(void * shared, size_t task_index, size_t worker_index);
+
+/// @brief returns number of online processor cores (at least 1)
+size_t getCoresNum();
+
+/// @brief runs func for every task index in [0, tasks_num) on workers_num threads and waits for all of them
+void parallelFor(size_t tasks_num, size_t workers_num, task_func_t func, void * shared);
+
+/// @brief function of a background task
+typedef void (* async_task_func_t)(void * arg);
+
+typedef struct async_pool async_pool_t;
+
+/// @brief starts workers_num threads that run pushed tasks in the background
+/// @return NULL if no thread can be created
+async_pool_t * asyncPoolStart(size_t workers_num);
+
+/// @brief adds task to the queue of the pool, it is run by the first free worker
+void asyncPoolPush(async_pool_t * pool, async_task_func_t func, void * arg);
+
+/// @brief waits for all pushed tasks, stops the workers and frees the pool
+void asyncPoolFinish(async_pool_t * pool);
+
+#endif
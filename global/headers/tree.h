@@ -4,6 +4,8 @@
 #include <stdbool.h>
 #include <stdlib.h>
 
+#include "interner.h"
+
 enum elem_type{
     NUM = 0,
     OPR = 1,
@@ -74,57 +76,60 @@ typedef struct {
     const char * asm_str;
 
     bool can_simple;
+
+    unsigned char precedence;       // of the infix operator in expressions, higher binds tighter, 0 - not infix
+    bool right_assoc;
 } oper_t;
 
-const oper_t opers[] = {
-    {.num = ADD, .name = "+"   , .dot_name = "+",   .binary = true,  .commutative = true , .asm_str = "ADD", .can_simple = true},
-    {.num = SUB, .name = "-"   , .dot_name = "-",   .binary = true,  .commutative = false, .asm_str = "SUB", .can_simple = true},
-    {.num = MUL, .name = "*"   , .dot_name = "*",   .binary = true,  .commutative = true , .asm_str = "MUL", .can_simple = true},
-    {.num = DIV, .name = "/"   , .dot_name = "/",   .binary = true,  .commutative = false, .asm_str = "DIV", .can_simple = true},
-    {.num = POW, .name = "^"   , .dot_name = "^",   .binary = true,  .commutative = false, .asm_str = "POW", .can_simple = true},
-    {.num = SQRT,.name = "sqrt", .dot_name = "sqrt",.binary = false, .commutative = false, .asm_str = "SQRT",.can_simple = false},
-    {.num = SIN, .name = "sin" , .dot_name = "sin", .binary = false, .commutative = false, .asm_str = "SIN", .can_simple = true},
-    {.num = COS, .name = "cos" , .dot_name = "cos", .binary = false, .commutative = false, .asm_str = "COS", .can_simple = true},
-    {.num = TAN, .name = "tan" , .dot_name = "tan", .binary = false, .commutative = false, .asm_str = "TAN", .can_simple = true},
-    {.num = LN , .name = "ln"  , .dot_name = "ln",  .binary = false, .commutative = false, .asm_str = "LN" , .can_simple = true},
-    {.num = LOG, .name = "log" , .dot_name = "log", .binary = true,  .commutative = false, .asm_str = NULL, .can_simple = false},
-    {.num = FAC, .name = "!"   , .dot_name = "!",   .binary = false, .commutative = false, .asm_str = NULL, .can_simple = false},
-
-    {.num = GREATER,    .name = ">"  , .dot_name = "GREATER",    .binary = true, .commutative = false, .asm_str = "CALL __GREATER_OP__:", .can_simple = false},
-    {.num = LESS   ,    .name = "<"  , .dot_name = "LESS",       .binary = true, .commutative = false, .asm_str = "CALL __LESS_OP__:", .can_simple = false},
-    {.num = GREATER_EQ, .name = ">=" , .dot_name = "GREATER_EQ", .binary = true, .commutative = false, .asm_str = "CALL __GREATER_EQ_OP__:", .can_simple = false},
-    {.num = LESS_EQ   , .name = "<=" , .dot_name = "LESS_EQ",    .binary = true, .commutative = false, .asm_str = "CALL __LESS_EQ_OP__:", .can_simple = false},
-    {.num = EQUAL   ,   .name = "==" , .dot_name = "EQUAL",      .binary = true, .commutative = false, .asm_str = "CALL __EQUAL_OP__:", .can_simple = false},
-    {.num = N_EQUAL   , .name = "!=" , .dot_name = "N_EQUAL",    .binary = true, .commutative = false, .asm_str = "CALL __N_EQUAL_OP__:", .can_simple = false},
-
-    {.num = IN , .name = "in" , .dot_name = "in" , .binary = false, .commutative = false, .asm_str = NULL, .can_simple = false},
-    {.num = OUT, .name = "out", .dot_name = "out", .binary = false, .commutative = false, .asm_str = NULL, .can_simple = false},
-
-    {.num = LBRACKET, .name = "(", .dot_name = "(", .binary = false, .commutative = false, .asm_str = NULL, .can_simple = false},
-    {.num = RBRACKET, .name = ")", .dot_name = ")", .binary = false, .commutative = false, .asm_str = NULL, .can_simple = false},
-
-    {.num = IF,      .name = "if"   , .dot_name = "if",   .binary = true, .commutative = false, .asm_str = NULL, .can_simple = false},
-    {.num = IF_ELSE, .name = "else" , .dot_name = "else", .binary = true, .commutative = false, .asm_str = NULL, .can_simple = false},
-
-    {.num = WHILE, .name = "while", .dot_name = "while", .binary = true, .commutative = false, .asm_str = NULL, .can_simple = false},
-
-    {.num = VAR_DECL, .name = "var", .dot_name = "var", .binary = false, .commutative = false, .asm_str = NULL, .can_simple = false},
-
-    {.num = CALL,        .name = NULL,     .dot_name = "CALL",        .binary = true,  .commutative = false, .asm_str = NULL, .can_simple = false},
-    {.num = FUNC_DECL,   .name = "func",   .dot_name = "func",        .binary = true,  .commutative = false, .asm_str = NULL, .can_simple = false},
-    {.num = FUNC_HEADER, .name = NULL,     .dot_name = "FUNC_HEADER", .binary = true,  .commutative = false, .asm_str = NULL, .can_simple = false},
-    {.num = ARG_SEP,     .name = ",",      .dot_name = "ARG_SEP",     .binary = true,  .commutative = false, .asm_str = NULL, .can_simple = false},
-    {.num = RETURN,      .name = "return", .dot_name = "RETURN",      .binary = false, .commutative = false, .asm_str = NULL, .can_simple = false},
-
-    { .num = BEGIN,  .name = "begin", .dot_name = "begin", .binary = false, .commutative = false, .asm_str = NULL, .can_simple = false},
-    { .num = ENDING, .name = "end"  , .dot_name = "end"  , .binary = false, .commutative = false, .asm_str = NULL, .can_simple = false},
-
-    {.num = ASSIGN  , .name = "="  , .dot_name = "="  , .binary = true , .commutative = false, .asm_str = NULL, .can_simple = false},
-    {.num = SEP     , .name = ";"  , .dot_name = "SEP", .binary = true , .commutative = false, .asm_str = NULL, .can_simple = false},
-    {.num = TEXT    , .name = "text"   , .dot_name = "TEXT",  .binary = false , .commutative = false, .asm_str = NULL, .can_simple = false},
+constexpr oper_t opers[] = {
+    {.num = ADD, .name = "+"   , .dot_name = "+",   .binary = true,  .commutative = true , .asm_str = "ADD", .can_simple = true, .precedence = 2, .right_assoc = false},
+    {.num = SUB, .name = "-"   , .dot_name = "-",   .binary = true,  .commutative = false, .asm_str = "SUB", .can_simple = true, .precedence = 2, .right_assoc = false},
+    {.num = MUL, .name = "*"   , .dot_name = "*",   .binary = true,  .commutative = true , .asm_str = "MUL", .can_simple = true, .precedence = 3, .right_assoc = false},
+    {.num = DIV, .name = "/"   , .dot_name = "/",   .binary = true,  .commutative = false, .asm_str = "DIV", .can_simple = true, .precedence = 3, .right_assoc = false},
+    {.num = POW, .name = "^"   , .dot_name = "^",   .binary = true,  .commutative = false, .asm_str = "POW", .can_simple = true, .precedence = 4, .right_assoc = true},
+    {.num = SQRT,.name = "sqrt", .dot_name = "sqrt",.binary = false, .commutative = false, .asm_str = "SQRT",.can_simple = false, .precedence = 0, .right_assoc = false},
+    {.num = SIN, .name = "sin" , .dot_name = "sin", .binary = false, .commutative = false, .asm_str = "SIN", .can_simple = true, .precedence = 0, .right_assoc = false},
+    {.num = COS, .name = "cos" , .dot_name = "cos", .binary = false, .commutative = false, .asm_str = "COS", .can_simple = true, .precedence = 0, .right_assoc = false},
+    {.num = TAN, .name = "tan" , .dot_name = "tan", .binary = false, .commutative = false, .asm_str = "TAN", .can_simple = true, .precedence = 0, .right_assoc = false},
+    {.num = LN , .name = "ln"  , .dot_name = "ln",  .binary = false, .commutative = false, .asm_str = "LN" , .can_simple = true, .precedence = 0, .right_assoc = false},
+    {.num = LOG, .name = "log" , .dot_name = "log", .binary = true,  .commutative = false, .asm_str = NULL, .can_simple = false, .precedence = 0, .right_assoc = false},
+    {.num = FAC, .name = "!"   , .dot_name = "!",   .binary = false, .commutative = false, .asm_str = NULL, .can_simple = false, .precedence = 0, .right_assoc = false},
+
+    {.num = GREATER,    .name = ">"  , .dot_name = "GREATER",    .binary = true, .commutative = false, .asm_str = "CALL __GREATER_OP__:", .can_simple = false, .precedence = 1, .right_assoc = false},
+    {.num = LESS   ,    .name = "<"  , .dot_name = "LESS",       .binary = true, .commutative = false, .asm_str = "CALL __LESS_OP__:", .can_simple = false, .precedence = 1, .right_assoc = false},
+    {.num = GREATER_EQ, .name = ">=" , .dot_name = "GREATER_EQ", .binary = true, .commutative = false, .asm_str = "CALL __GREATER_EQ_OP__:", .can_simple = false, .precedence = 1, .right_assoc = false},
+    {.num = LESS_EQ   , .name = "<=" , .dot_name = "LESS_EQ",    .binary = true, .commutative = false, .asm_str = "CALL __LESS_EQ_OP__:", .can_simple = false, .precedence = 1, .right_assoc = false},
+    {.num = EQUAL   ,   .name = "==" , .dot_name = "EQUAL",      .binary = true, .commutative = false, .asm_str = "CALL __EQUAL_OP__:", .can_simple = false, .precedence = 1, .right_assoc = false},
+    {.num = N_EQUAL   , .name = "!=" , .dot_name = "N_EQUAL",    .binary = true, .commutative = false, .asm_str = "CALL __N_EQUAL_OP__:", .can_simple = false, .precedence = 1, .right_assoc = false},
+
+    {.num = IN , .name = "in" , .dot_name = "in" , .binary = false, .commutative = false, .asm_str = NULL, .can_simple = false, .precedence = 0, .right_assoc = false},
+    {.num = OUT, .name = "out", .dot_name = "out", .binary = false, .commutative = false, .asm_str = NULL, .can_simple = false, .precedence = 0, .right_assoc = false},
+
+    {.num = LBRACKET, .name = "(", .dot_name = "(", .binary = false, .commutative = false, .asm_str = NULL, .can_simple = false, .precedence = 0, .right_assoc = false},
+    {.num = RBRACKET, .name = ")", .dot_name = ")", .binary = false, .commutative = false, .asm_str = NULL, .can_simple = false, .precedence = 0, .right_assoc = false},
+
+    {.num = IF,      .name = "if"   , .dot_name = "if",   .binary = true, .commutative = false, .asm_str = NULL, .can_simple = false, .precedence = 0, .right_assoc = false},
+    {.num = IF_ELSE, .name = "else" , .dot_name = "else", .binary = true, .commutative = false, .asm_str = NULL, .can_simple = false, .precedence = 0, .right_assoc = false},
+
+    {.num = WHILE, .name = "while", .dot_name = "while", .binary = true, .commutative = false, .asm_str = NULL, .can_simple = false, .precedence = 0, .right_assoc = false},
+
+    {.num = VAR_DECL, .name = "var", .dot_name = "var", .binary = false, .commutative = false, .asm_str = NULL, .can_simple = false, .precedence = 0, .right_assoc = false},
+
+    {.num = CALL,        .name = NULL,     .dot_name = "CALL",        .binary = true,  .commutative = false, .asm_str = NULL, .can_simple = false, .precedence = 0, .right_assoc = false},
+    {.num = FUNC_DECL,   .name = "func",   .dot_name = "func",        .binary = true,  .commutative = false, .asm_str = NULL, .can_simple = false, .precedence = 0, .right_assoc = false},
+    {.num = FUNC_HEADER, .name = NULL,     .dot_name = "FUNC_HEADER", .binary = true,  .commutative = false, .asm_str = NULL, .can_simple = false, .precedence = 0, .right_assoc = false},
+    {.num = ARG_SEP,     .name = ",",      .dot_name = "ARG_SEP",     .binary = true,  .commutative = false, .asm_str = NULL, .can_simple = false, .precedence = 0, .right_assoc = false},
+    {.num = RETURN,      .name = "return", .dot_name = "RETURN",      .binary = false, .commutative = false, .asm_str = NULL, .can_simple = false, .precedence = 0, .right_assoc = false},
+
+    { .num = BEGIN,  .name = "begin", .dot_name = "begin", .binary = false, .commutative = false, .asm_str = NULL, .can_simple = false, .precedence = 0, .right_assoc = false},
+    { .num = ENDING, .name = "end"  , .dot_name = "end"  , .binary = false, .commutative = false, .asm_str = NULL, .can_simple = false, .precedence = 0, .right_assoc = false},
+
+    {.num = ASSIGN  , .name = "="  , .dot_name = "="  , .binary = true , .commutative = false, .asm_str = NULL, .can_simple = false, .precedence = 0, .right_assoc = false},
+    {.num = SEP     , .name = ";"  , .dot_name = "SEP", .binary = true , .commutative = false, .asm_str = NULL, .can_simple = false, .precedence = 0, .right_assoc = false},
+    {.num = TEXT    , .name = "text"   , .dot_name = "TEXT",  .binary = false , .commutative = false, .asm_str = NULL, .can_simple = false, .precedence = 0, .right_assoc = false},
 
     //! must be the last!!!
-    {.num = NO_OP   , .name = "_NO_NAME_", .dot_name = "NO_OP", .binary = false , .commutative = false, .asm_str = NULL, .can_simple = false}
+    {.num = NO_OP   , .name = "_NO_NAME_", .dot_name = "NO_OP", .binary = false , .commutative = false, .asm_str = NULL, .can_simple = false, .precedence = 0, .right_assoc = false}
 };
 const size_t opers_size = sizeof(opers) / sizeof(*opers);
 
@@ -134,10 +139,9 @@ union value {
     enum oper op;
 };
 
+// NOTE: only hot fields live here (32 bytes, two nodes per cache line),
+//       source positions belong to tokens of the frontend
 typedef struct node {
-    size_t line_num;
-    size_t char_count;
-
     enum elem_type type;
     union value val;
 
@@ -145,7 +149,7 @@ typedef struct node {
     struct node * right;
 } node_t;
 
-const size_t NAME_MAX_LENGTH = 64;
+const size_t NAME_MAX_LENGTH = 64;      //< names are shorter, symbols of the objects keep them in arrays
 
 enum id_type {
     VAR,
@@ -153,7 +157,7 @@ enum id_type {
 };
 
 typedef struct {
-    char name[NAME_MAX_LENGTH];
+    const char * name;         // interned, lives as long as the interner of the tree or of the frontend
     enum id_type type;         // is VAR by default
 
     // for functions
@@ -161,17 +165,29 @@ typedef struct {
     size_t IR_index;
 } idr_t;
 
+typedef struct node_arena node_arena_t;
+
 typedef struct {
-    node_t * cur_node;
+    node_arena_t * arena;       // nodes of the read tree are allocated here
 
     idr_t * ids;
     unsigned int id_size;
+
+    interner_t names;           // names of the ids read from IR, the reader takes them with the ids
 } tree_context_t;
 
-void printTreePrefix(tree_context_t * tr, node_t * node);
+void printTreePrefix(tree_context_t * tr, node_t * root);
+
+/// @brief enables graph dumps, they are off by default because rendering is slow
+void treeGraphDumpsEnable(bool enable);
 
+/// @brief writes the tree to log_folder/dots/ and puts its image to the log, does nothing if dumps are disabled;
+///        the image is rendered by dot in the background, call treeGraphDumpsWait before exit
 void treeDumpGraph(tree_context_t * tree, node_t * root_node, const char * log_folder);
 
+/// @brief waits until all images of the dumped graphs are rendered
+void treeGraphDumpsWait();
+
 void treeMakeDot(tree_context_t * tr, node_t * node, FILE * dot_file);
 
 #endif
@@ -0,0 +1,372 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "IR_binary.h"
+#include "node_arena.h"
+#include "node_stack.h"
+#include "logger.h"
+
+const size_t BIN_NODES_START_CAP = 256;
+
+const size_t ROOT_LINK_SLOT = SIZE_MAX;
+
+typedef struct {
+    ir_bin_node_t * nodes;
+    size_t size;
+    size_t capacity;
+} bin_nodes_t;
+
+static bool checkBinaryHeader(const ir_bin_header_t * header, size_t file_size);
+
+static bool readBinaryNameTable(tree_context_t * tree, const char * file_start, const ir_bin_header_t * header);
+
+static bool linkBinaryNodes(ir_bin_node_t * nodes, size_t nodes_num, unsigned int ids_num);
+
+static void flattenTree(bin_nodes_t * flat, node_t * root);
+
+static void writeBinaryPadding(FILE * out_file, size_t cur_offset, size_t align);
+
+bool isBinaryIRfile(const char * file_name)
+{
+    assert(file_name);
+
+    FILE * file = fopen(file_name, "rb");
+    if (file == NULL)
+        return false;
+
+    char magic[IR_BIN_MAGIC_LEN] = {};
+    size_t read_len = fread(magic, 1, IR_BIN_MAGIC_LEN, file);
+
+    fclose(file);
+
+    return read_len == IR_BIN_MAGIC_LEN && memcmp(magic, IR_BIN_MAGIC, IR_BIN_MAGIC_LEN) == 0;
+}
+
+bool hasBinaryIRextension(const char * file_name)
+{
+    assert(file_name);
+
+    size_t name_len = strlen(file_name);
+    size_t ext_len  = strlen(IR_BIN_EXTENSION);
+
+    return name_len >= ext_len && strcmp(file_name + name_len - ext_len, IR_BIN_EXTENSION) == 0;
+}
+
+node_t * readTreeFromBinaryIR(tree_context_t * tree, const char * file_name)
+{
+    assert(tree);
+    assert(tree->arena);
+    assert(file_name);
+
+    logPrint(LOG_DEBUG, "mapping binary IR\n");
+
+    int fd = open(file_name, O_RDONLY);
+    if (fd < 0){
+        fprintf(stderr, "ERROR: cannot open '%s'\n", file_name);
+        return NULL;
+    }
+
+    struct stat st = {};
+    fstat(fd, &st);
+
+    size_t file_size = (size_t)st.st_size;
+
+    if (file_size < sizeof(ir_bin_header_t)){
+        close(fd);
+        fprintf(stderr, "ERROR: binary IR is too short\n");
+
+        return NULL;
+    }
+
+    // private mapping: links are turned into pointers in our copy of the pages, the file stays untouched
+    void * mapping = mmap(NULL, file_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (mapping == MAP_FAILED){
+        fprintf(stderr, "ERROR: cannot map '%s'\n", file_name);
+        return NULL;
+    }
+
+    char * file_start = (char *)mapping;
+    const ir_bin_header_t * header = (const ir_bin_header_t *)mapping;
+
+    if (! checkBinaryHeader(header, file_size) || ! readBinaryNameTable(tree, file_start, header)){
+        munmap(mapping, file_size);
+
+        logPrint(LOG_RELEASE, "ERROR: invalid binary IR\n");
+        fprintf(stderr, "ERROR: invalid binary IR\n");
+
+        return NULL;
+    }
+
+    ir_bin_node_t * nodes = (ir_bin_node_t *)(file_start + header->nodes_offset);
+    size_t nodes_num = header->nodes_num;
+    uint64_t root_link = header->root;
+
+    if (! linkBinaryNodes(nodes, nodes_num, tree->id_size)){
+        munmap(mapping, file_size);
+
+        free(tree->ids);
+        tree->ids = NULL;
+        tree->id_size = 0;
+        internerDtor(&tree->names);
+
+        logPrint(LOG_RELEASE, "ERROR: invalid links in binary IR\n");
+        fprintf(stderr, "ERROR: invalid links in binary IR\n");
+
+        return NULL;
+    }
+
+    nodeArenaAdoptMapping(tree->arena, mapping, file_size);
+
+    logPrint(LOG_DEBUG, "mapped %zu nodes\n", nodes_num);
+
+    if (root_link == 0)
+        return NULL;
+
+    return (node_t *)(nodes + root_link - 1);
+}
+
+static bool checkBinaryHeader(const ir_bin_header_t * header, size_t file_size)
+{
+    assert(header);
+
+    if (memcmp(header->magic, IR_BIN_MAGIC, IR_BIN_MAGIC_LEN) != 0)
+        return false;
+
+    if (header->version != IR_BIN_VERSION){
+        fprintf(stderr, "ERROR: binary IR version %u is not supported (expected %u)\n", header->version, IR_BIN_VERSION);
+        return false;
+    }
+
+    if (header->ids_offset > file_size || header->ids_num > (file_size - header->ids_offset) / sizeof(ir_bin_id_t))
+        return false;
+
+    if (header->strings_offset > file_size || header->strings_size > file_size - header->strings_offset)
+        return false;
+
+    if (header->nodes_offset % alignof(node_t) != 0 || header->nodes_offset > file_size ||
+        header->nodes_num > (file_size - header->nodes_offset) / sizeof(ir_bin_node_t))
+        return false;
+
+    if (header->root > header->nodes_num)
+        return false;
+
+    return true;
+}
+
+static bool readBinaryNameTable(tree_context_t * tree, const char * file_start, const ir_bin_header_t * header)
+{
+    assert(tree);
+    assert(file_start);
+    assert(header);
+
+    const ir_bin_id_t * bin_ids = (const ir_bin_id_t *)(file_start + header->ids_offset);
+    const char * strings = file_start + header->strings_offset;
+
+    tree->ids = (idr_t *)calloc(header->ids_num, sizeof(idr_t));
+    tree->id_size = header->ids_num;
+
+    for (size_t id_index = 0; id_index < header->ids_num; id_index++){
+        size_t name_offset = bin_ids[id_index].name_offset;
+
+        if (name_offset >= header->strings_size ||
+            memchr(strings + name_offset, '\0', header->strings_size - name_offset) == NULL){
+            free(tree->ids);
+            tree->ids = NULL;
+            tree->id_size = 0;
+            internerDtor(&tree->names);
+
+            return false;
+        }
+
+        const char * name = strings + name_offset;
+        tree->ids[id_index].name = internerName(&tree->names, internerIntern(&tree->names, name, strnlen(name, NAME_MAX_LENGTH - 1)));
+
+        tree->ids[id_index].type = (bin_ids[id_index].type == FUNC) ? FUNC : VAR;
+        tree->ids[id_index].num_of_args = bin_ids[id_index].num_of_args;
+    }
+
+    return true;
+}
+
+// nodes are in preorder, so every link points forward and the tree cannot have cycles
+static bool linkBinaryNodes(ir_bin_node_t * nodes, size_t nodes_num, unsigned int ids_num)
+{
+    assert(nodes || nodes_num == 0);
+
+    node_t * linked = (node_t *)nodes;
+
+    for (size_t node_index = 0; node_index < nodes_num; node_index++){
+        ir_bin_node_t * node = nodes + node_index;
+
+        uint64_t left  = node->left;
+        uint64_t right = node->right;
+
+        if ((left  != 0 && (left  <= node_index + 1 || left  > nodes_num)) ||
+            (right != 0 && (right <= node_index + 1 || right > nodes_num)))
+            return false;
+
+        switch (node->type){
+            case NUM:
+                break;
+            case IDR:
+                if (node->val.id >= ids_num)
+                    return false;
+                break;
+            case OPR:
+                if (node->val.op < ADD || node->val.op > NO_OP)
+                    return false;
+                break;
+            case END:
+            default:
+                return false;
+        }
+
+        linked[node_index].left  = (left  == 0) ? NULL : linked + left  - 1;
+        linked[node_index].right = (right == 0) ? NULL : linked + right - 1;
+    }
+
+    return true;
+}
+
+void writeTreeToBinaryFile(tree_context_t * tree, node_t * root, FILE * out_file)
+{
+    assert(tree);
+    assert(out_file);
+
+    bin_nodes_t flat = {};
+    flattenTree(&flat, root);
+
+    // string table
+    size_t strings_size = 0;
+    for (size_t id_index = 0; id_index < tree->id_size; id_index++)
+        strings_size += strlen(tree->ids[id_index].name) + 1;
+
+    ir_bin_header_t header = {};
+
+    memcpy(header.magic, IR_BIN_MAGIC, IR_BIN_MAGIC_LEN);
+    header.version = IR_BIN_VERSION;
+    header.ids_num = tree->id_size;
+
+    header.nodes_num = flat.size;
+    header.root = (flat.size == 0) ? 0 : 1;
+
+    header.ids_offset     = sizeof(header);
+    header.strings_offset = header.ids_offset + tree->id_size * sizeof(ir_bin_id_t);
+    header.strings_size   = strings_size;
+
+    size_t strings_end = header.strings_offset + strings_size;
+    header.nodes_offset = (strings_end + IR_BIN_NODES_ALIGN - 1) / IR_BIN_NODES_ALIGN * IR_BIN_NODES_ALIGN;
+
+    fwrite(&header, sizeof(header), 1, out_file);
+
+    uint32_t name_offset = 0;
+    for (size_t id_index = 0; id_index < tree->id_size; id_index++){
+        ir_bin_id_t bin_id = {};
+
+        bin_id.name_offset = name_offset;
+        bin_id.type = tree->ids[id_index].type;
+        bin_id.num_of_args = tree->ids[id_index].num_of_args;
+
+        fwrite(&bin_id, sizeof(bin_id), 1, out_file);
+
+        name_offset += (uint32_t)strlen(tree->ids[id_index].name) + 1;
+    }
+
+    for (size_t id_index = 0; id_index < tree->id_size; id_index++)
+        fwrite(tree->ids[id_index].name, 1, strlen(tree->ids[id_index].name) + 1, out_file);
+
+    writeBinaryPadding(out_file, strings_end, IR_BIN_NODES_ALIGN);
+
+    fwrite(flat.nodes, sizeof(*flat.nodes), flat.size, out_file);
+
+    free(flat.nodes);
+}
+
+// nodes are numbered in preorder, frame state is the link to fill: 2 * parent_index + (right child ? 1 : 0)
+static void flattenTree(bin_nodes_t * flat, node_t * root)
+{
+    assert(flat);
+
+    if (root == NULL)
+        return;
+
+    flat->nodes = (ir_bin_node_t *)calloc(BIN_NODES_START_CAP, sizeof(*flat->nodes));
+    flat->capacity = BIN_NODES_START_CAP;
+    flat->size = 0;
+
+    node_stack_t stack = nodeStackCtor();
+    nodeStackPush(&stack, root, NULL, ROOT_LINK_SLOT);
+
+    while (! nodeStackEmpty(&stack)){
+        node_frame_t frame = nodeStackPop(&stack);
+        node_t * node = frame.node;
+
+        if (flat->size >= flat->capacity){
+            flat->capacity *= 2;
+            flat->nodes = (ir_bin_node_t *)realloc(flat->nodes, flat->capacity * sizeof(*flat->nodes));
+        }
+
+        size_t node_index = flat->size;
+        flat->size++;
+
+        ir_bin_node_t * bin_node = flat->nodes + node_index;
+
+        bin_node->type = node->type;
+        bin_node->reserved = 0;
+        bin_node->left  = 0;
+        bin_node->right = 0;
+
+        // only the used member is copied, so the file does not depend on garbage in the rest of the union
+        bin_node->val = {};
+        switch (node->type){
+            case NUM:
+                bin_node->val.number = node->val.number;
+                break;
+            case IDR:
+                bin_node->val.id = node->val.id;
+                break;
+            case OPR:
+                bin_node->val.op = node->val.op;
+                break;
+            case END:
+            default:
+                break;
+        }
+
+        if (frame.state != ROOT_LINK_SLOT){
+            ir_bin_node_t * parent = flat->nodes + frame.state / 2;
+
+            if (frame.state % 2 == 0)
+                parent->left  = node_index + 1;
+            else
+                parent->right = node_index + 1;
+        }
+
+        if (node->right != NULL)
+            nodeStackPush(&stack, node->right, NULL, 2 * node_index + 1);
+        if (node->left != NULL)
+            nodeStackPush(&stack, node->left,  NULL, 2 * node_index);
+    }
+
+    nodeStackDtor(&stack);
+}
+
+static void writeBinaryPadding(FILE * out_file, size_t cur_offset, size_t align)
+{
+    assert(out_file);
+
+    while (cur_offset % align != 0){
+        fputc('\0', out_file);
+        cur_offset++;
+    }
+}
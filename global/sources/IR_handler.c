@@ -2,261 +2,710 @@
 #include <stdio.h>
 #include <assert.h>
 #include <string.h>
+#include <stdint.h>
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <unistd.h>
 
 #include "IR_handler.h"
+#include "IR_binary.h"
+#include "node_arena.h"
+#include "node_stack.h"
 #include "logger.h"
 
 const char * const SIGN_STRING  = "IR312:1";
-const size_t SIGN_MAX_LEN = 32;
-const size_t BUFFER_LEN   = 32;
+
+const size_t PROGRAM_TEXT_CHUNK_SIZE = 64 * 1024;      // pipes are read by chunks of this size
+
+const size_t ELEM_TYPE_TAG_LEN = 3;         // NUM, IDR, OPR
+
+// integers below 10^15 and powers of ten up to 10^22 are exact doubles
+const size_t MAX_EXACT_DIGITS = 15;
+const double POWERS_OF_TEN[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// perfect hash of oper_IR_names: (first + last_mul * last + len_mul * length) % OPER_IR_HASH_SIZE,
+// the table is built from oper_IR_names by the compiler, a new IR name needs no changes here
+const size_t OPER_IR_HASH_SIZE    = 64;
+const size_t OPER_IR_HASH_MAX_MUL = 64;     //< bound of the search of the hash parameters
+
+typedef struct {
+    size_t last_mul;
+    size_t len_mul;
+
+    enum oper opers[OPER_IR_HASH_SIZE];     //< operator of the name in the slot, NO_OP if the slot is empty
+
+    bool found;
+} oper_IR_hash_t;
+
+constexpr size_t constIRnameLen(const char * name)
+{
+    size_t len = 0;
+    while (name[len] != '\0')
+        len++;
+
+    return len;
+}
+
+constexpr size_t operIRhash(unsigned char first, unsigned char last, size_t len, size_t last_mul, size_t len_mul)
+{
+    return (first + last_mul * last + len_mul * len) % OPER_IR_HASH_SIZE;
+}
+
+constexpr oper_IR_hash_t makeOperIRhash()
+{
+    for (size_t last_mul = 1; last_mul < OPER_IR_HASH_MAX_MUL; last_mul++){
+        for (size_t len_mul = 0; len_mul < OPER_IR_HASH_MAX_MUL; len_mul++){
+            oper_IR_hash_t hash = {last_mul, len_mul, {}, true};
+
+            for (size_t slot = 0; slot < OPER_IR_HASH_SIZE; slot++)
+                hash.opers[slot] = NO_OP;
+
+            // NO_OP is the empty slot, its name is never looked up
+            for (size_t op = 0; op < NO_OP && hash.found; op++){
+                const char * name = oper_IR_names[op];
+                if (name == NULL)
+                    continue;
+
+                size_t len = constIRnameLen(name);
+                size_t slot = operIRhash((unsigned char)name[0], (unsigned char)name[len - 1], len, last_mul, len_mul);
+
+                if (hash.opers[slot] != NO_OP)
+                    hash.found = false;
+
+                hash.opers[slot] = (enum oper)op;
+            }
+
+            if (hash.found)
+                return hash;
+        }
+    }
+
+    return {0, 0, {}, false};
+}
+
+constexpr oper_IR_hash_t OPER_IR_HASH = makeOperIRhash();
+
+static_assert(OPER_IR_HASH.found, "no perfect hash of oper_IR_names, increase OPER_IR_HASH_SIZE");
+
+// text IR is read in a single pass, tokens are scanned in place
+typedef struct {
+    const char * pos;
+    const char * end;
+} ir_scanner_t;
+
+const char TMP_FILE_SUFFIX[] = ".tmp";
+
+static void writeTreeToTextFile(tree_context_t * tree, node_t * root, FILE * out_file);
 
 static void writeNameTable(tree_context_t * tree, FILE * out_file);
 
-static void writeTreeToFileRecursive(tree_context_t * tree, node_t * node, FILE * out_file, const size_t tab_num);
+static void writeTreeToFileIterative(tree_context_t * tree, node_t * root, FILE * out_file);
 
 static size_t getFileSize(const char * file_name);
 
-static int readSignature(tree_context_t * tree, const char ** cur_pos);
+static bool readSignature(ir_scanner_t * scanner);
+
+static bool readNameTable(tree_context_t * tree, ir_scanner_t * scanner);
+
+static bool readTreeFromIRiterative(tree_context_t * tree, ir_scanner_t * scanner, node_t ** root);
+
+static bool readNodeFromIR(tree_context_t * tree, ir_scanner_t * scanner, node_t ** node_slot);
+
+static size_t hashOperIRname(const char * name, size_t name_len);
 
-static node_t * readTreeFromIRrecursive(tree_context_t * tree, const char ** cur_pos);
+static void scanSpaces(ir_scanner_t * scanner);
 
-static int readNameTable(tree_context_t * tree, const char ** cur_pos);
+static bool scanChar(ir_scanner_t * scanner, char symbol);
 
-char * readProgramText(const char * file_name)
+static bool scanKeyword(ir_scanner_t * scanner, const char * keyword);
+
+static size_t scanIdentifier(ir_scanner_t * scanner, const char ** word);
+
+static bool scanUnsigned(ir_scanner_t * scanner, size_t * value);
+
+static bool scanNumber(ir_scanner_t * scanner, double * number);
+
+static size_t scanQuoted(ir_scanner_t * scanner, const char ** str);
+
+bool programTextOpen(program_text_t * program, const char * file_name)
 {
+    assert(program);
     assert(file_name);
 
     logPrint(LOG_DEBUG, "reading program text\n");
 
-    FILE * file = fopen(file_name, "r");
-    assert(file);
+    *program = {};
+
+    bool from_stdin = (strcmp(file_name, "-") == 0);
 
-    size_t file_len = getFileSize(file_name) + 1;
+    int fd = from_stdin ? STDIN_FILENO : open(file_name, O_RDONLY);
+    if (fd < 0)
+        return false;
 
-    logPrint(LOG_DEBUG, "file size: %zu\n", file_len);
+    struct stat st = {};
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)){
+        size_t file_size = (size_t)st.st_size;
+        size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
 
-    char * code_str = (char *)calloc(file_len, sizeof(*code_str));
-    fread(code_str, sizeof(*code_str), file_len, file);
+        // zero pages reserve at least one byte after the text, the file is mapped over their beginning
+        size_t mapping_size = (file_size / page_size + 1) * page_size;
 
-    fclose(file);
+        void * mapping = mmap(NULL, mapping_size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if (mapping != MAP_FAILED && file_size != 0 &&
+            mmap(mapping, file_size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED){
+            munmap(mapping, mapping_size);
+            mapping = MAP_FAILED;
+        }
+
+        if (mapping != MAP_FAILED){
+            madvise(mapping, mapping_size, MADV_SEQUENTIAL);
+
+            if (!from_stdin)
+                close(fd);
+
+            program->text = (char *)mapping;
+            program->size = file_size;
+            program->mapping_size = mapping_size;
+
+            logPrint(LOG_DEBUG, "file size: %zu (mapped)\n", file_size);
+
+            return true;
+        }
+    }
+
+    // pipe or a file that cannot be mapped
+    size_t capacity = PROGRAM_TEXT_CHUNK_SIZE;
+    size_t size = 0;
+    char * text = (char *)calloc(capacity + 1, sizeof(*text));
+
+    ssize_t read_size = 0;
+    while ((read_size = read(fd, text + size, capacity - size)) > 0){
+        size += (size_t)read_size;
+
+        if (size == capacity){
+            capacity *= 2;
+            text = (char *)realloc(text, capacity + 1);
+        }
+    }
+
+    if (!from_stdin)
+        close(fd);
+
+    if (read_size < 0){
+        free(text);
+        return false;
+    }
+
+    text[size] = '\0';
+
+    program->text = text;
+    program->size = size;
 
-    return code_str;
+    logPrint(LOG_DEBUG, "file size: %zu (read)\n", size);
+
+    return true;
+}
+
+void programTextClose(program_text_t * program)
+{
+    assert(program);
+
+    if (program->mapping_size != 0)
+        munmap(program->text, program->mapping_size);
+    else
+        free(program->text);
+
+    *program = {};
 }
 
 node_t * readTreeFromIR(tree_context_t * tree, const char * file_name)
 {
     assert(file_name);
     assert(tree);
+    assert(tree->arena);
 
     logPrint(LOG_DEBUG, "reading tree from IR\n");
 
-    size_t file_len = getFileSize(file_name) + 1;
+    if (isBinaryIRfile(file_name))
+        return readTreeFromBinaryIR(tree, file_name);
+
+    size_t file_len = getFileSize(file_name);
 
-    FILE * file = fopen(file_name, "r");
+    FILE * file = fopen(file_name, "rb");
     assert(file);
 
-    char * buffer = (char *)calloc(file_len, sizeof(*buffer));
-    fread(buffer, sizeof(*buffer), file_len, file);
+    // zero after the text stops strtod in the slow path of scanNumber
+    char * buffer = (char *)calloc(file_len + 1, sizeof(*buffer));
+    file_len = fread(buffer, sizeof(*buffer), file_len, file);
 
     fclose(file);
 
-    const char * cur_pos = buffer;
+    ir_scanner_t scanner = {};
+    scanner.pos = buffer;
+    scanner.end = buffer + file_len;
 
-    // checking signature
-    if (! readSignature(tree, &cur_pos)){
+    node_t * root = NULL;
+
+    if (! readSignature(&scanner)){
         logPrint(LOG_RELEASE, "ERROR: invalid signature\n");
         fprintf(stderr, "ERROR: invalid signature\n");
-
-        return NULL;
     }
-
-    // reading name table
-    if (! readNameTable(tree, &cur_pos)){
+    else if (! readNameTable(tree, &scanner)){
         logPrint(LOG_RELEASE, "ERROR: cannot read name table\n");
         fprintf(stderr, "ERROR: cannot read name table\n");
-
-        return NULL;
     }
+    else if (! readTreeFromIRiterative(tree, &scanner, &root)){
+        logPrint(LOG_RELEASE, "ERROR: invalid IR at offset %zu\n", (size_t)(scanner.pos - buffer));
+        fprintf(stderr, "ERROR: invalid IR at offset %zu\n", (size_t)(scanner.pos - buffer));
 
-    // reading tree
-    node_t * root = readTreeFromIRrecursive(tree, &cur_pos);
+        root = NULL;
+    }
 
     free(buffer);
 
     return root;
 }
 
-static int readSignature(tree_context_t * tree, const char ** cur_pos)
+static bool readSignature(ir_scanner_t * scanner)
 {
-    assert(tree);
-    assert(cur_pos);
-    assert(*cur_pos);
+    assert(scanner);
 
-    char sign_str[SIGN_MAX_LEN] = "";
+    size_t sign_len = strlen(SIGN_STRING);
 
-    int shift = 0;
-    sscanf(*cur_pos, "%[^\n]%n", sign_str, &shift);
-    *cur_pos += shift;
+    if ((size_t)(scanner->end - scanner->pos) < sign_len || memcmp(scanner->pos, SIGN_STRING, sign_len) != 0)
+        return false;
 
-    logPrint(LOG_DEBUG, "read signature: %s\n", sign_str);
+    scanner->pos += sign_len;
 
-    if (strcmp(sign_str, SIGN_STRING) == 0)
-        return 1;
+    logPrint(LOG_DEBUG, "read signature: %s\n", SIGN_STRING);
 
-    return 0;
+    // signature is the whole first line
+    return scanner->pos == scanner->end || *scanner->pos == '\n' || *scanner->pos == '\r';
 }
 
-static int readNameTable(tree_context_t * tree, const char ** cur_pos)
+static bool readNameTable(tree_context_t * tree, ir_scanner_t * scanner)
 {
     assert(tree);
-    assert(cur_pos);
-    assert(*cur_pos);
-
-    int shift = 0;
+    assert(scanner);
 
     size_t nametable_size = 0;
-    sscanf(*cur_pos, " NAMETABLE size: %zu {%n", &nametable_size, &shift);
 
-    // allocating memory for name table
-    tree->ids = (idr_t *)calloc(nametable_size, sizeof(idr_t));
-    tree->id_size = nametable_size;
+    if (! scanKeyword(scanner, "NAMETABLE") || ! scanKeyword(scanner, "size") || ! scanChar(scanner, ':') ||
+        ! scanUnsigned(scanner, &nametable_size) || ! scanChar(scanner, '{'))
+        return false;
+
+    // every entry takes more than a symbol, so larger size is a broken file and not a reason to allocate
+    if (nametable_size > (size_t)(scanner->end - scanner->pos))
+        return false;
 
-    *cur_pos += shift;
+    tree->ids = (idr_t *)calloc(nametable_size, sizeof(idr_t));
+    tree->id_size = (unsigned int)nametable_size;
 
-    shift = 0;
+    // ids missing in the table get empty names
+    for (size_t index = 0; index < nametable_size; index++)
+        tree->ids[index].name = "";
 
-    while (shift == 0){
-        char name_buf[BUFFER_LEN] = "";
-        char type_buf[BUFFER_LEN] = "";
+    while (! scanChar(scanner, '}')){
         size_t index = 0;
-
         size_t num_of_args = 0;
 
-        sscanf(*cur_pos, " %zu : \"%[^\"]\" , %[^ ,;] , %zu ;%n", &index, name_buf, type_buf, &num_of_args, &shift);
-        *cur_pos += shift;
+        const char * name = NULL;
+        size_t name_len = 0;
+
+        if (! scanUnsigned(scanner, &index) || index >= nametable_size || ! scanChar(scanner, ':'))
+            return false;
+
+        name_len = scanQuoted(scanner, &name);
+        if (name_len == 0 || name_len >= NAME_MAX_LENGTH || ! scanChar(scanner, ','))
+            return false;
+
+        tree->ids[index].name = internerName(&tree->names, internerIntern(&tree->names, name, name_len));
 
-        logPrint(LOG_DEBUG, "scanned name: %04zu, \"%s\", %s;\n", index, name_buf, type_buf);
+        const char * type_str = NULL;
+        size_t type_len = scanIdentifier(scanner, &type_str);
+
+        if (! scanChar(scanner, ',') || ! scanUnsigned(scanner, &num_of_args) || ! scanChar(scanner, ';'))
+            return false;
 
-        strcpy(tree->ids[index].name, name_buf);
         tree->ids[index].num_of_args = num_of_args;
 
-        if (strcmp(type_buf, "FUNC") == 0)
+        if (type_len == strlen("FUNC") && memcmp(type_str, "FUNC", type_len) == 0)
             tree->ids[index].type = FUNC;
         else
             tree->ids[index].type = VAR;
 
-        shift = 0;
-        sscanf(*cur_pos, " }%n", &shift);
+        logPrint(LOG_DEBUG, "scanned name: %04zu, \"%s\", %.*s;\n", index, tree->ids[index].name, (int)type_len, type_str);
     }
-    *cur_pos += shift;
 
     logPrint(LOG_DEBUG, "successfully scanned nametable\n");
 
-    return 1;
+    return true;
 }
 
-static node_t * readTreeFromIRrecursive(tree_context_t * tree, const char ** cur_pos)
+// states of the frames of iterative reading
+enum read_state {
+    READ_ELEM,          // element is read into the slot of the frame
+    READ_CLOSING        // closing brace of the operator is skipped
+};
+
+static bool readTreeFromIRiterative(tree_context_t * tree, ir_scanner_t * scanner, node_t ** root)
 {
     assert(tree);
-    assert(cur_pos);
-    assert(*cur_pos);
+    assert(scanner);
+    assert(root);
+
+    bool read_ok = true;
+
+    node_stack_t stack = nodeStackCtor();
+    nodeStackPush(&stack, NULL, root, READ_ELEM);
+
+    while (read_ok && ! nodeStackEmpty(&stack)){
+        node_frame_t frame = nodeStackPop(&stack);
+
+        if (frame.state == READ_CLOSING){
+            read_ok = scanChar(scanner, '}');
+            continue;
+        }
 
-    int shift = 0;
+        read_ok = readNodeFromIR(tree, scanner, frame.slot);
 
-    sscanf(*cur_pos, " { }%n", &shift);
-    if (shift != 0){
-        *cur_pos += shift;
+        node_t * node = *frame.slot;
 
-        return NULL;
+        if (read_ok && node != NULL && node->type == OPR){
+            // left child is read first, then right one, then the closing brace
+            nodeStackPush(&stack, node, NULL,         READ_CLOSING);
+            nodeStackPush(&stack, node, &node->right, READ_ELEM);
+            nodeStackPush(&stack, node, &node->left,  READ_ELEM);
+        }
     }
 
-    char type_str[MAX_ELEM_TYPE_NAME_LEN] = "";
-    shift = 0;
+    nodeStackDtor(&stack);
 
-    sscanf(*cur_pos, " { %[^ :] :%n", type_str, &shift);
-    *cur_pos += shift;
+    return read_ok;
+}
 
-    union value val = {};
+// reads leaf or header of the operator (its children are read by the caller)
+static bool readNodeFromIR(tree_context_t * tree, ir_scanner_t * scanner, node_t ** node_slot)
+{
+    assert(tree);
+    assert(scanner);
+    assert(node_slot);
 
-    if (strcmp(type_str, "NUM") == 0){
-        double number = 0.;
+    *node_slot = NULL;
 
-        sscanf(*cur_pos, " %lg }%n", &number, &shift);
-        *cur_pos += shift;
+    if (! scanChar(scanner, '{'))
+        return false;
 
-        node_t * num_node = tree->cur_node;
-        tree->cur_node++;
+    if (scanChar(scanner, '}'))
+        return true;
 
-        num_node->type = NUM;
-        num_node->val.number = number;
+    const char * type_str = NULL;
+    size_t type_len = scanIdentifier(scanner, &type_str);
+
+    if (type_len != ELEM_TYPE_TAG_LEN || ! scanChar(scanner, ':'))
+        return false;
 
-        num_node->left  = NULL;
-        num_node->right = NULL;
+    if (memcmp(type_str, "NUM", ELEM_TYPE_TAG_LEN) == 0){
+        node_t * num_node = nodeArenaAlloc(tree->arena);
+        *node_slot = num_node;
 
-        return num_node;
+        num_node->type = NUM;
+
+        return scanNumber(scanner, &num_node->val.number) && scanChar(scanner, '}');
     }
 
-    if (strcmp(type_str, "IDR") == 0){
-        unsigned int id_index = 0;
+    if (memcmp(type_str, "IDR", ELEM_TYPE_TAG_LEN) == 0){
+        size_t id_index = 0;
 
-        sscanf(*cur_pos, " %u }%n", &id_index, &shift);
-        *cur_pos += shift;
+        if (! scanUnsigned(scanner, &id_index) || id_index >= tree->id_size)
+            return false;
 
-        node_t * idr_node = tree->cur_node;
-        tree->cur_node++;
+        node_t * idr_node = nodeArenaAlloc(tree->arena);
+        *node_slot = idr_node;
 
         idr_node->type = IDR;
-        idr_node->val.id = id_index;
+        idr_node->val.id = (unsigned int)id_index;
+
+        return scanChar(scanner, '}');
+    }
+
+    if (memcmp(type_str, "OPR", ELEM_TYPE_TAG_LEN) != 0)
+        return false;
+
+    const char * op_str = NULL;
+    size_t op_len = scanIdentifier(scanner, &op_str);
+
+    enum oper op_num = getOperByIRname(op_str, op_len);
+
+    if (op_num == TEXT)
+        fprintf(stderr, "WARNING: TEXT operator is not supported\n");
+
+    if (op_num == NO_OP)
+        fprintf(stderr, "WARNING: unknown operator '%.*s' - program is unpredictable (tree writing would be incorrect)\n",
+                        (int)op_len, op_str);
+
+    node_t * opr_node = nodeArenaAlloc(tree->arena);
+    *node_slot = opr_node;
+
+    opr_node->type = OPR;
+    opr_node->val.op = op_num;
+
+    return true;
+}
+
+enum oper getOperByIRname(const char * name, size_t name_len)
+{
+    assert(name || name_len == 0);
+
+    if (name_len == 0)
+        return NO_OP;
+
+    // hash is perfect only for the known names, so the candidate is compared
+    enum oper candidate = OPER_IR_HASH.opers[hashOperIRname(name, name_len)];
+
+    if (candidate == NO_OP)
+        return NO_OP;
+
+    const char * candidate_name = oper_IR_names[candidate];
+
+    if (strlen(candidate_name) != name_len || memcmp(candidate_name, name, name_len) != 0)
+        return NO_OP;
+
+    return candidate;
+}
+
+static size_t hashOperIRname(const char * name, size_t name_len)
+{
+    assert(name);
+    assert(name_len > 0);
+
+    return operIRhash((unsigned char)name[0], (unsigned char)name[name_len - 1], name_len,
+                      OPER_IR_HASH.last_mul, OPER_IR_HASH.len_mul);
+}
+
+static bool isIRspace(char symbol)
+{
+    return symbol == ' ' || symbol == '\n' || symbol == '\t' || symbol == '\r';
+}
+
+static bool isIRdigit(char symbol)
+{
+    return '0' <= symbol && symbol <= '9';
+}
+
+static void scanSpaces(ir_scanner_t * scanner)
+{
+    assert(scanner);
+
+    while (scanner->pos < scanner->end && isIRspace(*scanner->pos))
+        scanner->pos++;
+}
+
+// skips spaces and the symbol, returns false (and skips only spaces) if there is other symbol
+static bool scanChar(ir_scanner_t * scanner, char symbol)
+{
+    assert(scanner);
 
-        idr_node->left  = NULL;
-        idr_node->right = NULL;
+    scanSpaces(scanner);
 
-        return idr_node;
+    if (scanner->pos >= scanner->end || *scanner->pos != symbol)
+        return false;
+
+    scanner->pos++;
+
+    return true;
+}
+
+static bool scanKeyword(ir_scanner_t * scanner, const char * keyword)
+{
+    assert(scanner);
+    assert(keyword);
+
+    const char * word = NULL;
+    size_t word_len = scanIdentifier(scanner, &word);
+
+    return word_len == strlen(keyword) && memcmp(word, keyword, word_len) == 0;
+}
+
+// skips spaces, word is [A-Za-z0-9_]* and it is not copied
+static size_t scanIdentifier(ir_scanner_t * scanner, const char ** word)
+{
+    assert(scanner);
+    assert(word);
+
+    scanSpaces(scanner);
+
+    *word = scanner->pos;
+
+    while (scanner->pos < scanner->end){
+        char symbol = *scanner->pos;
+
+        if (! (('A' <= symbol && symbol <= 'Z') || ('a' <= symbol && symbol <= 'z') || isIRdigit(symbol) || symbol == '_'))
+            break;
+
+        scanner->pos++;
+    }
+
+    return (size_t)(scanner->pos - *word);
+}
+
+static bool scanUnsigned(ir_scanner_t * scanner, size_t * value)
+{
+    assert(scanner);
+    assert(value);
+
+    scanSpaces(scanner);
+
+    const char * start = scanner->pos;
+    size_t result = 0;
+
+    while (scanner->pos < scanner->end && isIRdigit(*scanner->pos)){
+        size_t digit = (size_t)(*scanner->pos - '0');
+
+        if (result > (SIZE_MAX - digit) / 10)
+            return false;
+
+        result = result * 10 + digit;
+        scanner->pos++;
     }
 
-    // if (strmcp(type_str, "OPR") == 0)
-    char op_buffer[MAX_IR_OPER_NAME_LEN] = "";
+    *value = result;
+
+    return scanner->pos != start;
+}
+
+// fast path reads [-]digits[.digits] with at most MAX_EXACT_DIGITS digits:
+// mantissa and power of ten are exact doubles then, so one division gives correctly rounded result (as strtod does);
+// everything else (exponents, inf, nan, long numbers) goes to strtod
+static bool scanNumber(ir_scanner_t * scanner, double * number)
+{
+    assert(scanner);
+    assert(number);
+
+    scanSpaces(scanner);
 
-    sscanf(*cur_pos, " %[^\n {] %n", op_buffer, &shift);
-    *cur_pos += shift;
+    const char * pos = scanner->pos;
+    const char * end = scanner->end;
 
-    enum oper op_num = NO_OP;
-    // searching op_num by the name
-    // TODO: may be hashtable?
+    bool negative = false;
+    if (pos < end && (*pos == '-' || *pos == '+')){
+        negative = (*pos == '-');
+        pos++;
+    }
 
-    for (size_t oper_index = 0; oper_index < oper_names_num; oper_index++){
-        if (strcmp(op_buffer, oper_names[oper_index].name) == 0){
-            op_num = oper_names[oper_index].op_num;
+    uint64_t mantissa = 0;
+    size_t digits_num = 0;
+    size_t frac_digits_num = 0;
+
+    while (pos < end && isIRdigit(*pos)){
+        mantissa = mantissa * 10 + (uint64_t)(*pos - '0');
+        digits_num++;
+        pos++;
+
+        if (digits_num > MAX_EXACT_DIGITS)
             break;
+    }
+
+    if (pos < end && *pos == '.'){
+        pos++;
+
+        while (pos < end && isIRdigit(*pos) && digits_num <= MAX_EXACT_DIGITS){
+            mantissa = mantissa * 10 + (uint64_t)(*pos - '0');
+            digits_num++;
+            frac_digits_num++;
+            pos++;
         }
     }
 
-    if (op_num == TEXT)
-        fprintf(stderr, "WARNING: TEXT operator is not supported\n", op_buffer);
+    bool exact = digits_num > 0 && digits_num <= MAX_EXACT_DIGITS &&
+                 (pos >= end || ! (isIRdigit(*pos) || *pos == '.' || *pos == 'e' || *pos == 'E' || *pos == 'x' || *pos == 'X'));
 
-    if (op_num == NO_OP)
-        fprintf(stderr, "WARNING: unknown operator '%s' - program is unpredictable (tree writing would be incorrect)\n", op_buffer);
+    if (exact){
+        double value = (double)mantissa / POWERS_OF_TEN[frac_digits_num];
 
-    node_t * opr_node = tree->cur_node;
-    tree->cur_node++;
+        *number = negative ? -value : value;
+        scanner->pos = pos;
 
-    opr_node->type = OPR;
-    opr_node->val.op = op_num;
+        return true;
+    }
+
+    char * num_end = NULL;
+    *number = strtod(scanner->pos, &num_end);
+
+    if (num_end == scanner->pos || num_end > scanner->end)
+        return false;
+
+    scanner->pos = num_end;
+
+    return true;
+}
+
+// reads "..." into str, names longer than max_len - 1 are an error
+// string is not copied, returns its length or 0 if there is no quoted string
+static size_t scanQuoted(ir_scanner_t * scanner, const char ** str)
+{
+    assert(scanner);
+    assert(str);
+
+    if (! scanChar(scanner, '"'))
+        return 0;
+
+    const char * start = scanner->pos;
+
+    while (scanner->pos < scanner->end && *scanner->pos != '"')
+        scanner->pos++;
+
+    if (scanner->pos >= scanner->end)
+        return 0;
+
+    *str = start;
+
+    return (size_t)(scanner->pos++ - start);
+}
 
-    opr_node->left  = readTreeFromIRrecursive(tree, cur_pos);
-    opr_node->right = readTreeFromIRrecursive(tree, cur_pos);
+void writeTreeToFile(tree_context_t * tree, node_t * root, const char * file_name)
+{
+    assert(tree);
+    assert(root);
+    assert(file_name);
+
+    // tree is written next to the target and then renamed over it:
+    // the target may be the input file that is still mapped by the reader
+    size_t tmp_name_len = strlen(file_name) + sizeof(TMP_FILE_SUFFIX);
+    char * tmp_file_name = (char *)calloc(tmp_name_len, sizeof(*tmp_file_name));
+
+    strcpy(tmp_file_name, file_name);
+    strcat(tmp_file_name, TMP_FILE_SUFFIX);
+
+    FILE * out_file = fopen(tmp_file_name, "wb");
+    if (out_file == NULL){
+        fprintf(stderr, "ERROR: cannot open '%s'\n", tmp_file_name);
+        free(tmp_file_name);
 
-    sscanf(*cur_pos, " }%n", &shift);
-    *cur_pos += shift;
+        return;
+    }
+
+    if (hasBinaryIRextension(file_name))
+        writeTreeToBinaryFile(tree, root, out_file);
+    else
+        writeTreeToTextFile(tree, root, out_file);
+
+    fclose(out_file);
 
-    return opr_node;
+    if (rename(tmp_file_name, file_name) != 0)
+        fprintf(stderr, "ERROR: cannot write '%s'\n", file_name);
+
+    free(tmp_file_name);
 }
 
-void writeTreeToFile(tree_context_t * tree, node_t * root, FILE * out_file)
+static void writeTreeToTextFile(tree_context_t * tree, node_t * root, FILE * out_file)
 {
     assert(tree);
     assert(root);
@@ -267,7 +716,7 @@ void writeTreeToFile(tree_context_t * tree, node_t * root, FILE * out_file)
 
     writeNameTable(tree, out_file);
 
-    writeTreeToFileRecursive(tree, root, out_file, 0);
+    writeTreeToFileIterative(tree, root, out_file);
 
     fprintf(out_file, "\n");
 }
@@ -277,7 +726,7 @@ static void writeNameTable(tree_context_t * tree, FILE * out_file)
     assert(tree);
     assert(out_file);
 
-    fprintf(out_file, "NAMETABLE size: %zu {\n", tree->id_size);
+    fprintf(out_file, "NAMETABLE size: %u {\n", tree->id_size);
 
     for (size_t id_index = 0; id_index < tree->id_size; id_index++){
         const char * type_str = (tree->ids[id_index].type == VAR) ? "VAR" : "FUNC";
@@ -287,44 +736,55 @@ static void writeNameTable(tree_context_t * tree, FILE * out_file)
     fprintf(out_file, "}\n");
 }
 
-static void writeTreeToFileRecursive(tree_context_t * tree, node_t * node, FILE * out_file, const size_t tab_num)
+// states of the frames of iterative writing
+enum write_state {
+    WRITE_ELEM,         // element is written
+    WRITE_CLOSING       // closing brace of the operator is written
+};
+
+static void writeTreeToFileIterative(tree_context_t * tree, node_t * root, FILE * out_file)
 {
     assert(tree);
     assert(out_file);
 
-    if (node == NULL){
-        fprintf(out_file, "{}");
-        return;
-    }
+    node_stack_t stack = nodeStackCtor();
+    nodeStackPush(&stack, root, NULL, WRITE_ELEM);
 
-    if (node->type == NUM){
-        fprintf(out_file, "{NUM:%lg}", node->val.number);
-        return;
-    }
+    while (! nodeStackEmpty(&stack)){
+        node_frame_t frame = nodeStackPop(&stack);
+        node_t * node = frame.node;
 
-    if (node->type == IDR){
-        fprintf(out_file, "{IDR:%u}", node->val.id);
-        return;
-    }
+        if (frame.state == WRITE_CLOSING){
+            fprintf(out_file, "}\n");
+            continue;
+        }
+
+        if (node == NULL){
+            fprintf(out_file, "{}");
+            continue;
+        }
 
-    oper_t oper = opers[node->val.op];
+        if (node->type == NUM){
+            fprintf(out_file, "{NUM:%lg}", node->val.number);
+            continue;
+        }
 
-    // searching name for this operator
-    const char * op_name = NULL;
-    for (size_t oper_index = 0; oper_index < oper_names_num; oper_index++){
-        if (oper_names[oper_index].op_num == oper.num){
-            op_name = oper_names[oper_index].name;
-            break;
+        if (node->type == IDR){
+            fprintf(out_file, "{IDR:%u}", node->val.id);
+            continue;
         }
-    }
-    assert(op_name);
 
-    fprintf(out_file, "{OPR:%s\n", op_name);
+        const char * op_name = oper_IR_names[node->val.op];
+        assert(op_name);
 
-    writeTreeToFileRecursive(tree, node->left , out_file, tab_num + 1);
-    writeTreeToFileRecursive(tree, node->right, out_file, tab_num + 1);
+        fprintf(out_file, "{OPR:%s\n", op_name);
 
-    fprintf(out_file, "}\n");
+        nodeStackPush(&stack, node, NULL, WRITE_CLOSING);
+        nodeStackPush(&stack, node->right, NULL, WRITE_ELEM);
+        nodeStackPush(&stack, node->left,  NULL, WRITE_ELEM);
+    }
+
+    nodeStackDtor(&stack);
 }
 
 static size_t getFileSize(const char * file_name)
@@ -0,0 +1,120 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <errno.h>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "compile_protocol.h"
+
+bool readAll(int fd, void * buffer, size_t size)
+{
+    assert(buffer || size == 0);
+
+    char * cur = (char *)buffer;
+
+    while (size > 0){
+        ssize_t read_size = read(fd, cur, size);
+
+        if (read_size < 0 && errno == EINTR)
+            continue;
+
+        if (read_size <= 0)
+            return false;
+
+        cur  += read_size;
+        size -= (size_t)read_size;
+    }
+
+    return true;
+}
+
+bool writeAll(int fd, const void * buffer, size_t size)
+{
+    assert(buffer || size == 0);
+
+    const char * cur = (const char *)buffer;
+
+    while (size > 0){
+        ssize_t written_size = write(fd, cur, size);
+
+        if (written_size < 0 && errno == EINTR)
+            continue;
+
+        if (written_size <= 0)
+            return false;
+
+        cur  += written_size;
+        size -= (size_t)written_size;
+    }
+
+    return true;
+}
+
+int compileServerConnect(const char * socket_path)
+{
+    assert(socket_path);
+
+    struct sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+
+    if (strlen(socket_path) >= sizeof(address.sun_path))
+        return -1;
+
+    strcpy(address.sun_path, socket_path);
+
+    int socket_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (socket_fd < 0)
+        return -1;
+
+    if (connect(socket_fd, (struct sockaddr *)&address, sizeof(address)) != 0){
+        close(socket_fd);
+        return -1;
+    }
+
+    return socket_fd;
+}
+
+bool sendCompileRequest(int socket_fd, const char * code, size_t code_size, uint32_t flags)
+{
+    assert(code);
+
+    compile_request_t request = {
+        .magic = COMPILE_REQUEST_MAGIC,
+        .flags = flags,
+        .code_size = code_size
+    };
+
+    return writeAll(socket_fd, &request, sizeof(request)) && writeAll(socket_fd, code, code_size);
+}
+
+bool recvCompileResponse(int socket_fd, compile_response_t * response, char ** elf, char ** diag)
+{
+    assert(response);
+    assert(elf);
+    assert(diag);
+
+    *elf  = NULL;
+    *diag = NULL;
+
+    if (! readAll(socket_fd, response, sizeof(*response)) || response->magic != COMPILE_RESPONSE_MAGIC)
+        return false;
+
+    *elf  = (char *)calloc(response->elf_size + 1,  sizeof(char));
+    *diag = (char *)calloc(response->diag_size + 1, sizeof(char));
+
+    if (! readAll(socket_fd, *elf, response->elf_size) || ! readAll(socket_fd, *diag, response->diag_size)){
+        free(*elf);
+        free(*diag);
+
+        *elf  = NULL;
+        *diag = NULL;
+
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,239 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+
+#include "interner.h"
+
+const size_t INTERNER_CHUNKS_START_CAP = 16;
+const uint32_t INTERNER_NAMES_START_CAP = 64;
+
+const uint32_t FNV_OFFSET_BASIS = 2166136261u;
+const uint32_t FNV_PRIME        = 16777619u;
+
+static uint32_t hashName(const char * name, size_t len);
+
+static const char * storeName(interner_t * interner, const char * name, size_t len);
+
+static size_t findSlot(const interner_t * interner, const char * name, size_t len, uint32_t hash);
+
+static void growSlots(interner_t * interner);
+
+interner_t internerCtor()
+{
+    interner_t interner = {};
+
+    interner.chunks = (char **)calloc(INTERNER_CHUNKS_START_CAP, sizeof(*interner.chunks));
+    interner.chunks_capacity = INTERNER_CHUNKS_START_CAP;
+
+    interner.names   = (const char **)calloc(INTERNER_NAMES_START_CAP, sizeof(*interner.names));
+    interner.lengths = (uint32_t *)calloc(INTERNER_NAMES_START_CAP, sizeof(*interner.lengths));
+    interner.names_capacity = INTERNER_NAMES_START_CAP;
+
+    interner.slots = (interner_slot_t *)calloc(INTERNER_START_SLOTS_NUM, sizeof(*interner.slots));
+    interner.slots_num = INTERNER_START_SLOTS_NUM;
+
+    return interner;
+}
+
+void internerDtor(interner_t * interner)
+{
+    assert(interner);
+
+    for (size_t chunk_index = 0; chunk_index < interner->chunks_num; chunk_index++)
+        free(interner->chunks[chunk_index]);
+
+    free(interner->chunks);
+    free(interner->names);
+    free(interner->lengths);
+    free(interner->slots);
+
+    *interner = {};
+}
+
+void internerReset(interner_t * interner)
+{
+    assert(interner);
+
+    for (size_t chunk_index = 0; chunk_index < interner->chunks_num; chunk_index++)
+        free(interner->chunks[chunk_index]);
+
+    interner->chunks_num = 0;
+    interner->free_pos   = NULL;
+    interner->free_size  = 0;
+
+    interner->names_num = 0;
+
+    if (interner->slots != NULL)
+        memset(interner->slots, 0, interner->slots_num * sizeof(*interner->slots));
+}
+
+uint32_t internerIntern(interner_t * interner, const char * name, size_t len)
+{
+    assert(interner);
+    assert(name);
+
+    if (interner->slots == NULL)
+        *interner = internerCtor();
+
+    uint32_t hash = hashName(name, len);
+    size_t slot_index = findSlot(interner, name, len, hash);
+
+    if (interner->slots[slot_index].id_plus_one != 0)
+        return interner->slots[slot_index].id_plus_one - 1;
+
+    if (interner->names_num == interner->names_capacity){
+        interner->names_capacity *= 2;
+        interner->names   = (const char **)realloc(interner->names, interner->names_capacity * sizeof(*interner->names));
+        interner->lengths = (uint32_t *)realloc(interner->lengths, interner->names_capacity * sizeof(*interner->lengths));
+    }
+
+    uint32_t id = interner->names_num;
+
+    interner->names[id]   = storeName(interner, name, len);
+    interner->lengths[id] = (uint32_t)len;
+    interner->names_num++;
+
+    interner->slots[slot_index].hash = hash;
+    interner->slots[slot_index].id_plus_one = id + 1;
+
+    if (4 * (size_t)interner->names_num > 3 * interner->slots_num)
+        growSlots(interner);
+
+    return id;
+}
+
+uint32_t internerFind(const interner_t * interner, const char * name, size_t len)
+{
+    assert(interner);
+    assert(name);
+
+    if (interner->slots == NULL)
+        return INTERNER_NO_ID;
+
+    size_t slot_index = findSlot(interner, name, len, hashName(name, len));
+    uint32_t id_plus_one = interner->slots[slot_index].id_plus_one;
+
+    return (id_plus_one == 0) ? INTERNER_NO_ID : id_plus_one - 1;
+}
+
+const char * internerName(const interner_t * interner, uint32_t id)
+{
+    assert(interner);
+    assert(id < interner->names_num);
+
+    return interner->names[id];
+}
+
+uint32_t internerLength(const interner_t * interner, uint32_t id)
+{
+    assert(interner);
+    assert(id < interner->names_num);
+
+    return interner->lengths[id];
+}
+
+uint32_t internerSize(const interner_t * interner)
+{
+    assert(interner);
+
+    return interner->names_num;
+}
+
+// FNV-1a, names are short so it is not worth reading them by words
+static uint32_t hashName(const char * name, size_t len)
+{
+    assert(name);
+
+    uint32_t hash = FNV_OFFSET_BASIS;
+
+    for (size_t symbol_index = 0; symbol_index < len; symbol_index++){
+        hash ^= (unsigned char)name[symbol_index];
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}
+
+// linear probing, the names are compared only when the stored hashes are equal,
+// returns the slot of the name or the empty one where it should be
+static size_t findSlot(const interner_t * interner, const char * name, size_t len, uint32_t hash)
+{
+    assert(interner);
+    assert(name);
+
+    size_t mask = interner->slots_num - 1;
+    size_t slot_index = hash & mask;
+
+    while (interner->slots[slot_index].id_plus_one != 0){
+        interner_slot_t slot = interner->slots[slot_index];
+        uint32_t id = slot.id_plus_one - 1;
+
+        if (slot.hash == hash && interner->lengths[id] == len && memcmp(interner->names[id], name, len) == 0)
+            break;
+
+        slot_index = (slot_index + 1) & mask;
+    }
+
+    return slot_index;
+}
+
+static const char * storeName(interner_t * interner, const char * name, size_t len)
+{
+    assert(interner);
+    assert(name);
+
+    if (interner->free_size < len + 1){
+        size_t chunk_size = (len + 1 > INTERNER_CHUNK_SIZE) ? len + 1 : INTERNER_CHUNK_SIZE;
+
+        if (interner->chunks_num == interner->chunks_capacity){
+            interner->chunks_capacity *= 2;
+            interner->chunks = (char **)realloc(interner->chunks, interner->chunks_capacity * sizeof(*interner->chunks));
+        }
+
+        char * chunk = (char *)calloc(chunk_size, sizeof(*chunk));
+        interner->chunks[interner->chunks_num] = chunk;
+        interner->chunks_num++;
+
+        interner->free_pos  = chunk;
+        interner->free_size = chunk_size;
+    }
+
+    char * stored = interner->free_pos;
+
+    memcpy(stored, name, len);
+    stored[len] = '\0';
+
+    interner->free_pos  += len + 1;
+    interner->free_size -= len + 1;
+
+    return stored;
+}
+
+// ids are kept, slots are moved by the stored hashes
+static void growSlots(interner_t * interner)
+{
+    assert(interner);
+
+    size_t new_slots_num = 2 * interner->slots_num;
+    size_t mask = new_slots_num - 1;
+
+    interner_slot_t * new_slots = (interner_slot_t *)calloc(new_slots_num, sizeof(*new_slots));
+
+    for (size_t old_index = 0; old_index < interner->slots_num; old_index++){
+        interner_slot_t slot = interner->slots[old_index];
+        if (slot.id_plus_one == 0)
+            continue;
+
+        size_t slot_index = slot.hash & mask;
+        while (new_slots[slot_index].id_plus_one != 0)
+            slot_index = (slot_index + 1) & mask;
+
+        new_slots[slot_index] = slot;
+    }
+
+    free(interner->slots);
+
+    interner->slots = new_slots;
+    interner->slots_num = new_slots_num;
+}
@@ -1,66 +1,327 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <stdarg.h>
-#include <time.h>
-
-#include "logger.h"
-
-static enum loglevels LOGlevel = LOG_RELEASE;
-static FILE * LOGfile = NULL;
-
-int logStart(const char * logfilename, enum loglevels loglevel, log_mode_t mode)
-{
-    LOGlevel = loglevel;
-    // LOGfile = fopen(logfilename, "a+");
-    LOGfile = fopen(logfilename, "w");
-    if (LOGfile == NULL){
-        printf("}}} logger ERROR: cannot open logfile\n");
-        return 0;
-    }
-    if (mode == LOG_HTML)
-        logPrint(LOG_RELEASE, "<pre>\n");
-    logPrint(LOG_RELEASE, "\n{-----------STARTED-----------}\n");
-    return 1;
-}
-
-void logPrint(enum loglevels loglevel, const char * fmt, ...)
-{
-    if (loglevel <= LOGlevel){
-        //logPrintTime();
-        va_list va = {};
-        va_start(va, fmt);
-        vfprintf(LOGfile, fmt, va);
-        //fprintf(LOGfile, "\n");
-        va_end(va);
-    }
-}
-
-void logPrintTime(enum loglevels loglevel)
-{
-    if (loglevel <= LOGlevel){
-        time_t time_0= time(NULL);
-        struct tm *calctime = localtime(&time_0);
-
-        const size_t timestrlen = 100;
-        char timestr[timestrlen] = {};
-
-        strftime(timestr, timestrlen, "[%d.%m.%G %H:%M:%S] ", calctime);
-        fprintf(LOGfile, "%s", timestr);
-    }
-}
-
-void logExit()
-{
-    logPrint(LOG_RELEASE, "{-----------ENDING------------}\n");
-    fclose(LOGfile);
-}
-
-void logCancelBuffer()
-{
-    setbuf(LOGfile, NULL);
-}
-
-enum loglevels logGetLevel()
-{
-    return LOGlevel;
-}
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "logger.h"
+
+// messages are put to a ring of fixed-size slots (multi-producer, single consumer), a message longer than
+// one slot takes several slots in a row, the writer thread drains the ring to the file
+const size_t LOG_RING_SLOTS     = 4096;                 //< power of two
+const size_t LOG_SLOT_SIZE      = 256;
+const size_t LOG_SLOT_TEXT_SIZE = LOG_SLOT_SIZE - 2 * sizeof(size_t);
+const size_t LOG_MAX_MSG_SLOTS  = LOG_RING_SLOTS / 4;   //< longer messages are truncated
+const size_t LOG_LOCAL_MSG_SIZE = 1024;                 //< messages that fit are formatted without malloc
+const long   LOG_WRITER_SLEEP_NS = 50 * 1000 * 1000;   //< the writer wakes up at least this often
+
+typedef struct
+{
+    size_t sequence;        //< == position if free, == position + 1 if holds the message of the position
+    size_t length;
+    char   text[LOG_SLOT_TEXT_SIZE];
+} log_slot_t;
+
+static_assert(sizeof(log_slot_t) == LOG_SLOT_SIZE, "log slot must fill LOG_SLOT_SIZE");
+
+typedef struct
+{
+    log_slot_t *    slots;
+    size_t          enqueue_pos;
+    size_t          dequeue_pos;     //< touched by the writer only
+
+    pthread_t       writer;
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
+    int             writer_sleeping;
+    int             stopping;
+    int             running;
+} log_ring_t;
+
+enum loglevels LOGlevel = LOG_RELEASE;
+static FILE * LOGfile = NULL;       //< accessed atomically, logExit clears it before the file is closed
+static log_ring_t LOGring = {NULL, 0, 0, {}, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, 0, 0};
+
+static void   logWriteMessage(const char * text, size_t length);
+static int    logRingStart();
+static void   logRingStop();
+static size_t logRingDrain();
+static void * logWriterThread(void * arg);
+static void   logExitAtExit();
+static enum loglevels logLevelFromEnv(enum loglevels loglevel);
+
+int logStart(const char * logfilename, enum loglevels loglevel, log_mode_t mode)
+{
+    __atomic_store_n(&LOGlevel, logLevelFromEnv(loglevel), __ATOMIC_RELAXED);
+    // FILE * log_file = fopen(logfilename, "a+");
+    FILE * log_file = fopen(logfilename, "w");
+    if (log_file == NULL){
+        printf("}}} logger ERROR: cannot open logfile\n");
+        return 0;
+    }
+    __atomic_store_n(&LOGfile, log_file, __ATOMIC_RELEASE);
+
+    static int atexit_registered = 0;
+    if (!atexit_registered){
+        atexit(logExitAtExit);
+        atexit_registered = 1;
+    }
+
+    if (!logRingStart())
+        printf("}}} logger ERROR: cannot start writer thread, logging is synchronous\n");
+
+    if (mode == LOG_HTML)
+        logPrintMessage("<pre>\n");
+    logPrintMessage("\n{-----------STARTED-----------}\n");
+    return 1;
+}
+
+void logPrintMessage(const char * fmt, ...)
+{
+    FILE * log_file = __atomic_load_n(&LOGfile, __ATOMIC_ACQUIRE);
+    if (log_file == NULL)
+        return;
+
+    va_list va = {};
+    va_start(va, fmt);
+
+    if (!__atomic_load_n(&LOGring.running, __ATOMIC_ACQUIRE)){
+        vfprintf(log_file, fmt, va);
+        va_end(va);
+        return;
+    }
+
+    char local_text[LOG_LOCAL_MSG_SIZE] = {};
+    char * text = local_text;
+
+    va_list va_retry = {};
+    va_copy(va_retry, va);
+    int length = vsnprintf(local_text, LOG_LOCAL_MSG_SIZE, fmt, va);
+    va_end(va);
+
+    if (length >= (int) LOG_LOCAL_MSG_SIZE){
+        text = (char *) calloc((size_t) length + 1, sizeof(char));
+        if (text == NULL){
+            text = local_text;
+            length = (int) LOG_LOCAL_MSG_SIZE - 1;
+        }
+        else
+            vsnprintf(text, (size_t) length + 1, fmt, va_retry);
+    }
+    va_end(va_retry);
+
+    if (length > 0)
+        logWriteMessage(text, (size_t) length);
+
+    if (text != local_text)
+        free(text);
+}
+
+void logPrintTime(enum loglevels loglevel)
+{
+    if (logIsEnabled(loglevel)){
+        time_t time_0= time(NULL);
+        struct tm calctime = {};
+        localtime_r(&time_0, &calctime);
+
+        const size_t timestrlen = 100;
+        char timestr[timestrlen] = {};
+
+        strftime(timestr, timestrlen, "[%d.%m.%G %H:%M:%S] ", &calctime);
+        logPrintMessage("%s", timestr);
+    }
+}
+
+void logExit()
+{
+    if (__atomic_load_n(&LOGfile, __ATOMIC_ACQUIRE) == NULL)
+        return;
+
+    logPrintMessage("{-----------ENDING------------}\n");
+    logRingStop();
+
+    // messages after this are dropped instead of going to the closed file
+    fclose(__atomic_exchange_n(&LOGfile, NULL, __ATOMIC_ACQ_REL));
+}
+
+void logCancelBuffer()
+{
+    if (__atomic_load_n(&LOGfile, __ATOMIC_ACQUIRE) == NULL)
+        return;
+
+    logRingStop();
+    setbuf(LOGfile, NULL);
+}
+
+enum loglevels logGetLevel()
+{
+    return __atomic_load_n(&LOGlevel, __ATOMIC_RELAXED);
+}
+
+void logSetLevel(enum loglevels loglevel)
+{
+    __atomic_store_n(&LOGlevel, loglevel, __ATOMIC_RELAXED);
+}
+
+static void logWriteMessage(const char * text, size_t length)
+{
+    size_t slots_num = (length + LOG_SLOT_TEXT_SIZE - 1) / LOG_SLOT_TEXT_SIZE;
+    if (slots_num > LOG_MAX_MSG_SLOTS){
+        slots_num = LOG_MAX_MSG_SLOTS;
+        length    = LOG_MAX_MSG_SLOTS * LOG_SLOT_TEXT_SIZE;
+    }
+
+    // claim slots_num positions at once, the first one must be free, the rest are freed by the writer in order
+    size_t pos = __atomic_load_n(&LOGring.enqueue_pos, __ATOMIC_RELAXED);
+    while (1){
+        log_slot_t * slot = LOGring.slots + (pos & (LOG_RING_SLOTS - 1));
+        size_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        ptrdiff_t diff = (ptrdiff_t) sequence - (ptrdiff_t) pos;
+
+        if (diff == 0){
+            if (__atomic_compare_exchange_n(&LOGring.enqueue_pos, &pos, pos + slots_num, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        }
+        else if (diff < 0){
+            sched_yield();      // ring is full, wait for the writer
+            pos = __atomic_load_n(&LOGring.enqueue_pos, __ATOMIC_RELAXED);
+        }
+        else
+            pos = __atomic_load_n(&LOGring.enqueue_pos, __ATOMIC_RELAXED);
+    }
+
+    for (size_t slot_idx = 0; slot_idx < slots_num; slot_idx++){
+        size_t slot_pos = pos + slot_idx;
+        log_slot_t * slot = LOGring.slots + (slot_pos & (LOG_RING_SLOTS - 1));
+        while (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != slot_pos)
+            sched_yield();
+
+        size_t chunk_len = length - slot_idx * LOG_SLOT_TEXT_SIZE;
+        if (chunk_len > LOG_SLOT_TEXT_SIZE)
+            chunk_len = LOG_SLOT_TEXT_SIZE;
+
+        memcpy(slot->text, text + slot_idx * LOG_SLOT_TEXT_SIZE, chunk_len);
+        slot->length = chunk_len;
+        __atomic_store_n(&slot->sequence, slot_pos + 1, __ATOMIC_SEQ_CST);
+    }
+
+    // pairs with the store of writer_sleeping in the writer, so either it sees the message or we see it sleeping
+    if (__atomic_load_n(&LOGring.writer_sleeping, __ATOMIC_SEQ_CST)){
+        pthread_mutex_lock(&LOGring.mutex);
+        pthread_cond_signal(&LOGring.cond);
+        pthread_mutex_unlock(&LOGring.mutex);
+    }
+}
+
+static int logRingStart()
+{
+    if (LOGring.running)
+        return 1;
+
+    if (LOGring.slots == NULL){
+        LOGring.slots = (log_slot_t *) calloc(LOG_RING_SLOTS, sizeof(log_slot_t));
+        if (LOGring.slots == NULL)
+            return 0;
+    }
+
+    for (size_t slot_idx = 0; slot_idx < LOG_RING_SLOTS; slot_idx++)
+        LOGring.slots[slot_idx].sequence = slot_idx;
+    LOGring.enqueue_pos = 0;
+    LOGring.dequeue_pos = 0;
+    LOGring.stopping    = 0;
+
+    if (pthread_create(&LOGring.writer, NULL, logWriterThread, NULL) != 0)
+        return 0;
+
+    __atomic_store_n(&LOGring.running, 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+// the other threads must not log while the ring stops
+static void logRingStop()
+{
+    if (!LOGring.running)
+        return;
+
+    pthread_mutex_lock(&LOGring.mutex);
+    LOGring.stopping = 1;
+    pthread_cond_signal(&LOGring.cond);
+    pthread_mutex_unlock(&LOGring.mutex);
+
+    pthread_join(LOGring.writer, NULL);
+    __atomic_store_n(&LOGring.running, 0, __ATOMIC_RELEASE);
+    fflush(LOGfile);
+}
+
+static size_t logRingDrain()
+{
+    size_t written = 0;
+    while (1){
+        size_t pos = LOGring.dequeue_pos;
+        log_slot_t * slot = LOGring.slots + (pos & (LOG_RING_SLOTS - 1));
+        if (__atomic_load_n(&slot->sequence, __ATOMIC_SEQ_CST) != pos + 1)
+            return written;
+
+        fwrite(slot->text, sizeof(char), slot->length, LOGfile);
+        __atomic_store_n(&slot->sequence, pos + LOG_RING_SLOTS, __ATOMIC_RELEASE);
+        LOGring.dequeue_pos = pos + 1;
+        written++;
+    }
+}
+
+static void * logWriterThread(void * arg)
+{
+    while (1){
+        if (logRingDrain() != 0)
+            continue;
+
+        fflush(LOGfile);
+
+        pthread_mutex_lock(&LOGring.mutex);
+        if (LOGring.stopping){
+            pthread_mutex_unlock(&LOGring.mutex);
+            logRingDrain();
+            return arg;
+        }
+
+        __atomic_store_n(&LOGring.writer_sleeping, 1, __ATOMIC_SEQ_CST);
+        if (logRingDrain() == 0){
+            struct timespec wake_time = {};
+            clock_gettime(CLOCK_REALTIME, &wake_time);
+            wake_time.tv_nsec += LOG_WRITER_SLEEP_NS;
+            if (wake_time.tv_nsec >= 1000000000L){
+                wake_time.tv_sec  += 1;
+                wake_time.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&LOGring.cond, &LOGring.mutex, &wake_time);
+        }
+        __atomic_store_n(&LOGring.writer_sleeping, 0, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&LOGring.mutex);
+    }
+}
+
+static void logExitAtExit()
+{
+    logExit();
+}
+
+static enum loglevels logLevelFromEnv(enum loglevels loglevel)
+{
+    const char * env_level = getenv(LOG_LEVEL_ENV_NAME);
+    if (env_level == NULL)
+        return loglevel;
+
+    if (strcmp(env_level, "release") == 0)
+        return LOG_RELEASE;
+    if (strcmp(env_level, "debug") == 0)
+        return LOG_DEBUG;
+    if (strcmp(env_level, "debug_plus") == 0)
+        return LOG_DEBUG_PLUS;
+
+    printf("}}} logger ERROR: unknown %s = '%s', expected release, debug or debug_plus\n", LOG_LEVEL_ENV_NAME, env_level);
+    return loglevel;
+}
@@ -0,0 +1,118 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+
+#include <sys/mman.h>
+
+#include "node_arena.h"
+
+const size_t CHUNKS_START_CAP = 16;
+
+static void nodeArenaAddChunk(node_arena_t * arena);
+
+node_arena_t nodeArenaCtor()
+{
+    node_arena_t arena = {};
+
+    arena.chunks = (node_t **)calloc(CHUNKS_START_CAP, sizeof(*arena.chunks));
+    arena.chunks_capacity = CHUNKS_START_CAP;
+    arena.chunks_num = 0;
+
+    // so the first allocation will add a chunk
+    arena.last_chunk_size = NODE_ARENA_CHUNK_SIZE;
+
+    return arena;
+}
+
+void nodeArenaDtor(node_arena_t * arena)
+{
+    assert(arena);
+
+    for (size_t chunk_index = 0; chunk_index < arena->chunks_num; chunk_index++)
+        free(arena->chunks[chunk_index]);
+
+    free(arena->chunks);
+
+    if (arena->mapping != NULL)
+        munmap(arena->mapping, arena->mapping_size);
+
+    arena->mapping = NULL;
+    arena->mapping_size = 0;
+
+    arena->chunks = NULL;
+    arena->chunks_num = 0;
+    arena->chunks_capacity = 0;
+}
+
+void nodeArenaReset(node_arena_t * arena)
+{
+    assert(arena);
+
+    if (arena->mapping != NULL)
+        munmap(arena->mapping, arena->mapping_size);
+
+    arena->mapping = NULL;
+    arena->mapping_size = 0;
+
+    if (arena->chunks_num == 0)
+        return;
+
+    size_t first_chunk_used = (arena->chunks_num == 1) ? arena->last_chunk_size : NODE_ARENA_CHUNK_SIZE;
+
+    for (size_t chunk_index = 1; chunk_index < arena->chunks_num; chunk_index++)
+        free(arena->chunks[chunk_index]);
+
+    memset(arena->chunks[0], 0, first_chunk_used * sizeof(node_t));
+
+    arena->chunks_num = 1;
+    arena->last_chunk_size = 0;
+}
+
+node_t * nodeArenaAlloc(node_arena_t * arena)
+{
+    assert(arena);
+
+    if (arena->last_chunk_size >= NODE_ARENA_CHUNK_SIZE)
+        nodeArenaAddChunk(arena);
+
+    node_t * node = arena->chunks[arena->chunks_num - 1] + arena->last_chunk_size;
+    arena->last_chunk_size++;
+
+    return node;
+}
+
+void nodeArenaAdoptMapping(node_arena_t * arena, void * mapping, size_t mapping_size)
+{
+    assert(arena);
+    assert(mapping);
+    assert(arena->mapping == NULL);
+
+    arena->mapping = mapping;
+    arena->mapping_size = mapping_size;
+}
+
+size_t nodeArenaSize(const node_arena_t * arena)
+{
+    assert(arena);
+
+    if (arena->chunks_num == 0)
+        return 0;
+
+    return (arena->chunks_num - 1) * NODE_ARENA_CHUNK_SIZE + arena->last_chunk_size;
+}
+
+static void nodeArenaAddChunk(node_arena_t * arena)
+{
+    assert(arena);
+
+    if (arena->chunks_num >= arena->chunks_capacity){
+        arena->chunks_capacity *= 2;
+        arena->chunks = (node_t **)realloc(arena->chunks, arena->chunks_capacity * sizeof(*arena->chunks));
+    }
+
+    arena->chunks[arena->chunks_num] = (node_t *)calloc(NODE_ARENA_CHUNK_SIZE, sizeof(node_t));
+    arena->chunks_num++;
+
+    arena->last_chunk_size = 0;
+}
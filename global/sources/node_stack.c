@@ -0,0 +1,61 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+
+#include "node_stack.h"
+
+node_stack_t nodeStackCtor()
+{
+    node_stack_t stack = {};
+
+    stack.frames = (node_frame_t *)calloc(NODE_STACK_START_CAP, sizeof(*stack.frames));
+    stack.capacity = NODE_STACK_START_CAP;
+    stack.size = 0;
+
+    return stack;
+}
+
+void nodeStackDtor(node_stack_t * stack)
+{
+    assert(stack);
+
+    free(stack->frames);
+
+    stack->frames = NULL;
+    stack->size = 0;
+    stack->capacity = 0;
+}
+
+void nodeStackPush(node_stack_t * stack, node_t * node, node_t ** slot, size_t state)
+{
+    assert(stack);
+
+    if (stack->size >= stack->capacity){
+        stack->capacity *= 2;
+        stack->frames = (node_frame_t *)realloc(stack->frames, stack->capacity * sizeof(*stack->frames));
+    }
+
+    node_frame_t * frame = stack->frames + stack->size;
+    stack->size++;
+
+    frame->node  = node;
+    frame->slot  = slot;
+    frame->state = state;
+}
+
+node_frame_t nodeStackPop(node_stack_t * stack)
+{
+    assert(stack);
+    assert(stack->size > 0);
+
+    stack->size--;
+
+    return stack->frames[stack->size];
+}
+
+bool nodeStackEmpty(const node_stack_t * stack)
+{
+    assert(stack);
+
+    return stack->size == 0;
+}
@@ -0,0 +1,159 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+
+#include "sha256.h"
+
+static const uint32_t SHA256_ROUND_CONSTS[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const uint32_t SHA256_START_STATE[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+static void sha256Block(uint32_t * state, const uint8_t * block);
+
+static inline uint32_t rotateRight(uint32_t value, unsigned int shift)
+{
+    return (value >> shift) | (value << (32 - shift));
+}
+
+sha256_ctx_t sha256Ctor()
+{
+    sha256_ctx_t ctx = {};
+
+    memcpy(ctx.state, SHA256_START_STATE, sizeof(ctx.state));
+
+    return ctx;
+}
+
+void sha256Update(sha256_ctx_t * ctx, const void * data, size_t size)
+{
+    assert(ctx);
+    assert(data || size == 0);
+
+    const uint8_t * bytes = (const uint8_t *)data;
+
+    ctx->total_size += size;
+
+    if (ctx->block_size > 0){
+        size_t fill_size = SHA256_BLOCK_SIZE - ctx->block_size;
+        if (fill_size > size)
+            fill_size = size;
+
+        memcpy(ctx->block + ctx->block_size, bytes, fill_size);
+        ctx->block_size += fill_size;
+
+        bytes += fill_size;
+        size  -= fill_size;
+
+        if (ctx->block_size < SHA256_BLOCK_SIZE)
+            return;
+
+        sha256Block(ctx->state, ctx->block);
+        ctx->block_size = 0;
+    }
+
+    // whole blocks are hashed right from the data
+    for (; size >= SHA256_BLOCK_SIZE; bytes += SHA256_BLOCK_SIZE, size -= SHA256_BLOCK_SIZE)
+        sha256Block(ctx->state, bytes);
+
+    memcpy(ctx->block, bytes, size);
+    ctx->block_size = size;
+}
+
+void sha256Final(sha256_ctx_t * ctx, uint8_t * digest)
+{
+    assert(ctx);
+    assert(digest);
+
+    uint64_t total_bits = ctx->total_size * 8;
+
+    // padding: 0x80, zeros and message length in bits (big endian) at the end of the last block
+    ctx->block[ctx->block_size++] = 0x80;
+
+    if (ctx->block_size > SHA256_BLOCK_SIZE - sizeof(total_bits)){
+        memset(ctx->block + ctx->block_size, 0, SHA256_BLOCK_SIZE - ctx->block_size);
+        sha256Block(ctx->state, ctx->block);
+        ctx->block_size = 0;
+    }
+
+    memset(ctx->block + ctx->block_size, 0, SHA256_BLOCK_SIZE - ctx->block_size);
+
+    for (size_t byte_index = 0; byte_index < sizeof(total_bits); byte_index++)
+        ctx->block[SHA256_BLOCK_SIZE - 1 - byte_index] = (uint8_t)(total_bits >> (8 * byte_index));
+
+    sha256Block(ctx->state, ctx->block);
+
+    for (size_t word_index = 0; word_index < 8; word_index++)
+        for (size_t byte_index = 0; byte_index < 4; byte_index++)
+            digest[4 * word_index + byte_index] = (uint8_t)(ctx->state[word_index] >> (24 - 8 * byte_index));
+}
+
+void sha256ToHex(const uint8_t * digest, char * hex)
+{
+    assert(digest);
+    assert(hex);
+
+    const char HEX_DIGITS[] = "0123456789abcdef";
+
+    for (size_t byte_index = 0; byte_index < SHA256_DIGEST_SIZE; byte_index++){
+        hex[2 * byte_index]     = HEX_DIGITS[digest[byte_index] >> 4];
+        hex[2 * byte_index + 1] = HEX_DIGITS[digest[byte_index] & 0xf];
+    }
+
+    hex[2 * SHA256_DIGEST_SIZE] = '\0';
+}
+
+static void sha256Block(uint32_t * state, const uint8_t * block)
+{
+    uint32_t schedule[64] = {};
+
+    for (size_t word_index = 0; word_index < 16; word_index++)
+        schedule[word_index] = ((uint32_t)block[4 * word_index]     << 24) | ((uint32_t)block[4 * word_index + 1] << 16) |
+                               ((uint32_t)block[4 * word_index + 2] <<  8) |  (uint32_t)block[4 * word_index + 3];
+
+    for (size_t word_index = 16; word_index < 64; word_index++){
+        uint32_t word_15 = schedule[word_index - 15];
+        uint32_t word_2  = schedule[word_index - 2];
+
+        uint32_t sigma_0 = rotateRight(word_15, 7)  ^ rotateRight(word_15, 18) ^ (word_15 >> 3);
+        uint32_t sigma_1 = rotateRight(word_2,  17) ^ rotateRight(word_2,  19) ^ (word_2  >> 10);
+
+        schedule[word_index] = schedule[word_index - 16] + sigma_0 + schedule[word_index - 7] + sigma_1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+    for (size_t round_index = 0; round_index < 64; round_index++){
+        uint32_t sum_1  = rotateRight(e, 6) ^ rotateRight(e, 11) ^ rotateRight(e, 25);
+        uint32_t choose = (e & f) ^ (~e & g);
+        uint32_t temp_1 = h + sum_1 + choose + SHA256_ROUND_CONSTS[round_index] + schedule[round_index];
+
+        uint32_t sum_0    = rotateRight(a, 2) ^ rotateRight(a, 13) ^ rotateRight(a, 22);
+        uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t temp_2   = sum_0 + majority;
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + temp_1;
+        d = c;
+        c = b;
+        b = a;
+        a = temp_1 + temp_2;
+    }
+
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
@@ -0,0 +1,215 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "thread_pool.h"
+
+typedef struct {
+    task_func_t func;
+    void * shared;
+
+    size_t tasks_num;
+    size_t next_task;       // taken atomically by workers
+} task_queue_t;
+
+typedef struct {
+    task_queue_t * queue;
+    size_t worker_index;
+} worker_arg_t;
+
+typedef struct async_task {
+    async_task_func_t func;
+    void * arg;
+
+    struct async_task * next;
+} async_task_t;
+
+struct async_pool {
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
+
+    async_task_t * first;       // tasks are taken from the head and pushed to the tail
+    async_task_t * last;
+    int stopping;
+
+    pthread_t * threads;
+    size_t threads_num;
+};
+
+static void runTasks(task_queue_t * queue, size_t worker_index);
+
+static void * workerMain(void * arg);
+
+static void * asyncWorkerMain(void * arg);
+
+size_t getCoresNum()
+{
+    long cores_num = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (cores_num < 1)
+        return 1;
+
+    return (size_t)cores_num;
+}
+
+void parallelFor(size_t tasks_num, size_t workers_num, task_func_t func, void * shared)
+{
+    assert(func);
+
+    task_queue_t queue = {
+        .func = func,
+        .shared = shared,
+        .tasks_num = tasks_num,
+        .next_task = 0
+    };
+
+    if (workers_num > tasks_num)
+        workers_num = tasks_num;
+
+    // no need to spawn anything, calling thread does all the work
+    if (workers_num <= 1){
+        runTasks(&queue, 0);
+        return;
+    }
+
+    pthread_t   * threads = (pthread_t   *)calloc(workers_num, sizeof(*threads));
+    worker_arg_t * args   = (worker_arg_t *)calloc(workers_num, sizeof(*args));
+
+    // calling thread is worker #0
+    size_t spawned = 1;
+    for ( ; spawned < workers_num; spawned++){
+        args[spawned].queue = &queue;
+        args[spawned].worker_index = spawned;
+
+        if (pthread_create(threads + spawned, NULL, workerMain, args + spawned) != 0){
+            fprintf(stderr, "THREAD POOL: WARNING: cannot create thread, continuing with %zu workers\n", spawned);
+            break;
+        }
+    }
+
+    runTasks(&queue, 0);
+
+    for (size_t worker_index = 1; worker_index < spawned; worker_index++)
+        pthread_join(threads[worker_index], NULL);
+
+    free(threads);
+    free(args);
+}
+
+static void * workerMain(void * arg)
+{
+    worker_arg_t * worker_arg = (worker_arg_t *)arg;
+
+    runTasks(worker_arg->queue, worker_arg->worker_index);
+
+    return NULL;
+}
+
+static void runTasks(task_queue_t * queue, size_t worker_index)
+{
+    assert(queue);
+
+    size_t task_index = 0;
+
+    while ((task_index = __atomic_fetch_add(&queue->next_task, 1, __ATOMIC_RELAXED)) < queue->tasks_num)
+        queue->func(queue->shared, task_index, worker_index);
+}
+
+async_pool_t * asyncPoolStart(size_t workers_num)
+{
+    async_pool_t * pool = (async_pool_t *)calloc(1, sizeof(*pool));
+    pool->threads = (pthread_t *)calloc(workers_num, sizeof(*pool->threads));
+
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->cond, NULL);
+
+    for ( ; pool->threads_num < workers_num; pool->threads_num++){
+        if (pthread_create(pool->threads + pool->threads_num, NULL, asyncWorkerMain, pool) != 0){
+            fprintf(stderr, "THREAD POOL: WARNING: cannot create thread, continuing with %zu workers\n", pool->threads_num);
+            break;
+        }
+    }
+
+    if (pool->threads_num == 0){
+        asyncPoolFinish(pool);
+        return NULL;
+    }
+
+    return pool;
+}
+
+void asyncPoolPush(async_pool_t * pool, async_task_func_t func, void * arg)
+{
+    assert(pool);
+    assert(func);
+
+    async_task_t * task = (async_task_t *)calloc(1, sizeof(*task));
+    task->func = func;
+    task->arg  = arg;
+
+    pthread_mutex_lock(&pool->mutex);
+
+    if (pool->last == NULL)
+        pool->first = task;
+    else
+        pool->last->next = task;
+    pool->last = task;
+
+    pthread_cond_signal(&pool->cond);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+void asyncPoolFinish(async_pool_t * pool)
+{
+    if (pool == NULL)
+        return;
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (size_t thread_index = 0; thread_index < pool->threads_num; thread_index++)
+        pthread_join(pool->threads[thread_index], NULL);
+
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->cond);
+
+    free(pool->threads);
+    free(pool);
+}
+
+// workers leave only when the queue is empty, so finishing the pool runs every pushed task
+static void * asyncWorkerMain(void * arg)
+{
+    async_pool_t * pool = (async_pool_t *)arg;
+
+    pthread_mutex_lock(&pool->mutex);
+
+    while (1){
+        while (pool->first == NULL && !pool->stopping)
+            pthread_cond_wait(&pool->cond, &pool->mutex);
+
+        if (pool->first == NULL)
+            break;
+
+        async_task_t * task = pool->first;
+        pool->first = task->next;
+        if (pool->first == NULL)
+            pool->last = NULL;
+
+        pthread_mutex_unlock(&pool->mutex);
+
+        task->func(task->arg);
+        free(task);
+
+        pthread_mutex_lock(&pool->mutex);
+    }
+
+    pthread_mutex_unlock(&pool->mutex);
+
+    return NULL;
+}
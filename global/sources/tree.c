@@ -2,85 +2,172 @@
 #include <stdio.h>
 #include <assert.h>
 #include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include <spawn.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
 
 #include "tree.h"
+#include "node_stack.h"
 #include "logger.h"
+#include "thread_pool.h"
+
+extern char ** environ;
+
+const size_t GRAPH_RENDER_MAX_WORKERS = 4;
+const size_t GRAPH_MAX_FILE_NAME      = 256;
+const size_t GRAPH_DOT_ARG_SIZE       = 8;      //< -fstack-protector guards only functions with arrays of 8 bytes and more
+
+typedef struct {
+    char dot_file_name[GRAPH_MAX_FILE_NAME];
+    char img_file_name[GRAPH_MAX_FILE_NAME];
+} graph_render_t;
+
+static bool graph_dumps_enabled = false;
+static async_pool_t * graph_render_pool = NULL;
+
+static bool makeDirs(const char * path);
 
-void printTreePrefix(tree_context_t * tree, node_t * node)
+static bool fileNameFits(int name_len);
+
+static void renderGraph(void * arg);
+
+static void graphDumpsWaitAtExit();
+
+// states of the frames of iterative printing
+enum print_state {
+    PRINT_NODE,             // node is not printed yet
+    PRINT_AFTER_LEFT,       // left subtree of the operator is printed
+    PRINT_AFTER_RIGHT       // right subtree of the operator is printed
+};
+
+void printTreePrefix(tree_context_t * tree, node_t * root)
 {
     assert(tree);
 
-    if (node == NULL)
-        return;
+    node_stack_t stack = nodeStackCtor();
+    nodeStackPush(&stack, root, NULL, PRINT_NODE);
 
-    if (node->type == END){
-        printf("$\n");
-        return;
-    }
+    while (! nodeStackEmpty(&stack)){
+        node_frame_t frame = nodeStackPop(&stack);
+        node_t * node = frame.node;
 
-    if (node->type == NUM){
-        printf("%lg", node->val.number);
-        return;
-    }
+        if (frame.state == PRINT_AFTER_LEFT){
+            printf(")");
 
-    if (node->type == IDR){
-        printf("%s", tree->ids[node->val.id].name);
-        return;
-    }
+            if (opers[node->val.op].binary){
+                printf("(");
+                nodeStackPush(&stack, node, NULL, PRINT_AFTER_RIGHT);
+                nodeStackPush(&stack, node->right, NULL, PRINT_NODE);
+            }
+            else
+                printf(")");
 
-    oper_t oper = opers[node->val.op];
+            continue;
+        }
 
-    printf("(%s", oper.dot_name);
+        if (frame.state == PRINT_AFTER_RIGHT){
+            printf("))");
+            continue;
+        }
 
-    printf("(");
-    printTreePrefix(tree, node->left);
-    printf(")");
+        if (node == NULL)
+            continue;
 
-    if (oper.binary){
-        printf("(");
-        printTreePrefix(tree, node->right);
-        printf(")");
+        if (node->type == END){
+            printf("$\n");
+            continue;
+        }
+
+        if (node->type == NUM){
+            printf("%lg", node->val.number);
+            continue;
+        }
+
+        if (node->type == IDR){
+            printf("%s", tree->ids[node->val.id].name);
+            continue;
+        }
+
+        printf("(%s(", opers[node->val.op].dot_name);
+
+        nodeStackPush(&stack, node, NULL, PRINT_AFTER_LEFT);
+        nodeStackPush(&stack, node->left, NULL, PRINT_NODE);
     }
-    printf(")");
+
+    nodeStackDtor(&stack);
+}
+
+void treeGraphDumpsEnable(bool enable)
+{
+    graph_dumps_enabled = enable;
 }
 
 void treeDumpGraph(tree_context_t * tree, node_t * root_node, const char * log_folder)
 {
     assert(root_node);
 
+    if (!graph_dumps_enabled)
+        return;
+
     const int  IMG_WIDTH_IN_PERCENTS = 95;
     const int IMG_HEIGTH_IN_PERCENTS = 70;
 
     static size_t dump_count = 0;
 
-    const size_t MAX_FILE_NAME = 256;
-    char dot_file_name[MAX_FILE_NAME] = "";
-    char img_file_name[MAX_FILE_NAME] = "";
+    char dots_folder[GRAPH_MAX_FILE_NAME] = "";
+    char imgs_folder[GRAPH_MAX_FILE_NAME] = "";
 
-    char mkdir_dots_cmd[MAX_FILE_NAME] = "";
-    char mkdir_imgs_cmd[MAX_FILE_NAME] = "";
+    if (!fileNameFits(snprintf(dots_folder, GRAPH_MAX_FILE_NAME, "%s/dots", log_folder)) ||
+        !fileNameFits(snprintf(imgs_folder, GRAPH_MAX_FILE_NAME, "%s/imgs", log_folder)))
+        return;
 
-    sprintf(mkdir_dots_cmd, "mkdir -p %s/dots/", log_folder);
-    sprintf(mkdir_imgs_cmd, "mkdir -p %s/imgs/", log_folder);
+    if (!makeDirs(dots_folder) || !makeDirs(imgs_folder))
+        return;
 
-    system(mkdir_dots_cmd);
-    system(mkdir_imgs_cmd);
+    graph_render_t * render = (graph_render_t *)calloc(1, sizeof(*render));
 
-    sprintf(dot_file_name, "%s/dots/graph_%zu.dot", log_folder, dump_count);
-    sprintf(img_file_name, "%s/imgs/graph_%zu.svg", log_folder, dump_count);
+    if (!fileNameFits(snprintf(render->dot_file_name, GRAPH_MAX_FILE_NAME, "%s/graph_%zu.dot", dots_folder, dump_count)) ||
+        !fileNameFits(snprintf(render->img_file_name, GRAPH_MAX_FILE_NAME, "%s/graph_%zu.svg", imgs_folder, dump_count))){
+        logPrint(LOG_RELEASE, "graph dump: names of the files in '%s' are too long\n", log_folder);
+        free(render);
+        return;
+    }
 
-    FILE * dot_file = fopen(dot_file_name, "w");
+    FILE * dot_file = fopen(render->dot_file_name, "w");
+    if (dot_file == NULL){
+        logPrint(LOG_RELEASE, "graph dump: cannot open '%s'\n", render->dot_file_name);
+        free(render);
+        return;
+    }
     treeMakeDot(tree, root_node, dot_file);
     fclose(dot_file);
 
-    char sys_dot_cmd[MAX_FILE_NAME] = "";
-    sprintf(sys_dot_cmd, "dot %s -Tsvg -o %s", dot_file_name, img_file_name);
-    system(sys_dot_cmd);
+    if (graph_render_pool == NULL){
+        size_t workers_num = getCoresNum();
+        if (workers_num > GRAPH_RENDER_MAX_WORKERS)
+            workers_num = GRAPH_RENDER_MAX_WORKERS;
+
+        graph_render_pool = asyncPoolStart(workers_num);
 
-    char img_file_name_log[MAX_FILE_NAME] = "";
-    sprintf(img_file_name_log, "imgs/graph_%zu.svg", dump_count);
-    logPrint(LOG_DEBUG, "<img src = %s width = \"%d%%\" height = \"%d%%\">",
-                        img_file_name_log,
+        // registered after logStart, so the renders that log finish before logExit at exit
+        static bool atexit_registered = false;
+        if (graph_render_pool != NULL && !atexit_registered){
+            atexit(graphDumpsWaitAtExit);
+            atexit_registered = true;
+        }
+    }
+
+    if (graph_render_pool == NULL)
+        renderGraph(render);
+    else
+        asyncPoolPush(graph_render_pool, renderGraph, render);
+
+    logPrint(LOG_DEBUG, "<img src = imgs/graph_%zu.svg width = \"%d%%\" height = \"%d%%\">",
+                        dump_count,
                         IMG_WIDTH_IN_PERCENTS,
                         IMG_HEIGTH_IN_PERCENTS);
 
@@ -89,46 +176,109 @@ void treeDumpGraph(tree_context_t * tree, node_t * root_node, const char * log_f
     dump_count++;
 }
 
-static void nodeMakeDot(tree_context_t * tree, FILE * dot_file, node_t * node, node_t * parent);
+void treeGraphDumpsWait()
+{
+    asyncPoolFinish(graph_render_pool);
+    graph_render_pool = NULL;
+}
 
-void treeMakeDot(tree_context_t * tree, node_t * node, FILE * dot_file)
+static void graphDumpsWaitAtExit()
 {
-    assert(node);
-    assert(dot_file);
+    treeGraphDumpsWait();
+}
 
-    fprintf(dot_file, "digraph {\n");
-    fprintf(dot_file, "node [style=filled,color=\"#000000\"]\n");
+// mkdir -p without spawning a shell
+static bool makeDirs(const char * path)
+{
+    assert(path);
 
-    nodeMakeDot(tree, dot_file, node, NULL);
+    char cur_path[GRAPH_MAX_FILE_NAME] = "";
+    size_t path_len = strlen(path);
+    if (path_len >= GRAPH_MAX_FILE_NAME)
+        return false;
 
-    fprintf(dot_file, "}\n");
+    memcpy(cur_path, path, path_len);
+
+    for (size_t char_index = 1; char_index <= path_len; char_index++){
+        if (cur_path[char_index] != '/' && cur_path[char_index] != '\0')
+            continue;
+
+        char saved_char = cur_path[char_index];
+        cur_path[char_index] = '\0';
+
+        if (mkdir(cur_path, 0777) != 0 && errno != EEXIST){
+            logPrint(LOG_RELEASE, "graph dump: cannot create '%s': %s\n", cur_path, strerror(errno));
+            return false;
+        }
+
+        cur_path[char_index] = saved_char;
+    }
+
+    return true;
+}
+
+// a cut name would be another file, so the dump is skipped then
+static bool fileNameFits(int name_len)
+{
+    return name_len >= 0 && (size_t)name_len < GRAPH_MAX_FILE_NAME;
+}
+
+static void renderGraph(void * arg)
+{
+    graph_render_t * render = (graph_render_t *)arg;
+
+    char dot_name[GRAPH_DOT_ARG_SIZE]   = "dot";
+    char svg_option[GRAPH_DOT_ARG_SIZE] = "-Tsvg";
+    char out_option[GRAPH_DOT_ARG_SIZE] = "-o";
+    char * const dot_argv[] = {dot_name, render->dot_file_name, svg_option, out_option, render->img_file_name, NULL};
+
+    pid_t dot_pid = 0;
+    int spawn_error = posix_spawnp(&dot_pid, dot_name, NULL, NULL, dot_argv, environ);
+
+    if (spawn_error != 0)
+        logPrint(LOG_RELEASE, "graph dump: cannot run dot: %s\n", strerror(spawn_error));
+    else
+        waitpid(dot_pid, NULL, 0);
+
+    free(render);
 }
 
 static void dotPrintNode(tree_context_t * tree, FILE * dot_file, node_t * node);
 
-static void nodeMakeDot(tree_context_t * tree, FILE * dot_file, node_t * node, node_t * parent)
+void treeMakeDot(tree_context_t * tree, node_t * node, FILE * dot_file)
 {
     assert(node);
     assert(dot_file);
 
-    size_t node_num = (size_t)node;
+    fprintf(dot_file, "digraph {\n");
+    fprintf(dot_file, "node [style=filled,color=\"#000000\"]\n");
 
-    dotPrintNode(tree, dot_file, node);
+    node_stack_t stack = nodeStackCtor();
+    nodeStackPush(&stack, node, NULL, 0);
 
-    if (parent != NULL){
-        size_t node_parent_num = (size_t)(parent);
+    while (! nodeStackEmpty(&stack)){
+        node_t * cur_node = nodeStackPop(&stack).node;
+        size_t node_num = (size_t)cur_node;
 
-        if (node == parent->left)
-            fprintf(dot_file, "node_%zu:f0->node_%zu;\n", node_parent_num, node_num);
-        else
-            fprintf(dot_file, "node_%zu:f1->node_%zu;\n", node_parent_num, node_num);
+        dotPrintNode(tree, dot_file, cur_node);
+
+        if (cur_node->left != NULL)
+            fprintf(dot_file, "node_%zu:f0->node_%zu;\n", node_num, (size_t)cur_node->left);
+
+        if (cur_node->right != NULL)
+            fprintf(dot_file, "node_%zu:f1->node_%zu;\n", node_num, (size_t)cur_node->right);
+
+        // left subtree goes first
+        if (cur_node->right != NULL)
+            nodeStackPush(&stack, cur_node->right, NULL, 0);
+
+        if (cur_node->left != NULL)
+            nodeStackPush(&stack, cur_node->left, NULL, 0);
     }
 
-    if (node->left  != NULL)
-        nodeMakeDot(tree, dot_file, node->left, node);
+    nodeStackDtor(&stack);
 
-    if (node->right != NULL)
-        nodeMakeDot(tree, dot_file, node->right, node);
+    fprintf(dot_file, "}\n");
 }
 
 const uint32_t IDR_COLOR = 0xFFAAAAFF;
@@ -2,25 +2,34 @@
 #define MIDDLEEND_INCLUDED
 
 #include "tree.h"
-
-const size_t MAX_IDR_NUM = 128;
-const size_t MAX_NODES_NUM = 1024;
+#include "node_arena.h"
 
 typedef struct {
-    node_t * nodes;
-    node_t * free_node;
+    node_arena_t * arenas;      // one arena per worker, the first one also holds the read tree
+    size_t workers_num;
+
+    node_arena_t * arena;       // arena for newNode() of this context
 
     node_t * root;
 
     idr_t * ids;
     unsigned int id_size;
+
+    interner_t names;           // names of the ids read by middleendInit, ids given to the constructors keep the caller's
+
+    const bool * skip_statements;   // top-level statements that simplifyProgram leaves as they are, NULL - none
 } me_context_t;
 
-me_context_t middleendInit(const char * tree_file_name);
+me_context_t middleendInit(const char * tree_file_name, size_t workers_num);
+
+me_context_t middleendCtor(node_t * root, const idr_t * ids, unsigned int id_size, size_t workers_num);
+
+/// @brief takes the next tree, nodes of the previous one are freed but the arenas keep their first chunks, nothing is skipped
+void middleendReset(me_context_t * me, node_t * root, const idr_t * ids, unsigned int id_size);
 
 void middleendDestroy(me_context_t * me);
 
-void middleendRun(const char * tree_file_name);
+void middleendRun(const char * tree_file_name, const char * out_file_name, size_t workers_num);
 
 node_t * newNode(me_context_t * context, enum elem_type type, union value val, node_t * left, node_t * right);
 
@@ -34,4 +43,6 @@ node_t * deleteNeutral(me_context_t * me, node_t * node, bool * changed_tree);
 
 node_t * simplifyExpression(me_context_t * me, node_t * node);
 
+node_t * simplifyProgram(me_context_t * me, node_t * root);
+
 #endif
@@ -1,16 +1,39 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "middleend.h"
+#include "thread_pool.h"
 
+// ARGS
+// [-j threads_num] - number of worker threads (number of cores by default)
+// [tree file name]
+// [output file name] - tree file is overwritten by default, .astb extension means binary IR
 int main(int argc, char ** argv)
 {
     const char * tree_file_name = "out.ast";
+    const char * out_file_name  = NULL;
+    size_t threads_num = getCoresNum();
 
-    if (argc > 1)
-        tree_file_name = argv[1];
+    int arg_index = 1;
 
-    middleendRun(tree_file_name);
+    if (argc > arg_index + 1 && strcmp(argv[arg_index], "-j") == 0){
+        threads_num = strtoul(argv[arg_index + 1], NULL, 10);
+        if (threads_num == 0)
+            threads_num = 1;
+
+        arg_index += 2;
+    }
+
+    if (argc > arg_index)
+        tree_file_name = argv[arg_index];
+
+    if (argc > arg_index + 1)
+        out_file_name = argv[arg_index + 1];
+    else
+        out_file_name = tree_file_name;
+
+    middleendRun(tree_file_name, out_file_name, threads_num);
 
     return 0;
 }
@@ -2,62 +2,118 @@
 #include <stdio.h>
 #include <assert.h>
 #include <math.h>
+#include <string.h>
 
 #include "tree.h"
 #include "IR_handler.h"
 #include "middleend.h"
+#include "node_stack.h"
+#include "thread_pool.h"
 #include "logger.h"
 
 static double calcOper(enum oper op_num, double left_val, double right_val);
 
+static node_t * foldConstantsInNode(me_context_t * me, node_t * node, bool * changed_tree);
+
 static node_t * delNeutralInCommutatives(me_context_t * me, node_t * node, bool * changed_tree);
 
 static node_t * delNeutralInNonCommutatives(me_context_t * me, node_t * node, bool * changed_tree);
 
-me_context_t middleendInit(const char * tree_file_name)
+static void simplifyStatementTask(void * shared, size_t task_index, size_t worker_index);
+
+static me_context_t middleendArenasCtor(size_t workers_num);
+
+static me_context_t middleendArenasCtor(size_t workers_num)
 {
+    assert(workers_num > 0);
+
     me_context_t context = {};
 
-    context.nodes = (node_t *)calloc(MAX_NODES_NUM, sizeof(*context.nodes));
+    context.workers_num = workers_num;
+    context.arenas = (node_arena_t *)calloc(workers_num, sizeof(*context.arenas));
+
+    for (size_t worker_index = 0; worker_index < workers_num; worker_index++)
+        context.arenas[worker_index] = nodeArenaCtor();
+
+    context.arena = context.arenas;
+
+    return context;
+}
+
+me_context_t middleendInit(const char * tree_file_name, size_t workers_num)
+{
+    me_context_t context = middleendArenasCtor(workers_num);
 
     tree_context_t tree = {};
-    tree.cur_node = context.nodes;
+    tree.arena = context.arenas;
     tree.id_size = 0;
     tree.ids = context.ids;
 
     context.root = readTreeFromIR(&tree, tree_file_name);
     context.id_size = tree.id_size;
     context.ids     = tree.ids;
+    context.names   = tree.names;
+
+    return context;
+}
+
+// the tree stays where it is (new nodes go to the arenas of the context), the ids are copied
+// but their names stay in the interner of the caller
+me_context_t middleendCtor(node_t * root, const idr_t * ids, unsigned int id_size, size_t workers_num)
+{
+    assert(ids || id_size == 0);
+
+    me_context_t context = middleendArenasCtor(workers_num);
+
+    context.root = root;
 
-    context.free_node = tree.cur_node + 1;
+    context.id_size = id_size;
+    context.ids = (idr_t *)calloc(id_size + 1, sizeof(idr_t));
+    if (id_size > 0)
+        memcpy(context.ids, ids, id_size * sizeof(idr_t));
 
     return context;
 }
 
-void middleendRun(const char * tree_file_name)
+void middleendReset(me_context_t * me, node_t * root, const idr_t * ids, unsigned int id_size)
 {
-    me_context_t context = middleendInit(tree_file_name);
+    assert(me);
+    assert(ids || id_size == 0);
 
-    context.root = simplifyExpression(&context, context.root);
+    for (size_t worker_index = 0; worker_index < me->workers_num; worker_index++)
+        nodeArenaReset(me->arenas + worker_index);
 
-    FILE * tree_file = fopen(tree_file_name, "w");
+    me->arena = me->arenas;
+    me->root = root;
+
+    me->skip_statements = NULL;
+
+    free(me->ids);
+
+    me->id_size = id_size;
+    me->ids = (idr_t *)calloc(id_size + 1, sizeof(idr_t));
+    if (id_size > 0)
+        memcpy(me->ids, ids, id_size * sizeof(idr_t));
+}
+
+void middleendRun(const char * tree_file_name, const char * out_file_name, size_t workers_num)
+{
+    me_context_t context = middleendInit(tree_file_name, workers_num);
+
+    context.root = simplifyProgram(&context, context.root);
 
     tree_context_t ir_context = {};
-    ir_context.cur_node = context.root;
     ir_context.id_size  = context.id_size;
     ir_context.ids      = context.ids;
 
-    writeTreeToFile(&ir_context, context.root, tree_file);
-
-    fclose(tree_file);
+    writeTreeToFile(&ir_context, context.root, out_file_name);
 
     middleendDestroy(&context);
 }
 
 node_t * newNode(me_context_t * context, enum elem_type type, union value val, node_t * left, node_t * right)
 {
-    node_t * node = context->free_node;
-    context->free_node++;
+    node_t * node = nodeArenaAlloc(context->arena);
 
     node->type = type;
     node->val = val;
@@ -86,11 +142,72 @@ node_t * newNumNode(me_context_t * context, double number)
 
 void middleendDestroy(me_context_t * me)
 {
-    free(me->nodes);
     free(me->ids);
+    internerDtor(&me->names);
+
+    for (size_t worker_index = 0; worker_index < me->workers_num; worker_index++)
+        nodeArenaDtor(me->arenas + worker_index);
+
+    free(me->arenas);
+
+    me->ids    = NULL;
+    me->arenas = NULL;
+    me->arena  = NULL;
+}
+
+typedef struct {
+    me_context_t * me;
+    node_t ** seps;             // SEP nodes of the top-level chain
+} simplify_tasks_t;
+
+// top-level statements (function declarations first of all) do not depend on each other,
+// so every one of them is simplified by its own task, each worker allocating in its own arena
+node_t * simplifyProgram(me_context_t * me, node_t * root)
+{
+    assert(me);
+    assert(root);
+
+    if (!(root->type == OPR && root->val.op == SEP))
+        return simplifyExpression(me, root);
 
-    me->nodes = NULL;
-    me->ids   = NULL;
+    size_t seps_num = 0;
+    for (node_t * sep = root; sep != NULL; sep = sep->right)
+        seps_num++;
+
+    simplify_tasks_t tasks = {
+        .me = me,
+        .seps = (node_t **)calloc(seps_num, sizeof(node_t *))
+    };
+
+    size_t sep_index = 0;
+    for (node_t * sep = root; sep != NULL; sep = sep->right)
+        tasks.seps[sep_index++] = sep;
+
+    logPrint(LOG_DEBUG, "simplifying %zu top-level statements on %zu workers\n", seps_num, me->workers_num);
+
+    parallelFor(seps_num, me->workers_num, simplifyStatementTask, &tasks);
+
+    free(tasks.seps);
+
+    return root;
+}
+
+static void simplifyStatementTask(void * shared, size_t task_index, size_t worker_index)
+{
+    simplify_tasks_t * tasks = (simplify_tasks_t *)shared;
+
+    node_t * sep = tasks->seps[task_index];
+    if (sep->left == NULL)
+        return;
+
+    if (tasks->me->skip_statements != NULL && tasks->me->skip_statements[task_index])
+        return;
+
+    // results of each task are written only to its own SEP, so the tree does not depend on scheduling
+    me_context_t worker_me = *(tasks->me);
+    worker_me.arena = tasks->me->arenas + worker_index;
+
+    sep->left = simplifyExpression(&worker_me, sep->left);
 }
 
 node_t * simplifyExpression(me_context_t * me, node_t * node)
@@ -108,21 +225,47 @@ node_t * simplifyExpression(me_context_t * me, node_t * node)
     return node;
 }
 
+// states of the frames of simplifying traversals
+enum simplify_state {
+    SIMPLIFY_ENTER,         // children of the node are not simplified yet
+    SIMPLIFY_EXIT           // children are simplified, the node itself is simplified now
+};
+
 node_t * foldConstants(me_context_t * me, node_t * node, bool * changed_tree)
 {
-    if (node == NULL)
-        return NULL;
+    node_t * root = node;
 
-    if (node->type == VAR)
-        return node;
+    node_stack_t stack = nodeStackCtor();
+    nodeStackPush(&stack, root, &root, SIMPLIFY_ENTER);
 
-    if (node->type == NUM)
-        return node;
+    while (! nodeStackEmpty(&stack)){
+        node_frame_t frame = nodeStackPop(&stack);
+        node_t * cur_node = frame.node;
 
-    enum oper op_num = node->val.op;
+        if (frame.state == SIMPLIFY_EXIT){
+            *frame.slot = foldConstantsInNode(me, cur_node, changed_tree);
+            continue;
+        }
 
-    node->left  = foldConstants(me, node->left , changed_tree);
-    node->right = foldConstants(me, node->right, changed_tree);
+        if (cur_node == NULL || cur_node->type == IDR || cur_node->type == NUM)
+            continue;
+
+        // left subtree first, result of every node replaces it in the parent
+        nodeStackPush(&stack, cur_node, frame.slot, SIMPLIFY_EXIT);
+        nodeStackPush(&stack, cur_node->right, &cur_node->right, SIMPLIFY_ENTER);
+        nodeStackPush(&stack, cur_node->left,  &cur_node->left,  SIMPLIFY_ENTER);
+    }
+
+    nodeStackDtor(&stack);
+
+    return root;
+}
+
+static node_t * foldConstantsInNode(me_context_t * me, node_t * node, bool * changed_tree)
+{
+    assert(node);
+
+    enum oper op_num = node->val.op;
 
     if (op_num == NO_OP || ! opers[op_num].can_simple)
         return node;
@@ -218,22 +361,35 @@ static double calcOper(enum oper op_num, double left_val, double right_val)
 
 node_t * deleteNeutral(me_context_t * me, node_t * node, bool * changed_tree)
 {
-    if (node == NULL)
-        return NULL;
+    node_t * root = node;
 
-    if (node->type != OPR)
-        return node;
+    node_stack_t stack = nodeStackCtor();
+    nodeStackPush(&stack, root, &root, SIMPLIFY_ENTER);
 
-    if (node->val.op == NO_OP)
-        return node;
+    while (! nodeStackEmpty(&stack)){
+        node_frame_t frame = nodeStackPop(&stack);
+        node_t * cur_node = frame.node;
+
+        if (frame.state == SIMPLIFY_EXIT){
+            if (opers[cur_node->val.op].commutative)
+                *frame.slot = delNeutralInCommutatives(me, cur_node, changed_tree);
+            else
+                *frame.slot = delNeutralInNonCommutatives(me, cur_node, changed_tree);
 
-    node->left  = deleteNeutral(me, node->left,  changed_tree);
-    node->right = deleteNeutral(me, node->right, changed_tree);
+            continue;
+        }
+
+        if (cur_node == NULL || cur_node->type != OPR || cur_node->val.op == NO_OP)
+            continue;
+
+        nodeStackPush(&stack, cur_node, frame.slot, SIMPLIFY_EXIT);
+        nodeStackPush(&stack, cur_node->right, &cur_node->right, SIMPLIFY_ENTER);
+        nodeStackPush(&stack, cur_node->left,  &cur_node->left,  SIMPLIFY_ENTER);
+    }
 
-    if (opers[node->val.op].commutative)
-        return delNeutralInCommutatives(me, node, changed_tree);
+    nodeStackDtor(&stack);
 
-    return delNeutralInNonCommutatives(me, node, changed_tree);
+    return root;
 }
 
 